@@ -0,0 +1,55 @@
+/***********************************************************************
+* Benchmark firmware marker protocol                                   *
+* Purpose: Bracket driver calls with GPIOR writes the simulator        *
+*          harness in bench/sim timestamps to the exact cycle          *
+*                                                                      *
+* GPIOR1 holds the probe id, a write to GPIOR0 opens or closes it and  *
+* GPIOR2 streams the probe name once. The GPIOR registers are plain    *
+* storage on the chip, so the markers cost one OUT each and touch no   *
+* peripheral. Probe 0 is an empty body the harness subtracts.          *
+***********************************************************************/
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <stdint.h>
+
+#define BENCH_BEGIN 0x01
+#define BENCH_END   0x02
+#define BENCH_DONE  0xFF
+
+#define BENCH_EMPTY 0       /*Marker overhead, subtracted from every probe*/
+#define BENCH_RUNS  16      /*Runs of each probe, the table reports min/max/mean*/
+
+static inline void bench_name(uint8_t id, const char* name) {
+    GPIOR1 = id;
+    while (*name) GPIOR2 = *name++;
+    GPIOR2 = '\0';
+}
+
+#define BENCH(id, body) do { \
+    GPIOR1 = (id); \
+    GPIOR0 = BENCH_BEGIN; \
+    body; \
+    GPIOR0 = BENCH_END; \
+} while (0)
+
+// Calibrate the markers, every image runs this first
+static inline void bench_calibrate(void) {
+    uint8_t n;
+
+    bench_name(BENCH_EMPTY, "empty");
+    for (n = 0; n < BENCH_RUNS; n++) BENCH(BENCH_EMPTY, );
+}
+
+// Sleeping with interrupts off halts the simulator as well
+static inline void bench_done(void) {
+    GPIOR0 = BENCH_DONE;
+    cli();
+    for (;;) sleep_cpu();
+}
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,31 @@
+/***********************************************************************
+* ADC benchmark image                                                  *
+* Same setup as main.c, the harness drives ADC3 with a fixed voltage   *
+***********************************************************************/
+
+#include "bench.h"
+#include "pwr.h"
+#include "systick.h"
+#include "adc.h"
+
+#define P_READ    1
+
+void main(void) {
+    uint16_t v;
+    uint8_t n;
+
+    bench_calibrate();
+    pwr_init();
+    systick_init();
+    sei();
+
+    pwr_acquire(PWR_ADC);
+    ADMUX = (1 << REFS0);
+    ADCSRA = ADCPSC_VAL;
+    pwr_release(PWR_ADC);
+
+    bench_name(P_READ, "adc_read");
+    for (n = 0; n < BENCH_RUNS; n++) BENCH(P_READ, adc_read(ADC3, &v));
+
+    bench_done();
+}
@@ -0,0 +1,67 @@
+/***********************************************************************
+* Fixed point against soft float benchmark image                       *
+* Each pair does the same job, the fixed point version first. The      *
+* operands are volatile so nothing folds at compile time.              *
+***********************************************************************/
+
+#include "bench.h"
+#include "fix.h"
+#include <math.h>
+
+#define P_Q8_MUL    1
+#define P_Q16_MUL   2
+#define P_F_MUL     3
+#define P_UDIV      4
+#define P_DIV       5
+#define P_F_DIV     6
+#define P_ISQRT     7
+#define P_SQRTF     8
+#define P_SIN       9
+#define P_SINF      10
+#define P_LOG2      11
+#define P_LOGF      12
+
+static volatile q8_8_t qa = Q8_8(1.7), qb = Q8_8(-2.3);
+static volatile q16_16_t la = Q16_16(12.34), lb = Q16_16(-5.67);
+static volatile float fa = 1.7f, fb = -2.3f;
+static volatile uint16_t u = 54321;
+static volatile uint32_t w = 123456789UL;
+static volatile uint8_t ang = 77;
+
+static volatile int32_t sink;
+static volatile float fsink;
+
+void main(void) {
+    uint8_t n;
+
+    bench_calibrate();
+
+    bench_name(P_Q8_MUL, "q8_mul");
+    bench_name(P_Q16_MUL, "q16_mul");
+    bench_name(P_F_MUL, "float mul");
+    bench_name(P_UDIV, "fix_udiv /10");
+    bench_name(P_DIV, "uint16 /10");
+    bench_name(P_F_DIV, "float /10");
+    bench_name(P_ISQRT, "fix_isqrt");
+    bench_name(P_SQRTF, "sqrtf");
+    bench_name(P_SIN, "fix_sin");
+    bench_name(P_SINF, "sinf");
+    bench_name(P_LOG2, "fix_log2");
+    bench_name(P_LOGF, "logf * log2(e)");
+    for (n = 0; n < BENCH_RUNS; n++) {
+        BENCH(P_Q8_MUL, sink = q8_mul(qa, qb));
+        BENCH(P_Q16_MUL, sink = q16_mul(la, lb));
+        BENCH(P_F_MUL, fsink = fa * fb);
+        BENCH(P_UDIV, sink = fix_udiv(u, 10));
+        BENCH(P_DIV, sink = u / 10);
+        BENCH(P_F_DIV, fsink = fa / 10.0f);
+        BENCH(P_ISQRT, sink = fix_isqrt(w));
+        BENCH(P_SQRTF, fsink = sqrtf(w));
+        BENCH(P_SIN, sink = fix_sin(ang));
+        BENCH(P_SINF, fsink = sinf(ang * (float)(2 * M_PI / 256)));
+        BENCH(P_LOG2, sink = fix_log2(w));
+        BENCH(P_LOGF, fsink = logf(w) * (float)M_LOG2E);
+    }
+
+    bench_done();
+}
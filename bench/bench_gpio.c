@@ -0,0 +1,33 @@
+/***********************************************************************
+* GPIO benchmark image                                                 *
+***********************************************************************/
+
+#include "bench.h"
+#include "gpio.h"
+
+#define P_PIN_HIGH  1
+#define P_PIN_LOW   2
+#define P_PIN_READ  3
+#define P_PORT      4
+
+void main(void) {
+    uint8_t n;
+    bit_t v;
+
+    bench_calibrate();
+    gpio_pin_init(GPIO_D, DIR_OUTPUT, 5);
+    gpio_port_init(GPIO_B, DIR_OUTPUT, 0x3D);
+
+    bench_name(P_PIN_HIGH, "gpio_pin_write high");
+    bench_name(P_PIN_LOW, "gpio_pin_write low");
+    bench_name(P_PIN_READ, "gpio_pin_read");
+    bench_name(P_PORT, "gpio_port_write");
+    for (n = 0; n < BENCH_RUNS; n++) {
+        BENCH(P_PIN_HIGH, gpio_pin_write(GPIO_D, 5, HIGH));
+        BENCH(P_PIN_LOW, gpio_pin_write(GPIO_D, 5, LOW));
+        BENCH(P_PIN_READ, gpio_pin_read(GPIO_D, 5, &v));
+        BENCH(P_PORT, gpio_port_write(GPIO_B, n, 0x3D));
+    }
+
+    bench_done();
+}
@@ -0,0 +1,43 @@
+/***********************************************************************
+* SPI benchmark image, nothing attached so MISO reads 0xFF             *
+* The queued transfer pays the vector per byte, the burst only the     *
+* polling loop, both at SPI_DIV2                                       *
+***********************************************************************/
+
+#include "bench.h"
+#include "pwr.h"
+#include "systick.h"
+#include "spi.h"
+
+#define P_BYTE      1
+#define P_XFER      2
+#define P_BURST     3
+#define P_BURST_RX  4
+
+static const spi_dev_t dev = SPI_DEV(GPIO_B, PORTB2, SPI_MODE0, SPI_DIV2, SPI_MSB_FIRST);
+static uint8_t block[256];
+
+void main(void) {
+    uint8_t b = 0;
+    uint8_t n;
+
+    bench_calibrate();
+    pwr_init();
+    systick_init();
+    sei();
+    spi_init();
+    spi_dev_init(&dev);
+
+    bench_name(P_BYTE, "spi_transfer 1");
+    bench_name(P_XFER, "spi_transfer 256 @8M");
+    bench_name(P_BURST, "spi_burst 256 @8M");
+    bench_name(P_BURST_RX, "spi_burst 256 rx @8M");
+    for (n = 0; n < BENCH_RUNS; n++) {
+        BENCH(P_BYTE, spi_transfer(&dev, &b, &b, 1));
+        BENCH(P_XFER, spi_transfer(&dev, block, NULL, sizeof(block)));
+        BENCH(P_BURST, spi_burst(&dev, block, NULL, sizeof(block)));
+        BENCH(P_BURST_RX, spi_burst(&dev, NULL, block, sizeof(block)));
+    }
+
+    bench_done();
+}
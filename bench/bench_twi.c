@@ -0,0 +1,36 @@
+/***********************************************************************
+* TWI benchmark image, run against the harness DS3231 at 0x68          *
+***********************************************************************/
+
+#include "bench.h"
+#include "pwr.h"
+#include "systick.h"
+#include "twi_hal.h"
+
+#define RTC_ADDR 0x68
+
+#define P_WRITE   1
+#define P_READ    2
+#define P_READ1   3
+
+void main(void) {
+    uint8_t rtc[7] = {0x50, 0x46, 0x20, 0x07, 0x16, 0x07, 0x23};
+    uint8_t n;
+
+    bench_calibrate();
+    pwr_init();
+    systick_init();
+    sei();
+    twi_init(false);
+
+    bench_name(P_WRITE, "twi_write 7 @400k");
+    bench_name(P_READ, "twi_read 7 @400k");
+    bench_name(P_READ1, "twi_read 1 @400k");
+    for (n = 0; n < BENCH_RUNS; n++) {
+        BENCH(P_WRITE, twi_write(RTC_ADDR, 0x00, rtc, sizeof(rtc)));
+        BENCH(P_READ, twi_read(RTC_ADDR, 0x00, rtc, sizeof(rtc)));
+        BENCH(P_READ1, twi_read(RTC_ADDR, 0x00, rtc, 1));
+    }
+
+    bench_done();
+}
@@ -0,0 +1,35 @@
+/***********************************************************************
+* UART benchmark image                                                 *
+* Queueing a string only costs the ring copy while there is room, the  *
+* flush probe is the wire time at the driver baud rate                 *
+***********************************************************************/
+
+#include "bench.h"
+#include "pwr.h"
+#include "systick.h"
+#include "uart.h"
+
+#define P_BYTE    1
+#define P_STRING  2
+#define P_FLUSH   3
+
+void main(void) {
+    uint8_t n;
+
+    bench_calibrate();
+    pwr_init();
+    systick_init();
+    sei();
+    uart_init(TX, false, NONE);
+
+    bench_name(P_BYTE, "uart_transmit_byte");
+    bench_name(P_STRING, "uart_transmit_string 16");
+    bench_name(P_FLUSH, "uart_flush 17");
+    for (n = 0; n < BENCH_RUNS; n++) {
+        BENCH(P_BYTE, uart_transmit_byte('>'));
+        BENCH(P_STRING, uart_transmit_string((unsigned char*)"0123456789abcdef"));
+        BENCH(P_FLUSH, uart_flush());
+    }
+
+    bench_done();
+}
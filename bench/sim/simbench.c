@@ -0,0 +1,295 @@
+/***********************************************************************
+* simavr benchmark harness                                             *
+* Purpose: Run one bench/ firmware image to BENCH_DONE and print its   *
+*          probe cycle counts and interrupt latencies as CSV rows      *
+*                                                                      *
+* Usage: simbench <image.elf>                                          *
+* Rows: kind,image,name,count,min,max,mean,bytes with kind "cycles"    *
+* for marker probes and "isr" for pending-to-vector latency. The       *
+* makefile adds the "flash" and "sram" rows from avr-nm.               *
+*                                                                      *
+* The harness also attaches a DS3231 register file at 0x68 to the TWI  *
+* pins and holds ADC3 at BENCH_ADC3_MV, images that do not use them    *
+* never notice.                                                        *
+***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <libgen.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "sim_irq.h"
+#include "sim_interrupts.h"
+#include "avr_twi.h"
+#include "avr_adc.h"
+#include "avr_uart.h"
+
+#define BENCH_MCU      "atmega328p"
+#define BENCH_F_CPU    16000000UL
+#define BENCH_LIMIT    (10UL * BENCH_F_CPU)    /*Cycles before a run counts as hung*/
+#define BENCH_ADC3_MV  1250
+
+/*Must match bench/bench.h*/
+#define BENCH_BEGIN 0x01
+#define BENCH_END   0x02
+#define BENCH_DONE  0xFF
+#define BENCH_EMPTY 0
+
+/*Data space addresses of the marker registers*/
+#define ADDR_GPIOR0 0x3E
+#define ADDR_GPIOR1 0x4A
+#define ADDR_GPIOR2 0x4B
+
+#define NAME_LEN 32
+
+typedef struct bench_stat {
+    uint32_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+} stat_t;
+
+typedef struct probe {
+    char name[NAME_LEN];
+    uint8_t name_len;
+    uint64_t start;
+    stat_t st;
+} probe_t;
+
+typedef struct vector {
+    uint8_t num;
+    const char* name;
+    uint64_t pending;
+    stat_t st;
+} vector_t;
+
+static probe_t probes[256];
+static bool done;
+
+static vector_t vectors[] = {
+    {14, "TIMER0_COMPA"},
+    {17, "SPI_STC"},
+    {18, "USART_RX"},
+    {19, "USART_UDRE"},
+    {20, "USART_TX"},
+    {21, "ADC"},
+    {24, "TWI"},
+};
+#define VECTOR_COUNT (sizeof(vectors) / sizeof(vectors[0]))
+
+static void stat_add(stat_t* s, uint64_t v) {
+    if (s->count == 0 || v < s->min) s->min = v;
+    if (v > s->max) s->max = v;
+    s->sum += v;
+    s->count++;
+}
+
+/***********************************************************************
+* Marker registers                                                     *
+***********************************************************************/
+
+static void gpior0_write(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+    probe_t* p = &probes[avr->data[ADDR_GPIOR1]];
+
+    avr->data[addr] = v;
+    switch (v) {
+        case BENCH_BEGIN:
+            p->start = avr->cycle;
+            break;
+        case BENCH_END:
+            stat_add(&p->st, avr->cycle - p->start);
+            break;
+        case BENCH_DONE:
+            done = true;
+            break;
+    }
+}
+
+static void gpior2_write(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+    probe_t* p = &probes[avr->data[ADDR_GPIOR1]];
+
+    avr->data[addr] = v;
+    if (v == '\0') return;
+    if (p->name_len < NAME_LEN - 1) p->name[p->name_len++] = (char)v;
+}
+
+/***********************************************************************
+* Interrupt latency, flag raised to first vector instruction           *
+***********************************************************************/
+
+static avr_t* bench_avr;
+
+static void vector_pending_hook(avr_irq_t* irq, uint32_t value, void* param) {
+    vector_t* vec = param;
+
+    if (value) vec->pending = bench_avr->cycle;
+}
+
+static void vector_running_hook(avr_irq_t* irq, uint32_t value, void* param) {
+    vector_t* vec = param;
+
+    if (value && vec->pending) {
+        stat_add(&vec->st, bench_avr->cycle - vec->pending);
+        vec->pending = 0;
+    }
+}
+
+/***********************************************************************
+* DS3231 shaped slave, register pointer then auto-incrementing data    *
+***********************************************************************/
+
+typedef struct ds3231 {
+    avr_irq_t* irq;
+    uint8_t addr;           /*8 bit SLA, R/W bit clear*/
+    uint8_t selected;
+    uint8_t index;
+    uint8_t ptr;
+    uint8_t reg[0x13];
+} ds3231_t;
+
+static const char* ds3231_irq_names[2] = {
+    [TWI_IRQ_INPUT] = "8>ds3231.in",
+    [TWI_IRQ_OUTPUT] = "32<ds3231.out",
+};
+
+static void ds3231_hook(avr_irq_t* irq, uint32_t value, void* param) {
+    ds3231_t* p = param;
+    avr_twi_msg_irq_t v;
+
+    v.u.v = value;
+    if (v.u.twi.msg & TWI_COND_STOP) p->selected = 0;
+
+    if (v.u.twi.msg & TWI_COND_START) {
+        p->selected = 0;
+        p->index = 0;
+        if ((v.u.twi.addr & 0xFE) == p->addr) {
+            p->selected = v.u.twi.addr;
+            avr_raise_irq(p->irq + TWI_IRQ_INPUT,
+                avr_twi_irq_msg(TWI_COND_ACK, p->selected, 1));
+        }
+    }
+    if (!p->selected) return;
+
+    if (v.u.twi.msg & TWI_COND_WRITE) {
+        avr_raise_irq(p->irq + TWI_IRQ_INPUT,
+            avr_twi_irq_msg(TWI_COND_ACK, p->selected, 1));
+        if (p->index++ == 0) p->ptr = v.u.twi.data;
+        else p->reg[p->ptr++ % sizeof(p->reg)] = v.u.twi.data;
+    }
+    if (v.u.twi.msg & TWI_COND_READ) {
+        avr_raise_irq(p->irq + TWI_IRQ_INPUT,
+            avr_twi_irq_msg(TWI_COND_READ, p->selected, p->reg[p->ptr++ % sizeof(p->reg)]));
+    }
+}
+
+static void ds3231_attach(avr_t* avr, ds3231_t* p, uint8_t addr) {
+    memset(p, 0, sizeof(*p));
+    p->addr = addr << 1;
+    p->irq = avr_alloc_irq(&avr->irq_pool, 0, 2, ds3231_irq_names);
+    avr_irq_register_notify(p->irq + TWI_IRQ_OUTPUT, ds3231_hook, p);
+
+    avr_connect_irq(p->irq + TWI_IRQ_INPUT,
+        avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+    avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+        p->irq + TWI_IRQ_OUTPUT);
+}
+
+/***********************************************************************
+* Run and report                                                       *
+***********************************************************************/
+
+static void print_row(const char* kind, const char* image, const char* name, const stat_t* s, uint64_t sub) {
+    uint64_t min = s->min > sub ? s->min - sub : 0;
+    uint64_t max = s->max > sub ? s->max - sub : 0;
+    uint64_t mean = s->sum / s->count;
+
+    mean = mean > sub ? mean - sub : 0;
+    printf("%s,%s,%s,%u,%llu,%llu,%llu,\n", kind, image, name, s->count,
+        (unsigned long long)min, (unsigned long long)max, (unsigned long long)mean);
+}
+
+int main(int argc, char** argv) {
+    elf_firmware_t fw;
+    static ds3231_t rtc;
+    avr_t* avr;
+    char path[256];
+    char* image;
+    char* dot;
+    uint64_t empty;
+    uint32_t flags = 0;
+    unsigned i;
+    int state;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <image.elf>\n", argv[0]);
+        return 1;
+    }
+    // Image name for the table, argv[1] stays intact for the loader
+    snprintf(path, sizeof(path), "%s", argv[1]);
+    image = basename(path);
+    dot = strrchr(image, '.');
+    if (dot) *dot = '\0';
+
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(argv[1], &fw) != 0) {
+        fprintf(stderr, "%s: cannot load %s\n", argv[0], argv[1]);
+        return 1;
+    }
+    if (!fw.mmcu[0]) strcpy(fw.mmcu, BENCH_MCU);
+    if (!fw.frequency) fw.frequency = BENCH_F_CPU;
+
+    avr = avr_make_mcu_by_name(fw.mmcu);
+    if (!avr) {
+        fprintf(stderr, "%s: unknown mcu %s\n", argv[0], fw.mmcu);
+        return 1;
+    }
+    bench_avr = avr;
+    avr_init(avr);
+    avr_load_firmware(avr, &fw);
+    avr->vcc = avr->avcc = avr->aref = 5000;
+    avr->log = LOG_NONE;
+
+    avr_register_io_write(avr, ADDR_GPIOR0, gpior0_write, NULL);
+    avr_register_io_write(avr, ADDR_GPIOR2, gpior2_write, NULL);
+
+    for (i = 0; i < VECTOR_COUNT; i++) {
+        avr_irq_t* irq = avr_get_interrupt_irq(avr, vectors[i].num);
+
+        avr_irq_register_notify(irq + AVR_INT_IRQ_PENDING, vector_pending_hook, &vectors[i]);
+        avr_irq_register_notify(irq + AVR_INT_IRQ_RUNNING, vector_running_hook, &vectors[i]);
+    }
+
+    ds3231_attach(avr, &rtc, 0x68);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC3), BENCH_ADC3_MV);
+
+    // Keep the UART off stdout, the table is the only output
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+
+    do {
+        state = avr_run(avr);
+    } while (!done && state != cpu_Done && state != cpu_Crashed && avr->cycle < BENCH_LIMIT);
+
+    if (!done) {
+        fprintf(stderr, "%s: %s stopped at cycle %llu without BENCH_DONE\n",
+            argv[0], image, (unsigned long long)avr->cycle);
+        return 2;
+    }
+
+    empty = probes[BENCH_EMPTY].st.count ? probes[BENCH_EMPTY].st.min : 0;
+    for (i = 0; i < 256; i++) {
+        if (i == BENCH_EMPTY || probes[i].st.count == 0) continue;
+        print_row("cycles", image, probes[i].name, &probes[i].st, empty);
+    }
+    for (i = 0; i < VECTOR_COUNT; i++) {
+        if (vectors[i].st.count == 0) continue;
+        print_row("isr", image, vectors[i].name, &vectors[i].st, 0);
+    }
+    return 0;
+}
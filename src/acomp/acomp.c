@@ -0,0 +1,150 @@
+/***********************************************************************
+* Analog comparator driver                                             *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Catch threshold crossings within a microsecond and hand     *
+*          them to an event queue, an ADC conversion or a Timer1       *
+*          input capture without polling                               *
+***********************************************************************/
+
+#include "acomp.h"
+#include "pwr.h"
+#include "systick.h"
+#include "counter.h"
+#include "irq.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
+
+#define ACOMP_MASK (ACOMP_QUEUE_SIZE - 1)
+
+_Static_assert((ACOMP_QUEUE_SIZE & ACOMP_MASK) == 0 && ACOMP_QUEUE_SIZE <= 256,
+               "ACOMP_QUEUE_SIZE must be a power of two up to 256");
+
+static acomp_event_t acomp_queue[ACOMP_QUEUE_SIZE];
+static volatile uint8_t acomp_head = 0;
+static volatile uint8_t acomp_tail = 0;
+static void (*acomp_cb)(bool high) = 0;
+static volatile bool acomp_cb_high;     /*Level for the callback's next run*/
+static bool acomp_on = false;
+static uint8_t acomp_didr0 = 0;        /*DIDR0 bit acomp_init() turned on*/
+static acomp_stats_t acomp_stat;
+
+// Vector entry clears ACI, which also re-arms the ADC auto trigger. The
+// crossing is queued with interrupts masked, the callback runs with them
+// enabled. Crossings during the callback are queued and give it one more
+// run with the latest level.
+ISR(ANALOG_COMP_vect) {
+    uint8_t next = (acomp_head + 1) & ACOMP_MASK;
+    bool high = (ACSR & (1 << ACO)) != 0;
+
+    STAT_INC(acomp_stat.crossings);
+    if (next != acomp_tail) {
+        acomp_queue[acomp_head].us = systick_micros();
+        acomp_queue[acomp_head].high = high;
+        acomp_head = next;
+    }
+    else STAT_INC(acomp_stat.dropped);
+
+    acomp_cb_high = high;
+    if (!acomp_cb || !irq_open(IRQ_ACOMP)) return;
+    do acomp_cb(acomp_cb_high); while (irq_close(IRQ_ACOMP));
+}
+
+/************************** Comparator Stuff **************************/
+
+// neg is ACOMP_NEG_AIN1 or ADC0..ADC7. The comparator interrupt is off
+// while the inputs and edge change and a stale ACI is cleared before it
+// is enabled, as datasheet 23.2 asks.
+acomp_error_t acomp_init(acomp_pos_t pos, uint8_t neg, acomp_edge_t edge, acomp_action_t action) {
+    uint8_t acsr;
+
+    if (pos > ACOMP_POS_BANDGAP || (neg != ACOMP_NEG_AIN1 && neg > 7)) return ACOMP_INVALID_INPUT;
+    if (edge != ACOMP_TOGGLE && edge != ACOMP_FALLING && edge != ACOMP_RISING) return ACOMP_INVALID_INPUT;
+    if (action > ACOMP_CAPTURE) return ACOMP_INVALID_ACTION;
+    if (action == ACOMP_START_ADC && neg != ACOMP_NEG_AIN1) return ACOMP_INVALID_ACTION;
+
+    acomp_stop();
+    pwr_acquire(PWR_ADC);
+    if (neg != ACOMP_NEG_AIN1 && (ADCSRA & (1 << ADEN))) {
+        pwr_release(PWR_ADC);
+        return ACOMP_ADC_BUSY;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        acomp_head = acomp_tail = 0;
+        acomp_stat = (acomp_stats_t){0};
+    }
+
+    // Digital input buffers off on the analog pins
+    if (pos == ACOMP_POS_AIN0) DIDR1 |= (1 << AIN0D);
+    if (neg == ACOMP_NEG_AIN1) {
+        DIDR1 |= (1 << AIN1D);
+        ADCSRB &= ~(1 << ACME);
+    }
+    else {
+        if (neg < 6 && !(DIDR0 & (1 << neg))) {
+            acomp_didr0 = (1 << neg);
+            DIDR0 |= acomp_didr0;
+        }
+        ADMUX = (ADMUX & 0xF0) | neg;
+        ADCSRB |= (1 << ACME);
+    }
+
+    acsr = edge;
+    if (pos == ACOMP_POS_BANDGAP) acsr |= (1 << ACBG);
+    if (action == ACOMP_CAPTURE) acsr |= (1 << ACIC);
+    ACSR = acsr;
+    if (pos == ACOMP_POS_BANDGAP) _delay_us(ACOMP_BANDGAP_US);
+
+    // Clearing ACI in the same write that sets ACIE leaves no window for
+    // a crossing from the settling inputs to be taken
+    if (action != ACOMP_CAPTURE) acsr |= (1 << ACIE);
+    ACSR = acsr | (1 << ACI);
+    acomp_on = true;
+    return ACOMP_OK;
+}
+
+// Powers the comparator down and gives the multiplexer back to the ADC
+void acomp_stop(void) {
+    if (!acomp_on) return;
+    ACSR = (1 << ACD) | (1 << ACI);
+    ADCSRB &= ~(1 << ACME);
+    DIDR1 &= ~((1 << AIN0D) | (1 << AIN1D));
+    DIDR0 &= ~acomp_didr0;
+    acomp_didr0 = 0;
+    acomp_on = false;
+    pwr_release(PWR_ADC);
+}
+
+// Live output, true while the positive input is above the negative
+bool acomp_level(void) {
+    return (ACSR & (1 << ACO)) != 0;
+}
+
+// Pops the oldest crossing, returns false when the queue is empty
+bool acomp_read(acomp_event_t* ev) {
+    bool ok = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (acomp_tail != acomp_head) {
+            *ev = acomp_queue[acomp_tail];
+            acomp_tail = (acomp_tail + 1) & ACOMP_MASK;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Runs after the crossing is queued with interrupts enabled, see irq.h.
+// State it shares with the main loop needs an ATOMIC_BLOCK.
+void acomp_callback(void (*cb)(bool high)) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        acomp_cb = cb;
+    }
+}
+
+void acomp_stats(acomp_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = acomp_stat;
+    }
+}
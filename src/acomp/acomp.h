@@ -0,0 +1,84 @@
+/***********************************************************************
+* Analog comparator driver                                             *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Catch threshold crossings within a microsecond and hand     *
+*          them to an event queue, an ADC conversion or a Timer1       *
+*          input capture without polling                               *
+*                                                                      *
+* The comparator answers in under a microsecond against ~104 us for a  *
+* 10 bit conversion plus however long until the next poll. Positive    *
+* input is AIN0 (PD6) or the 1.1 V bandgap, negative input AIN1 (PD7)  *
+* or one of ADC0..ADC7 through the ADC multiplexer, which only works   *
+* while the ADC itself is off.                                         *
+*                                                                      *
+* ANALOG_COMP_vect stamps each crossing with systick_micros() and the  *
+* new output level into a ring read with acomp_read(). A crossing can  *
+* also start hardware on its own:                                      *
+*   ACOMP_START_ADC  auto trigger source AIN, set up the ADC with      *
+*                    adc_init(vref, AIN, mux, true), take results with *
+*                    adc_result(). Needs AIN1 as the negative input.   *
+*   ACOMP_CAPTURE    ACIC routes the output to Timer1 input capture,   *
+*                    stamped per clock by tmr1_icp_init(), edge from   *
+*                    its ICES1 setting. No comparator interrupt.       *
+*                                                                      *
+* The driver holds PWR_ADC while enabled: the multiplexer needs the    *
+* ADC clocked, and the comparator can not wake the CPU from power-save *
+* so pwr_sleep() has to stay in IDLE.                                  *
+***********************************************************************/
+
+#ifndef ACOMP_H_
+#define ACOMP_H_
+
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ACOMP_QUEUE_SIZE 8      /*Events, power of two up to 256*/
+#define ACOMP_NEG_AIN1 0xFF     /*Negative input on PD7 instead of an ADC channel*/
+#define ACOMP_BANDGAP_US 70     /*Bandgap start-up, datasheet table 28-7*/
+
+typedef enum acomp_error {
+    ACOMP_OK,
+    ACOMP_INVALID_INPUT,
+    ACOMP_INVALID_ACTION,
+    ACOMP_ADC_BUSY      /*ADC enabled, its multiplexer can not be shared*/
+} acomp_error_t;
+
+typedef enum acomp_pos {
+    ACOMP_POS_AIN0,
+    ACOMP_POS_BANDGAP
+} acomp_pos_t;
+
+// ACIS1:0, datasheet table 23-2
+typedef enum acomp_edge {
+    ACOMP_TOGGLE = 0,
+    ACOMP_FALLING = 2,
+    ACOMP_RISING = 3
+} acomp_edge_t;
+
+typedef enum acomp_action {
+    ACOMP_EVENT,        /*Queue a timestamp only*/
+    ACOMP_START_ADC,    /*Queue and start an auto triggered conversion*/
+    ACOMP_CAPTURE       /*Timer1 input capture, nothing queued*/
+} acomp_action_t;
+
+typedef struct acomp_event {
+    uint32_t us;        /*systick_micros() in the ISR*/
+    bool high;          /*ACO after the crossing, positive above negative*/
+} acomp_event_t;
+
+// Saturating, see counter.h
+typedef struct acomp_stats {
+    uint32_t crossings;
+    uint16_t dropped;   /*Queue full*/
+} acomp_stats_t;
+
+acomp_error_t acomp_init(acomp_pos_t pos, uint8_t neg, acomp_edge_t edge, acomp_action_t action);
+void acomp_stop(void);
+bool acomp_level(void);
+bool acomp_read(acomp_event_t* ev);
+void acomp_callback(void (*cb)(bool high));
+void acomp_stats(acomp_stats_t* stats);
+
+#endif //ACOMP_H_
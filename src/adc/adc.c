@@ -1,7 +1,28 @@
 
 #include "adc.h"
+#include <avr/interrupt.h>
+#include "pwr.h"
+#include "prof.h"
+#include "counter.h"
+#include <util/atomic.h>
 
+static volatile bool adc_done = false;
+static volatile uint16_t adc_last;
+static adc_stats_t adc_stat;
+static uint8_t adc_adps = ADCPSC_VAL;       /*For the current system clock, see adc_retime()*/
+
+// Completion is what wakes the CPU from ADC noise reduction sleep
+ISR(ADC_vect) {
+    if (adc_done) STAT_INC(adc_stat.missed);
+    STAT_INC(adc_stat.conversions);
+    adc_last = ADC & 0x3FF;
+    adc_done = true;
+}
+
+// Auto triggered conversions keep the ADC powered from here on
 adc_error_t adc_init(voltage_ref_t vref, trigger_source_t trig, mux_value_t mux, bool intEn) {
+    adc_stats_reset();
+    pwr_acquire(PWR_ADC);
     ADCSRB |= (trig);                       /*Set trigger source*/
     ADMUX = (mux) | (vref << 6);            /*Select a mux channel to start and select voltage reference*/
     ADMUX &= ~(1 << ADLAR);                 /*Ensure bit ordering is consistent with the adc_read fxn*/
@@ -9,20 +30,80 @@ adc_error_t adc_init(voltage_ref_t vref, trigger_source_t trig, mux_value_t mux,
     if (intEn) ADCSRA |= (1 << ADIE);
     /*Enable the ADC functionality, enable auto triggering by HW, set start conversion bit, and
      set prescalar*/
-    ADCSRA |= ADCPSC_VAL; /* set PSC value so sample rate b/w 50kHz -- 200kHz for 10bit res*/
+    ADCSRA = (ADCSRA & ~((1 << ADIF) | 0x07)) | adc_adps; /* set PSC value so sample rate b/w 50kHz -- 200kHz for 10bit res*/
     ADCSRA |= ((1 << ADEN) | (1 << ADATE) | (1 << ADSC));  
     return ADC_OK;
 }
 
+// Single conversions power the ADC up, sleep through the conversion and
+// switch it back off so it can be gated again
 adc_error_t adc_read(mux_value_t mux, uint16_t* value) {
-    //ADMUX |= mux;
-    ADCSRA |= (1 << ADSC);  
-    while(!(ADCSRA & (1 << ADIF)));
-    _delay_us(10);
+    PROF_SCOPE(PROF_ADC_READ);
+    if (mux > ADC8) return ADC_INVALID_MUX;
+    pwr_acquire(PWR_ADC);
+    ADMUX = (ADMUX & 0xF0) | mux;
+    adc_done = false;
+    ADCSRA |= (1 << ADIF);                  /*Clear a stale completion flag by writing a one*/
+    ADCSRA |= (1 << ADEN) | (1 << ADIE) | (1 << ADSC);
+    if (!(SREG & (1 << SREG_I))) {
+        while(!(ADCSRA & (1 << ADIF)));
+        ADCSRA |= (1 << ADIF);
+        STAT_INC(adc_stat.conversions);     /*No ISR with interrupts off*/
+    }
+    else {
+        while (!adc_done) {
+            cli();
+            if (!adc_done) pwr_sleep();
+            else sei();
+        }
+    }
+    // The result is valid as soon as ADIF is set, ADC reads ADCL before ADCH
     // the below line will change according the the ADLAR bit
-    *value = (uint16_t)(ADCL | ((ADCH & 0x03) << 8))&(0x3FF);
+    *value = ADC & (0x3FF);
+    adc_done = false;                       /*Taken, a later completion is not a miss*/
+    if (!(ADCSRA & (1 << ADATE))) ADCSRA &= ~((1 << ADEN) | (1 << ADIE));
+    pwr_release(PWR_ADC);
     // below line needed if free running/auto triggering is not enabled
     //ADCSRA |= (1 << (ADSC));
     //if (!(ADCSRA & (1 << ADIE) >> ADIE)) (ADCSRA |= 1 << ADIF);
     return ADC_OK;
-}
\ No newline at end of file
+}
+
+// Latest result of an auto triggered conversion started by hardware, false
+// until one completed since the last call. Needs adc_init(..., true).
+bool adc_result(uint16_t* value) {
+    bool ok = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (adc_done) {
+            *value = adc_last;
+            adc_done = false;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Reloads ADPS for a new system clock, called by clk_set(). Takes the
+// smallest prescaler that keeps the ADC clock at or below 200 kHz, below
+// 100 kHz system clock even /2 leaves it under 50 kHz, still 10 bits.
+void adc_retime(uint32_t hz) {
+    uint8_t adps = 1;
+
+    while (adps < 7 && (hz >> adps) > BOARD_ADC_HZ_MAX) adps++;
+    adc_adps = adps;
+    pwr_acquire(PWR_ADC);
+    ADCSRA = (ADCSRA & ~((1 << ADIF) | 0x07)) | adps;
+    pwr_release(PWR_ADC);
+}
+
+void adc_stats(adc_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = adc_stat;
+    }
+}
+
+void adc_stats_reset(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        adc_stat = (adc_stats_t){0};
+    }
+}
@@ -5,7 +5,7 @@
 #include <avr/io.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <util/delay.h>
+#include "board.h"
 
 typedef enum adc_error {
     ADC_OK,
@@ -14,6 +14,13 @@ typedef enum adc_error {
     ADC_INVALID_REF
 } adc_error_t;
 
+// Saturating, see counter.h. A conversion is missed when the next one
+// completes before adc_read() took its result, as in auto triggered mode
+typedef struct adc_stats {
+    uint32_t conversions;
+    uint16_t missed;
+} adc_stats_t;
+
 typedef enum voltage_reference {
     EXTERNAL_VREF = 0,
     ANALOG_VCC = 1,
@@ -55,11 +62,14 @@ typedef enum trigger_source {
 maximum resolution. If a lower resolution than 10 bits is needed, the input clock frequency to the ADC can be higher than
 200kHz to get a higher sample rate*/
 
-#define ADCPSC_VAL 7
-
-//16MHz / 128 == 125kHz sample rate, write 7 to the ADPS bits 2:0
+// ADPS bits 2:0 for BOARD_ADC_PSC at F_CPU, the 50kHz -- 200kHz range is checked in board.h
+#define ADCPSC_VAL BOARD_ADC_ADPS
 
 adc_error_t adc_init(voltage_ref_t vref, trigger_source_t trig, mux_value_t mux, bool intEn);
 adc_error_t adc_read(mux_value_t mux, uint16_t* value);
+bool adc_result(uint16_t* value);
+void adc_retime(uint32_t hz);
+void adc_stats(adc_stats_t* stats);
+void adc_stats_reset(void);
 
 #endif //ADC_H_
\ No newline at end of file
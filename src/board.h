@@ -0,0 +1,110 @@
+/***********************************************************************
+* Board configuration                                                  *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: One place for the clock and every rate derived from it, so  *
+*          drivers load constants and a bad setting fails the build    *
+*                                                                      *
+* F_CPU and BAUD come from the makefile. Everything else a driver      *
+* needs for its clock registers is worked out here by the compiler:    *
+*                                                                      *
+*   UART   UBRR0 and U2X0, baud error within BOARD_UART_ERR_MAX        *
+*   TWI    TWBR at prescaler 1, SCL 31 kHz .. 400 kHz with TWBR >= 10  *
+*   ADC    ADPS2:0, ADC clock 50 .. 200 kHz for 10 bit results         *
+*   Timers systick fits Timer0, PWM keeps BOARD_PWM_MIN_STEPS of duty  *
+*   SUART  CPU cycles per bit at least BOARD_SUART_BIT_MIN             *
+*   IRQ    entry latency budgets, a share of the period each vector    *
+*          keeps, see irq.h                                            *
+*                                                                      *
+* Change a rate here, not in a driver. The assertions say which limit  *
+* a setting breaks, e.g. 115200 baud has 3.5% error at 16 samples per  *
+* bit and 16 MHz, so the UART runs at 8 samples per bit with U2X0.     *
+*                                                                      *
+* These hold for F_CPU. clk_set() divides the clock at runtime and the *
+* drivers redo the same sums for the slower clock, see clk.h.          *
+***********************************************************************/
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#ifndef F_CPU
+#error "F_CPU must be set by the makefile"
+#endif
+#ifndef BAUD
+#error "BAUD must be set by the makefile"
+#endif
+
+/*UART*/
+#define BOARD_UART_BAUD BAUD
+#define BOARD_UART_U2X 1                /*8 samples per bit, finer UBRR steps*/
+#define BOARD_UART_ERR_MAX 25           /*Per mille, the CH340 side is crystal accurate*/
+
+#define BOARD_UART_SAMPLES (BOARD_UART_U2X ? 8UL : 16UL)
+
+// The _AT forms take the system clock so clk.c can redo them at runtime,
+// hz must be at least BOARD_UART_SAMPLES * BOARD_UART_BAUD
+#define BOARD_UBRR_AT(hz) (((hz) + BOARD_UART_SAMPLES * BOARD_UART_BAUD / 2) / (BOARD_UART_SAMPLES * BOARD_UART_BAUD) - 1)
+#define BOARD_UART_ACTUAL_AT(hz) ((hz) / (BOARD_UART_SAMPLES * (BOARD_UBRR_AT(hz) + 1)))
+#define BOARD_UART_ERR_AT(hz) \
+    ((BOARD_UART_ACTUAL_AT(hz) > BOARD_UART_BAUD ? BOARD_UART_ACTUAL_AT(hz) - BOARD_UART_BAUD \
+                                                 : BOARD_UART_BAUD - BOARD_UART_ACTUAL_AT(hz)) \
+     * 1000UL / BOARD_UART_BAUD)
+
+#define BOARD_UBRR BOARD_UBRR_AT(F_CPU)
+#define BOARD_UART_ACTUAL BOARD_UART_ACTUAL_AT(F_CPU)
+#define BOARD_UART_ERR BOARD_UART_ERR_AT(F_CPU)
+
+_Static_assert(BOARD_UBRR <= 0x0FFF, "BAUD too low for the 12 bit UBRR0");
+_Static_assert(F_CPU / (BOARD_UART_SAMPLES * BOARD_UART_BAUD) >= 1, "BAUD too high for F_CPU");
+_Static_assert(BOARD_UART_ERR <= BOARD_UART_ERR_MAX, "UART baud rate error above BOARD_UART_ERR_MAX");
+
+/*TWI*/
+#define BOARD_SCL_HZ 400000UL
+#define BOARD_TWBR_MIN 10UL             /*Lowest TWBR for master mode*/
+#define BOARD_TWBR_AT(hz) (((hz) / BOARD_SCL_HZ - 16) / 2)    /*TWPS = 0, datasheet 22.5.2*/
+#define BOARD_TWBR BOARD_TWBR_AT(F_CPU)
+
+_Static_assert(BOARD_SCL_HZ <= 400000UL, "SCL above fast mode");
+_Static_assert(F_CPU / BOARD_SCL_HZ >= 16 + 2 * BOARD_TWBR_MIN, "TWBR below 10, too fast for master mode at this F_CPU");
+_Static_assert(BOARD_TWBR <= 0xFF, "SCL too slow for TWBR without the TWPS prescaler");
+
+/*ADC*/
+#define BOARD_ADC_PSC 128UL
+#define BOARD_ADC_HZ (F_CPU / BOARD_ADC_PSC)
+#define BOARD_ADC_HZ_MAX 200000UL
+#define BOARD_ADC_ADPS \
+    (BOARD_ADC_PSC == 2UL  ? 1 : BOARD_ADC_PSC == 4UL  ? 2 : \
+     BOARD_ADC_PSC == 8UL  ? 3 : BOARD_ADC_PSC == 16UL ? 4 : \
+     BOARD_ADC_PSC == 32UL ? 5 : BOARD_ADC_PSC == 64UL ? 6 : 7)
+
+_Static_assert((BOARD_ADC_PSC & (BOARD_ADC_PSC - 1)) == 0 && BOARD_ADC_PSC >= 2 && BOARD_ADC_PSC <= 128,
+               "BOARD_ADC_PSC must be a power of two from 2 to 128");
+_Static_assert(BOARD_ADC_HZ >= 50000UL && BOARD_ADC_HZ <= BOARD_ADC_HZ_MAX, "ADC clock outside 50 -- 200 kHz");
+
+/*Timers*/
+#define BOARD_PWM_HZ 1000UL             /*Timer1 phase correct PWM on OC1A*/
+#define BOARD_PWM_MIN_STEPS 256UL       /*Duty resolution the PWM must keep*/
+
+// Timer0 at /64 counts one 1 ms systick in 8 bits, see systick.h
+_Static_assert(F_CPU / 64UL / 1000UL <= 256, "F_CPU too fast for the Timer0 systick at /64");
+// Timer1 picks the smallest prescaler, so prescaler 1 bounds TOP from below
+_Static_assert(F_CPU / (2UL * BOARD_PWM_HZ) >= BOARD_PWM_MIN_STEPS, "BOARD_PWM_HZ too high for BOARD_PWM_MIN_STEPS");
+
+/*Software UART*/
+#define BOARD_SUART_BAUD 38400UL
+#define BOARD_SUART_BIT_MIN 200UL       /*CPU cycles per bit, room for both ISRs and a late one*/
+
+// Timer2 is picked to keep 1.5 bits inside its 8 bits, /1024 bounds it
+_Static_assert(F_CPU / BOARD_SUART_BAUD >= BOARD_SUART_BIT_MIN, "BOARD_SUART_BAUD too high for F_CPU");
+_Static_assert(F_CPU / 1024UL / BOARD_SUART_BAUD * 3 / 2 < 256, "BOARD_SUART_BAUD too low for Timer2");
+
+/*Interrupt latency budgets*/
+#define BOARD_IRQ_TICK_DIV 4            /*systick entered within a quarter of a tick*/
+#define BOARD_IRQ_SUART_DIV 4           /*SUART edges and samples within a quarter bit*/
+
+// Half a bit late an RX sample reads the next bit, half a tick late
+// systick_micros() leaves out the tick its pending match adds
+_Static_assert(BOARD_IRQ_SUART_DIV > 2, "BOARD_IRQ_SUART_DIV lets an RX sample slip into the next bit");
+_Static_assert(BOARD_IRQ_TICK_DIV > 2, "BOARD_IRQ_TICK_DIV lets a late systick confuse systick_micros()");
+
+#endif //BOARD_H_
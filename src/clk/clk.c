@@ -0,0 +1,57 @@
+/***********************************************************************
+* System clock manager                                                 *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Divide the system clock at runtime through CLKPR and have   *
+*          the drivers reload every register worked out from it        *
+***********************************************************************/
+
+#include "clk.h"
+#include "systick.h"
+#include "uart.h"
+#include "suart.h"
+#include "twi_hal.h"
+#include "adc.h"
+#include "tmr1.h"
+#include <avr/power.h>
+#include <util/atomic.h>
+
+static clk_div_t clk_div = CLK_DIV1;       /*CKDIV8 fuse unprogrammed*/
+
+// Queued bytes on both UARTs go out at the old rate first. Timer0 is
+// moved right before the CLKPR write and the others right after, all
+// with interrupts off, so no ISR sees a driver set up for the wrong
+// clock. CLKPS must be written within four cycles of CLKPCE, avr-libc's
+// clock_prescale_set() does both in inline asm whatever the -O level.
+clk_error_t clk_set(clk_div_t div) {
+    uint32_t hz;
+
+    if (div > CLK_DIV256) return CLK_INVALID_DIV;
+    if (div == clk_div) return CLK_OK;
+    hz = F_CPU >> div;
+    if (!uart_clock_ok(hz)) return CLK_UART_BAUD;
+    if (!suart_clock_ok(hz)) return CLK_SUART_BAUD;
+
+    uart_flush();
+    suart_flush();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!systick_retime(hz)) return CLK_SYSTICK;
+        clock_prescale_set((clock_div_t)div);
+        clk_div = div;
+
+        uart_retime(hz);
+        suart_retime(hz);
+        twi_retime(hz);
+        adc_retime(hz);
+        tmr1_retime(hz);
+    }
+    return CLK_OK;
+}
+
+clk_div_t clk_get(void) {
+    return clk_div;
+}
+
+uint32_t clk_hz(void) {
+    return F_CPU >> clk_div;
+}
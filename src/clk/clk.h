@@ -0,0 +1,61 @@
+/***********************************************************************
+* System clock manager                                                 *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Divide the system clock at runtime through CLKPR and have   *
+*          the drivers reload every register worked out from it        *
+*                                                                      *
+* board.h sizes UBRR0, TWBR, ADPS and the timers for F_CPU at build    *
+* time. clk_set() runs the same sums for F_CPU >> div and hands the    *
+* result to each driver:                                               *
+*   systick  Timer0 prescaler and TOP, 1 ms tick or 2/4 ms if needed   *
+*   UART     UBRR0, refused once uart_init() ran if the baud rate      *
+*            error would pass BOARD_UART_ERR_MAX                       *
+*   SUART    Timer2 prescaler and bit period, refused once             *
+*            suart_init() ran if a bit would take fewer than           *
+*            BOARD_SUART_BIT_MIN cycles                                *
+*   TWI      TWBR, SCL drops below BOARD_SCL_HZ once TWBR hits 10      *
+*   ADC      ADPS for an ADC clock at or below 200 kHz                 *
+*   Timer1   CTC/PWM keep frequency and duty, captures use the new     *
+*            clock                                                     *
+*                                                                      *
+* Every peripheral clock follows the divider, so the CPU and they slow *
+* down together: run at CLK_DIV1 for a burst of work, divide down for  *
+* long stretches of waiting. 115200 baud only holds at CLK_DIV1, so a  *
+* UART in use pins the clock there. TMR1_INIT() and _delay_us() are    *
+* worked out for F_CPU at compile time: set Timer1 up at CLK_DIV1 and  *
+* let clk_set() move it, delays stretch by the divider.                *
+***********************************************************************/
+
+#ifndef CLK_H_
+#define CLK_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+typedef enum clk_error {
+    CLK_OK,
+    CLK_INVALID_DIV,
+    CLK_UART_BAUD,      /*UART set up and BOARD_UART_BAUD out of reach*/
+    CLK_SYSTICK,        /*No Timer0 setting gives a whole number of us per count*/
+    CLK_SUART_BAUD      /*Software UART set up and short of BOARD_SUART_BIT_MIN*/
+} clk_error_t;
+
+// CLKPS3:0, datasheet table 9-17
+typedef enum clk_div {
+    CLK_DIV1,
+    CLK_DIV2,
+    CLK_DIV4,
+    CLK_DIV8,
+    CLK_DIV16,
+    CLK_DIV32,
+    CLK_DIV64,
+    CLK_DIV128,
+    CLK_DIV256
+} clk_div_t;
+
+clk_error_t clk_set(clk_div_t div);
+clk_div_t clk_get(void);
+uint32_t clk_hz(void);
+
+#endif //CLK_H_
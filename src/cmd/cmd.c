@@ -0,0 +1,283 @@
+/***********************************************************************
+* Binary command interface over the UART                               *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Let a host change and query the running firmware with       *
+*          short framed requests instead of reflashing it              *
+***********************************************************************/
+
+#include "cmd.h"
+#include "uart.h"
+#include "stats.h"
+#include "systick.h"
+#include "counter.h"
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#define CMD_CRC_INIT 0xFFFF
+#define CMD_DATA_MAX 254        /*Reply len counts the status byte too*/
+#define CMD_REG_FIRST 0x20      /*Below are the CPU registers, not I/O*/
+
+typedef enum cmd_state {
+    CMD_WAIT_SYNC,
+    CMD_WAIT_LEN,
+    CMD_WAIT_ID,
+    CMD_WAIT_ARG,
+    CMD_WAIT_CRC_LO,
+    CMD_WAIT_CRC_HI
+} cmd_state_t;
+
+typedef enum cmd_reply_state {
+    CMD_REPLY_CLOSED,       /*No handler running*/
+    CMD_REPLY_NONE,         /*Handler running, nothing sent yet*/
+    CMD_REPLY_OPEN          /*Header sent, cmd_tx_left data bytes to go*/
+} cmd_reply_state_t;
+
+static const cmd_entry_t* cmd_table = 0;
+static uint8_t cmd_count = 0;
+static cmd_stats_t cmd_stat;
+
+// Request being received
+static cmd_state_t cmd_state = CMD_WAIT_SYNC;
+static uint8_t cmd_len;
+static uint8_t cmd_id;
+static uint8_t cmd_pos;
+static uint8_t cmd_crc_lo;
+static uint16_t cmd_crc;
+static uint32_t cmd_last_ms;        /*When the last byte was taken*/
+static uint8_t cmd_arg[CMD_PAYLOAD_MAX];
+
+// Reply being sent
+static cmd_reply_state_t cmd_reply_state = CMD_REPLY_CLOSED;
+static uint8_t cmd_tx_left;
+static uint16_t cmd_tx_crc;
+
+/************************** Command Reply Stuff ***********************/
+
+static void cmd_tx(uint8_t b) {
+    cmd_tx_crc = _crc_ccitt_update(cmd_tx_crc, b);
+    uart_transmit_byte(b);
+}
+
+static void cmd_reply_head(cmd_status_t status, uint8_t len) {
+    uart_transmit_byte(CMD_SYNC);
+    cmd_tx_crc = CMD_CRC_INIT;
+    cmd_tx(len + 1);
+    cmd_tx(cmd_id | CMD_REPLY);
+    cmd_tx(status);
+    cmd_tx_left = len;
+}
+
+// Pads data the handler declared but did not write
+static void cmd_reply_end(void) {
+    while (cmd_tx_left) {
+        cmd_tx(0);
+        cmd_tx_left--;
+    }
+    uart_transmit_byte((uint8_t)cmd_tx_crc);
+    uart_transmit_byte((uint8_t)(cmd_tx_crc >> 8));
+}
+
+static void cmd_reply_status(cmd_status_t status) {
+    cmd_reply_head(status, 0);
+    cmd_reply_end();
+}
+
+// Only from a handler, once. Longer than CMD_DATA_MAX is cut short.
+void cmd_reply_begin(uint8_t len) {
+    if (cmd_reply_state != CMD_REPLY_NONE) return;
+    if (len > CMD_DATA_MAX) len = CMD_DATA_MAX;
+    cmd_reply_head(CMD_OK, len);
+    cmd_reply_state = CMD_REPLY_OPEN;
+}
+
+// Bytes past the length given to cmd_reply_begin() are dropped
+void cmd_reply_byte(uint8_t b) {
+    if (cmd_reply_state != CMD_REPLY_OPEN || cmd_tx_left == 0) return;
+    cmd_tx(b);
+    cmd_tx_left--;
+}
+
+void cmd_reply_u16(uint16_t v) {
+    cmd_reply_byte((uint8_t)v);
+    cmd_reply_byte((uint8_t)(v >> 8));
+}
+
+void cmd_reply_u32(uint32_t v) {
+    cmd_reply_u16((uint16_t)v);
+    cmd_reply_u16((uint16_t)(v >> 16));
+}
+
+void cmd_reply_buf(const void* data, uint8_t len) {
+    const uint8_t* p = data;
+    while (len--) cmd_reply_byte(*p++);
+}
+
+/************************* Command Parser Stuff ***********************/
+
+void cmd_init(const cmd_entry_t* table, uint8_t count) {
+    cmd_table = table;
+    cmd_count = count;
+    cmd_state = CMD_WAIT_SYNC;
+    cmd_reply_state = CMD_REPLY_CLOSED;
+    cmd_stat = (cmd_stats_t){0};
+}
+
+// The table lives in flash, so the entry is read a field at a time
+static void cmd_dispatch(void) {
+    cmd_fn_t fn = 0;
+    cmd_status_t status;
+    uint8_t min_len = 0, max_len = 0;
+
+    if (cmd_id < cmd_count) {
+        fn = (cmd_fn_t)pgm_read_ptr(&cmd_table[cmd_id].fn);
+        min_len = pgm_read_byte(&cmd_table[cmd_id].min_len);
+        max_len = pgm_read_byte(&cmd_table[cmd_id].max_len);
+    }
+    if (!fn) {
+        STAT_INC(cmd_stat.unknown);
+        cmd_reply_status(CMD_UNKNOWN);
+        return;
+    }
+    if (cmd_len < min_len || cmd_len > max_len) {
+        STAT_INC(cmd_stat.bad_len);
+        cmd_reply_status(CMD_BAD_LEN);
+        return;
+    }
+
+    cmd_reply_state = CMD_REPLY_NONE;
+    status = fn(cmd_arg, cmd_len);
+    if (cmd_reply_state == CMD_REPLY_OPEN) cmd_reply_end();
+    else cmd_reply_status(status);
+    cmd_reply_state = CMD_REPLY_CLOSED;
+}
+
+// Returns true when b completed a request, which has then been answered
+static bool cmd_take(uint8_t b) {
+    switch (cmd_state) {
+        case CMD_WAIT_SYNC:
+            if (b == CMD_SYNC) {
+                cmd_crc = CMD_CRC_INIT;
+                cmd_state = CMD_WAIT_LEN;
+            }
+            return false;
+        case CMD_WAIT_LEN:
+            if (b > CMD_PAYLOAD_MAX) {
+                // Not a request after all, the byte may start the real one
+                STAT_INC(cmd_stat.dropped);
+                cmd_state = (b == CMD_SYNC) ? CMD_WAIT_LEN : CMD_WAIT_SYNC;
+                return false;
+            }
+            cmd_len = b;
+            cmd_pos = 0;
+            cmd_state = CMD_WAIT_ID;
+            break;
+        case CMD_WAIT_ID:
+            cmd_id = b;
+            cmd_state = cmd_len ? CMD_WAIT_ARG : CMD_WAIT_CRC_LO;
+            break;
+        case CMD_WAIT_ARG:
+            cmd_arg[cmd_pos++] = b;
+            if (cmd_pos == cmd_len) cmd_state = CMD_WAIT_CRC_LO;
+            break;
+        case CMD_WAIT_CRC_LO:
+            cmd_crc_lo = b;
+            cmd_state = CMD_WAIT_CRC_HI;
+            return false;
+        case CMD_WAIT_CRC_HI:
+            cmd_state = CMD_WAIT_SYNC;
+            STAT_INC(cmd_stat.requests);
+            if ((((uint16_t)b << 8) | cmd_crc_lo) != cmd_crc) {
+                STAT_INC(cmd_stat.crc_errors);
+                cmd_reply_status(CMD_BAD_CRC);
+            }
+            else cmd_dispatch();
+            return true;
+    }
+    cmd_crc = _crc_ccitt_update(cmd_crc, b);
+    return false;
+}
+
+// Returns true if a request was answered, more may be waiting. The gap
+// is only judged with the RX ring empty: cmd_last_ms is when the last
+// byte was taken, never before it arrived, so a task that held up the
+// poll can not make a request look stalled.
+bool cmd_poll(void) {
+    uint8_t b;
+
+    while (uart_rx_get(&b)) {
+        cmd_last_ms = systick_millis();
+        if (cmd_take(b)) return true;
+    }
+    if (cmd_state != CMD_WAIT_SYNC && systick_millis() - cmd_last_ms > CMD_TIMEOUT_MS) {
+        STAT_INC(cmd_stat.dropped);
+        cmd_state = CMD_WAIT_SYNC;
+    }
+    return false;
+}
+
+void cmd_stats(cmd_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = cmd_stat;
+    }
+}
+
+/************************ Command Handler Stuff ***********************/
+
+// Echoes the payload, for link checks and round trip timing
+cmd_status_t cmd_ping(const uint8_t* arg, uint8_t len) {
+    cmd_reply_begin(len);
+    cmd_reply_buf(arg, len);
+    return CMD_OK;
+}
+
+// Payload: first address, count. Reads I/O and extended I/O registers
+// 0x20..0xFF as the data space maps them. Reading a data register such
+// as UDR0 or TWDR has the same side effects as it does in a driver.
+cmd_status_t cmd_read_regs(const uint8_t* arg, uint8_t len) {
+    uint8_t addr, count, i;
+
+    if (len != 2) return CMD_BAD_LEN;
+    addr = arg[0];
+    count = arg[1];
+    if (addr < CMD_REG_FIRST || count == 0 || count > CMD_REGS_MAX) return CMD_BAD_ARG;
+    if ((uint16_t)addr + count - 1 > 0xFF) return CMD_BAD_ARG;
+
+    cmd_reply_begin(count);
+    for (i = 0; i < count; i++) cmd_reply_byte(_SFR_MEM8(addr + i));
+    return CMD_OK;
+}
+
+// stats_t in declaration order, the 52 byte layout a host decodes:
+//   ms; TWI transactions, bytes, nacks, start, restart fails, timeouts;
+//   UART tx, rx bytes, overruns, frame, parity errors, rx dropped;
+//   ADC conversions, missed; GPIO writes, reads, errors
+cmd_status_t cmd_dump_stats(const uint8_t* arg, uint8_t len) {
+    stats_t s;
+
+    (void)arg;
+    (void)len;
+    stats_snapshot(&s);
+    cmd_reply_begin(52);
+    cmd_reply_u32(s.ms);
+    cmd_reply_u32(s.twi.transactions);
+    cmd_reply_u32(s.twi.bytes);
+    cmd_reply_u16(s.twi.nacks);
+    cmd_reply_u16(s.twi.start_fails);
+    cmd_reply_u16(s.twi.restart_fails);
+    cmd_reply_u16(s.twi.timeouts);
+    cmd_reply_u32(s.uart.tx_bytes);
+    cmd_reply_u32(s.uart.rx_bytes);
+    cmd_reply_u16(s.uart.overruns);
+    cmd_reply_u16(s.uart.frame_errors);
+    cmd_reply_u16(s.uart.parity_errors);
+    cmd_reply_u16(s.uart.rx_dropped);
+    cmd_reply_u32(s.adc.conversions);
+    cmd_reply_u16(s.adc.missed);
+    cmd_reply_u32(s.gpio.writes);
+    cmd_reply_u32(s.gpio.reads);
+    cmd_reply_u16(s.gpio.errors);
+    return CMD_OK;
+}
@@ -0,0 +1,86 @@
+/***********************************************************************
+* Binary command interface over the UART                               *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Let a host change and query the running firmware with       *
+*          short framed requests instead of reflashing it              *
+*                                                                      *
+* Request: C3, len, id, payload (len bytes), CRC lo, CRC hi            *
+* Reply:   C3, len, id | 80, status, data (len - 1 bytes), CRC lo, hi  *
+*                                                                      *
+* The CRC is CRC-16/MCRF4XX (avr-libc _crc_ccitt_update from FFFF)     *
+* over len, id and what follows them. The sync byte is outside ASCII,  *
+* so a host can pick replies out of the text and log lines sharing     *
+* the TX line. A gap of more than CMD_TIMEOUT_MS inside a request or a *
+* len above CMD_PAYLOAD_MAX drops it and the parser hunts for the next *
+* sync byte.                                                           *
+*                                                                      *
+* The application hands cmd_init() a PROGMEM table indexed by command  *
+* id: the handler and the payload lengths it accepts. A request the    *
+* table has no handler for, or with a length outside its range, is     *
+* answered without calling anything. A handler checks its arguments    *
+* before it calls cmd_reply_begin(), which commits to CMD_OK and the   *
+* data length, then writes the data with cmd_reply_xxx(), multi-byte   *
+* values little endian. The bytes go straight into the UART TX ring    *
+* with the CRC kept on the way, so nothing is buffered twice. A        *
+* handler that returns without replying gets a reply with its status   *
+* and no data.                                                         *
+*                                                                      *
+* cmd_poll() takes bytes from the UART RX ring until it has answered   *
+* one request, it needs uart_init(RX or BOTH, true, ...) first. Called *
+* on every wake-up it also times out a request that stopped halfway.   *
+***********************************************************************/
+
+#ifndef CMD_H_
+#define CMD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CMD_SYNC 0xC3
+#define CMD_REPLY 0x80          /*Or'ed into the id of a reply*/
+#define CMD_PAYLOAD_MAX 32      /*Longest request payload*/
+#define CMD_TIMEOUT_MS 20       /*Longest gap between two bytes of a request*/
+#define CMD_REGS_MAX 32         /*Registers per cmd_read_regs()*/
+
+typedef enum cmd_status {
+    CMD_OK,
+    CMD_UNKNOWN,        /*No handler for the id*/
+    CMD_BAD_LEN,        /*Payload length outside the handler's range*/
+    CMD_BAD_CRC,        /*Reply id is the one received, it may be corrupt too*/
+    CMD_BAD_ARG,        /*Refused by the handler*/
+    CMD_BUSY            /*Resource in use, try again*/
+} cmd_status_t;
+
+typedef cmd_status_t (*cmd_fn_t)(const uint8_t* arg, uint8_t len);
+
+typedef struct cmd_entry {
+    cmd_fn_t fn;        /*0 for an unused id*/
+    uint8_t min_len;
+    uint8_t max_len;
+} cmd_entry_t;
+
+// Saturating, see counter.h
+typedef struct cmd_stats {
+    uint32_t requests;      /*Complete frames, errors included*/
+    uint16_t crc_errors;
+    uint16_t unknown;
+    uint16_t bad_len;       /*Length refused by the table*/
+    uint16_t dropped;       /*Timed out or len above CMD_PAYLOAD_MAX*/
+} cmd_stats_t;
+
+void cmd_init(const cmd_entry_t* table, uint8_t count);
+bool cmd_poll(void);
+void cmd_reply_begin(uint8_t len);
+void cmd_reply_byte(uint8_t b);
+void cmd_reply_u16(uint16_t v);
+void cmd_reply_u32(uint32_t v);
+void cmd_reply_buf(const void* data, uint8_t len);
+void cmd_stats(cmd_stats_t* stats);
+
+// Handlers for the application's table
+cmd_status_t cmd_ping(const uint8_t* arg, uint8_t len);
+cmd_status_t cmd_read_regs(const uint8_t* arg, uint8_t len);
+cmd_status_t cmd_dump_stats(const uint8_t* arg, uint8_t len);
+
+#endif //CMD_H_
@@ -0,0 +1,323 @@
+/***********************************************************************
+* Write-behind EEPROM driver                                           *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Keep the 3.4 ms EEPROM byte writes off the main loop and    *
+*          spread repeated saves over a ring of record slots           *
+***********************************************************************/
+
+#include "ee.h"
+#include "pwr.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#define EE_PEND_MASK (EE_PEND_SIZE - 1)
+#define EE_TAG(addr) ((addr) & ~(uint16_t)(EE_LINE - 1))
+
+_Static_assert((EE_PEND_SIZE & EE_PEND_MASK) == 0 && EE_PEND_SIZE <= 256, "EE_PEND_SIZE must be a power of two up to 256");
+_Static_assert((EE_LINE & (EE_LINE - 1)) == 0, "EE_LINE must be a power of two");
+
+typedef struct ee_line {
+    uint16_t tag;
+    bool valid;
+    uint8_t data[EE_LINE];
+} ee_line_t;
+
+// Pending writes, the main loop adds at head and the ISR takes from tail.
+// Each address is queued at most once.
+static uint16_t ee_pend_addr[EE_PEND_SIZE];
+static uint8_t ee_pend_data[EE_PEND_SIZE];
+static volatile uint8_t ee_head = 0;
+static volatile uint8_t ee_tail = 0;
+static volatile bool ee_active = false;    /*PWR_EE held from the first queued byte until the last write is done*/
+static volatile bool ee_hold = false;      /*Reader wants the array, start no new write*/
+
+static ee_line_t ee_cache[EE_CACHE_LINES];
+static uint8_t ee_victim = 0;
+
+/************************** Commit Stuff ******************************/
+
+// Called with EEPE clear, from the ISR or by hand with interrupts masked.
+// Programs the next queued byte that differs from the array.
+static void ee_service(void) {
+    uint16_t addr;
+    uint8_t data;
+
+    if (ee_hold) {
+        EECR &= ~(1 << EERIE);
+        return;
+    }
+    while (ee_tail != ee_head) {
+        addr = ee_pend_addr[ee_tail];
+        data = ee_pend_data[ee_tail];
+        ee_tail = (ee_tail + 1) & EE_PEND_MASK;
+
+        EEAR = addr;
+        EECR |= (1 << EERE);
+        if (EEDR == data) continue;
+
+        // Erase and write in one go, EEPE has to follow EEMPE within 4 cycles
+        //  Direct from ATMega328P datasheet pg 21
+        EEDR = data;
+        EECR = (1 << EEMPE) | (1 << EERIE);
+        EECR |= (1 << EEPE);
+        return;
+    }
+    EECR &= ~(1 << EERIE);
+    ee_active = false;
+    pwr_release(PWR_EE);
+}
+
+// Fires while EEPE is clear, which is right after each write finishes
+ISR(EE_READY_vect) {
+    ee_service();
+}
+
+// Stop the queue after the write in flight and wait for that one
+static void ee_pause(void) {
+    ee_hold = true;
+    while (EECR & (1 << EEPE)) {
+        if (!(SREG & (1 << SREG_I))) continue;
+        cli();
+        if (EECR & (1 << EEPE)) pwr_sleep();
+        else sei();
+    }
+}
+
+static void ee_resume(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ee_hold = false;
+        if (ee_active) EECR |= (1 << EERIE);
+    }
+}
+
+// Make room in a full queue, nothing drains it with interrupts masked
+static void ee_wait_space(void) {
+    if (!(SREG & (1 << SREG_I))) {
+        while (EECR & (1 << EEPE));
+        ee_service();
+        return;
+    }
+    cli();
+    if (((ee_head + 1) & EE_PEND_MASK) == ee_tail) pwr_sleep();
+    else sei();
+}
+
+static void ee_put(uint16_t addr, uint8_t data) {
+    uint8_t i;
+
+    for (;;) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            for (i = ee_tail; i != ee_head; i = (i + 1) & EE_PEND_MASK) {
+                if (ee_pend_addr[i] == addr) {
+                    ee_pend_data[i] = data;
+                    return;
+                }
+            }
+            if (((ee_head + 1) & EE_PEND_MASK) != ee_tail) {
+                ee_pend_addr[ee_head] = addr;
+                ee_pend_data[ee_head] = data;
+                ee_head = (ee_head + 1) & EE_PEND_MASK;
+                if (!ee_active) {
+                    ee_active = true;
+                    pwr_acquire(PWR_EE);
+                }
+                EECR |= (1 << EERIE);
+                return;
+            }
+        }
+        ee_wait_space();
+    }
+}
+
+/************************** Cache Stuff *******************************/
+
+static ee_line_t* ee_lookup(uint16_t tag) {
+    uint8_t i;
+
+    for (i = 0; i < EE_CACHE_LINES; i++) {
+        if (ee_cache[i].valid && ee_cache[i].tag == tag) return &ee_cache[i];
+    }
+    return 0;
+}
+
+// Read a line from the array, then lay the queued bytes over it since
+// they are newer
+static ee_line_t* ee_fill(uint16_t tag) {
+    ee_line_t* line = &ee_cache[ee_victim];
+    uint8_t i;
+
+    ee_victim = (ee_victim + 1) % EE_CACHE_LINES;
+    ee_pause();
+    for (i = 0; i < EE_LINE; i++) {
+        EEAR = tag + i;
+        EECR |= (1 << EERE);
+        line->data[i] = EEDR;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (i = ee_tail; i != ee_head; i = (i + 1) & EE_PEND_MASK) {
+            if (EE_TAG(ee_pend_addr[i]) == tag) line->data[ee_pend_addr[i] & (EE_LINE - 1)] = ee_pend_data[i];
+        }
+    }
+    ee_resume();
+
+    line->tag = tag;
+    line->valid = true;
+    return line;
+}
+
+/************************** EEPROM Stuff ******************************/
+
+// Drops the cache and any queued writes, ee_flush() first to keep them.
+// A write already started still completes in hardware.
+void ee_init(void) {
+    uint8_t i;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        EECR &= ~(1 << EERIE);
+        ee_head = ee_tail = 0;
+        ee_hold = false;
+        if (ee_active) {
+            ee_active = false;
+            pwr_release(PWR_EE);
+        }
+    }
+    for (i = 0; i < EE_CACHE_LINES; i++) ee_cache[i].valid = false;
+    ee_victim = 0;
+}
+
+ee_error_t ee_read(uint16_t addr, uint8_t* data, uint16_t len) {
+    ee_line_t* line = 0;
+    uint16_t i;
+
+    if (addr >= EE_SIZE || len > EE_SIZE - addr) return EE_INVALID_ADDR;
+
+    for (i = 0; i < len; i++, addr++) {
+        if (!line || line->tag != EE_TAG(addr)) {
+            line = ee_lookup(EE_TAG(addr));
+            if (!line) line = ee_fill(EE_TAG(addr));
+        }
+        data[i] = line->data[addr & (EE_LINE - 1)];
+    }
+    return EE_OK;
+}
+
+// Queues the bytes and returns, sleeping only while the queue is full.
+// A cached byte that already holds the value is not queued at all.
+ee_error_t ee_write(uint16_t addr, const uint8_t* data, uint16_t len) {
+    ee_line_t* line;
+    uint8_t* cached;
+    uint16_t i;
+
+    if (addr >= EE_SIZE || len > EE_SIZE - addr) return EE_INVALID_ADDR;
+
+    for (i = 0; i < len; i++, addr++) {
+        line = ee_lookup(EE_TAG(addr));
+        if (line) {
+            cached = &line->data[addr & (EE_LINE - 1)];
+            if (*cached == data[i]) continue;
+            *cached = data[i];
+        }
+        ee_put(addr, data[i]);
+    }
+    return EE_OK;
+}
+
+bool ee_busy(void) {
+    return ee_active;
+}
+
+// Waits until every queued byte is in the array
+void ee_flush(void) {
+    while (ee_active) {
+        if (!(SREG & (1 << SREG_I))) {
+            while (EECR & (1 << EEPE));
+            ee_service();
+            continue;
+        }
+        cli();
+        if (ee_active) pwr_sleep();
+        else sei();
+    }
+}
+
+/************************** Record Ring Stuff *************************/
+
+static uint16_t ee_slot_addr(const ee_ring_t* ring, uint8_t slot) {
+    return ring->base + (uint16_t)slot * (ring->size + 2U);
+}
+
+// Reads the slot's sequence number, true if its CRC checks out. An
+// erased slot is refused outright, its 0xFF CRC matches the 0xFF bytes
+// before it for 126 and 253 byte payloads.
+static bool ee_slot_valid(const ee_ring_t* ring, uint8_t slot, uint8_t* seq) {
+    uint16_t addr = ee_slot_addr(ring, slot);
+    uint8_t crc = EE_CRC_INIT;
+    bool blank = true;
+    uint8_t b;
+    uint16_t i;                 /*Sequence byte and payload, up to 256*/
+
+    for (i = 0; i < ring->size + 1U; i++) {
+        ee_read(addr + i, &b, 1);
+        if (i == 0) *seq = b;
+        if (b != 0xFF) blank = false;
+        crc = _crc8_ccitt_update(crc, b);
+    }
+    ee_read(addr + ring->size + 1, &b, 1);
+    return !(blank && b == 0xFF) && b == crc;
+}
+
+// Finds the newest record, EE_EMPTY when no slot holds a valid one
+ee_error_t ee_ring_open(ee_ring_t* ring) {
+    uint8_t seq, next_seq;
+    uint8_t slot, next;
+
+    if (ring->slots == 0 || ring->slots == 0xFF) return EE_INVALID_ADDR;
+    if (ring->base + EE_RING_BYTES(ring->slots, ring->size) > EE_SIZE) return EE_INVALID_ADDR;
+
+    ring->newest = EE_RING_NONE;
+    for (slot = 0; slot < ring->slots; slot++) {
+        if (!ee_slot_valid(ring, slot, &seq)) continue;
+        next = (slot + 1 == ring->slots) ? 0 : slot + 1;
+        if (!ee_slot_valid(ring, next, &next_seq) || next_seq != (uint8_t)(seq + 1)) {
+            ring->newest = slot;
+            ring->seq = seq;
+            return EE_OK;
+        }
+    }
+    return EE_EMPTY;
+}
+
+ee_error_t ee_ring_load(const ee_ring_t* ring, void* data) {
+    if (ring->newest == EE_RING_NONE) return EE_EMPTY;
+    return ee_read(ee_slot_addr(ring, ring->newest) + 1, data, ring->size);
+}
+
+// Queues the record into the slot after the newest, CRC last so a torn
+// save never checks out
+ee_error_t ee_ring_save(ee_ring_t* ring, const void* data) {
+    const uint8_t* p = data;
+    uint8_t slot = 0;
+    uint8_t seq = 0;
+    uint8_t crc = EE_CRC_INIT;
+    uint16_t addr;
+    uint8_t i;
+
+    if (ring->newest != EE_RING_NONE) {
+        slot = (ring->newest + 1 == ring->slots) ? 0 : ring->newest + 1;
+        seq = ring->seq + 1;
+    }
+    addr = ee_slot_addr(ring, slot);
+
+    crc = _crc8_ccitt_update(crc, seq);
+    for (i = 0; i < ring->size; i++) crc = _crc8_ccitt_update(crc, p[i]);
+
+    ee_write(addr, &seq, 1);
+    ee_write(addr + 1, p, ring->size);
+    ee_write(addr + ring->size + 1, &crc, 1);
+
+    ring->newest = slot;
+    ring->seq = seq;
+    return EE_OK;
+}
@@ -0,0 +1,63 @@
+/***********************************************************************
+* Write-behind EEPROM driver                                           *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Keep the 3.4 ms EEPROM byte writes off the main loop and    *
+*          spread repeated saves over a ring of record slots           *
+*                                                                      *
+* ee_write() queues bytes and returns, the EE_READY interrupt programs *
+* them one at a time. A byte already queued is updated in place and a  *
+* byte that already holds the value is never programmed. ee_read()     *
+* serves from a small line cache that includes the queued bytes, a     *
+* miss pauses the queue once the write in flight is done (EERE is      *
+* ignored while EEPE is set) and so may wait up to one write time.     *
+*                                                                      *
+* A record ring keeps `slots` copies of a `size` byte record, each     *
+* laid out as seq, payload, CRC-8 over both. A save goes to the slot   *
+* after the newest with seq + 1, so the newest is the valid slot whose *
+* successor breaks the sequence, and a save torn by a reset fails its  *
+* CRC and leaves the one before it in charge.                          *
+***********************************************************************/
+
+#ifndef EE_H_
+#define EE_H_
+
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EE_SIZE (E2END + 1)
+#define EE_PEND_SIZE 16         /*Queued byte writes, power of two*/
+#define EE_CACHE_LINES 4
+#define EE_LINE 8               /*Bytes per cache line, power of two*/
+#define EE_CRC_INIT 0xFF        /*A zeroed slot never checks out, a blank one is refused*/
+
+typedef enum ee_error {
+    EE_OK,
+    EE_INVALID_ADDR,
+    EE_EMPTY            /*No valid record in the ring*/
+} ee_error_t;
+
+typedef struct ee_ring {
+    uint16_t base;      /*EEPROM address of slot 0*/
+    uint8_t slots;
+    uint8_t size;       /*Payload bytes*/
+    uint8_t newest;     /*Slot of the newest record, EE_RING_NONE if empty*/
+    uint8_t seq;        /*Its sequence number*/
+} ee_ring_t;
+
+#define EE_RING_NONE 0xFF
+#define EE_RING_INIT(base, slots, size) { (base), (slots), (size), EE_RING_NONE, 0 }
+#define EE_RING_BYTES(slots, size) ((uint16_t)(slots) * ((size) + 2U))
+
+void ee_init(void);
+ee_error_t ee_read(uint16_t addr, uint8_t* data, uint16_t len);
+ee_error_t ee_write(uint16_t addr, const uint8_t* data, uint16_t len);
+bool ee_busy(void);
+void ee_flush(void);
+
+ee_error_t ee_ring_open(ee_ring_t* ring);
+ee_error_t ee_ring_load(const ee_ring_t* ring, void* data);
+ee_error_t ee_ring_save(ee_ring_t* ring, const void* data);
+
+#endif //EE_H_
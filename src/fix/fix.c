@@ -0,0 +1,132 @@
+/***********************************************************************
+* Fixed point math                                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Sensor conversion and filtering without the float library   *
+***********************************************************************/
+
+#include "fix.h"
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+
+// sin(i * 90 / 64 degrees) in Q1.15, i = 0..64, the other three
+// quarters are mirror images
+static const uint16_t fix_sin_table[65] PROGMEM = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767
+};
+
+// log2(1 + i / 32) in Q0.16, i = 0..32, the last one clipped to 0xFFFF
+static const uint16_t fix_log2_table[33] PROGMEM = {
+    0x0000, 0x0B5D, 0x1664, 0x2119, 0x2B80, 0x359F, 0x3F78, 0x4910,
+    0x526A, 0x5B89, 0x646F, 0x6D20, 0x759D, 0x7DEA, 0x8608, 0x8DFA,
+    0x95C0, 0x9D5E, 0xA4D4, 0xAC24, 0xB350, 0xBA59, 0xC140, 0xC807,
+    0xCEAF, 0xD538, 0xDBA5, 0xE1F5, 0xE82A, 0xEE45, 0xF446, 0xFA2F,
+    0xFFFF
+};
+
+/************************** Arithmetic Stuff **************************/
+
+q8_8_t q8_from_q16(q16_16_t q) {
+    int32_t r;
+
+    if (q > Q16_16_MAX - 0x80) return Q8_8_MAX;
+    r = (q + 0x80) >> 8;
+    if (r > Q8_8_MAX) return Q8_8_MAX;
+    if (r < Q8_8_MIN) return Q8_8_MIN;
+    return (q8_8_t)r;
+}
+
+// Adds to a magnitude unless it would pass lim
+static bool q16_acc(uint32_t* r, uint32_t add, uint32_t lim) {
+    if (add > lim - *r) return false;
+    *r += add;
+    return true;
+}
+
+// The 64 bit product would pull in the slow __muldi3, so multiply the
+// magnitudes as four 16x16 partial products and keep the middle 32 bits
+q16_16_t q16_mul(q16_16_t a, q16_16_t b) {
+    bool neg = (a < 0) != (b < 0);
+    uint32_t ua = (a < 0) ? 0UL - (uint32_t)a : (uint32_t)a;
+    uint32_t ub = (b < 0) ? 0UL - (uint32_t)b : (uint32_t)b;
+    uint32_t lim = neg ? 0x80000000UL : 0x7FFFFFFFUL;
+    uint16_t ah = ua >> 16, al = (uint16_t)ua;
+    uint16_t bh = ub >> 16, bl = (uint16_t)ub;
+    uint32_t hi = (uint32_t)ah * bh;
+    uint32_t r;
+
+    if (hi > (lim >> 16)) goto saturate;
+    r = hi << 16;
+    if (!q16_acc(&r, (uint32_t)ah * bl, lim)) goto saturate;
+    if (!q16_acc(&r, (uint32_t)al * bh, lim)) goto saturate;
+    if (!q16_acc(&r, ((uint32_t)al * bl + 0x8000UL) >> 16, lim)) goto saturate;
+    return neg ? (q16_16_t)(0UL - r) : (q16_16_t)r;
+
+saturate:
+    return neg ? Q16_16_MIN : Q16_16_MAX;
+}
+
+/************************** Function Stuff ****************************/
+
+// Floor of the square root, one result bit per pass, no multiplies
+uint16_t fix_isqrt(uint32_t x) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+// 256 steps per turn, 1.4 degrees, no interpolation needed
+q15_t fix_sin(uint8_t angle) {
+    uint8_t i = angle & 0x3F;
+    q15_t s;
+
+    if (angle & 0x40) i = 64 - i;
+    s = (q15_t)pgm_read_word(&fix_sin_table[i]);
+    return (angle & 0x80) ? -s : s;
+}
+
+q15_t fix_cos(uint8_t angle) {
+    return fix_sin(angle + 64);
+}
+
+// Whole part from the top set bit, fraction from the next 5 bits into
+// the table and the 16 below them between two entries. log2(0) is the
+// most negative value.
+q8_8_t fix_log2(uint32_t x) {
+    uint8_t n = 31;
+    uint16_t lo, hi, rem;
+    uint8_t i;
+    uint16_t f;
+
+    if (x == 0) return Q8_8_MIN;
+    while (!(x & 0x80000000UL)) {
+        x <<= 1;
+        n--;
+    }
+
+    i = (x >> 26) & 0x1F;
+    rem = (uint16_t)(x >> 10);
+    lo = pgm_read_word(&fix_log2_table[i]);
+    hi = pgm_read_word(&fix_log2_table[i + 1]);
+    f = lo + (uint16_t)(((uint32_t)(hi - lo) * rem) >> 16);
+    return (q8_8_t)(((uint16_t)n << 8) + ((f + 0x80UL) >> 8));
+}
@@ -0,0 +1,137 @@
+/***********************************************************************
+* Fixed point math                                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Sensor conversion and filtering without the float library   *
+*                                                                      *
+* The AVR has an 8x8 hardware multiply and nothing for floats: a float *
+* multiply is a libgcc call of ~100 cycles, a divide ~500 and sinf()   *
+* or logf() thousands, plus 1-2 KB of flash for the soft float code.   *
+* These types keep the numbers in integers with a fixed binary point:  *
+*                                                                      *
+*   q8_8_t    int16_t, 8 fraction bits, -128 .. 127.996                *
+*   q16_16_t  int32_t, 16 fraction bits, -32768 .. 32767.99998         *
+*   q15_t     int16_t, 15 fraction bits, -1 .. 0.99997, for sine       *
+*                                                                      *
+* Add, subtract and multiply saturate at the type limits rather than   *
+* wrap, so a filter that overshoots clips instead of changing sign.    *
+* Multiplies round to nearest. Q8_8() and Q16_16() turn a constant     *
+* into its fixed point value at compile time.                          *
+*                                                                      *
+* fix_udiv() divides by a constant with a multiply by its reciprocal:  *
+* FIX_RECIP(d) folds at compile time and one correction step makes     *
+* the result exact for every 16 bit dividend. fix_sin() reads a        *
+* quarter wave PROGMEM table, fix_log2() interpolates a 33 entry one.  *
+* bench/bench_fix.c has the cycle counts against the float versions.   *
+***********************************************************************/
+
+#ifndef FIX_H_
+#define FIX_H_
+
+#include <stdint.h>
+
+typedef int16_t q8_8_t;
+typedef int32_t q16_16_t;
+typedef int16_t q15_t;
+
+#define Q8_8_ONE    ((q8_8_t)0x0100)
+#define Q8_8_MAX    ((q8_8_t)INT16_MAX)
+#define Q8_8_MIN    ((q8_8_t)INT16_MIN)
+#define Q16_16_ONE  ((q16_16_t)0x00010000L)
+#define Q16_16_MAX  ((q16_16_t)INT32_MAX)
+#define Q16_16_MIN  ((q16_16_t)INT32_MIN)
+
+// Constants only, a variable argument pulls in the float library
+#define Q8_8(x)     ((q8_8_t)((x) * 256.0 + ((x) < 0 ? -0.5 : 0.5)))
+#define Q16_16(x)   ((q16_16_t)((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+// Whole part, truncating towards minus infinity like a shift
+#define Q8_8_INT(q)     ((int8_t)((q) >> 8))
+#define Q16_16_INT(q)   ((int16_t)((q) >> 16))
+
+// Reciprocal rounded up, 2^16 / d, d constant and nonzero
+#define FIX_RECIP(d)    ((uint32_t)((0x10000UL + (d) - 1) / (d)))
+
+// Angles in binary degrees, 256 per turn, so they wrap for free
+#define FIX_DEG(deg)    ((uint8_t)((deg) * 256L / 360))
+
+/************************** Conversions *******************************/
+
+static inline q8_8_t q8_from_int(int8_t i) {
+    return (q8_8_t)((uint16_t)i << 8);
+}
+
+static inline q16_16_t q16_from_int(int16_t i) {
+    return (q16_16_t)((uint32_t)i << 16);
+}
+
+static inline q16_16_t q16_from_q8(q8_8_t q) {
+    return (q16_16_t)q << 8;
+}
+
+q8_8_t q8_from_q16(q16_16_t q);
+
+/************************** Saturating Arithmetic *********************/
+
+static inline q8_8_t q8_add(q8_8_t a, q8_8_t b) {
+    int32_t r = (int32_t)a + b;
+
+    if (r > Q8_8_MAX) return Q8_8_MAX;
+    if (r < Q8_8_MIN) return Q8_8_MIN;
+    return (q8_8_t)r;
+}
+
+static inline q8_8_t q8_sub(q8_8_t a, q8_8_t b) {
+    int32_t r = (int32_t)a - b;
+
+    if (r > Q8_8_MAX) return Q8_8_MAX;
+    if (r < Q8_8_MIN) return Q8_8_MIN;
+    return (q8_8_t)r;
+}
+
+// 16x16 product, rounded back to 8 fraction bits
+static inline q8_8_t q8_mul(q8_8_t a, q8_8_t b) {
+    int32_t r = ((int32_t)a * b + 0x80) >> 8;
+
+    if (r > Q8_8_MAX) return Q8_8_MAX;
+    if (r < Q8_8_MIN) return Q8_8_MIN;
+    return (q8_8_t)r;
+}
+
+// Overflow only if the signs agree and the sum's does not
+static inline q16_16_t q16_add(q16_16_t a, q16_16_t b) {
+    q16_16_t r = (q16_16_t)((uint32_t)a + (uint32_t)b);
+
+    if ((a ^ r) & (b ^ r) & Q16_16_MIN) return (a < 0) ? Q16_16_MIN : Q16_16_MAX;
+    return r;
+}
+
+static inline q16_16_t q16_sub(q16_16_t a, q16_16_t b) {
+    q16_16_t r = (q16_16_t)((uint32_t)a - (uint32_t)b);
+
+    if ((a ^ b) & (a ^ r) & Q16_16_MIN) return (a < 0) ? Q16_16_MIN : Q16_16_MAX;
+    return r;
+}
+
+q16_16_t q16_mul(q16_16_t a, q16_16_t b);
+
+/************************** Division by Constants *********************/
+
+// x / d for a constant d, a 16x32 multiply and one 16x16 check instead
+// of the ~200 cycle __udivmodhi4 loop. The reciprocal is rounded up so
+// the estimate is never low and at most one too high.
+static inline uint16_t fix_udiv(uint16_t x, uint16_t d) {
+    uint16_t q = (uint16_t)(((uint32_t)x * FIX_RECIP(d)) >> 16);
+
+    if ((uint32_t)q * d > x) q--;
+    return q;
+}
+
+/************************** Functions *********************************/
+
+uint16_t fix_isqrt(uint32_t x);
+q15_t fix_sin(uint8_t angle);
+q15_t fix_cos(uint8_t angle);
+q8_8_t fix_log2(uint32_t x);
+
+#endif //FIX_H_
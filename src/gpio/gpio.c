@@ -8,6 +8,11 @@
 ***********************************************************************/
 
 #include "gpio.h"
+#include "prof.h"
+#include "counter.h"
+#include <util/atomic.h>
+
+static gpio_stats_t gpio_stat;
 
 // try to break some of this out into static functions
 
@@ -114,7 +119,7 @@ gpio_error_t gpio_pin_init(gpio_port_t port, gpio_dir_t dir, uint8_t pin) {
 // this mask is only to allow writes when the entire port is not initialized,
 // but since assignment operation used, 0's wil be written possibly in port bits
 // that are uninitialized
-gpio_error_t gpio_port_write(gpio_port_t port, uint8_t val, uint8_t mask) {
+static gpio_error_t gpio_port_write_(gpio_port_t port, uint8_t val, uint8_t mask) {
 	switch(port) {
 		case(GPIO_B):
 			if (DDRB == (0xFF & mask) || DDRB == 0xFF) PORTB = val;
@@ -136,7 +141,8 @@ gpio_error_t gpio_port_write(gpio_port_t port, uint8_t val, uint8_t mask) {
 	return GPIO_OK;
 }
 
-gpio_error_t gpio_pin_write(gpio_port_t port, uint8_t pin, bit_t state) {
+static gpio_error_t gpio_pin_write_(gpio_port_t port, uint8_t pin, bit_t state) {
+	PROF_SCOPE(PROF_GPIO_PIN_WRITE);
 	switch(port) {
 		case(GPIO_B):
 			if(pin < 8) {
@@ -178,7 +184,7 @@ gpio_error_t gpio_pin_write(gpio_port_t port, uint8_t pin, bit_t state) {
 	return GPIO_OK;
 }
 
-gpio_error_t gpio_port_read(gpio_port_t port, uint8_t* result, uint8_t mask) {
+static gpio_error_t gpio_port_read_(gpio_port_t port, uint8_t* result, uint8_t mask) {
 	switch(port) {
 		case(GPIO_B):
 			if (DDRB == (0x00 | ~mask) || DDRB == 0x00) *result = PINB;
@@ -199,7 +205,7 @@ gpio_error_t gpio_port_read(gpio_port_t port, uint8_t* result, uint8_t mask) {
 	return GPIO_OK;
 }
 
-gpio_error_t gpio_pin_read(gpio_port_t port, uint8_t pin, bit_t* result) {
+static gpio_error_t gpio_pin_read_(gpio_port_t port, uint8_t pin, bit_t* result) {
 	// input_pullup mode auto inverts the values read so that theyre consisten
 	switch(port) {
 		case(GPIO_B):
@@ -222,4 +228,41 @@ gpio_error_t gpio_pin_read(gpio_port_t port, uint8_t pin, bit_t* result) {
 		}
 
 	return GPIO_OK;
-}
\ No newline at end of file
+}
+
+/************************** Counted Access ****************************/
+
+// Tallies a read or write, or the reason it was refused
+static gpio_error_t gpio_count(gpio_error_t err, uint32_t* ok) {
+	if (err == GPIO_OK) STAT_INC(*ok);
+	else STAT_INC(gpio_stat.errors);
+	return err;
+}
+
+gpio_error_t gpio_port_write(gpio_port_t port, uint8_t val, uint8_t mask) {
+	return gpio_count(gpio_port_write_(port, val, mask), &gpio_stat.writes);
+}
+
+gpio_error_t gpio_pin_write(gpio_port_t port, uint8_t pin, bit_t state) {
+	return gpio_count(gpio_pin_write_(port, pin, state), &gpio_stat.writes);
+}
+
+gpio_error_t gpio_port_read(gpio_port_t port, uint8_t* result, uint8_t mask) {
+	return gpio_count(gpio_port_read_(port, result, mask), &gpio_stat.reads);
+}
+
+gpio_error_t gpio_pin_read(gpio_port_t port, uint8_t pin, bit_t* result) {
+	return gpio_count(gpio_pin_read_(port, pin, result), &gpio_stat.reads);
+}
+
+void gpio_stats(gpio_stats_t* stats) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*stats = gpio_stat;
+	}
+}
+
+void gpio_stats_reset(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		gpio_stat = (gpio_stats_t){0};
+	}
+}
@@ -36,6 +36,14 @@ typedef enum gpio_port {
 	GPIO_D
 } gpio_port_t;
 
+// Saturating, see counter.h, for calls from the main loop. A refused
+// read or write counts as an error rather than a read or write.
+typedef struct gpio_stats {
+	uint32_t writes;
+	uint32_t reads;
+	uint16_t errors;
+} gpio_stats_t;
+
 #define OFFSET_PIN  0x00
 #define OFFSET_DIR  0x01
 #define OFFSET_PORT 0x02
@@ -52,4 +60,7 @@ gpio_error_t gpio_port_read(gpio_port_t port, uint8_t* result, uint8_t mask);
 gpio_error_t gpio_pin_write(gpio_port_t port, uint8_t pin, bit_t state);
 gpio_error_t gpio_port_write(gpio_port_t port, uint8_t val, uint8_t mask);
 
+void gpio_stats(gpio_stats_t* stats);
+void gpio_stats_reset(void);
+
 #endif //GPIO_H_
@@ -0,0 +1,68 @@
+/***********************************************************************
+* Interrupt latency budgets and preemptible handlers                   *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Watch how late the time-critical vectors are entered and    *
+*          let slow handler bodies run with interrupts enabled         *
+***********************************************************************/
+
+#include "irq.h"
+#include <util/atomic.h>
+
+irq_probe_t irq_probe[IRQ_COUNT];
+uint8_t irq_busy = 0;
+uint8_t irq_again = 0;
+
+// Called by the driver that owns the vector whenever it sets its timer
+// up. psc is the prescaler, a power of two, budget is in timer counts.
+void irq_watch(irq_id_t id, uint16_t psc, uint8_t budget) {
+    uint8_t shift = 0;
+
+    if (id >= IRQ_COUNT) return;
+    while ((1U << shift) < psc) shift++;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        irq_probe[id].shift = shift;
+        irq_probe[id].budget = budget;
+    }
+}
+
+void irq_stats(irq_id_t id, irq_stats_t* stats) {
+    irq_probe_t p;
+
+    if (id >= IRQ_COUNT) return;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        p = irq_probe[id];
+    }
+    stats->count = p.count;
+    stats->late = p.late;
+    stats->nested = p.nested;
+    stats->latency_max = (uint32_t)p.max << p.shift;
+    stats->budget = (uint32_t)p.budget << p.shift;
+}
+
+// Budgets stay, they belong to the drivers
+void irq_stats_reset(void) {
+    uint8_t i;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        for (i = 0; i < IRQ_COUNT; i++) {
+            irq_probe[i].count = 0;
+            irq_probe[i].late = 0;
+            irq_probe[i].nested = 0;
+            irq_probe[i].max = 0;
+        }
+    }
+}
+
+// Worst entry latency of any timed vector, in CPU cycles
+uint32_t irq_masked_max(void) {
+    irq_stats_t st;
+    uint32_t worst = 0;
+    uint8_t i;
+
+    for (i = 0; i < IRQ_COUNT; i++) {
+        irq_stats((irq_id_t)i, &st);
+        if (st.latency_max > worst) worst = st.latency_max;
+    }
+    return worst;
+}
@@ -0,0 +1,115 @@
+/***********************************************************************
+* Interrupt latency budgets and preemptible handlers                   *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Watch how late the time-critical vectors are entered and    *
+*          let slow handler bodies run with interrupts enabled         *
+*                                                                      *
+* The AVR has no interrupt priorities: once a handler runs, every      *
+* other vector waits for its reti, as it waits for a critical section. *
+*                                                                      *
+* Timed vectors: a compare match sets its flag at a known count, so    *
+* the counter read on entry says how late the ISR is. irq_stamp()      *
+* keeps the worst and counts entries over the budget the driver set    *
+* with irq_watch(). A late entry was held off by interrupts being      *
+* masked, so irq_masked_max() is the longest interrupt-disabled time   *
+* the run has met, to within a count of the slowest timer.             *
+*                                                                      *
+* Preemptible bodies: irq_open() enables interrupts for the rest of a  *
+* handler. ISR_NOBLOCK does so before the first line, too early for a  *
+* source whose flag is not cleared on entry; here the handler masks or *
+* clears its source first. A vector that fires again while its body    *
+* runs is counted in nested and irq_close() sends the running body     *
+* round once more, bodies never run inside themselves.                 *
+***********************************************************************/
+
+#ifndef IRQ_H_
+#define IRQ_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "counter.h"
+
+// Ids index the probe table, add new ones before IRQ_COUNT
+typedef enum irq_id {
+    IRQ_SYSTICK,        /*TIMER0_COMPA_vect, timed*/
+    IRQ_SUART_TX,       /*TIMER2_COMPA_vect, timed*/
+    IRQ_SUART_RX,       /*TIMER2_COMPB_vect, timed*/
+    IRQ_ACOMP,          /*ANALOG_COMP_vect callback, preemptible*/
+    IRQ_TMR1_CTC,       /*TIMER1_COMPA_vect callback, preemptible*/
+    IRQ_COUNT
+} irq_id_t;
+
+_Static_assert(IRQ_COUNT <= 8, "irq_busy has one bit per id");
+
+// Latency and budget in CPU cycles at the clock they were taken at
+typedef struct irq_stats {
+    uint16_t count;         /*Entries, or body runs for a preemptible one*/
+    uint16_t late;          /*Timed entries over the budget*/
+    uint16_t nested;        /*Entries that found the body running*/
+    uint32_t latency_max;
+    uint32_t budget;
+} irq_stats_t;
+
+// Kept in the timer's own counts so the ISR side is byte compares only
+typedef struct irq_probe {
+    uint16_t count;
+    uint16_t late;
+    uint16_t nested;
+    uint8_t max;
+    uint8_t budget;
+    uint8_t shift;          /*log2 of the timer's prescaler*/
+} irq_probe_t;
+
+// For the inline functions below, use the calls at the end elsewhere
+extern irq_probe_t irq_probe[IRQ_COUNT];
+extern uint8_t irq_busy;
+extern uint8_t irq_again;
+
+// First thing in a timed ISR, late is the counts since the match
+static inline void irq_stamp(irq_id_t id, uint8_t late) {
+    irq_probe_t* p = &irq_probe[id];
+
+    STAT_INC(p->count);
+    if (late > p->max) p->max = late;
+    if (late > p->budget) STAT_INC(p->late);
+}
+
+// Lets every interrupt in for the rest of the handler. False if the body
+// is already running further down the stack, which then runs it again.
+static inline bool irq_open(irq_id_t id) {
+    irq_probe_t* p = &irq_probe[id];
+
+    if (irq_busy & (1 << id)) {
+        STAT_INC(p->nested);
+        irq_again |= (1 << id);
+        return false;
+    }
+    irq_busy |= (1 << id);
+    STAT_INC(p->count);
+    sei();
+    return true;
+}
+
+// Masks interrupts before the handler returns. True, with interrupts
+// enabled again, if the vector fired meanwhile and the body is due again.
+static inline bool irq_close(irq_id_t id) {
+    cli();
+    if (irq_again & (1 << id)) {
+        irq_again &= ~(1 << id);
+        STAT_INC(irq_probe[id].count);
+        sei();
+        return true;
+    }
+    irq_busy &= ~(1 << id);
+    return false;
+}
+
+void irq_watch(irq_id_t id, uint16_t psc, uint8_t budget);
+void irq_stats(irq_id_t id, irq_stats_t* stats);
+void irq_stats_reset(void);
+uint32_t irq_masked_max(void);
+
+#endif //IRQ_H_
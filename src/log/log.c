@@ -0,0 +1,279 @@
+/***********************************************************************
+* Timestamped data logging pipeline                                    *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Take fixed size sample records from producers, ISRs         *
+*          included, pack them into compact batches and hand full      *
+*          batches to a sink without ever blocking the producers       *
+***********************************************************************/
+
+#include "log.h"
+#include "systick.h"
+#include "uart.h"
+#include "twi_hal.h"
+#include <string.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_TAG_SAME_V 0x80
+#define LOG_TAG_SAME_T 0x40
+
+_Static_assert((LOG_RING_SIZE & LOG_RING_MASK) == 0 && LOG_RING_SIZE <= 256, "LOG_RING_SIZE must be a power of two up to 256");
+_Static_assert(LOG_HIGH_WATER < LOG_RING_SIZE, "LOG_HIGH_WATER must leave room in the ring");
+_Static_assert(LOG_BATCH_SIZE >= LOG_HEADER + LOG_REC_MAX + 1 && LOG_BATCH_SIZE < 256, "LOG_BATCH_SIZE must hold one record and fit the length byte");
+_Static_assert((LOG_24C_SIZE & (LOG_24C_SIZE - 1)) == 0 && (LOG_24C_PAGE & (LOG_24C_PAGE - 1)) == 0, "24C size and page must be powers of two");
+
+// Record ring, any number of producers under a critical section, log_task() consumes
+static log_rec_t log_ring[LOG_RING_SIZE];
+static volatile uint8_t log_head = 0;
+static volatile uint8_t log_tail = 0;
+
+// Open batch, or the closed one waiting on the sink
+static uint8_t log_batch[LOG_BATCH_SIZE];
+static uint8_t log_len = 0;
+static uint8_t log_count = 0;
+static uint8_t log_sent = 0;
+static bool log_closed = false;
+static bool log_flush_req = false;
+static deadline_t log_due;
+static uint32_t log_t_prev;
+static uint16_t log_last[LOG_SRC_COUNT];
+
+static log_sink_fn log_sink = 0;
+static log_stats_t log_stat;
+
+static uint8_t log_uart_left = 0;       /*Batch bytes still to print*/
+static uint8_t log_uart_at = 0;         /*Offset of the next one in its batch*/
+static uint16_t log_24c_at = 0;         /*Next byte address in the 24C16*/
+
+/************************** Stage 1: Capture **************************/
+
+// A NULL sink throws the batches away
+void log_init(log_sink_fn sink) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        log_head = log_tail = 0;
+        log_stat = (log_stats_t){0};
+    }
+    log_len = log_count = log_sent = 0;
+    log_closed = log_flush_req = false;
+    log_sink = sink;
+    log_uart_left = 0;
+    log_uart_at = 0;
+    log_24c_at = 0;
+}
+
+// Safe from ISRs, never blocks
+log_error_t log_put(log_src_t src, uint8_t ch, uint16_t value) {
+    uint32_t ms = systick_millis();
+    log_rec_t* r;
+    uint8_t fill;
+
+    if (src >= LOG_SRC_COUNT || ch > 0x0F) return LOG_INVALID_CH;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        fill = (uint8_t)(log_head - log_tail) & LOG_RING_MASK;
+        if (fill == LOG_RING_MASK) {
+            log_stat.dropped++;
+            return LOG_FULL;
+        }
+        r = &log_ring[log_head];
+        r->ms = ms;
+        r->src = src;
+        r->ch = ch;
+        r->value = value;
+        log_head = (log_head + 1) & LOG_RING_MASK;
+
+        log_stat.logged++;
+        if (fill + 1 > log_stat.peak) log_stat.peak = fill + 1;
+    }
+    return LOG_OK;
+}
+
+// Seconds, minutes, hours as the DS3231 keeps them, 24 hour mode
+log_error_t log_rtc(const uint8_t* bcd) {
+    uint32_t sod;
+
+    sod = (uint32_t)((bcd[2] >> 4) * 10 + (bcd[2] & 0x0F)) * 3600UL
+        + (uint16_t)((bcd[1] >> 4) * 10 + (bcd[1] & 0x0F)) * 60U
+        + (uint8_t)(((bcd[0] >> 4) & 0x07) * 10 + (bcd[0] & 0x0F));
+    return log_put(LOG_SRC_RTC, (uint8_t)(sod >> 16), (uint16_t)sod);
+}
+
+bool log_backpressure(void) {
+    return ((uint8_t)(log_head - log_tail) & LOG_RING_MASK) >= LOG_HIGH_WATER;
+}
+
+static bool log_get(log_rec_t* r) {
+    uint8_t tail = log_tail;
+
+    if (tail == log_head) return false;
+    *r = log_ring[tail];
+    log_tail = (tail + 1) & LOG_RING_MASK;
+    return true;
+}
+
+/************************** Stage 2: Compact **************************/
+
+static uint8_t* log_varint(uint8_t* p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static void log_encode(const log_rec_t* r) {
+    uint8_t* p;
+    uint8_t tag = (r->src << 4) | r->ch;
+    int32_t dv;
+    uint32_t dt, zz;
+
+    if (log_count == 0) {
+        log_len = LOG_HEADER;
+        log_t_prev = r->ms;
+        memcpy(&log_batch[3], &r->ms, sizeof(r->ms));      /*Little endian on both ends*/
+        memset(log_last, 0, sizeof(log_last));
+        deadline_set(&log_due, LOG_BATCH_MS);
+    }
+
+    dt = r->ms - log_t_prev;
+    dv = (int32_t)r->value - (int32_t)log_last[r->src];
+    zz = (dv < 0) ? ~((uint32_t)dv << 1) : ((uint32_t)dv << 1);
+    if (dt == 0) tag |= LOG_TAG_SAME_T;
+    if (zz == 0) tag |= LOG_TAG_SAME_V;
+
+    p = &log_batch[log_len];
+    *p++ = tag;
+    if (dt) p = log_varint(p, dt);
+    if (zz) p = log_varint(p, zz);
+
+    log_len = (uint8_t)(p - log_batch);
+    log_count++;
+    log_t_prev = r->ms;
+    log_last[r->src] = r->value;
+    log_stat.bytes_in += sizeof(log_rec_t);
+}
+
+/************************** Stage 3: Flush ****************************/
+
+static void log_close(void) {
+    uint8_t crc = 0xFF;
+    uint8_t i;
+
+    log_batch[0] = LOG_MAGIC;
+    log_batch[1] = log_len + 1;
+    log_batch[2] = log_count;
+    for (i = 0; i < log_len; i++) crc = _crc8_ccitt_update(crc, log_batch[i]);
+    log_batch[log_len++] = crc;
+
+    log_closed = true;
+    log_sent = 0;
+}
+
+// Offers the closed batch to the sink, true once all of it is gone
+static bool log_drain(void) {
+    uint8_t n;
+
+    while (log_sent < log_len) {
+        n = log_sink ? log_sink(&log_batch[log_sent], log_len - log_sent) : log_len - log_sent;
+        if (n == 0) {
+            log_stat.sink_busy++;
+            return false;
+        }
+        log_sent += n;
+        log_stat.bytes_out += n;
+    }
+    log_stat.batches++;
+    log_closed = false;
+    log_len = log_count = 0;
+    return true;
+}
+
+// Run from the main loop, returns quickly whatever the sink does
+void log_task(void) {
+    log_rec_t r;
+    bool full;
+
+    // A closed batch has to go before the next one opens
+    if (log_closed && !log_drain()) return;
+
+    while (log_len + LOG_REC_MAX + 1 <= LOG_BATCH_SIZE && log_get(&r)) log_encode(&r);
+
+    // A flush with nothing open has nothing to close, it must not cut
+    // the next batch short
+    full = (log_len + LOG_REC_MAX + 1 > LOG_BATCH_SIZE);
+    if (log_count == 0) log_flush_req = false;
+    else if (full || log_flush_req || deadline_expired(&log_due)) {
+        log_flush_req = false;
+        log_close();
+        log_drain();
+    }
+}
+
+// Closes the open batch without waiting for it to fill, does not wait
+// for the sink either
+void log_flush(void) {
+    log_flush_req = true;
+    log_task();
+}
+
+void log_stats(log_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = log_stat;
+    }
+}
+
+void log_stats_reset(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        log_stat = (log_stats_t){0};
+    }
+}
+
+/************************** Sinks *************************************/
+
+// "D<offset><hex>" lines on the debug UART, each a whole line made of
+// what fits in the TX ring, so text from the other tasks only ever falls
+// between lines. The offset is where the piece sits in its batch, 00
+// starts a new batch, whose length byte tells where it ends.
+uint8_t log_sink_uart(const uint8_t* data, uint8_t len) {
+    static const char hex[] = "0123456789ABCDEF";
+    uint8_t space = uart_tx_space();
+    uint8_t n, i;
+
+    if (space < 7) return 0;
+    n = (space - 5) / 2;
+
+    if (log_uart_left == 0) {
+        log_uart_left = data[1];
+        log_uart_at = 0;
+    }
+    if (n > len) n = len;
+    if (n > log_uart_left) n = log_uart_left;
+
+    uart_transmit_byte('D');
+    uart_transmit_byte(hex[log_uart_at >> 4]);
+    uart_transmit_byte(hex[log_uart_at & 0x0F]);
+    for (i = 0; i < n; i++) {
+        uart_transmit_byte(hex[data[i] >> 4]);
+        uart_transmit_byte(hex[data[i] & 0x0F]);
+    }
+    uart_transmit_byte('\r');
+    uart_transmit_byte('\n');
+    log_uart_left -= n;
+    log_uart_at += n;
+    return n;
+}
+
+// Circular log in a 24C16, one page write per call. The part NACKs its
+// address for the 5 ms it is programming, which reads as busy here.
+uint8_t log_sink_24c(const uint8_t* data, uint8_t len) {
+    uint16_t at = log_24c_at;
+    uint8_t n = LOG_24C_PAGE - (at & (LOG_24C_PAGE - 1));
+
+    if (n > len) n = len;
+    if (twi_write(LOG_24C_ADDR | (uint8_t)(at >> 8), (uint8_t)at, (uint8_t*)data, n) != TWI_OK) return 0;
+    log_24c_at = (at + n) & (LOG_24C_SIZE - 1);
+    return n;
+}
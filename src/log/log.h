@@ -0,0 +1,92 @@
+/***********************************************************************
+* Timestamped data logging pipeline                                    *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Take fixed size sample records from producers, ISRs         *
+*          included, pack them into compact batches and hand full      *
+*          batches to a sink without ever blocking the producers       *
+*                                                                      *
+* Stage 1, log_put(): stamp the record with systick_millis() and add   *
+*   it to the record ring, or count a drop when the ring is full.      *
+*   log_backpressure() tells producers the ring is filling up so they  *
+*   can decimate before samples get dropped.                           *
+* Stage 2, log_task(): encode records into the open batch. Each one    *
+*   becomes a tag byte, the time since the previous record and the     *
+*   change from the last value of the same source, both as LEB128      *
+*   varints (the value zigzagged), with the varints left out when      *
+*   zero. Deltas restart every batch so each decodes on its own.       *
+* Stage 3, log_task(): a batch closes when the next record might not   *
+*   fit, after LOG_BATCH_MS, or on log_flush(), and is then offered to *
+*   the sink until it has taken every byte. A busy sink holds the      *
+*   batch, and the ring absorbs the samples meanwhile.                 *
+*                                                                      *
+* Batch: A5, length, count, t0 (u32 LE ms), records..., CRC-8 over all *
+* Tag:   bit 7 value unchanged, bit 6 time unchanged, 5:4 src, 3:0 ch  *
+***********************************************************************/
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LOG_RING_SIZE 16        /*Records, power of two up to 256*/
+#define LOG_HIGH_WATER 12       /*Ring fill where backpressure starts*/
+#define LOG_BATCH_SIZE 64       /*Bytes per batch including header and CRC*/
+#define LOG_BATCH_MS 1000       /*Oldest record waits at most this long*/
+#define LOG_MAGIC 0xA5
+#define LOG_HEADER 7
+#define LOG_REC_MAX 9           /*Tag, 5 byte time varint, 3 byte value varint*/
+
+typedef enum log_error {
+    LOG_OK,
+    LOG_FULL,           /*Record dropped*/
+    LOG_INVALID_CH
+} log_error_t;
+
+typedef enum log_src {
+    LOG_SRC_ADC,        /*ch mux channel, value the 10-bit result*/
+    LOG_SRC_RTC,        /*ch bit 16 and value bits 15:0 of the second of the day*/
+    LOG_SRC_GPIO,       /*ch pin, value port << 8 | level*/
+    LOG_SRC_USER,
+    LOG_SRC_COUNT
+} log_src_t;
+
+typedef struct log_rec {
+    uint32_t ms;
+    uint8_t src;
+    uint8_t ch;
+    uint16_t value;
+} log_rec_t;
+
+typedef struct log_stats {
+    uint32_t logged;
+    uint32_t dropped;
+    uint32_t batches;
+    uint32_t bytes_in;      /*Record bytes taken from the ring*/
+    uint32_t bytes_out;     /*Batch bytes taken by the sink*/
+    uint16_t sink_busy;     /*Times the sink took nothing*/
+    uint8_t peak;           /*Highest ring fill seen*/
+} log_stats_t;
+
+// Takes up to len bytes, returns how many, 0 while busy
+typedef uint8_t (*log_sink_fn)(const uint8_t* data, uint8_t len);
+
+void log_init(log_sink_fn sink);
+log_error_t log_put(log_src_t src, uint8_t ch, uint16_t value);
+log_error_t log_rtc(const uint8_t* bcd);
+bool log_backpressure(void);
+void log_task(void);
+void log_flush(void);
+void log_stats(log_stats_t* stats);
+void log_stats_reset(void);
+
+// Sinks
+#define LOG_24C_ADDR 0x50       /*24C16, eight 256 byte blocks at 0x50..0x57*/
+#define LOG_24C_SIZE 2048U
+#define LOG_24C_PAGE 16
+
+uint8_t log_sink_uart(const uint8_t* data, uint8_t len);
+uint8_t log_sink_24c(const uint8_t* data, uint8_t len);
+
+#endif //LOG_H_
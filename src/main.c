@@ -13,20 +13,52 @@
 #include <stdio.h>
 #include <stdbool.h>
 
-#define F_SCL 400000UL
-#define UART_BAUD 115200UL
-
+#include "board.h"
 #include "uart/uart.h"
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include "twi/twi_hal.h"
 #include "gpio/gpio_types.h"
 
 #include "adc/adc.h"
+#include "tmr1/tmr1.h"
+#include "systick/systick.h"
+#include "sched/sched.h"
+#include "pwr/pwr.h"
+#include "prof/prof.h"
+#include "mem/mem.h"
+#include "ee/ee.h"
+#include "log/log.h"
+#include "oled/oled.h"
+#include "stats/stats.h"
+#include "cmd/cmd.h"
+#include "irq/irq.h"
 
 #include <stdlib.h>  //itoa()
 
 #define RTC_ADDR 0x68 /*Address for DS3231 RTC clock*/
 
+/*EEPROM layout, 8 copies of the boot counter from address 0*/
+#define EE_BOOT_BASE  0x000
+#define EE_BOOT_SLOTS 8
+
+/*Task ids double as priorities, 0 runs first*/
+#define TASK_RTC   0
+#define TASK_ADC   1
+#define TASK_GPIOB 2
+#define TASK_GPIOD 3
+#define TASK_FLAGS 4
+#define TASK_STATS 5
+#define TASK_LOG   6
+#define TASK_OLED  7
+
+/*Command ids, see cmd.h for the framing*/
+#define CMD_ID_PING     0
+#define CMD_ID_REGS     1
+#define CMD_ID_STATS    2
+#define CMD_ID_ADC_RATE 3
+#define CMD_ID_CAPTURE  4
+
 uint8_t numBits = 6;
 uint8_t flagCount = 0;
 uint8_t i;					// bad name for a modular program
@@ -39,22 +71,353 @@ uint8_t print_buffer[24];
 uint8_t error;
 uint8_t count;
 
-bit_t *c0_val;
+bit_t c0_val;
 
 uint16_t adc_val;
 
+bool oled_present = false;
+
+uint32_t boot_count = 0;
+ee_ring_t boot_ring = EE_RING_INIT(EE_BOOT_BASE, EE_BOOT_SLOTS, sizeof(uint32_t));
+
+// BCD encoded, so hex values == decimal
+uint8_t rtc_data[7] = {0x50, 0x46, 0x20, 0x07, 0x16, 0x07, 0x23};
+
+// One pin of a port flashed per step, high then low
+typedef struct blink {
+	gpio_port_t port;
+	uint8_t mask;
+	uint8_t pin;
+	bool on;
+} blink_t;
+
+// Dont flash pinB1 (PWM output) or pinB6/7 (external oscillator pins)
+blink_t blink_b = {GPIO_B, 0x3D, 0, false};
+blink_t blink_d = {GPIO_D, 0xFC, 2, false};
+
+// Returns true once the last pin in the mask has been flashed
+static bool blink_step(blink_t* b) {
+	uint8_t first = b->pin;
+
+	if (!b->on) {
+		gpio_pin_write(b->port, b->pin, HIGH);
+		b->on = true;
+		return false;
+	}
+
+	gpio_pin_write(b->port, b->pin, LOW);
+	b->on = false;
+	uart_transmit_byte(b->pin + 0x30);
+	uart_transmit_string((unsigned char*)" done.");
+	uart_transmit_nl(1, false);
+
+	do {
+		b->pin = (b->pin + 1) & 0x07;
+	} while (!(b->mask & (1 << b->pin)));
+
+	return (b->pin <= first);
+}
+
+static void task_rtc(void) {
+	uint8_t err = twi_read(RTC_ADDR,0x00,rtc_data,sizeof(rtc_data));
+	if(err != TWI_OK){
+		memset(print_buffer,0,sizeof(print_buffer));
+		sprintf(print_buffer,"%d error %d\r\n\n",__LINE__,err);
+		uart_transmit_string((uint8_t*)print_buffer);
+	}
+	else {
+		memset(print_buffer,0,sizeof(print_buffer));
+		sprintf(print_buffer,"\r20%02x/%02x/%02x %02x:%02x:%02x",
+			rtc_data[6],
+			rtc_data[5],
+			rtc_data[4],
+			rtc_data[2],
+			rtc_data[1],
+			rtc_data[0]
+			);
+		uart_transmit_string((unsigned char*)print_buffer);
+		uart_transmit_nl(2, false);
+		log_rtc(rtc_data);
+		if (oled_present) oled_text(0, 0, (char*)print_buffer + 1);
+	}
+}
+
+static void task_adc(void) {
+	adc_read(ADC3, &adc_val);
+	log_put(LOG_SRC_ADC, ADC3, adc_val);
+	if (oled_present) oled_bar(0, 1, OLED_WIDTH, adc_val >> 3);
+
+	uart_transmit_string((unsigned char*)itoa(adc_val, print_buffer, 10));
+	uart_transmit_nl(2, false);
+}
+
+static void task_gpio_b(void) {
+	if (blink_step(&blink_b)) {
+		uart_transmit_string((unsigned char*)"Flashed bits 0:5 on port B");
+		uart_transmit_nl(2, false);
+	}
+}
+
+// Flashes bits 2:7 one at a time, then all at once, then reads PINC bit 0
+static void task_gpio_d(void) {
+	static uint8_t hold = 0;
+
+	if (hold) {
+		if (--hold) return;
+		gpio_port_write(GPIO_D, 0x00, 0xFC);
+
+		uart_transmit_string((unsigned char*)"Reading PINC bit 0");
+		uart_transmit_nl(2, false);
+
+		error = gpio_pin_read(GPIO_C, PINC0, &c0_val);
+		if (error == GPIO_OK) log_put(LOG_SRC_GPIO, PINC0, ((uint16_t)GPIO_C << 8) | c0_val);
+
+		if (c0_val == 1 && error == GPIO_OK) {
+			uart_transmit_string((unsigned char*)"Pin C0 is pulled up!");
+			uart_transmit_nl(2, false);
+		}
+		else if (c0_val == 0 && error == GPIO_OK) {
+			uart_transmit_string((unsigned char*)"Pin C0 is pulled down... :(");
+			uart_transmit_nl(2, false);
+		}
+		else {
+			uart_transmit_string((unsigned char*)"GPIO read error ");
+			uart_transmit_byte(error + 0x30);
+			uart_transmit_nl(2, false);
+		}
+
+		uart_transmit_string((unsigned char*)"All GPIO tests done.");
+		uart_transmit_nl(2, false);
+		return;
+	}
+
+	if (!blink_step(&blink_d)) return;
+
+	uart_transmit_string((unsigned char*)"Writing bits 2:7 on port D at once...");
+	uart_transmit_nl(2, false);
+
+	error = gpio_port_write(GPIO_D, 0xFF, 0xFC);
+	if (error != GPIO_OK) {
+		uart_transmit_string((unsigned char*)"Error ");
+		uart_transmit_byte(0x30 + error);
+		uart_transmit_nl(2, false);
+	}
+	hold = 3;	// keep them lit for a few steps
+}
+
+// One dirty region per run, so the RTC gets the bus in between
+static void task_oled(void) {
+	oled_update();
+}
+
+static void task_flags(void) {
+	uart_transmit_string((unsigned char*)"Starting UART Flag Check...");
+	uart_transmit_nl(2, false);
+
+	flagCount = 0;
+	for (i = maxBitPos; i >= maxBitPos - numBits; i--) {
+		// Dont increment for transmit complete or UDRE
+		if ((uart_check_flag(i) == true) && (!(i == TXC0) || (i == UDRE0))) flagCount++;
+	}
+
+	if (flagCount == 0) {
+		uart_transmit_string((unsigned char*)"No flags found.");
+		uart_transmit_nl(2, false);
+	}
+	else {
+		decToASCII(buff, flagCount);
+		uart_transmit_string((unsigned char*)buff);
+		uart_transmit_string((unsigned char*)" flags found.");
+		uart_transmit_nl(2, false);
+	}
+}
+
+// Payload: ADC task period in ms, u16 LE
+static cmd_status_t cmd_adc_rate(const uint8_t* arg, uint8_t len) {
+	uint16_t ms = arg[0] | ((uint16_t)arg[1] << 8);
+
+	(void)len;
+	if (ms == 0) return CMD_BAD_ARG;
+	sched_period(TASK_ADC, ms);
+	return CMD_OK;
+}
+
+// One ADC3 conversion now, replies the result and its systick_micros()
+static cmd_status_t cmd_capture(const uint8_t* arg, uint8_t len) {
+	uint16_t v;
+	uint32_t us = systick_micros();
+
+	(void)arg;
+	(void)len;
+	if (adc_read(ADC3, &v) != ADC_OK) return CMD_BUSY;
+	cmd_reply_begin(6);
+	cmd_reply_u16(v);
+	cmd_reply_u32(us);
+	return CMD_OK;
+}
+
+static const cmd_entry_t main_cmds[] PROGMEM = {
+	[CMD_ID_PING]     = {cmd_ping, 0, CMD_PAYLOAD_MAX},
+	[CMD_ID_REGS]     = {cmd_read_regs, 2, 2},
+	[CMD_ID_STATS]    = {cmd_dump_stats, 0, 0},
+	[CMD_ID_ADC_RATE] = {cmd_adc_rate, 2, 2},
+	[CMD_ID_CAPTURE]  = {cmd_capture, 0, 0},
+};
+
+// Every task id is taken, so requests are answered between tasks: a
+// received byte wakes the CPU and the request is parsed before it
+// sleeps again, waiting at most for the task running when it arrived.
+// Entered with interrupts masked, returns with them enabled.
+static void idle(void) {
+	sei();
+	if (cmd_poll()) return;
+	cli();
+	if (uart_rx_available()) sei();
+	else pwr_sleep();
+}
+
+// Per task: id, runs, busy us, longest run in us, deadline misses
+// Per sleep mode: mode, entries, microseconds asleep
+// SRAM: static bytes, deepest stack, stack now, bytes never touched
+// Log: records, drops, batches, record bytes in, batch bytes out, sink busy, ring peak
+// Drivers at one instant: ms, then
+//   I transactions, bytes, NACKs, start and restart failures, timeouts
+//   U bytes sent, received, overruns, frame and parity errors, RX ring drops
+//   A conversions, missed; G writes, reads, refused calls
+// Commands: requests, CRC errors, unknown ids, refused lengths, dropped
+// Per vector: id, entries, late entries, nested entries, worst latency, budget, in cycles
+// Per probe (make PROF=1): id, count, min, max, mean, histogram, in cycles
+static void task_stats(void) {
+	sched_stats_t st;
+	pwr_stats_t ps;
+	mem_stats_t ms;
+	log_stats_t ls;
+	stats_t ds;
+	cmd_stats_t cs;
+	irq_stats_t is;
+	uint8_t id;
+	char line[72];
+
+	for (id = 0; id < SCHED_MAX_TASKS; id++) {
+		if (sched_stats(id, &st) != SCHED_OK) continue;
+		sprintf(line, "T%u %lu %lu %lu %u",
+			id,
+			st.runs,
+			st.busy_us,
+			(unsigned long)st.max_us,
+			st.misses
+			);
+		uart_transmit_string((unsigned char*)line);
+		uart_transmit_nl(1, true);
+	}
+
+	pwr_stats(&ps);
+	for (id = 0; id < PWR_MODE_COUNT; id++) {
+		sprintf(line, "S%u %lu %lu", id, ps.entries[id], ps.sleep_us[id]);
+		uart_transmit_string((unsigned char*)line);
+		uart_transmit_nl(1, true);
+	}
+
+	mem_stats(&ms);
+	sprintf(line, "M %u %u %u %u", ms.static_bytes, ms.stack_peak, ms.stack_now, ms.free_min);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+
+	log_stats(&ls);
+	sprintf(line, "L %lu %lu %lu %lu %lu %u %u",
+		ls.logged,
+		ls.dropped,
+		ls.batches,
+		ls.bytes_in,
+		ls.bytes_out,
+		ls.sink_busy,
+		ls.peak
+		);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+
+	stats_snapshot(&ds);
+	sprintf(line, "N %lu", ds.ms);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+	sprintf(line, "I %lu %lu %u %u %u %u",
+		ds.twi.transactions,
+		ds.twi.bytes,
+		ds.twi.nacks,
+		ds.twi.start_fails,
+		ds.twi.restart_fails,
+		ds.twi.timeouts
+		);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+	sprintf(line, "U %lu %lu %u %u %u %u",
+		ds.uart.tx_bytes,
+		ds.uart.rx_bytes,
+		ds.uart.overruns,
+		ds.uart.frame_errors,
+		ds.uart.parity_errors,
+		ds.uart.rx_dropped
+		);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+	sprintf(line, "A %lu %u G %lu %lu %u",
+		ds.adc.conversions,
+		ds.adc.missed,
+		ds.gpio.writes,
+		ds.gpio.reads,
+		ds.gpio.errors
+		);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+
+	cmd_stats(&cs);
+	sprintf(line, "C %lu %u %u %u %u", cs.requests, cs.crc_errors, cs.unknown, cs.bad_len, cs.dropped);
+	uart_transmit_string((unsigned char*)line);
+	uart_transmit_nl(1, true);
+
+	for (id = 0; id < IRQ_COUNT; id++) {
+		irq_stats((irq_id_t)id, &is);
+		sprintf(line, "V%u %u %u %u %lu %lu", id, is.count, is.late, is.nested, is.latency_max, is.budget);
+		uart_transmit_string((unsigned char*)line);
+		uart_transmit_nl(1, true);
+	}
+
+	prof_dump();
+	uart_transmit_nl(1, false);
+}
+
 void main(void) {
 
-	uart_init(TX, false, NONE);
+	pwr_init();
+	// everything stays powered down in PRR until a driver acquires it
+
+	systick_init();
 
-	_delay_ms(10);
+	sei(); /*Enable interrupts, necessary for the system tick and I2C*/
+
+	uart_init(BOTH, true, NONE);
+	cmd_init(main_cmds, sizeof(main_cmds) / sizeof(main_cmds[0]));
+
+	log_init(log_sink_uart);
+	// samples go out as "D<offset><hex>" batch lines between the text
+
+	systick_delay_ms(10);
+
+	uart_transmit_string((unsigned char*)"UART configured for output and commands @ 115200 baud");
+	uart_transmit_nl(1, false);
 
-	uart_transmit_string((unsigned char*)"UART configured as output @ 115200 baud");
+	// Count this boot, the save is committed in the background
+	if (ee_ring_open(&boot_ring) == EE_OK) ee_ring_load(&boot_ring, &boot_count);
+	boot_count++;
+	ee_ring_save(&boot_ring, &boot_count);
+	sprintf((char*)print_buffer, "Boot %lu", boot_count);
+	uart_transmit_string(print_buffer);
 	uart_transmit_nl(1, false);
 
 	//adc_init(INTERNAL_VREF, FREE, ADC2/*PC6 alt fxn*/, false);
 
 	//ADCSRB |= ();                       //Set trigger source
+	pwr_acquire(PWR_ADC);
 	DDRC &= ~(1 << PINC3);
     ADMUX = 0x43;            //Select a mux channel to start and select voltage reference
     //ADMUX &= ~(1 << ADLAR);                 //Ensure bit ordering is consistent with the adc_read fxn
@@ -63,7 +426,8 @@ void main(void) {
     // set prescalar
     //ADCSRA |= ADCPSC_VAL;  // set PSC value so sample rate b/w 50kHz -- 200kHz for 10bit res
     //ADCSRA |= ((1 << ADEN) /*| (1 << ADATE) | (1 << ADSC)*/);
-	ADCSRA = 0x87;
+	ADCSRA = ADCPSC_VAL;	// adc_read() enables the ADC for each conversion
+	pwr_release(PWR_ADC);
 
 	uart_transmit_string((unsigned char*)"ADC initialized to read from PC6 with 1.1V internal reference");
 	uart_transmit_nl(1, false);
@@ -72,7 +436,7 @@ void main(void) {
 	// mask == 0xDF, omit bit 5
 	error = gpio_port_init(GPIO_B, DIR_OUTPUT, 0xFF);
 
-	_delay_ms(10);
+	systick_delay_ms(10);
 
 	if (error == GPIO_OK) {
 		uart_transmit_string((unsigned char*)"PORTB configured as output");
@@ -83,7 +447,7 @@ void main(void) {
 		error = gpio_pin_init(GPIO_D, DIR_OUTPUT, count);
 	}
 
-	_delay_ms(10);
+	systick_delay_ms(10);
     
 	if (error == GPIO_OK) {
 		uart_transmit_string((unsigned char*)"PORTD bits 2:7 configured as output");
@@ -93,7 +457,7 @@ void main(void) {
 	// initialization and reads are not workign with input pullup selected
 	error = gpio_pin_init(GPIO_C, DIR_INPUT_PULLUP, PINC0);
 
-	_delay_ms(10);
+	systick_delay_ms(10);
 
 	if (error == GPIO_OK) {
 		uart_transmit_string((unsigned char*)"PORTC bit 0 configured as input pullup");
@@ -106,18 +470,13 @@ void main(void) {
 		uart_transmit_nl(1, false);
 	}
 
-	twi_init(F_SCL, false);
+	twi_init(false);
 
-	_delay_ms(10);
+	systick_delay_ms(10);
 	
 	uart_transmit_string((unsigned char*)"TWI bit rate and SCL initialized");
 	uart_transmit_nl(1, false);
 
-	// BCD encoded, so hex values == decimal
-	uint8_t rtc_data[7] = {0x50, 0x46, 0x20, 0x07, 0x16, 0x07, 0x23};
-
-	sei(); /*Enable interrupts, necessary for I2C*/
-
 	uart_transmit_string((unsigned char*)"Taking control of and writing to I2C bus");
 	uart_transmit_nl(1, false);
 	
@@ -129,153 +488,39 @@ void main(void) {
 		//while(1);
 	}
 
-	DDRB |= (1 << DDB1);
-   	// PB1 as output
-   	OCR1A = 0x01FF;
-   	// set PWM for 50% duty cycle at 10bit
-   	TCCR1A |= (1 << COM1A1);
-   	// set non-inverting mode
-   	TCCR1A |= (1 << WGM11) | (1 << WGM10);
-   	// set 10bit phase corrected PWM Mode
-   	TCCR1B |= (1 << CS11);
-   	// set prescaler to 8 and starts PWM
+	// Status display on the same bus, optional
+	oled_present = (oled_init() == OLED_OK);
+
+#if PROF_ENABLE
+	prof_init();
+	// the profiler needs Timer1 free running, so no PWM on OC1A
+#else
+	TMR1_INIT(TMR1_PWM_PHASE, BOARD_PWM_HZ);
+	// phase correct PWM, prescaler and TOP picked at compile time
+	tmr1_pwm_enable(TMR1_CH_A, false);
+	// non-inverting output on OC1A, sets PB1 as output
+	tmr1_pwm_duty(TMR1_CH_A, TMR1_DUTY_PCT(50));
+	// 50% duty cycle
+#endif
     
-	_delay_ms(1000);
+	systick_delay_ms(1000);
 
 	uart_transmit_string((unsigned char*)"Initialization complete.");
 	uart_transmit_nl(2, false);
 
-	while(1) {
-		
-		err = twi_read(RTC_ADDR,0x00,rtc_data,sizeof(rtc_data));
-		if(err != TWI_OK){
-			memset(print_buffer,0,sizeof(print_buffer));
-			sprintf(print_buffer,"%d error %d\r\n\n",__LINE__,err);
-			uart_transmit_string((uint8_t*)print_buffer);
-			//while(1);
-		}
-		else {
-			memset(print_buffer,0,sizeof(print_buffer));
-			sprintf(print_buffer,"\r20%02x/%02x/%02x %02x:%02x:%02x",
-				rtc_data[6],
-				rtc_data[5],
-				rtc_data[4],
-				rtc_data[2],
-				rtc_data[1],
-				rtc_data[0]
-				);
-			uart_transmit_string((unsigned char*)print_buffer);
-			uart_transmit_nl(2, false);
-
-		//adc_read(ADC3, *adc_val);
-		}
-
-		ADCSRA |= (1 << ADSC);  
-    	while((ADCSRA & (1 << ADIF)) == 0);
-    	_delay_us(10);
-    	// the below line will change according the the ADLAR bit
-    	adc_val = (ADCL | ((ADCH & 0x03) << 8))&(0x3FF);
-		//*adc_val |= ADCL;
-		//*adc_val |= ((ADCH & 0x03) << 8);
-		//*adc_val &= (0x3FF);
-
-		uart_transmit_string((unsigned char*)itoa(adc_val, print_buffer, 10));
-		uart_transmit_nl(2, false);
-
-		uart_transmit_string((unsigned char*)"Flashing bits 0:5 on port B...");
-		uart_transmit_nl(2, false);
-
-		// Dont flash pinB6 or 7; external oscillator pins
-		for (i = 0; i <= maxBitPos - 2; i++) {
-			if(i!=1) {
-				gpio_pin_write(GPIO_B, i, HIGH);
-				_delay_ms(100);
-				gpio_pin_write(GPIO_B, i, LOW);
-				_delay_ms(100);
-				uart_transmit_byte(i + 0x30);
-				uart_transmit_string((unsigned char*)" done.");
-				uart_transmit_nl(1, false);
-			}
-		}
-
-		uart_transmit_nl(1, false);
-		_delay_ms(100);
-
-		uart_transmit_string((unsigned char*)"Flashing bits 2:7 on port D...");
-		uart_transmit_nl(2, false);
-
-		// Dont flash pinB6 or 7; external oscillator pins
-		for (i = 2; i <= maxBitPos; i++) {
-			gpio_pin_write(GPIO_D, i, HIGH);
-			_delay_ms(100);
-			gpio_pin_write(GPIO_D, i, LOW);
-			_delay_ms(100);
-			uart_transmit_byte(i + 0x30);
-			uart_transmit_string((unsigned char*)" done.");
-			uart_transmit_nl(1, false);
-		}
-		
-		uart_transmit_nl(1, false);
-		_delay_ms(100);
-
-		uart_transmit_string((unsigned char*)"Writing bits 2:7 on port D at once...");
-		uart_transmit_nl(2, false);
-
-		error = 0;
-		error = gpio_port_write(GPIO_D, 0xFF, 0xFC);
-		if (error != GPIO_OK) {
-			uart_transmit_string((unsigned char*)"Error ");
-			uart_transmit_byte(0x30 + error);
-			uart_transmit_nl(2, false);
-		}
-		_delay_ms(250);
-		gpio_port_write(GPIO_D, 0x00, 0xFC);
-
-		uart_transmit_string((unsigned char*)"Reading PINC bit 0");
-		uart_transmit_nl(2, false);
-
-		error = 0;
-		error = gpio_pin_read(GPIO_C, PINC0, c0_val);
-
-		if (*c0_val == 1 && error == GPIO_OK) {
-			uart_transmit_string((unsigned char*)"Pin C0 is pulled up!");
-			uart_transmit_nl(2, false);
-		}
-		else if (*c0_val == 0 && error == GPIO_OK) {
-			uart_transmit_string((unsigned char*)"Pin C0 is pulled down... :(");
-			uart_transmit_nl(2, false);
-		}
-		else {
-			uart_transmit_string((unsigned char*)"GPIO read error ");
-			uart_transmit_byte(error + 0x30);
-			uart_transmit_nl(2, false);
-		}
-		
-		uart_transmit_string((unsigned char*)"All GPIO tests done.");
-		uart_transmit_nl(2, false);
-		_delay_ms(100);
-
-		uart_transmit_string((unsigned char*)"Starting UART Flag Check...");
-		uart_transmit_nl(2, false);
-
-		for (i = maxBitPos; i >= maxBitPos - numBits; i--) {
-			// Dont increment for transmit complete or UDRE
-			if ((uart_check_flag(i) == true) && (!(i == TXC0) || (i == UDRE0))) flagCount++;
-		}
-
-		if (flagCount == 0) {
-			uart_transmit_string((unsigned char*)"No flags found.");
-			uart_transmit_nl(2, false);
-		}
-		else {
-			decToASCII(buff, flagCount);
-			uart_transmit_string((unsigned char*)buff);
-			uart_transmit_string((unsigned char*)" flags found.");
-			uart_transmit_nl(2, false);
-		}
-
-		_delay_ms(2000);
-	}
+	// Each subsystem runs at its own rate instead of the slowest blocking step
+	sched_add(TASK_RTC, task_rtc, 1000);
+	sched_add(TASK_ADC, task_adc, 500);
+	sched_add(TASK_GPIOB, task_gpio_b, 100);
+	sched_add(TASK_GPIOD, task_gpio_d, 100);
+	sched_add(TASK_FLAGS, task_flags, 2000);
+	sched_add(TASK_STATS, task_stats, 10000);
+	sched_add(TASK_LOG, log_task, 100);
+	if (oled_present) sched_add(TASK_OLED, task_oled, 50);
+
+	// Answer commands, or sleep, whenever no task is ready
+	sched_set_idle(idle);
+	sched_run();
 }
 
 /* =================================================================================
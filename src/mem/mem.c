@@ -0,0 +1,63 @@
+/***********************************************************************
+* SRAM high-water mark                                                 *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Paint the free SRAM between .bss and the stack with a       *
+*          canary at reset and measure how deep the stack has reached  *
+***********************************************************************/
+
+#include "mem.h"
+#include <stdint.h>
+#include <util/atomic.h>
+
+// avr-libc linker script symbols: first byte after .bss/.noinit and the
+// initial stack pointer, the last byte of RAM
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+
+// Data space address to pointer and back, the identity on the target.
+// Worked out on integers, an offset from &__stack would point outside
+// the one byte object the linker symbol is declared as.
+#define MEM_PTR(addr) ((uint8_t*)((uintptr_t)&__stack - RAMEND + (addr)))
+#define MEM_ADDR(p) ((uint16_t)((uintptr_t)(p) - (uintptr_t)&__stack + RAMEND))
+
+/************************** Paint Stuff *******************************/
+
+static inline __attribute__((always_inline)) void mem_fill(uint8_t* p, uint8_t* end) {
+    while (p <= end) *p++ = MEM_CANARY;
+}
+
+// Falls through into .init4, no prologue, no return and no stack use
+void mem_boot(void) __attribute__((naked, used, section(".init3")));
+void mem_boot(void) {
+    mem_fill(&__heap_start, &__stack);
+}
+
+// Repaint what lies below the current stack to restart the high-water
+// mark, say once start-up is over. Interrupts stay off so no ISR frame
+// gets painted over.
+void mem_paint(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uint8_t* top = MEM_PTR(SP) - MEM_GUARD;
+
+        if (top >= &__heap_start) mem_fill(&__heap_start, top);
+    }
+}
+
+/************************** Measure Stuff *****************************/
+
+uint16_t mem_free_min(void) {
+    const uint8_t* p = &__heap_start;
+
+    while (p <= &__stack && *p == MEM_CANARY) p++;
+    return (uint16_t)(p - &__heap_start);
+}
+
+void mem_stats(mem_stats_t* stats) {
+    uint16_t gap = (uint16_t)(&__stack - &__heap_start) + 1;
+
+    stats->static_bytes = MEM_ADDR(&__heap_start) - RAMSTART;
+    stats->free_min = mem_free_min();
+    stats->stack_peak = gap - stats->free_min;
+    stats->stack_now = (uint16_t)(RAMEND - SP);
+}
@@ -0,0 +1,39 @@
+/***********************************************************************
+* SRAM high-water mark                                                 *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Paint the free SRAM between .bss and the stack with a       *
+*          canary at reset and measure how deep the stack has reached  *
+*                                                                      *
+* The paint runs from .init3, after avr-libc has set SP and before     *
+* .data and .bss are initialised, so it covers all of free RAM. The    *
+* stack grows down into the painted bytes, and scanning up from        *
+* __heap_start to the first byte that is not the canary gives the      *
+* lowest address it ever reached. A stacked byte that happens to equal *
+* MEM_CANARY at the boundary reads as free, so the peak can come out   *
+* a byte or two short. Nothing here uses malloc, the heap stays empty. *
+*                                                                      *
+* Static use per module comes from the link map, see `make memcheck`.  *
+***********************************************************************/
+
+#ifndef MEM_H_
+#define MEM_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+#define MEM_CANARY 0xC5
+#define MEM_GUARD  16       /*Bytes under SP left alone by mem_paint()*/
+
+typedef struct mem_stats {
+    uint16_t static_bytes;  /*.data + .bss*/
+    uint16_t stack_peak;    /*Deepest stack since the last paint*/
+    uint16_t stack_now;     /*Stack in use by the caller*/
+    uint16_t free_min;      /*Canary bytes never touched*/
+} mem_stats_t;
+
+void mem_paint(void);
+uint16_t mem_free_min(void);
+void mem_stats(mem_stats_t* stats);
+
+#endif //MEM_H_
@@ -0,0 +1,22 @@
+/***********************************************************************
+* 5x7 ASCII font                                                       *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Column major glyphs for ' ' to '~', bit 0 the top row, kept *
+*          in flash                                                    *
+***********************************************************************/
+
+#ifndef FONT5X7_H_
+#define FONT5X7_H_
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+
+#define FONT_FIRST ' '
+#define FONT_LAST '~'
+#define FONT_WIDTH 5
+#define FONT_HEIGHT 7
+
+extern const uint8_t font5x7[(FONT_LAST - FONT_FIRST + 1) * FONT_WIDTH] PROGMEM;
+
+#endif //FONT5X7_H_
@@ -0,0 +1,229 @@
+/***********************************************************************
+* SSD1306 OLED driver                                                  *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Draw into a RAM framebuffer and send only what changed to   *
+*          the panel over TWI, leaving the bus to the RTC in between   *
+***********************************************************************/
+
+#include "oled.h"
+#include "font5x7.h"
+#include "twi_hal.h"
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#define OLED_CLEAN 0xFF         /*oled_x0[] of a page with nothing to send*/
+#define OLED_REGION_MAX 256     /*Bytes per data write, bounds how long the RTC waits*/
+
+_Static_assert(OLED_HEIGHT == 32 || OLED_HEIGHT == 64, "OLED_HEIGHT must be 32 or 64");
+_Static_assert(OLED_REGION_MAX >= OLED_WIDTH, "OLED_REGION_MAX must hold a full page");
+
+static uint8_t oled_fb[OLED_PAGES * OLED_WIDTH];
+
+// Dirty column range per page, x0 == OLED_CLEAN when clean
+static uint8_t oled_x0[OLED_PAGES];
+static uint8_t oled_x1[OLED_PAGES];
+
+// Horizontal addressing so a column/page window fills row by row,
+// SSD1306 datasheet 10.1.3 and the application note power up sequence
+static const uint8_t oled_init_seq[] PROGMEM = {
+    0xAE,                       /*Display off*/
+    0xD5, 0x80,                 /*Clock divide, oscillator*/
+    0xA8, OLED_HEIGHT - 1,      /*Multiplex ratio*/
+    0xD3, 0x00,                 /*Display offset*/
+    0x40,                       /*Start line 0*/
+    0x8D, 0x14,                 /*Charge pump on*/
+    0x20, 0x00,                 /*Horizontal addressing*/
+    0xA1,                       /*Column 127 at SEG0*/
+    0xC8,                       /*COM scan from the top*/
+    0xDA, (OLED_HEIGHT == 64) ? 0x12 : 0x02,    /*COM pin layout*/
+    0x81, 0x8F,                 /*Contrast*/
+    0xD9, 0xF1,                 /*Precharge*/
+    0xDB, 0x40,                 /*VCOMH deselect*/
+    0xA4,                       /*Show RAM*/
+    0xA6,                       /*Not inverted*/
+    0xAF                        /*Display on*/
+};
+
+/************************** Framebuffer Stuff *************************/
+
+static void oled_mark(uint8_t page, uint8_t x) {
+    if (oled_x0[page] == OLED_CLEAN) {
+        oled_x0[page] = oled_x1[page] = x;
+        return;
+    }
+    if (x < oled_x0[page]) oled_x0[page] = x;
+    if (x > oled_x1[page]) oled_x1[page] = x;
+}
+
+// Only a byte that changes needs to go to the panel
+static void oled_store(uint8_t x, uint8_t page, uint8_t b) {
+    uint8_t* p = &oled_fb[(uint16_t)page * OLED_WIDTH + x];
+
+    if (*p == b) return;
+    *p = b;
+    oled_mark(page, x);
+}
+
+static oled_error_t oled_cmd(uint8_t* cmd, uint8_t len) {
+    if (twi_write(OLED_ADDR, OLED_CTRL_CMD, cmd, len) != TWI_OK) return OLED_BUS;
+    return OLED_OK;
+}
+
+/************************** OLED Stuff ********************************/
+
+// Configures the panel and blanks the buffer, all of it marked dirty
+// so the first flush also clears whatever the panel RAM held
+oled_error_t oled_init(void) {
+    uint8_t seq[sizeof(oled_init_seq)];
+    uint8_t page;
+
+    memset(oled_fb, 0, sizeof(oled_fb));
+    for (page = 0; page < OLED_PAGES; page++) {
+        oled_x0[page] = 0;
+        oled_x1[page] = OLED_WIDTH - 1;
+    }
+
+    memcpy_P(seq, oled_init_seq, sizeof(seq));
+    return oled_cmd(seq, sizeof(seq));
+}
+
+oled_error_t oled_contrast(uint8_t level) {
+    uint8_t cmd[2] = {0x81, level};
+
+    return oled_cmd(cmd, sizeof(cmd));
+}
+
+oled_error_t oled_power(bool on) {
+    uint8_t cmd = on ? 0xAF : 0xAE;
+
+    return oled_cmd(&cmd, 1);
+}
+
+void oled_clear(void) {
+    uint8_t page, x;
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        for (x = 0; x < OLED_WIDTH; x++) oled_store(x, page, 0x00);
+    }
+}
+
+oled_error_t oled_pixel(uint8_t x, uint8_t y, bool on) {
+    uint8_t page = y >> 3;
+    uint8_t b;
+
+    if (x >= OLED_WIDTH || y >= OLED_HEIGHT) return OLED_INVALID_POS;
+    b = oled_fb[(uint16_t)page * OLED_WIDTH + x];
+    if (on) b |= (1 << (y & 0x07));
+    else b &= ~(1 << (y & 0x07));
+    oled_store(x, page, b);
+    return OLED_OK;
+}
+
+// One glyph at column x of a text row, characters the font lacks show as '?'
+oled_error_t oled_char(uint8_t x, uint8_t page, char c) {
+    const uint8_t* glyph;
+    uint8_t i;
+
+    if (x > OLED_WIDTH - OLED_CHAR_W || page >= OLED_PAGES) return OLED_INVALID_POS;
+    if (c < FONT_FIRST || c > FONT_LAST) c = '?';
+
+    glyph = &font5x7[(uint16_t)(c - FONT_FIRST) * FONT_WIDTH];
+    for (i = 0; i < FONT_WIDTH; i++) oled_store(x + i, page, pgm_read_byte(glyph + i));
+    oled_store(x + FONT_WIDTH, page, 0x00);
+    return OLED_OK;
+}
+
+// Stops at the right edge with OLED_INVALID_POS
+oled_error_t oled_text(uint8_t x, uint8_t page, const char* str) {
+    oled_error_t err;
+
+    for (; *str; str++, x += OLED_CHAR_W) {
+        err = oled_char(x, page, *str);
+        if (err != OLED_OK) return err;
+    }
+    return OLED_OK;
+}
+
+oled_error_t oled_text_P(uint8_t x, uint8_t page, const char* str) {
+    oled_error_t err;
+    char c;
+
+    while ((c = pgm_read_byte(str++))) {
+        err = oled_char(x, page, c);
+        if (err != OLED_OK) return err;
+        x += OLED_CHAR_W;
+    }
+    return OLED_OK;
+}
+
+// Outlined bar one text row tall, the first fill inner columns solid
+oled_error_t oled_bar(uint8_t x, uint8_t page, uint8_t width, uint8_t fill) {
+    uint8_t i;
+
+    if (width < 2 || page >= OLED_PAGES || x + width > OLED_WIDTH) return OLED_INVALID_POS;
+    if (fill > width - 2) fill = width - 2;
+
+    oled_store(x, page, 0x7E);
+    for (i = 1; i < width - 1; i++) oled_store(x + i, page, (i <= fill) ? 0x7E : 0x42);
+    oled_store(x + width - 1, page, 0x7E);
+    return OLED_OK;
+}
+
+bool oled_dirty(void) {
+    uint8_t page;
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        if (oled_x0[page] != OLED_CLEAN) return true;
+    }
+    return false;
+}
+
+// Sends the first dirty region, one window command and one data burst.
+// Full width pages that follow each other are contiguous in the buffer
+// and go together, up to OLED_REGION_MAX bytes.
+oled_error_t oled_update(void) {
+    uint8_t cmd[6];
+    uint8_t p0, p1, p;
+    uint8_t x0, x1;
+    uint16_t len;
+
+    for (p0 = 0; p0 < OLED_PAGES && oled_x0[p0] == OLED_CLEAN; p0++);
+    if (p0 == OLED_PAGES) return OLED_OK;
+
+    x0 = oled_x0[p0];
+    x1 = oled_x1[p0];
+    p1 = p0;
+    if (x0 == 0 && x1 == OLED_WIDTH - 1) {
+        while (p1 + 1 < OLED_PAGES && oled_x0[p1 + 1] == 0 && oled_x1[p1 + 1] == OLED_WIDTH - 1 &&
+               (uint16_t)(p1 + 2 - p0) * OLED_WIDTH <= OLED_REGION_MAX) p1++;
+    }
+
+    cmd[0] = 0x21;      /*Column window*/
+    cmd[1] = x0;
+    cmd[2] = x1;
+    cmd[3] = 0x22;      /*Page window*/
+    cmd[4] = p0;
+    cmd[5] = p1;
+    if (oled_cmd(cmd, sizeof(cmd)) != OLED_OK) return OLED_BUS;
+
+    len = (uint16_t)(x1 - x0 + 1) * (p1 - p0 + 1);
+    if (twi_write(OLED_ADDR, OLED_CTRL_DATA, &oled_fb[(uint16_t)p0 * OLED_WIDTH + x0], len) != TWI_OK) return OLED_BUS;
+
+    for (p = p0; p <= p1; p++) oled_x0[p] = OLED_CLEAN;
+    return OLED_OK;
+}
+
+oled_error_t oled_flush(void) {
+    oled_error_t err;
+
+    while (oled_dirty()) {
+        err = oled_update();
+        if (err != OLED_OK) return err;
+    }
+    return OLED_OK;
+}
+
+const uint8_t* oled_buffer(void) {
+    return oled_fb;
+}
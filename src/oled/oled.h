@@ -0,0 +1,61 @@
+/***********************************************************************
+* SSD1306 OLED driver                                                  *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Draw into a RAM framebuffer and send only what changed to   *
+*          the panel over TWI, leaving the bus to the RTC in between   *
+*                                                                      *
+* The framebuffer is laid out like the panel's GDDRAM: OLED_PAGES rows *
+* of 8 pixel tall bytes, bit 0 the top row. Drawing compares before it *
+* stores, so only bytes that actually change mark their page dirty and *
+* widen its dirty column range. A second copy of what the panel shows  *
+* would do the same job but costs another 512 bytes of the 2 KB SRAM.  *
+*                                                                      *
+* oled_update() sends one region per call: a column/page window and    *
+* the bytes inside it as a single twi_write(). Adjacent dirty pages    *
+* whose ranges cover the full width go out as one region since they   *
+* are contiguous in the buffer. A clock digit is one 5 byte region,    *
+* about 0.5 ms at 400 kHz, where the full 512 byte screen is ~15 ms.   *
+***********************************************************************/
+
+#ifndef OLED_H_
+#define OLED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define OLED_ADDR 0x3C          /*0x3D with SA0 high*/
+#define OLED_WIDTH 128
+#define OLED_HEIGHT 32          /*32 or 64, 64 doubles the buffer to 1 KB*/
+#define OLED_PAGES (OLED_HEIGHT / 8)
+
+#define OLED_CHAR_W 6           /*5 pixel glyph plus a blank column*/
+#define OLED_COLS (OLED_WIDTH / OLED_CHAR_W)
+
+// Control byte in front of every transfer, SSD1306 datasheet 8.1.5.1
+#define OLED_CTRL_CMD 0x00
+#define OLED_CTRL_DATA 0x40
+
+typedef enum oled_error {
+    OLED_OK,
+    OLED_BUS,           /*twi_write() failed, nothing marked clean*/
+    OLED_INVALID_POS
+} oled_error_t;
+
+oled_error_t oled_init(void);
+oled_error_t oled_contrast(uint8_t level);
+oled_error_t oled_power(bool on);
+
+void oled_clear(void);
+oled_error_t oled_pixel(uint8_t x, uint8_t y, bool on);
+oled_error_t oled_char(uint8_t x, uint8_t page, char c);
+oled_error_t oled_text(uint8_t x, uint8_t page, const char* str);
+oled_error_t oled_text_P(uint8_t x, uint8_t page, const char* str);
+oled_error_t oled_bar(uint8_t x, uint8_t page, uint8_t width, uint8_t fill);
+
+bool oled_dirty(void);
+oled_error_t oled_update(void);
+oled_error_t oled_flush(void);
+const uint8_t* oled_buffer(void);
+
+#endif //OLED_H_
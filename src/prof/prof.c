@@ -0,0 +1,113 @@
+/***********************************************************************
+* Cycle-accurate hot-path profiler                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Time instrumented scopes against the free running Timer1    *
+*          counter and keep per-probe statistics in a fixed table      *
+***********************************************************************/
+
+#include "prof.h"
+
+#if PROF_ENABLE
+
+#include "uart.h"
+
+static prof_stats_t prof_table[PROF_PROBE_COUNT];
+static uint32_t prof_overhead = 0;     /*Cycles an empty scope measures*/
+
+/************************** Profiler Setup Stuff **********************/
+
+// Takes Timer1 over and measures what the probe itself costs, that is
+// subtracted from every sample afterwards
+void prof_init(void) {
+    prof_mark_t mark;
+
+    tmr1_init(TMR1_NORMAL, TMR1_CLK_DIV1, 0xFFFF);
+
+    mark.start = tmr1_ticks32();
+    prof_overhead = tmr1_ticks32() - mark.start;
+    prof_reset();
+}
+
+void prof_reset(void) {
+    uint8_t i;
+    for (i = 0; i < PROF_PROBE_COUNT; i++) {
+        prof_table[i] = (prof_stats_t){0};
+        prof_table[i].min = 0xFFFFFFFFUL;
+    }
+}
+
+/************************* Profiler Sample Stuff **********************/
+
+// Main loop context only, the table is not protected against ISRs
+void prof_leave(prof_mark_t* mark) {
+    uint32_t cycles = tmr1_ticks32() - mark->start;
+    prof_stats_t* st;
+    uint32_t c;
+    uint8_t b = 0;
+
+    if (mark->id >= PROF_PROBE_COUNT) return;
+    st = &prof_table[mark->id];
+
+    cycles = (cycles > prof_overhead) ? (cycles - prof_overhead) : 0;
+
+    if (st->count != 0xFFFF) st->count++;
+    if (cycles < st->min) st->min = cycles;
+    if (cycles > st->max) st->max = cycles;
+    st->sum = ((st->sum + cycles) < st->sum) ? 0xFFFFFFFFUL : (st->sum + cycles);
+
+    c = cycles >> PROF_BUCKET_BASE;
+    while (c && (b < PROF_BUCKETS - 1)) {
+        c >>= 2;
+        b++;
+    }
+    if (st->hist[b] != 0xFFFF) st->hist[b]++;
+}
+
+void prof_get(prof_probe_t id, prof_stats_t* stats) {
+    if (id < PROF_PROBE_COUNT) *stats = prof_table[id];
+}
+
+/************************** Profiler Dump Stuff ***********************/
+
+// Writes bytes directly so the dump does not land in the UART probe
+static void prof_put_str(const char* str) {
+    while (*str) uart_transmit_byte(*str++);
+}
+
+static void prof_put_u32(uint32_t val, char sep) {
+    char digits[10];
+    uint8_t n = 0;
+
+    do {
+        digits[n++] = '0' + (val % 10);
+        val /= 10;
+    } while (val);
+    while (n) uart_transmit_byte(digits[--n]);
+    uart_transmit_byte(sep);
+}
+
+// One line per probe that fired, all values in cycles:
+// P<id> count min max mean h0,h1,...,h7
+void prof_dump(void) {
+    uint8_t i, b;
+    prof_stats_t* st;
+
+    for (i = 0; i < PROF_PROBE_COUNT; i++) {
+        st = &prof_table[i];
+        if (st->count == 0) continue;
+
+        prof_put_str("P");
+        prof_put_u32(i, ' ');
+        prof_put_u32(st->count, ' ');
+        prof_put_u32(st->min, ' ');
+        prof_put_u32(st->max, ' ');
+        prof_put_u32(st->sum / st->count, ' ');
+        for (b = 0; b < PROF_BUCKETS; b++) {
+            prof_put_u32(st->hist[b], (b == PROF_BUCKETS - 1) ? '\r' : ',');
+        }
+        uart_transmit_byte('\n');
+    }
+}
+
+#endif //PROF_ENABLE
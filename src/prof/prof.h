@@ -0,0 +1,82 @@
+/***********************************************************************
+* Cycle-accurate hot-path profiler                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Time instrumented scopes against the free running Timer1    *
+*          counter and keep per-probe statistics in a fixed table      *
+*                                                                      *
+* Build with `make PROF=1` to enable. With PROF_ENABLE at 0 every      *
+* macro and call below compiles to nothing. The profiler owns Timer1   *
+* in TMR1_NORMAL at F_CPU, so it cannot share it with the PWM output.  *
+***********************************************************************/
+
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+#ifndef PROF_ENABLE
+#define PROF_ENABLE 0
+#endif
+
+// Probe ids index the statistics table, add new ones before PROF_PROBE_COUNT
+typedef enum prof_probe {
+    PROF_TWI_READ,
+    PROF_TWI_WRITE,
+    PROF_UART_STRING,
+    PROF_GPIO_PIN_WRITE,
+    PROF_ADC_READ,
+    PROF_SPI_TRANSFER,
+    PROF_SPI_BURST,
+    PROF_PROBE_COUNT
+} prof_probe_t;
+
+// Histogram buckets are powers of four starting below 32 cycles:
+// <32, <128, <512, <2048, <8192, <32768, <131072, and everything above
+#define PROF_BUCKETS 8
+#define PROF_BUCKET_BASE 5      /*log2 of the first bucket's upper bound*/
+
+typedef struct prof_stats {
+    uint16_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;               /*Saturates rather than wrapping*/
+    uint16_t hist[PROF_BUCKETS];
+} prof_stats_t;
+
+typedef struct prof_mark {
+    uint32_t start;
+    uint8_t id;
+} prof_mark_t;
+
+#if PROF_ENABLE
+
+#include "tmr1.h"
+
+// Times from this line to the end of the enclosing block, on every exit path
+#define PROF_SCOPE(id) \
+    prof_mark_t prof_mark_ __attribute__((__cleanup__(prof_leave))) = { tmr1_ticks32(), (id) }
+
+// Explicit pair for spans that do not line up with a block
+#define PROF_BEGIN(id) prof_mark_t prof_mark_##id = { tmr1_ticks32(), (id) }
+#define PROF_END(id) prof_leave(&prof_mark_##id)
+
+void prof_init(void);
+void prof_leave(prof_mark_t* mark);
+void prof_get(prof_probe_t id, prof_stats_t* stats);
+void prof_reset(void);
+void prof_dump(void);
+
+#else
+
+#define PROF_SCOPE(id)
+#define PROF_BEGIN(id)
+#define PROF_END(id)
+
+static inline void prof_init(void) {}
+static inline void prof_reset(void) {}
+static inline void prof_dump(void) {}
+
+#endif //PROF_ENABLE
+
+#endif //PROF_H_
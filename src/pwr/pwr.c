@@ -0,0 +1,104 @@
+/***********************************************************************
+* Idle-time power manager                                              *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Reference count the clocked peripherals, gate the unused    *
+*          ones through PRR and sleep as deep as the active set allows *
+***********************************************************************/
+
+#include "pwr.h"
+#include "systick.h"
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+// Peripherals that stop without clkIO and so only allow IDLE, plus the
+// EEPROM whose ready interrupt wakes only from IDLE and ADC noise reduction
+#define PWR_IDLE_MASK ((1 << PWR_USART0) | (1 << PWR_SPI) | (1 << PWR_TIM1) | \
+                       (1 << PWR_TIM2) | (1 << PWR_TWI) | (1 << PWR_EE))
+
+static uint8_t pwr_refs[8];                 /*Indexed by PRR bit*/
+static volatile uint8_t pwr_held = 0;       /*Bit set while pwr_refs[bit] != 0*/
+static pwr_stats_t pwr_stat;
+
+static const uint8_t pwr_sleep_modes[PWR_MODE_COUNT] = {
+    SLEEP_MODE_IDLE,
+    SLEEP_MODE_ADC,
+    SLEEP_MODE_PWR_SAVE
+};
+
+/************************** Power Gating Stuff ************************/
+
+// Powers down every peripheral nobody has acquired yet
+void pwr_init(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        PRR = PWR_PRR_MASK & ~pwr_held;
+    }
+}
+
+// A module must be acquired before its registers are touched, PRR
+// freezes it and writes are ignored while it is powered down
+void pwr_acquire(pwr_periph_t p) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (pwr_refs[p]++ == 0) {
+            PRR &= ~(1 << p);
+            pwr_held |= (1 << p);
+        }
+    }
+}
+
+void pwr_release(pwr_periph_t p) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if ((pwr_refs[p] != 0) && (--pwr_refs[p] == 0)) {
+            pwr_held &= ~(1 << p);
+            PRR |= (1 << p) & PWR_PRR_MASK;     /*Reserved bits stay zero*/
+        }
+    }
+}
+
+uint8_t pwr_active(void) {
+    return pwr_held;
+}
+
+/*************************** Power Sleep Stuff ************************/
+
+pwr_mode_t pwr_mode(void) {
+    uint8_t held = pwr_held;
+    if (held & PWR_IDLE_MASK) return PWR_MODE_IDLE;
+    // Noise reduction only pays off for a single conversion in flight,
+    // a free running ADC is happy in IDLE
+    if ((held & (1 << PWR_ADC)) && (ADCSRA & (1 << ADSC)) && !(ADCSRA & (1 << ADATE))) {
+        return PWR_MODE_ADC;
+    }
+    if (held & ((1 << PWR_TIM0) | (1 << PWR_ADC))) return PWR_MODE_IDLE;
+    return PWR_MODE_SAVE;
+}
+
+// Enter with interrupts masked, right after checking the wake condition.
+// sei() only takes effect after the following instruction, so an interrupt
+// arriving in between still ends the sleep instead of being missed.
+// Returns with interrupts enabled.
+void pwr_sleep(void) {
+    pwr_mode_t mode = pwr_mode();
+    uint32_t start = systick_micros();
+
+    set_sleep_mode(pwr_sleep_modes[mode]);
+    sleep_enable();
+    if (mode == PWR_MODE_SAVE) sleep_bod_disable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+
+    pwr_stat.entries[mode]++;
+    pwr_stat.sleep_us[mode] += systick_micros() - start;
+}
+
+/*************************** Power Stats Stuff ************************/
+
+void pwr_stats(pwr_stats_t* stats) {
+    *stats = pwr_stat;
+}
+
+void pwr_stats_reset(void) {
+    pwr_stat = (pwr_stats_t){{0}};
+}
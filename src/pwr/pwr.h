@@ -0,0 +1,64 @@
+/***********************************************************************
+* Idle-time power manager                                              *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Reference count the clocked peripherals, gate the unused    *
+*          ones through PRR and sleep as deep as the active set allows *
+*                                                                      *
+* Drivers acquire a peripheral while it has work in flight and release *
+* it when done. Whatever is not held sits powered down in PRR, and     *
+* pwr_sleep() picks the sleep mode from what is still held:            *
+*   UART, SPI, TWI, Timer1, Timer2 or an                               *
+*   EEPROM write held                      -> IDLE                     *
+*   single ADC conversion running          -> ADC noise reduction      *
+*   Timer0 tick or a free running ADC held -> IDLE                     *
+*   nothing held                           -> power-save               *
+* Power-save needs a wake source armed (INT0/1, PCINT, TWI address     *
+* match, Timer2 or the WDT), and neither it nor ADC noise reduction    *
+* clock Timer0, so systick time stands still while in them.            *
+***********************************************************************/
+
+#ifndef PWR_H_
+#define PWR_H_
+
+#include <avr/io.h>
+#include <stdint.h>
+
+// Values are the PRR bit positions. PWR_EE sits on the reserved bit 4,
+// it only keeps sleep shallow enough for EE_READY to wake the CPU.
+typedef enum pwr_periph {
+    PWR_ADC = PRADC,
+    PWR_USART0 = PRUSART0,
+    PWR_SPI = PRSPI,
+    PWR_TIM1 = PRTIM1,
+    PWR_EE = 4,
+    PWR_TIM0 = PRTIM0,
+    PWR_TIM2 = PRTIM2,
+    PWR_TWI = PRTWI
+} pwr_periph_t;
+
+typedef enum pwr_mode {
+    PWR_MODE_IDLE,
+    PWR_MODE_ADC,
+    PWR_MODE_SAVE,
+    PWR_MODE_COUNT
+} pwr_mode_t;
+
+typedef struct pwr_stats {
+    uint32_t entries[PWR_MODE_COUNT];
+    uint32_t sleep_us[PWR_MODE_COUNT];  /*As seen by systick, see the note above*/
+} pwr_stats_t;
+
+#define PWR_PRR_MASK ((1 << PRADC) | (1 << PRUSART0) | (1 << PRSPI) | (1 << PRTIM1) | \
+                      (1 << PRTIM0) | (1 << PRTIM2) | (1 << PRTWI))
+
+void pwr_init(void);
+void pwr_acquire(pwr_periph_t p);
+void pwr_release(pwr_periph_t p);
+uint8_t pwr_active(void);
+pwr_mode_t pwr_mode(void);
+void pwr_sleep(void);
+void pwr_stats(pwr_stats_t* stats);
+void pwr_stats_reset(void);
+
+#endif //PWR_H_
@@ -0,0 +1,158 @@
+/***********************************************************************
+* Cooperative run-to-completion task scheduler                         *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Run statically allocated tasks at their own period or when  *
+*          signalled from an ISR, highest priority first               *
+***********************************************************************/
+
+#include "sched.h"
+#include "systick.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+typedef struct sched_task {
+    void (*run)(void);
+    uint16_t period_ms;
+    uint32_t next_ms;       /*Next release for periodic tasks*/
+    sched_stats_t stats;
+} sched_task_t;
+
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static volatile uint8_t sched_ready = 0;
+static uint8_t sched_used = 0;
+static void (*sched_idle)(void) = 0;
+
+/************************ Scheduler Setup Stuff ***********************/
+
+// The first release of a periodic task is one period from now
+sched_error_t sched_add(uint8_t id, void (*run)(void), uint16_t period_ms) {
+    if ((id >= SCHED_MAX_TASKS) || (run == 0)) return SCHED_INVALID_ID;
+    if (sched_used & (1 << id)) return SCHED_ID_IN_USE;
+
+    sched_tasks[id].run = run;
+    sched_tasks[id].period_ms = period_ms;
+    sched_tasks[id].next_ms = systick_millis() + period_ms;
+    sched_tasks[id].stats = (sched_stats_t){0};
+    sched_used |= (1 << id);
+    return SCHED_OK;
+}
+
+sched_error_t sched_remove(uint8_t id) {
+    if (id >= SCHED_MAX_TASKS) return SCHED_INVALID_ID;
+    sched_used &= ~(1 << id);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sched_ready &= ~(1 << id);
+    }
+    return SCHED_OK;
+}
+
+// Takes effect from now, the next release is one new period away. A
+// release already pending still runs.
+sched_error_t sched_period(uint8_t id, uint16_t period_ms) {
+    if ((id >= SCHED_MAX_TASKS) || !(sched_used & (1 << id))) return SCHED_INVALID_ID;
+    sched_tasks[id].period_ms = period_ms;
+    sched_tasks[id].next_ms = systick_millis() + period_ms;
+    return SCHED_OK;
+}
+
+// Called with nothing ready, e.g. to sleep until the next interrupt.
+// It is entered with interrupts masked so a signal raised after the ready
+// check still wakes it, and must return with them enabled (see pwr_sleep).
+void sched_set_idle(void (*idle)(void)) {
+    sched_idle = idle;
+}
+
+/************************ Scheduler Signal Stuff **********************/
+
+void sched_signal(uint8_t id) {
+    if (id >= SCHED_MAX_TASKS) return;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        sched_ready |= (1 << id);
+    }
+}
+
+// Interrupts are already masked inside an ISR, skip the SREG save
+void sched_signal_isr(uint8_t id) {
+    sched_ready |= (1 << id);
+}
+
+/************************* Scheduler Run Stuff ************************/
+
+// Mark periodic tasks whose release time has come. A release that finds
+// the previous one still pending, or that is a whole period late, is a miss.
+static void sched_release(uint32_t now) {
+    uint8_t id;
+    uint8_t bit;
+    sched_task_t* t;
+
+    for (id = 0, bit = 1; id < SCHED_MAX_TASKS; id++, bit <<= 1) {
+        t = &sched_tasks[id];
+        if (!(sched_used & bit) || (t->period_ms == SCHED_EVENT)) continue;
+        if ((int32_t)(now - t->next_ms) < 0) continue;
+
+        if (sched_ready & bit) t->stats.misses++;
+        else sched_signal(id);
+
+        t->next_ms += t->period_ms;
+        if ((int32_t)(now - t->next_ms) >= 0) {
+            // Fell behind by more than a period, resync instead of bursting
+            t->stats.misses++;
+            t->next_ms = now + t->period_ms;
+        }
+    }
+}
+
+// Runs the highest priority ready task, returns false when none was ready
+bool sched_run_once(void) {
+    uint8_t ready;
+    uint8_t id = 0;
+    uint32_t start, elapsed;
+    sched_task_t* t;
+
+    sched_release(systick_millis());
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ready = sched_ready & sched_used;
+        if (ready) {
+            while (!(ready & 1)) {
+                ready >>= 1;
+                id++;
+            }
+            sched_ready &= ~(1 << id);
+        }
+    }
+    if (!ready) return false;
+
+    t = &sched_tasks[id];
+    start = systick_micros();
+    t->run();
+    elapsed = systick_micros() - start;
+
+    t->stats.runs++;
+    t->stats.busy_us += elapsed;
+    if (elapsed > t->stats.max_us) t->stats.max_us = (elapsed > 0xFFFF) ? 0xFFFF : elapsed;
+    return true;
+}
+
+void sched_run(void) {
+    while (1) {
+        if (sched_run_once() || !sched_idle) continue;
+        cli();
+        if (sched_ready & sched_used) sei();
+        else sched_idle();
+    }
+}
+
+/************************ Scheduler Stats Stuff ***********************/
+
+sched_error_t sched_stats(uint8_t id, sched_stats_t* stats) {
+    if ((id >= SCHED_MAX_TASKS) || !(sched_used & (1 << id))) return SCHED_INVALID_ID;
+    *stats = sched_tasks[id].stats;
+    return SCHED_OK;
+}
+
+void sched_stats_reset(void) {
+    uint8_t id;
+    for (id = 0; id < SCHED_MAX_TASKS; id++) sched_tasks[id].stats = (sched_stats_t){0};
+}
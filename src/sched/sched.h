@@ -0,0 +1,46 @@
+/***********************************************************************
+* Cooperative run-to-completion task scheduler                         *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Run statically allocated tasks at their own period or when  *
+*          signalled from an ISR, highest priority first               *
+*                                                                      *
+* The task id is its priority (0 runs first) and its bit in the ready  *
+* bitmap. Tasks must return quickly; anything long is split into steps *
+* kept in static state and continued on the next release.              *
+***********************************************************************/
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS 8       /*One bit each in an 8-bit ready map*/
+#define SCHED_EVENT 0           /*Period for tasks that only run when signalled*/
+
+typedef enum sched_error {
+    SCHED_OK,
+    SCHED_INVALID_ID,
+    SCHED_ID_IN_USE
+} sched_error_t;
+
+typedef struct sched_stats {
+    uint32_t runs;
+    uint32_t busy_us;       /*Total time spent in the task, from systick_micros()*/
+    uint16_t max_us;        /*Longest single run*/
+    uint16_t misses;        /*Releases that found the previous one still pending*/
+} sched_stats_t;
+
+sched_error_t sched_add(uint8_t id, void (*run)(void), uint16_t period_ms);
+sched_error_t sched_remove(uint8_t id);
+sched_error_t sched_period(uint8_t id, uint16_t period_ms);
+void sched_signal(uint8_t id);
+void sched_signal_isr(uint8_t id);
+void sched_set_idle(void (*idle)(void));
+bool sched_run_once(void);
+void sched_run(void);
+sched_error_t sched_stats(uint8_t id, sched_stats_t* stats);
+void sched_stats_reset(void);
+
+#endif //SCHED_H_
@@ -0,0 +1,267 @@
+/***********************************************************************
+* SPI master driver                                                    *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Share the hardware SPI between devices with different modes *
+*          and clocks, queue transfers to run from SPI_STC_vect and    *
+*          stream large blocks with a polled burst                     *
+***********************************************************************/
+
+#include "spi.h"
+#include "pwr.h"
+#include "prof.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#define SPI_QUEUE_MASK (SPI_QUEUE_SIZE - 1)
+
+_Static_assert((SPI_QUEUE_SIZE & SPI_QUEUE_MASK) == 0 && SPI_QUEUE_SIZE <= 256, "SPI_QUEUE_SIZE must be a power of two up to 256");
+
+// Queued transfers, the one at tail is on the bus while the queue runs
+static spi_xfer_t* spi_queue[SPI_QUEUE_SIZE];
+static volatile uint8_t spi_head = 0;
+static volatile uint8_t spi_tail = 0;
+static volatile bool spi_active = false;    /*Bus owned by the queue or a burst, PWR_SPI held*/
+
+/************************** Bus Stuff *********************************/
+
+static void spi_cs(const spi_dev_t* dev, bool level) {
+    uint8_t mask = (1 << dev->cs_pin);
+
+    switch (dev->cs_port) {
+        case(GPIO_B):
+            if (level) PORTB |= mask;
+            else PORTB &= ~mask;
+            break;
+        case(GPIO_C):
+            if (level) PORTC |= mask;
+            else PORTC &= ~mask;
+            break;
+        case(GPIO_D):
+            if (level) PORTD |= mask;
+            else PORTD &= ~mask;
+            break;
+    }
+}
+
+// Mode and clock first so SCK is at its idle level before CS drops
+static void spi_select(const spi_dev_t* dev, uint8_t spie) {
+    SPCR = dev->spcr | spie;
+    SPSR = dev->spsr;
+    spi_cs(dev, false);
+}
+
+// Puts the transfer at tail on the bus, called with the bus owned
+static void spi_start(void) {
+    spi_xfer_t* x = spi_queue[spi_tail];
+
+    x->pos = 0;
+    spi_select(x->dev, (1 << SPIE));
+    SPDR = x->tx ? x->tx[0] : SPI_FILL;
+}
+
+// Queue empty, let the module power down
+static void spi_idle(void) {
+    SPCR &= ~(1 << SPIE);
+    spi_active = false;
+    pwr_release(PWR_SPI);
+}
+
+// Called with SPIF set, from the ISR or by hand with interrupts masked.
+// SPDR is read before it is written, which is what clears SPIF.
+static void spi_service(void) {
+    spi_xfer_t* x = spi_queue[spi_tail];
+    uint8_t in = SPDR;
+
+    if (x->rx) x->rx[x->pos] = in;
+    if (++x->pos < x->len) {
+        SPDR = x->tx ? x->tx[x->pos] : SPI_FILL;
+        return;
+    }
+
+    spi_cs(x->dev, true);
+    spi_tail = (spi_tail + 1) & SPI_QUEUE_MASK;
+    x->busy = false;
+    if (x->done) x->done(x);
+
+    if (spi_tail != spi_head) spi_start();
+    else spi_idle();
+}
+
+ISR(SPI_STC_vect) {
+    spi_service();
+}
+
+// Make room in a full queue, nothing drains it with interrupts masked
+static void spi_wait_space(void) {
+    if (!(SREG & (1 << SREG_I))) {
+        while (!(SPSR & (1 << SPIF)));
+        spi_service();
+        return;
+    }
+    cli();
+    if (((spi_head + 1) & SPI_QUEUE_MASK) == spi_tail) pwr_sleep();
+    else sei();
+}
+
+// Waits for the queue to drain, then keeps the bus for a burst
+static void spi_claim(void) {
+    for (;;) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (!spi_active) {
+                spi_active = true;
+                pwr_acquire(PWR_SPI);
+                return;
+            }
+        }
+        spi_flush();
+    }
+}
+
+// Hands the bus back, to the queue if a transfer came in meanwhile
+static void spi_unclaim(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (spi_tail != spi_head) spi_start();
+        else spi_idle();
+    }
+}
+
+/************************** SPI Stuff *********************************/
+
+// Pins and an empty queue, drops anything queued. The module itself
+// stays powered down until a transfer needs it.
+void spi_init(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (spi_active) {
+            SPCR = 0;
+            spi_active = false;
+            pwr_release(PWR_SPI);
+        }
+        spi_head = spi_tail = 0;
+    }
+    PORTB |= (1 << PORTB2);
+    DDRB |= (1 << DDB2) | (1 << DDB3) | (1 << DDB5);
+    DDRB &= ~(1 << DDB4);
+}
+
+// Drives the chip select high, deselected, as an output
+spi_error_t spi_dev_init(const spi_dev_t* dev) {
+    uint8_t mask;
+
+    if (dev->cs_pin > 7) return SPI_INVALID_DEV;
+    mask = (1 << dev->cs_pin);
+
+    switch (dev->cs_port) {
+        case(GPIO_B):
+            if (mask & ((1 << PORTB3) | (1 << PORTB4) | (1 << PORTB5))) return SPI_INVALID_DEV;
+            PORTB |= mask;
+            DDRB |= mask;
+            break;
+        case(GPIO_C):
+            if (dev->cs_pin > 5) return SPI_INVALID_DEV;
+            PORTC |= mask;
+            DDRC |= mask;
+            break;
+        case(GPIO_D):
+            PORTD |= mask;
+            DDRD |= mask;
+            break;
+        default:
+            return SPI_INVALID_DEV;
+    }
+    return SPI_OK;
+}
+
+// Queues the transfer and returns, x must stay put until busy clears
+spi_error_t spi_submit(spi_xfer_t* x) {
+    if (x->len == 0) return SPI_INVALID_LEN;
+    if (x->busy) return SPI_BUSY;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (((spi_head + 1) & SPI_QUEUE_MASK) == spi_tail) return SPI_FULL;
+        x->busy = true;
+        spi_queue[spi_head] = x;
+        spi_head = (spi_head + 1) & SPI_QUEUE_MASK;
+        if (!spi_active) {
+            spi_active = true;
+            pwr_acquire(PWR_SPI);
+            spi_start();
+        }
+    }
+    return SPI_OK;
+}
+
+// Sleeps until the transfer is done, works the queue by hand while
+// interrupts are masked
+void spi_wait(spi_xfer_t* x) {
+    while (x->busy) {
+        if (!(SREG & (1 << SREG_I))) {
+            while (!(SPSR & (1 << SPIF)));
+            spi_service();
+            continue;
+        }
+        cli();
+        if (x->busy) pwr_sleep();
+        else sei();
+    }
+}
+
+// Waits until the bus is free, the queue empty and no burst running
+void spi_flush(void) {
+    while (spi_active) {
+        if (!(SREG & (1 << SREG_I))) {
+            if (spi_tail == spi_head) return;   /*A burst, which cannot be running*/
+            while (!(SPSR & (1 << SPIF)));
+            spi_service();
+            continue;
+        }
+        cli();
+        if (spi_active) pwr_sleep();
+        else sei();
+    }
+}
+
+bool spi_busy(void) {
+    return spi_active;
+}
+
+// Queued transfer that waits, sleeping while the bytes move
+spi_error_t spi_transfer(const spi_dev_t* dev, const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    spi_xfer_t x = {dev, tx, rx, len, 0, false, 0};
+    spi_error_t err;
+
+    PROF_SCOPE(PROF_SPI_TRANSFER);
+    while ((err = spi_submit(&x)) == SPI_FULL) spi_wait_space();
+    if (err != SPI_OK) return err;
+    spi_wait(&x);
+    return SPI_OK;
+}
+
+// Polled, back to back bytes for large blocks. The next tx byte is
+// fetched while the current one shifts, so at SPI_DIV2 the loop only
+// has to be ready within the 16 cycles a byte takes.
+spi_error_t spi_burst(const spi_dev_t* dev, const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    uint8_t out, in;
+
+    if (len == 0) return SPI_INVALID_LEN;
+
+    PROF_SCOPE(PROF_SPI_BURST);
+    spi_claim();
+    spi_select(dev, 0);
+
+    SPDR = tx ? *tx++ : SPI_FILL;
+    while (--len) {
+        out = tx ? *tx++ : SPI_FILL;
+        while (!(SPSR & (1 << SPIF)));
+        in = SPDR;
+        SPDR = out;
+        if (rx) *rx++ = in;
+    }
+    while (!(SPSR & (1 << SPIF)));
+    in = SPDR;
+    if (rx) *rx = in;
+
+    spi_cs(dev, true);
+    spi_unclaim();
+    return SPI_OK;
+}
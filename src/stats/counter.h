@@ -0,0 +1,26 @@
+/***********************************************************************
+* Saturating event counters                                            *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Count driver events without ever wrapping back to a small   *
+*          number that would hide a fault                              *
+*                                                                      *
+* A counter sticks at its type's maximum. The read-modify-write is not *
+* atomic on multi byte types, so a counter an ISR bumps may only be    *
+* bumped elsewhere with interrupts off. Readers copy a driver's        *
+* counters with interrupts off, see stats.h.                           *
+***********************************************************************/
+
+#ifndef COUNTER_H_
+#define COUNTER_H_
+
+#define STAT_INC(c) do { \
+    if ((c) != (__typeof__(c))~0) (c)++; \
+} while (0)
+
+#define STAT_ADD(c, n) do { \
+    __typeof__(c) s_ = (c) + (n); \
+    (c) = (s_ < (c)) ? (__typeof__(c))~0 : s_; \
+} while (0)
+
+#endif //COUNTER_H_
@@ -0,0 +1,32 @@
+/***********************************************************************
+* Driver health and throughput statistics                              *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: One snapshot of every driver's counters so error rates and  *
+*          throughput can be read in the field without a debugger      *
+***********************************************************************/
+
+#include "stats.h"
+#include "systick.h"
+#include <util/atomic.h>
+
+// The drivers' own copies nest their ATOMIC_RESTORESTATE blocks, which
+// leaves interrupts off until the last one is taken
+void stats_snapshot(stats_t* s) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        s->ms = systick_millis();
+        twi_stats(&s->twi);
+        uart_stats(&s->uart);
+        adc_stats(&s->adc);
+        gpio_stats(&s->gpio);
+    }
+}
+
+void stats_reset(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        twi_stats_reset();
+        uart_stats_reset();
+        adc_stats_reset();
+        gpio_stats_reset();
+    }
+}
@@ -0,0 +1,35 @@
+/***********************************************************************
+* Driver health and throughput statistics                              *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: One snapshot of every driver's counters so error rates and  *
+*          throughput can be read in the field without a debugger      *
+*                                                                      *
+* Each driver keeps its own saturating counters (counter.h) and hands  *
+* out a copy with xxx_stats(). stats_snapshot() takes all of them and  *
+* the millisecond clock inside one interrupt-free block, so counters   *
+* from different drivers describe the same instant and two snapshots   *
+* give rates over the time between them.                               *
+***********************************************************************/
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>
+#include "twi_hal.h"
+#include "uart.h"
+#include "adc.h"
+#include "gpio.h"
+
+typedef struct stats {
+    uint32_t ms;            /*systick_millis() when taken*/
+    twi_stats_t twi;
+    uart_stats_t uart;
+    adc_stats_t adc;
+    gpio_stats_t gpio;
+} stats_t;
+
+void stats_snapshot(stats_t* s);
+void stats_reset(void);
+
+#endif //STATS_H_
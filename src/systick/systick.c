@@ -0,0 +1,137 @@
+/***********************************************************************
+* Monotonic system time service                                        *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: 1 ms tick on Timer0 with a microsecond clock built from the *
+*          tick count and the live TCNT0, plus non-blocking deadlines  *
+***********************************************************************/
+
+#include "systick.h"
+#include "pwr.h"
+#include "irq.h"
+#include "board.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+static volatile uint32_t systick_ms = 0;
+static volatile uint32_t systick_us = 0;    /*Microseconds at the last tick, saves a multiply in micros*/
+
+// Timer0 setting for the current system clock, see systick_retime()
+static uint8_t systick_top = SYSTICK_TOP;
+static uint8_t systick_cs = (1 << CS01) | (1 << CS00);     /*F_CPU / 64*/
+static uint8_t systick_us_per_count = SYSTICK_US_PER_COUNT;
+static uint8_t systick_step = 1;            /*ms per compare match*/
+static uint16_t systick_step_us = 1000;
+
+static const uint16_t systick_psc[5] = {1, 8, 64, 256, 1024};   /*Indexed by CS02:0 - 1*/
+
+// CTC restarts the count at the match, so TCNT0 is how late this is
+ISR(TIMER0_COMPA_vect) {
+    irq_stamp(IRQ_SYSTICK, TCNT0);
+    systick_ms += systick_step;
+    systick_us += systick_step_us;
+}
+
+// Needs global interrupts enabled to advance
+void systick_init(void) {
+    pwr_acquire(PWR_TIM0);
+    TCCR0B = 0;
+    TCCR0A = (1 << WGM01);                  /*CTC, TOP = OCR0A*/
+    OCR0A = systick_top;
+    TCNT0 = 0;
+    TIFR0 = (1 << OCF0A);
+    TIMSK0 |= (1 << OCIE0A);
+    TCCR0B = systick_cs;
+    irq_watch(IRQ_SYSTICK, systick_psc[systick_cs - 1], systick_top / BOARD_IRQ_TICK_DIV);
+}
+
+// Moves Timer0 to a new system clock of hz, called by clk_set() right
+// before the CLKPR write. The tick grows to 2 or 4 ms where 1 ms is not
+// a whole number of counts, micros() stays exact. The time into the
+// current tick carries over, so millis() and micros() do not jump.
+// Returns false, changing nothing, if no prescaler fits.
+bool systick_retime(uint32_t hz) {
+    uint8_t ms, step, i, count, cs = 0, top = 0, us_per_count = 0;
+    uint32_t counts = 0;
+    uint16_t elapsed, step_us;
+
+    for (ms = 1; ms <= 4 && cs == 0; ms <<= 1) {
+        for (i = 0; i < 5; i++) {
+            if ((hz % systick_psc[i]) != 0 || ((hz / systick_psc[i]) * ms) % 1000UL != 0) continue;
+            counts = (hz / systick_psc[i]) * ms / 1000UL;
+            if (counts < 2 || counts > 256 || ((uint32_t)systick_psc[i] * 1000000UL) % hz != 0) continue;
+            cs = i + 1;
+            top = (uint8_t)(counts - 1);
+            us_per_count = (uint8_t)((uint32_t)systick_psc[i] * 1000000UL / hz);
+            break;
+        }
+    }
+    if (cs == 0) return false;
+    step = (uint8_t)(counts * us_per_count / 1000);
+    step_us = step * 1000U;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (pwr_active() & (1 << PWR_TIM0)) {
+            count = TCNT0;
+            elapsed = (uint16_t)count * systick_us_per_count;
+            if (TIFR0 & (1 << OCF0A)) {
+                if (count < (systick_top / 2)) {
+                    systick_ms += systick_step;
+                    systick_us += systick_step_us;
+                }
+                TIFR0 = (1 << OCF0A);
+            }
+            while (elapsed >= step_us) {
+                systick_ms += step;
+                systick_us += step_us;
+                elapsed -= step_us;
+            }
+            TCCR0B = 0;
+            OCR0A = top;
+            TCNT0 = (uint8_t)(elapsed / us_per_count);
+            TCCR0B = cs;
+        }
+        systick_top = top;
+        systick_cs = cs;
+        systick_us_per_count = us_per_count;
+        systick_step = step;
+        systick_step_us = step_us;
+    }
+    irq_watch(IRQ_SYSTICK, systick_psc[cs - 1], top / BOARD_IRQ_TICK_DIV);
+    return true;
+}
+
+uint32_t systick_millis(void) {
+    uint32_t ms;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = systick_ms;
+    }
+    return ms;
+}
+
+// Only the reads are atomic, the sums are done with interrupts back on
+uint32_t systick_micros(void) {
+    uint32_t us;
+    uint8_t count;
+    bool pending;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        us = systick_us;
+        count = TCNT0;
+        pending = (TIFR0 & (1 << OCF0A)) != 0;
+    }
+    // A compare match after interrupts were masked is still pending,
+    // a small count means TCNT0 already restarted from zero
+    if (pending && (count < (systick_top / 2))) us += systick_step_us;
+    return us + (uint16_t)count * systick_us_per_count;
+}
+
+// Blocking wait for code that has nothing else to do yet, sleeps
+// between ticks instead of spinning
+void systick_delay_ms(uint16_t ms) {
+    deadline_t d;
+    deadline_set(&d, ms);
+    while (!deadline_expired(&d)) {
+        cli();
+        pwr_sleep();
+    }
+}
@@ -0,0 +1,53 @@
+/***********************************************************************
+* Monotonic system time service                                        *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: 1 ms tick on Timer0 with a microsecond clock built from the *
+*          tick count and the live TCNT0, plus non-blocking deadlines  *
+*                                                                      *
+* Timer0 runs in CTC mode at F_CPU/64, so one count is 4 us at 16 MHz  *
+* and every read is an atomic copy plus a shift/add, no division.      *
+* systick_retime() picks another prescaler when clk_set() divides the  *
+* system clock, SYSTICK_* below are the values for F_CPU.              *
+***********************************************************************/
+
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SYSTICK_PSC 64UL
+#define SYSTICK_TOP ((uint8_t)(F_CPU / SYSTICK_PSC / 1000UL - 1))    /*OCR0A for 1 kHz*/
+#define SYSTICK_US_PER_COUNT ((uint8_t)(SYSTICK_PSC * 1000000UL / F_CPU))
+
+_Static_assert((F_CPU / SYSTICK_PSC) % 1000UL == 0, "F_CPU/64 must be a whole number of kHz for a 1 ms tick");
+_Static_assert((SYSTICK_PSC * 1000000UL) % F_CPU == 0, "F_CPU must give a whole number of us per Timer0 count");
+
+// Wrap safe as long as deadlines are less than 2^31 ms/us away
+typedef uint32_t deadline_t;
+
+void systick_init(void);
+uint32_t systick_millis(void);
+uint32_t systick_micros(void);
+void systick_delay_ms(uint16_t ms);
+bool systick_retime(uint32_t hz);
+
+static inline void deadline_set(deadline_t* d, uint32_t ms) {
+    *d = systick_millis() + ms;
+}
+
+static inline bool deadline_expired(const deadline_t* d) {
+    return (int32_t)(systick_millis() - *d) >= 0;
+}
+
+static inline void deadline_set_us(deadline_t* d, uint32_t us) {
+    *d = systick_micros() + us;
+}
+
+static inline bool deadline_expired_us(const deadline_t* d) {
+    return (int32_t)(systick_micros() - *d) >= 0;
+}
+
+#endif //SYSTICK_H_
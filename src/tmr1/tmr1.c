@@ -1 +1,441 @@
-#include "tmr1.h"
\ No newline at end of file
+/***********************************************************************
+* Hardware Abstraction for AVR Microcontrollers Timer1 driver          *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Drive the 16-bit Timer/Counter1 as a free running counter,  *
+*          a CTC period timer, a PWM generator on OC1A/OC1B or an      *
+*          input capture frequency/period meter on ICP1                *
+***********************************************************************/
+
+#include "tmr1.h"
+#include "pwr.h"
+#include "irq.h"
+#include "tmr2.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+static volatile uint16_t tmr1_ovf = 0;       /*Upper half of the 32-bit count*/
+static void (*volatile tmr1_ctc_cb)(void) = 0;
+static uint16_t tmr1_top = 0xFFFF;
+static tmr1_mode_t tmr1_mode = TMR1_NORMAL;
+static bool tmr1_powered = false;
+static uint32_t tmr1_hz = F_CPU;            /*System clock, see tmr1_retime()*/
+
+static const uint16_t tmr1_psc[5] = {1, 8, 64, 256, 1024};     /*Indexed by TMR1_CLK_DIVx - 1*/
+
+/*Input capture state, written from the capture and gate ISRs*/
+static volatile tmr1_capture_t icp_ring[TMR1_ICP_RING];
+static volatile uint8_t icp_head = 0;
+static volatile uint8_t icp_tail = 0;
+static volatile uint32_t icp_last[2];       /*Last stamp per edge, indexed by tmr1_edge_t*/
+static volatile uint8_t icp_seen = 0;       /*Bit per edge once icp_last holds a real stamp*/
+static volatile uint32_t icp_period = 0;
+static volatile uint32_t icp_high = 0;
+static volatile uint32_t icp_gate_freq = 0;
+static volatile uint32_t icp_gate_last = 0;
+static volatile uint8_t icp_gate_ms = 0;
+static volatile bool icp_gated = false;
+static uint32_t icp_gate_enter = TMR1_ICP_GATE_ENTER;   /*0 while the clock allows no 1 ms gate*/
+static uint8_t icp_gate_ocr = TMR1_ICP_GATE_OCR2A;
+static uint8_t icp_gate_cs = (1 << CS22) | (1 << CS20);         /*F_CPU / 128*/
+static tmr1_icp_mode_t icp_mode = TMR1_ICP_PERIOD;
+static tmr1_edge_t icp_edge = TMR1_EDGE_RISING;
+
+// Call with interrupts masked. An overflow that is still pending in TIFR1
+// belongs to a small count that wrapped before it was sampled.
+static uint32_t tmr1_extend(uint16_t lo) {
+    uint16_t hi = tmr1_ovf;
+    if ((TIFR1 & (1 << TOV1)) && (lo < 0x8000)) hi++;
+    return ((uint32_t)hi << 16) | lo;
+}
+
+static void icp_gate_stop(void) {
+    TCCR2B = 0;
+    TIMSK2 &= ~(1 << TOIE2);
+    pwr_release(PWR_TIM2);
+    tmr2_release(TMR2_ICP_GATE);
+    icp_gated = false;
+}
+
+// Timer1 counts edges on T1 and Timer2 opens a 1 ms gate tick. Fast PWM
+// with TOP = OCR2A and no outputs overflows every period. While the
+// software UART holds Timer2 the meter stays on captures instead.
+static void icp_gate_start(void) {
+    if (!tmr2_claim(TMR2_ICP_GATE)) return;
+    TIMSK1 &= ~(1 << ICIE1);
+    TCCR1B = (TCCR1B & ~0x07) | TMR1_CLK_EXT_RISE;
+    icp_gate_last = tmr1_extend(TCNT1);
+    icp_gate_ms = 0;
+    icp_gated = true;
+
+    pwr_acquire(PWR_TIM2);
+    TCCR2A = (1 << WGM21) | (1 << WGM20);
+    OCR2A = icp_gate_ocr;
+    TCNT2 = 0;
+    TIFR2 = (1 << TOV2);
+    TIMSK2 |= (1 << TOIE2);
+    TCCR2B = (1 << WGM22) | icp_gate_cs;
+}
+
+static void icp_capture_start(void) {
+    if (icp_gated) icp_gate_stop();
+    TCCR1B = (TCCR1B & ~0x07) | TMR1_CLK_DIV1;
+    icp_seen = 0;
+    TIFR1 = (1 << ICF1);
+    TIMSK1 |= (1 << ICIE1);
+}
+
+ISR(TIMER1_OVF_vect) {
+    tmr1_ovf++;
+}
+
+ISR(TIMER1_CAPT_vect) {
+    uint32_t stamp = tmr1_extend(ICR1);
+    tmr1_edge_t edge = (TCCR1B & (1 << ICES1)) ? TMR1_EDGE_RISING : TMR1_EDGE_FALLING;
+    uint8_t next = (icp_head + 1) & (TMR1_ICP_RING - 1);
+
+    if (icp_mode == TMR1_ICP_DUTY) {
+        // Look for the opposite edge next, changing ICES1 can raise a false ICF1
+        TCCR1B ^= (1 << ICES1);
+        TIFR1 = (1 << ICF1);
+        if ((edge == TMR1_EDGE_FALLING) && (icp_seen & (1 << TMR1_EDGE_RISING))) {
+            icp_high = stamp - icp_last[TMR1_EDGE_RISING];
+        }
+    }
+    if ((edge == icp_edge) && (icp_seen & (1 << edge))) {
+        icp_period = stamp - icp_last[edge];
+    }
+    icp_last[edge] = stamp;
+    icp_seen |= (1 << edge);
+
+    // Keep the most recent captures, the oldest one is dropped when full
+    icp_ring[icp_head].stamp = stamp;
+    icp_ring[icp_head].edge = edge;
+    icp_head = next;
+    if (next == icp_tail) icp_tail = (icp_tail + 1) & (TMR1_ICP_RING - 1);
+
+    if ((icp_period != 0) && (icp_period < icp_gate_enter)) icp_gate_start();
+}
+
+// Gate tick for the high frequency range, only enabled while gated
+ISR(TIMER2_OVF_vect) {
+    uint32_t count, edges;
+
+    if (++icp_gate_ms < TMR1_ICP_GATE_MS) return;
+    icp_gate_ms = 0;
+
+    count = tmr1_extend(TCNT1);
+    edges = count - icp_gate_last;
+    icp_gate_last = count;
+    icp_gate_freq = edges * (1000UL / TMR1_ICP_GATE_MS);
+
+    if (edges < TMR1_ICP_GATE_EXIT) {
+        icp_period = 0;
+        icp_capture_start();
+    }
+}
+
+// The callback runs with interrupts enabled, a period that ends during
+// it gives one more run instead of a nested one
+ISR(TIMER1_COMPA_vect) {
+    if (!tmr1_ctc_cb || !irq_open(IRQ_TMR1_CTC)) return;
+    do tmr1_ctc_cb(); while (irq_close(IRQ_TMR1_CTC));
+}
+
+/************************* Timer1 Utility Stuff ***********************/
+
+tmr1_error_t tmr1_init(tmr1_mode_t mode, tmr1_clk_t clk, uint16_t top) {
+    if (clk > TMR1_CLK_EXT_RISE) return TMR1_INVALID_CLK;
+    if (!tmr1_powered) {
+        pwr_acquire(PWR_TIM1);
+        tmr1_powered = true;
+    }
+
+    // Stop the counter while the waveform generator is reconfigured
+    TCCR1B = 0;
+    TIMSK1 &= ~((1 << TOIE1) | (1 << OCIE1A) | (1 << ICIE1));
+    TIFR1 = (1 << TOV1) | (1 << OCF1A) | (1 << ICF1);
+    if (icp_gated) icp_gate_stop();
+
+    switch (mode) {
+        case(TMR1_NORMAL):
+            TCCR1A = 0;
+            top = 0xFFFF;
+            TIMSK1 |= (1 << TOIE1);
+            break;
+        case(TMR1_CTC):
+            TCCR1A = 0;
+            TCCR1B = (1 << WGM12);
+            OCR1A = top;
+            TIMSK1 |= (1 << OCIE1A);
+            break;
+        case(TMR1_PWM_FAST):
+            TCCR1A = (1 << WGM11);
+            TCCR1B = (1 << WGM13) | (1 << WGM12);
+            ICR1 = top;
+            break;
+        case(TMR1_PWM_PHASE):
+            TCCR1A = (1 << WGM11);
+            TCCR1B = (1 << WGM13);
+            ICR1 = top;
+            break;
+        default:
+            return TMR1_INVALID_MODE;
+    }
+
+    tmr1_top = top;
+    tmr1_mode = mode;
+    tmr1_ovf = 0;
+    TCNT1 = 0;
+    tmr1_start(clk);
+    return TMR1_OK;
+}
+
+void tmr1_start(tmr1_clk_t clk) {
+    if (!tmr1_powered) {
+        pwr_acquire(PWR_TIM1);
+        tmr1_powered = true;
+    }
+    TCCR1B = (TCCR1B & ~0x07) | (clk & 0x07);
+}
+
+// Releases Timer1 so it can be powered down, tmr1_start() reacquires it
+void tmr1_stop(void) {
+    TCCR1B &= ~0x07;
+    if (tmr1_powered) {
+        pwr_release(PWR_TIM1);
+        tmr1_powered = false;
+    }
+}
+
+/************************** Timer1 PWM Stuff **************************/
+
+// Non-inverting clears OC1x on compare match counting up, inverting sets it
+tmr1_error_t tmr1_pwm_enable(uint8_t channels, bool inverted) {
+    if ((channels == 0) || (channels & ~(TMR1_CH_A | TMR1_CH_B))) return TMR1_INVALID_CHANNEL;
+
+    if (channels & TMR1_CH_A) {
+        TCCR1A |= (1 << COM1A1) | (inverted ? (1 << COM1A0) : 0);
+        DDRB |= (1 << DDB1);
+    }
+    if (channels & TMR1_CH_B) {
+        TCCR1A |= (1 << COM1B1) | (inverted ? (1 << COM1B0) : 0);
+        DDRB |= (1 << DDB2);
+    }
+    return TMR1_OK;
+}
+
+// In both PWM modes the hardware double buffers OCR1x and latches the new
+// value at TOP/BOTTOM, so an update never produces a short or runt pulse.
+// The 16-bit write goes through the shared TEMP register and must not be
+// split by an ISR touching another 16-bit Timer1 register.
+tmr1_error_t tmr1_pwm_write(tmr1_channel_t ch, uint16_t ocr) {
+    if (ocr > tmr1_top) ocr = tmr1_top;
+    switch (ch) {
+        case(TMR1_CH_A):
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                OCR1A = ocr;
+            }
+            break;
+        case(TMR1_CH_B):
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                OCR1B = ocr;
+            }
+            break;
+        default:
+            return TMR1_INVALID_CHANNEL;
+    }
+    return TMR1_OK;
+}
+
+// duty is a Q15 fraction of TOP, TMR1_DUTY_MAX == 100%
+tmr1_error_t tmr1_pwm_duty(tmr1_channel_t ch, uint16_t duty) {
+    if (duty > TMR1_DUTY_MAX) duty = TMR1_DUTY_MAX;
+    return tmr1_pwm_write(ch, (uint16_t)(((uint32_t)tmr1_top * duty) >> 15));
+}
+
+/************************** Timer1 CTC Stuff **************************/
+
+// Runs once per period with interrupts enabled, see irq.h. State it
+// shares with the main loop needs an ATOMIC_BLOCK.
+void tmr1_ctc_callback(void (*cb)(void)) {
+    tmr1_ctc_cb = cb;
+}
+
+/********************** Timer1 Input Capture Stuff ********************/
+
+// Timer1 runs free at F_CPU so every capture has 1/F_CPU resolution and
+// a 32-bit range (~268 s at 16 MHz). The noise canceler adds a 4 sample
+// delay to each capture but rejects glitches shorter than that.
+tmr1_error_t tmr1_icp_init(tmr1_icp_mode_t mode, tmr1_edge_t edge, bool noise_cancel) {
+    if (mode > TMR1_ICP_DUTY) return TMR1_INVALID_MODE;
+
+    tmr1_init(TMR1_NORMAL, TMR1_CLK_DIV1, 0xFFFF);
+    DDRB &= ~(1 << DDB0);   /*ICP1*/
+    DDRD &= ~(1 << DDD5);   /*T1, only used while gated*/
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        icp_mode = mode;
+        icp_edge = edge;
+        icp_head = 0;
+        icp_tail = 0;
+        icp_period = 0;
+        icp_high = 0;
+        icp_gate_freq = 0;
+        TCCR1B &= ~((1 << ICNC1) | (1 << ICES1));
+        if (noise_cancel) TCCR1B |= (1 << ICNC1);
+        if (edge == TMR1_EDGE_RISING) TCCR1B |= (1 << ICES1);
+        icp_capture_start();
+    }
+    return TMR1_OK;
+}
+
+void tmr1_icp_stop(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        TIMSK1 &= ~(1 << ICIE1);
+        if (icp_gated) {
+            icp_gate_stop();
+            TCCR1B = (TCCR1B & ~0x07) | TMR1_CLK_DIV1;
+        }
+    }
+}
+
+// Pops the oldest capture, returns false when the ring is empty
+bool tmr1_icp_read(tmr1_capture_t* cap) {
+    bool ok = false;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (icp_tail != icp_head) {
+            cap->stamp = icp_ring[icp_tail].stamp;
+            cap->edge = icp_ring[icp_tail].edge;
+            icp_tail = (icp_tail + 1) & (TMR1_ICP_RING - 1);
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Last period in system clock ticks, 0 until two edges were seen or while gated
+uint32_t tmr1_icp_period(void) {
+    uint32_t period;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        period = icp_period;
+    }
+    return period;
+}
+
+// Last high time in system clock ticks, TMR1_ICP_DUTY only
+uint32_t tmr1_icp_high(void) {
+    uint32_t high;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        high = icp_high;
+    }
+    return high;
+}
+
+// The division only happens here, never in interrupt context
+uint32_t tmr1_icp_freq(void) {
+    uint32_t period;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (icp_gated) return icp_gate_freq;
+        period = icp_period;
+    }
+    return (period != 0) ? (tmr1_hz / period) : 0;
+}
+
+bool tmr1_icp_gated(void) {
+    return icp_gated;
+}
+
+/************************* Timer1 Counter Stuff ***********************/
+
+uint16_t tmr1_count(void) {
+    uint16_t count;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        count = TCNT1;
+    }
+    return count;
+}
+
+// 32 bits in TMR1_NORMAL only. The other modes leave TOIE1 off and TOV1
+// stays set, so there is no upper half and this is TCNT1 alone.
+uint32_t tmr1_ticks32(void) {
+    uint32_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ticks = (tmr1_mode == TMR1_NORMAL) ? tmr1_extend(TCNT1) : TCNT1;
+    }
+    return ticks;
+}
+
+/************************** Timer1 Clock Stuff ************************/
+
+// Timer2 settings for the 1 ms gate tick at a system clock of hz, false
+// if no prescaler gives a whole number of counts
+static bool icp_gate_plan(uint32_t hz) {
+    static const uint16_t psc2[7] = {1, 8, 32, 64, 128, 256, 1024};    /*CS22:0 - 1*/
+    uint32_t counts;
+    uint8_t i;
+
+    for (i = 0; i < 7; i++) {
+        if ((hz % (psc2[i] * 1000UL)) != 0) continue;
+        counts = hz / (psc2[i] * 1000UL);
+        if (counts > 256) continue;
+        icp_gate_ocr = (uint8_t)(counts - 1);
+        icp_gate_cs = i + 1;
+        return true;
+    }
+    return false;
+}
+
+// Moves Timer1 to a new system clock of hz, called by clk_set() after the
+// CLKPR write. CTC and PWM keep their frequency with a new prescaler and
+// TOP, duty cycles are scaled with TOP. Captures and tmr1_icp_freq() use
+// the new clock, a period that straddles the change is dropped. The gated
+// range is only kept while Timer2 can time a whole 1 ms.
+void tmr1_retime(uint32_t hz) {
+    uint32_t cycles, counts;
+    uint16_t top;
+    uint8_t clk, i, slopes;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        clk = TCCR1B & 0x07;
+        if (tmr1_powered && tmr1_mode != TMR1_NORMAL && clk >= TMR1_CLK_DIV1 && clk <= TMR1_CLK_DIV1024) {
+            slopes = (tmr1_mode == TMR1_PWM_PHASE) ? 2 : 1;
+            counts = (tmr1_mode == TMR1_PWM_PHASE) ? tmr1_top : (uint32_t)tmr1_top + 1;
+            cycles = tmr1_psc[clk - 1] * slopes * counts;
+            // The clocks are F_CPU over powers of two, so the ratio is exact
+            if (hz < tmr1_hz) cycles /= (tmr1_hz / hz);
+            else cycles *= (hz / tmr1_hz);
+
+            for (i = 0; i < 4; i++) {
+                if (cycles / ((uint32_t)tmr1_psc[i] * slopes) <= ((slopes == 2) ? 0xFFFFUL : 0x10000UL)) break;
+            }
+            counts = cycles / ((uint32_t)tmr1_psc[i] * slopes);
+            if (counts > ((slopes == 2) ? 0xFFFFUL : 0x10000UL)) counts = (slopes == 2) ? 0xFFFFUL : 0x10000UL;
+            if (counts < 4) counts = 4;
+            top = (uint16_t)((slopes == 2) ? counts : counts - 1);
+
+            TCCR1B &= ~0x07;
+            if (tmr1_mode == TMR1_CTC) OCR1A = top;
+            else {
+                OCR1A = (uint16_t)((uint32_t)OCR1A * top / tmr1_top);
+                OCR1B = (uint16_t)((uint32_t)OCR1B * top / tmr1_top);
+                ICR1 = top;
+            }
+            tmr1_top = top;
+            TCNT1 = 0;
+            TCCR1B |= i + 1;
+        }
+
+        icp_gate_enter = icp_gate_plan(hz) ? hz / TMR1_ICP_GATE_HZ : 0;
+        if (icp_gated) {
+            if (icp_gate_enter) {
+                OCR2A = icp_gate_ocr;
+                TCNT2 = 0;
+                TCCR2B = (1 << WGM22) | icp_gate_cs;
+            }
+            else icp_capture_start();
+        }
+        icp_seen = 0;
+        tmr1_hz = hz;
+    }
+}
@@ -1,3 +1,142 @@
+/***********************************************************************
+* Hardware Abstraction for AVR Microcontrollers Timer1 driver          *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Drive the 16-bit Timer/Counter1 as a free running counter,  *
+*          a CTC period timer, a PWM generator on OC1A/OC1B or an      *
+*          input capture frequency/period meter on ICP1                *
+*                                                                      *
+* Prescaler and TOP are picked from a requested frequency with the     *
+* TMR1_CLK_FOR()/TMR1_TOP_FOR() macros, which fold to constants, so    *
+* TMR1_INIT() compiles down to a handful of register loads.            *
+***********************************************************************/
+
 #ifndef TMR1_H_
 #define TMR1_H_
-#endif //TMR1_H_
\ No newline at end of file
+
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum tmr1_error {
+    TMR1_OK,
+    TMR1_INVALID_MODE,
+    TMR1_INVALID_CLK,
+    TMR1_INVALID_CHANNEL
+} tmr1_error_t;
+
+// TCCR1B bits 2:0
+typedef enum tmr1_clk {
+    TMR1_CLK_STOP,
+    TMR1_CLK_DIV1,
+    TMR1_CLK_DIV8,
+    TMR1_CLK_DIV64,
+    TMR1_CLK_DIV256,
+    TMR1_CLK_DIV1024,
+    TMR1_CLK_EXT_FALL,  /*External clock on T1 (PD5), falling edge*/
+    TMR1_CLK_EXT_RISE   /*External clock on T1 (PD5), rising edge*/
+} tmr1_clk_t;
+
+typedef enum tmr1_mode {
+    TMR1_NORMAL,        /*WGM 0, counts 0 -- 0xFFFF, overflows extend TCNT1 to 32 bits*/
+    TMR1_CTC,           /*WGM 4, TOP = OCR1A, callback once per period*/
+    TMR1_PWM_FAST,      /*WGM 14, TOP = ICR1, single slope*/
+    TMR1_PWM_PHASE      /*WGM 10, TOP = ICR1, dual slope*/
+} tmr1_mode_t;
+
+// Bitmask so both outputs can be enabled in one call
+typedef enum tmr1_channel {
+    TMR1_CH_A = 0x01,   /*OC1A on PB1*/
+    TMR1_CH_B = 0x02    /*OC1B on PB2*/
+} tmr1_channel_t;
+
+// ICES1 value, the edge that loads ICR1
+typedef enum tmr1_edge {
+    TMR1_EDGE_FALLING,
+    TMR1_EDGE_RISING
+} tmr1_edge_t;
+
+typedef enum tmr1_icp_mode {
+    TMR1_ICP_PERIOD,    /*Capture one edge polarity, period only*/
+    TMR1_ICP_DUTY       /*Alternate edges, period and high time*/
+} tmr1_icp_mode_t;
+
+// One ICR1 sample extended with the overflow count, in system clock ticks
+typedef struct tmr1_capture {
+    uint32_t stamp;
+    tmr1_edge_t edge;
+} tmr1_capture_t;
+
+/*Input capture configuration*/
+// Captures run at the system clock (62.5 ns at 16 MHz) and are kept in a ring
+// that must be a power of two. Above TMR1_ICP_GATE_HZ a capture per
+// edge would swamp the CPU, so the driver switches to counting edges
+// on T1 (PD5) over a TMR1_ICP_GATE_MS window timed by Timer2, and
+// switches back below half that frequency. ICP1 (PB0) and T1 (PD5)
+// must both be wired to the signal for the gated range to work. The
+// gate needs Timer2, see tmr2.h: while the software UART holds it the
+// meter keeps capturing, as far as the CPU keeps up.
+#define TMR1_ICP_RING 8
+#define TMR1_ICP_GATE_HZ 50000UL
+#define TMR1_ICP_GATE_MS 10
+#define TMR1_ICP_GATE_ENTER (F_CPU / TMR1_ICP_GATE_HZ)                     /*Period in ticks*/
+#define TMR1_ICP_GATE_EXIT ((TMR1_ICP_GATE_HZ / 2) * TMR1_ICP_GATE_MS / 1000) /*Edges per gate*/
+#define TMR1_ICP_GATE_OCR2A ((uint8_t)(F_CPU / 128UL / 1000UL - 1))          /*1 ms at /128*/
+
+/*Duty cycles are Q15 fractions of TOP so scaling is a multiply and shift*/
+#define TMR1_DUTY_MAX 0x8000U
+#define TMR1_DUTY_PCT(pct) ((uint16_t)(((pct) * (uint32_t)TMR1_DUTY_MAX) / 100UL))
+
+/*Compile time prescaler and TOP selection*/
+// Fast PWM and CTC:   f = F_CPU / (N * (1 + TOP))
+// Phase correct PWM:  f = F_CPU / (2 * N * TOP)
+// The smallest prescaler whose count still fits 16 bits gives the finest resolution.
+#define TMR1_SLOPES_(mode) ((mode) == TMR1_PWM_PHASE ? 2UL : 1UL)
+#define TMR1_COUNTS_(mode, div, hz) (F_CPU / ((uint32_t)(div) * TMR1_SLOPES_(mode) * (uint32_t)(hz)))
+#define TMR1_FITS_(mode, div, hz) (TMR1_COUNTS_(mode, div, hz) <= ((mode) == TMR1_PWM_PHASE ? 0xFFFFUL : 0x10000UL))
+
+#define TMR1_DIV_FOR(mode, hz) \
+    (TMR1_FITS_(mode, 1, hz)   ? 1UL   : \
+     TMR1_FITS_(mode, 8, hz)   ? 8UL   : \
+     TMR1_FITS_(mode, 64, hz)  ? 64UL  : \
+     TMR1_FITS_(mode, 256, hz) ? 256UL : 1024UL)
+
+#define TMR1_CLK_FOR(mode, hz) \
+    (TMR1_FITS_(mode, 1, hz)   ? TMR1_CLK_DIV1   : \
+     TMR1_FITS_(mode, 8, hz)   ? TMR1_CLK_DIV8   : \
+     TMR1_FITS_(mode, 64, hz)  ? TMR1_CLK_DIV64  : \
+     TMR1_FITS_(mode, 256, hz) ? TMR1_CLK_DIV256 : TMR1_CLK_DIV1024)
+
+#define TMR1_TOP_FOR(mode, hz) \
+    ((uint16_t)(TMR1_COUNTS_(mode, TMR1_DIV_FOR(mode, hz), hz) - ((mode) == TMR1_PWM_PHASE ? 0UL : 1UL)))
+
+// Rejects frequencies that are out of reach even with the /1024 prescaler
+#define TMR1_INIT(mode, hz) ({ \
+    _Static_assert(TMR1_FITS_(mode, 1024, hz), "Timer1 frequency too low for a 16-bit TOP"); \
+    _Static_assert(TMR1_COUNTS_(mode, 1, hz) >= 4UL, "Timer1 frequency too high for 2-bit resolution"); \
+    tmr1_init((mode), TMR1_CLK_FOR(mode, hz), TMR1_TOP_FOR(mode, hz)); \
+})
+
+tmr1_error_t tmr1_init(tmr1_mode_t mode, tmr1_clk_t clk, uint16_t top);
+void tmr1_start(tmr1_clk_t clk);
+void tmr1_stop(void);
+
+tmr1_error_t tmr1_pwm_enable(uint8_t channels, bool inverted);
+tmr1_error_t tmr1_pwm_write(tmr1_channel_t ch, uint16_t ocr);
+tmr1_error_t tmr1_pwm_duty(tmr1_channel_t ch, uint16_t duty);
+
+void tmr1_ctc_callback(void (*cb)(void));
+
+tmr1_error_t tmr1_icp_init(tmr1_icp_mode_t mode, tmr1_edge_t edge, bool noise_cancel);
+void tmr1_icp_stop(void);
+bool tmr1_icp_read(tmr1_capture_t* cap);
+uint32_t tmr1_icp_period(void);
+uint32_t tmr1_icp_high(void);
+uint32_t tmr1_icp_freq(void);
+bool tmr1_icp_gated(void);
+
+uint16_t tmr1_count(void);
+uint32_t tmr1_ticks32(void);
+void tmr1_retime(uint32_t hz);
+
+#endif //TMR1_H_
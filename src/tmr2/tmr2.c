@@ -0,0 +1,35 @@
+/***********************************************************************
+* Timer2 ownership                                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Let one driver at a time set Timer2 up                      *
+***********************************************************************/
+
+#include "tmr2.h"
+#include <util/atomic.h>
+
+static volatile tmr2_owner_t tmr2_who = TMR2_FREE;
+
+// True if the timer was free or already held by who. Safe from an ISR.
+bool tmr2_claim(tmr2_owner_t who) {
+    bool ok = false;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (tmr2_who == TMR2_FREE || tmr2_who == who) {
+            tmr2_who = who;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Does nothing unless who holds the timer
+void tmr2_release(tmr2_owner_t who) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (tmr2_who == who) tmr2_who = TMR2_FREE;
+    }
+}
+
+tmr2_owner_t tmr2_owner(void) {
+    return tmr2_who;
+}
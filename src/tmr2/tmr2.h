@@ -0,0 +1,28 @@
+/***********************************************************************
+* Timer2 ownership                                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Let one driver at a time set Timer2 up                      *
+*                                                                      *
+* The software UART runs Timer2 free with both compares, tmr1's gated  *
+* frequency range runs it as a 1 ms tick. Each claims the timer before *
+* touching its registers and a claim held by the other one fails.      *
+* Powering it is still up to the owner, through PWR_TIM2.              *
+***********************************************************************/
+
+#ifndef TMR2_H_
+#define TMR2_H_
+
+#include <stdbool.h>
+
+typedef enum tmr2_owner {
+    TMR2_FREE,
+    TMR2_SUART,         /*suart.c, from suart_init() on*/
+    TMR2_ICP_GATE       /*tmr1.c, while the gated range is on*/
+} tmr2_owner_t;
+
+bool tmr2_claim(tmr2_owner_t who);
+void tmr2_release(tmr2_owner_t who);
+tmr2_owner_t tmr2_owner(void);
+
+#endif //TMR2_H_
@@ -6,139 +6,119 @@
  */ 
 
 #include "twi_hal.h"
+#include <util/atomic.h>
+#include "systick.h"
+#include "pwr.h"
+#include "prof.h"
+#include "counter.h"
 
 volatile uint8_t status = 0xF8;
 
-// Interrupt routine that triggers when TWINT is cleared by hardware
+static twi_stats_t twi_stat;		/*Only touched from the main loop*/
+static uint8_t twi_twbr = (uint8_t)BOARD_TWBR;	/*For the current system clock, see twi_retime()*/
+
+// Interrupt routine that triggers when TWINT is set by hardware.
+// TWINT stays set until the next command, so TWIE goes off here and
+// every command turns it back on, otherwise the ISR would run back to
+// back until then. TWCR is written, not read back: writing TWINT as
+// one would start the next bus action.
 ISR(TWI_vect) {
 	status = (TWSR & 0xF8); /* Bit mask throws away the lower two bits (PSC setting bits)*/
+	TWCR = (1 << TWEN);
 }
 
 /* Note: The TWCR register bits control the I2C action to come */
 /* 		 When TWINT is cleared, these actions occur            */
 
+// Issue a bus action and sleep until the ISR reports the expected status.
+// status is reset first, otherwise a step expecting the same code as the
+// previous one (e.g. consecutive data bytes) would see the stale value.
+// The ISR runs as soon as TWIE is set with TWINT still up, so the reset
+// and the TWCR write that clears TWINT have to happen without it between.
+// Any other status is final (a NACK, lost arbitration), so it fails the
+// step at once with err; only a bus that never answers waits out
+// TWI_TIMEOUT, whatever the step, and ends with TWI_ERROR_TIMEOUT.
+static twi_error_t twi_cmd(uint8_t twcr, uint8_t expect, twi_error_t err) {
+
+	deadline_t d;
+	deadline_set_us(&d, TWI_TIMEOUT);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		status = TWI_NONE;
+		TWCR = twcr;
+	}
+
+	while(status != expect){
+		if(status != TWI_NONE) return err;
+		if(deadline_expired_us(&d)) return TWI_ERROR_TIMEOUT;
+		cli();
+		if(status == TWI_NONE) pwr_sleep();
+		else sei();
+	}
+	return TWI_OK;
+}
+
 static twi_error_t twi_start(void) {
 
-	uint16_t i = 0;
-	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
-	
 	// Wait for TWSR to indicate that the START condition was properly
 	// initiated on the I2C bus
-	while(status != TWI_START){
-		i++;
-		if(i >= TWI_TIMEOUT){
-			return TWI_ERROR_START;
-		}
-	}
-	return TWI_OK;
+	return twi_cmd((1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE), TWI_START, TWI_ERROR_START);
 }
 
 static void twi_stop(void) {
-	
+
+	deadline_t d;
 	TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN) | (1 << TWIE);
+
+	// TWSTO clears once the STOP is on the bus, only then may the
+	// module be powered down
+	deadline_set_us(&d, TWI_TIMEOUT);
+	while((TWCR & (1 << TWSTO)) && !deadline_expired_us(&d));
 }
 
 static twi_error_t twi_restart(void) {
 
-	uint16_t i = 0;
-	TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
-
 	// Wait for TWSR to indicate that START condition was transmitted
 	// and therefore the MCU is the bus master
-	while(status != TWI_RSTART){
-		i++;
-		if(i >= TWI_TIMEOUT){
-			return TWI_ERROR_RSTART;
-		}
-	}
-	return TWI_OK;
+	return twi_cmd((1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE), TWI_RSTART, TWI_ERROR_RSTART);
 }
 
 static twi_error_t twi_addr_write_ack(void) {
 
-	uint16_t i = 0;
-	TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
-
 	// Wait for TWSR to indicate that SLA + W has been transmitted
 	// and ACK has been received from slave device
-	while(status != TWIT_ADDR_ACK){
-		i++;
-		if(i >= TWI_TIMEOUT){
-			return TWI_NACK;
-		}
-	}
-	return TWI_OK;
+	return twi_cmd((1 << TWINT) | (1 << TWEN) | (1 << TWIE), TWIT_ADDR_ACK, TWI_NACK);
 }
 
 
 static twi_error_t twi_data_write_ack(void) {
 
-	uint16_t i = 0;
-	TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
-
 	// Wait for TWSR to indicate that DATA has been transmitted
 	// and ACK has been received from slave device
-	while(status != TWIT_DATA_ACK){
-		i++;
-		if(i >= TWI_TIMEOUT){
-			return TWI_NACK;
-		}
-	}
-	return TWI_OK;
+	return twi_cmd((1 << TWINT) | (1 << TWEN) | (1 << TWIE), TWIT_DATA_ACK, TWI_NACK);
 }
 
 
 static twi_error_t twi_addr_read_ack(void) {
 
-	uint16_t i = 0;
-	TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
-
-	// Wait for TWSR to indicate that DATA has been transmitted
+	// Wait for TWSR to indicate that SLA + R has been transmitted
 	// and ACK has been received from slave device
-	while(status != TWIR_ADDR_ACK){
-		i++;
-		if(i >= TWI_TIMEOUT){
-			return TWI_NACK;
-		}
-	}
-	return TWI_OK;
+	return twi_cmd((1 << TWINT) | (1 << TWEN) | (1 << TWIE), TWIR_ADDR_ACK, TWI_NACK);
 }
 
 // Optionally wait for NACK (In the I2C protocol, NACK signifies to slave 
 // that master is done reading...)
 static twi_error_t twi_data_read_ack(uint8_t ack) {
 
-	uint16_t i = 0;
-
 	if(ack != 0) {
-
-		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE) | (1 << TWEA);
-
-		while(status != TWIR_DATA_ACK) {
-			i++;
-			if(i >= TWI_TIMEOUT){
-				return TWI_NACK;
-			}
-		}
+		return twi_cmd((1 << TWINT) | (1 << TWEN) | (1 << TWIE) | (1 << TWEA), TWIR_DATA_ACK, TWI_NACK);
 	}
 
-	else {
-		
-		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
-
-		while(status != TWIR_DATA_NACK){
-			i++;
-			if(i >= TWI_TIMEOUT){
-				return TWI_ERROR_START;
-			}
-		}
-		
-	}
-	return TWI_OK;
+	return twi_cmd((1 << TWINT) | (1 << TWEN) | (1 << TWIE), TWIR_DATA_NACK, TWI_ERROR_START);
 }
 
 
-twi_error_t twi_read(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+static twi_error_t twi_read_xfer(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
 	
 	uint16_t i = 0;
 	uint8_t err = TWI_OK;
@@ -201,7 +181,7 @@ twi_error_t twi_read(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
 }
 
 
-twi_error_t twi_write(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+static twi_error_t twi_write_xfer(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
 	
 	uint16_t i = 0;
 	uint8_t err = TWI_OK;
@@ -245,13 +225,78 @@ twi_error_t twi_write(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
 }
 
 
-twi_error_t twi_init(uint32_t speed, bool PUE) {
-	
-	uint32_t gen_t = 0;
-	// Bitwise and with 0xFF to ensure 8 bit integer width
-	gen_t = (((F_CPU/speed) - 16) / 2) & 0xFF;
-	TWBR = gen_t & 0xFF;
+// The TWI is powered down between transactions and the datasheet asks
+// for it to be set up again after PRR has woken it, as twi_init() does
+static void twi_acquire(void) {
+
+	pwr_acquire(PWR_TWI);
+	TWSR = 0;				/*Prescaler 1, BOARD_TWBR assumes it*/
+	TWBR = twi_twbr;
 	TWCR = (1 << TWEN) | (1 << TWIE);
+}
+
+
+// Counts a finished transaction by how it ended
+static void twi_count(twi_error_t err, uint16_t len) {
+
+	STAT_INC(twi_stat.transactions);
+	switch(err) {
+		case(TWI_OK):
+			STAT_ADD(twi_stat.bytes, len);
+			break;
+		case(TWI_NACK):
+			STAT_INC(twi_stat.nacks);
+			break;
+		case(TWI_ERROR_START):
+			STAT_INC(twi_stat.start_fails);
+			break;
+		case(TWI_ERROR_RSTART):
+			STAT_INC(twi_stat.restart_fails);
+			break;
+		case(TWI_ERROR_TIMEOUT):
+			STAT_INC(twi_stat.timeouts);
+			break;
+		default:
+			break;
+	}
+}
+
+
+// The TWI is only powered for the length of a transaction
+twi_error_t twi_read(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+
+	twi_error_t err;
+	PROF_SCOPE(PROF_TWI_READ);
+
+	twi_acquire();
+	err = twi_read_xfer(addr, reg, data, len);
+	pwr_release(PWR_TWI);
+	twi_count(err, len);
+
+	return err;
+}
+
+
+twi_error_t twi_write(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+
+	twi_error_t err;
+	PROF_SCOPE(PROF_TWI_WRITE);
+
+	twi_acquire();
+	err = twi_write_xfer(addr, reg, data, len);
+	pwr_release(PWR_TWI);
+	twi_count(err, len);
+
+	return err;
+}
+
+
+// SCL is BOARD_SCL_HZ, TWBR is worked out and range checked in board.h
+twi_error_t twi_init(bool PUE) {
+
+	twi_stats_reset();
+	twi_acquire();
+	pwr_release(PWR_TWI);
 
 	// Check if MCUCR has PUD bit set...
 	if((MCUCR & (uint8_t)0x08) && PUE) {
@@ -265,3 +310,31 @@ twi_error_t twi_init(uint32_t speed, bool PUE) {
 }
 
 
+// Reloads TWBR for a new system clock, called by clk_set(). SCL stays at
+// BOARD_SCL_HZ while TWBR can reach BOARD_TWBR_MIN, below that it slows
+// down with the clock.
+void twi_retime(uint32_t hz) {
+
+	if (hz / BOARD_SCL_HZ >= 16 + 2 * BOARD_TWBR_MIN) twi_twbr = (uint8_t)BOARD_TWBR_AT(hz);
+	else twi_twbr = BOARD_TWBR_MIN;
+
+	pwr_acquire(PWR_TWI);
+	TWBR = twi_twbr;
+	pwr_release(PWR_TWI);
+}
+
+
+void twi_stats(twi_stats_t* stats) {
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*stats = twi_stat;
+	}
+}
+
+
+void twi_stats_reset(void) {
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		twi_stat = (twi_stats_t){0};
+	}
+}
@@ -13,8 +13,9 @@
 #include <avr/interrupt.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "board.h"
 
-#define TWI_TIMEOUT 1600
+#define TWI_TIMEOUT 1000 /*us allowed for each bus step*/
 
 #define TWI_START		0x08
 #define TWI_RSTART		0x10
@@ -39,13 +40,27 @@ typedef enum {
 	TWI_ERROR_START,
 	TWI_ERROR_RSTART,
 	TWI_NACK,
-	TWI_PUD
+	TWI_PUD,
+	TWI_ERROR_TIMEOUT
 } twi_error_t;
 
+// Saturating, see counter.h. A transaction that fails is counted once,
+// by how it ended: a bus that never answered is a timeout only.
+typedef struct twi_stats {
+	uint32_t transactions;
+	uint32_t bytes;			/*Data bytes moved, not the address or register*/
+	uint16_t nacks;
+	uint16_t start_fails;
+	uint16_t restart_fails;
+	uint16_t timeouts;
+} twi_stats_t;
 
-twi_error_t twi_init(uint32_t speed, bool PUE);
+twi_error_t twi_init(bool PUE);
 twi_error_t twi_write(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len);
 twi_error_t twi_read(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len);
+void twi_retime(uint32_t hz);
+void twi_stats(twi_stats_t* stats);
+void twi_stats_reset(void);
 /*all other functions are static and therefore not delcared here*/
 
 #endif /* TWI_HAL_H_ */
\ No newline at end of file
@@ -0,0 +1,263 @@
+/***********************************************************************
+* Software I2C master on GPIO pins                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: A second, independent I2C bus on any two port pins so slow  *
+*          or misbehaving devices stay off the hardware TWI            *
+***********************************************************************/
+
+#include "twi_soft.h"
+#include "systick.h"
+#include "counter.h"
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#define TWI_SOFT_BASE(port) ((uint8_t)(0x23 + 3 * (port)))     /*PINB, PINC, PIND*/
+
+static uint32_t twi_soft_edge;      /*systick_micros() at the last SCL edge*/
+
+/************************** Bus Line Stuff ****************************/
+
+// Open drain: an output with PORT cleared pulls the line low, an input
+// lets the pull-up have it. Other pins on the port may change in ISRs.
+static inline void twi_soft_pull(uint8_t base, uint8_t mask) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _SFR_MEM8(base + OFFSET_DIR) |= mask;
+    }
+}
+
+static inline void twi_soft_let_go(uint8_t base, uint8_t mask) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _SFR_MEM8(base + OFFSET_DIR) &= ~mask;
+    }
+}
+
+static inline bool twi_soft_high(uint8_t base, uint8_t mask) {
+    return (_SFR_MEM8(base + OFFSET_PIN) & mask) != 0;
+}
+
+// Rest of the half period since the last SCL edge
+static void twi_soft_half(twi_soft_t* bus) {
+    while (systick_micros() - twi_soft_edge < bus->half_us);
+}
+
+static void twi_soft_scl_low(twi_soft_t* bus) {
+    twi_soft_half(bus);
+    twi_soft_pull(bus->scl_base, bus->scl);
+    twi_soft_edge = systick_micros();
+}
+
+// Lets SCL go and waits out a slave stretching it, false on TWI_TIMEOUT
+static bool twi_soft_scl_high(twi_soft_t* bus) {
+    deadline_t d;
+
+    twi_soft_half(bus);
+    twi_soft_let_go(bus->scl_base, bus->scl);
+    deadline_set_us(&d, TWI_TIMEOUT);
+    while (!twi_soft_high(bus->scl_base, bus->scl)) {
+        if (deadline_expired_us(&d)) return false;
+    }
+    twi_soft_edge = systick_micros();
+    return true;
+}
+
+// SDA only moves while SCL is low, apart from START and STOP
+static void twi_soft_sda(twi_soft_t* bus, bool high) {
+    if (high) twi_soft_let_go(bus->sda_base, bus->sda);
+    else twi_soft_pull(bus->sda_base, bus->sda);
+}
+
+/************************** Bus Framing Stuff *************************/
+
+// Called with SCL low, ends with both lines released
+static void twi_soft_stop(twi_soft_t* bus) {
+    twi_soft_sda(bus, false);
+    twi_soft_scl_high(bus);
+    twi_soft_half(bus);
+    twi_soft_sda(bus, true);
+    twi_soft_edge = systick_micros();
+}
+
+// A slave cut off mid-read holds SDA low until it has clocked out the
+// rest of its byte, nine pulses free it whatever bit it was on
+static bool twi_soft_recover(twi_soft_t* bus) {
+    uint8_t i;
+
+    for (i = 0; i < TWI_SOFT_RECOVER && !twi_soft_high(bus->sda_base, bus->sda); i++) {
+        twi_soft_scl_low(bus);
+        if (!twi_soft_scl_high(bus)) return false;
+    }
+    if (!twi_soft_high(bus->sda_base, bus->sda)) return false;
+    twi_soft_scl_low(bus);
+    twi_soft_stop(bus);
+    return true;
+}
+
+// SDA falls while SCL is high, a repeated START first brings SCL back up
+static twi_error_t twi_soft_start(twi_soft_t* bus, bool repeated) {
+    twi_error_t err = repeated ? TWI_ERROR_RSTART : TWI_ERROR_START;
+
+    if (repeated) {
+        twi_soft_sda(bus, true);
+        if (!twi_soft_scl_high(bus)) return TWI_ERROR_TIMEOUT;
+    }
+    else {
+        if (!twi_soft_high(bus->scl_base, bus->scl)) return err;
+        if (!twi_soft_high(bus->sda_base, bus->sda) && !twi_soft_recover(bus)) return err;
+    }
+    twi_soft_half(bus);
+    twi_soft_sda(bus, false);
+    twi_soft_edge = systick_micros();
+    twi_soft_scl_low(bus);
+    return TWI_OK;
+}
+
+// Eight bits MSB first, then the slave's ACK. Ends with SCL low.
+static twi_error_t twi_soft_put(twi_soft_t* bus, uint8_t b) {
+    uint8_t bit;
+    bool ack;
+
+    for (bit = 0x80; bit; bit >>= 1) {
+        twi_soft_sda(bus, b & bit);
+        if (!twi_soft_scl_high(bus)) return TWI_ERROR_TIMEOUT;
+        twi_soft_scl_low(bus);
+    }
+    twi_soft_sda(bus, true);
+    if (!twi_soft_scl_high(bus)) return TWI_ERROR_TIMEOUT;
+    ack = !twi_soft_high(bus->sda_base, bus->sda);
+    twi_soft_scl_low(bus);
+    return ack ? TWI_OK : TWI_NACK;
+}
+
+// Eight bits MSB first, then ACK for more or NACK for the last byte
+static twi_error_t twi_soft_get(twi_soft_t* bus, uint8_t* b, bool ack) {
+    uint8_t i;
+
+    twi_soft_sda(bus, true);
+    *b = 0;
+    for (i = 0; i < 8; i++) {
+        if (!twi_soft_scl_high(bus)) return TWI_ERROR_TIMEOUT;
+        *b = (*b << 1) | twi_soft_high(bus->sda_base, bus->sda);
+        twi_soft_scl_low(bus);
+    }
+    twi_soft_sda(bus, !ack);
+    if (!twi_soft_scl_high(bus)) return TWI_ERROR_TIMEOUT;
+    twi_soft_scl_low(bus);
+    twi_soft_sda(bus, true);
+    return TWI_OK;
+}
+
+/************************** Transaction Stuff *************************/
+
+static twi_error_t twi_soft_write_xfer(twi_soft_t* bus, uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    twi_error_t err;
+    uint16_t i;
+
+    err = twi_soft_start(bus, false);
+    if (err != TWI_OK) return err;
+    err = twi_soft_put(bus, addr << 1);
+    if (err == TWI_OK) err = twi_soft_put(bus, reg);
+    for (i = 0; i < len && err == TWI_OK; i++) err = twi_soft_put(bus, data[i]);
+    twi_soft_stop(bus);
+    return err;
+}
+
+static twi_error_t twi_soft_read_xfer(twi_soft_t* bus, uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    twi_error_t err;
+    uint16_t i;
+
+    err = twi_soft_start(bus, false);
+    if (err != TWI_OK) return err;
+    err = twi_soft_put(bus, addr << 1);
+    if (err == TWI_OK) err = twi_soft_put(bus, reg);
+    if (err == TWI_OK) err = twi_soft_start(bus, true);
+    if (err == TWI_OK) err = twi_soft_put(bus, (addr << 1) | 1);
+    for (i = 0; i < len && err == TWI_OK; i++) err = twi_soft_get(bus, &data[i], i + 1 < len);
+    twi_soft_stop(bus);
+    return err;
+}
+
+// Counts a finished transaction by how it ended, as twi_hal.c does
+static void twi_soft_count(twi_soft_t* bus, twi_error_t err, uint16_t len) {
+    STAT_INC(bus->stats.transactions);
+    switch (err) {
+        case(TWI_OK):
+            STAT_ADD(bus->stats.bytes, len);
+            break;
+        case(TWI_NACK):
+            STAT_INC(bus->stats.nacks);
+            break;
+        case(TWI_ERROR_START):
+            STAT_INC(bus->stats.start_fails);
+            break;
+        case(TWI_ERROR_RSTART):
+            STAT_INC(bus->stats.restart_fails);
+            break;
+        case(TWI_ERROR_TIMEOUT):
+            STAT_INC(bus->stats.timeouts);
+            break;
+        default:
+            break;
+    }
+}
+
+twi_error_t twi_soft_write(twi_soft_t* bus, uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    twi_error_t err = twi_soft_write_xfer(bus, addr, reg, data, len);
+    twi_soft_count(bus, err, len);
+    return err;
+}
+
+twi_error_t twi_soft_read(twi_soft_t* bus, uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    twi_error_t err = len ? twi_soft_read_xfer(bus, addr, reg, data, len) : TWI_OK;
+    twi_soft_count(bus, err, len);
+    return err;
+}
+
+/**************************** Bus Setup Stuff *************************/
+
+// Pins as gpio_pin_init() numbers them, PC6 is RESET and not allowed.
+// Both lines are released before PORT is cleared, so setting up never
+// drives the bus high. hz 0 picks TWI_SOFT_HZ.
+gpio_error_t twi_soft_init(twi_soft_t* bus, gpio_port_t sda_port, uint8_t sda_pin,
+                           gpio_port_t scl_port, uint8_t scl_pin, uint32_t hz) {
+    uint32_t half;
+
+    if (sda_port > GPIO_D || scl_port > GPIO_D) return GPIO_INVALID_PORT;
+    if (sda_pin >= ((sda_port == GPIO_C) ? 6 : 8)) return GPIO_INVALID_PIN;
+    if (scl_pin >= ((scl_port == GPIO_C) ? 6 : 8)) return GPIO_INVALID_PIN;
+    if (sda_port == scl_port && sda_pin == scl_pin) return GPIO_INVALID_PIN;
+
+    bus->sda_base = TWI_SOFT_BASE(sda_port);
+    bus->sda = (1 << sda_pin);
+    bus->scl_base = TWI_SOFT_BASE(scl_port);
+    bus->scl = (1 << scl_pin);
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        _SFR_MEM8(bus->sda_base + OFFSET_DIR) &= ~bus->sda;
+        _SFR_MEM8(bus->scl_base + OFFSET_DIR) &= ~bus->scl;
+        _SFR_MEM8(bus->sda_base + OFFSET_PORT) &= ~bus->sda;
+        _SFR_MEM8(bus->scl_base + OFFSET_PORT) &= ~bus->scl;
+    }
+
+    // A half period read off 4 us counts is up to one count short, so
+    // one is added on top
+    if (hz == 0) hz = TWI_SOFT_HZ;
+    half = (500000UL + hz - 1) / hz + SYSTICK_US_PER_COUNT;
+    bus->half_us = (half > 0xFF) ? 0xFF : (uint8_t)half;
+
+    twi_soft_stats_reset(bus);
+    twi_soft_edge = systick_micros();
+    return GPIO_OK;
+}
+
+void twi_soft_stats(twi_soft_t* bus, twi_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = bus->stats;
+    }
+}
+
+void twi_soft_stats_reset(twi_soft_t* bus) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        bus->stats = (twi_stats_t){0};
+    }
+}
@@ -0,0 +1,52 @@
+/***********************************************************************
+* Software I2C master on GPIO pins                                     *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: A second, independent I2C bus on any two port pins so slow  *
+*          or misbehaving devices stay off the hardware TWI            *
+*                                                                      *
+* The pins are open drain: a line is pulled low by making it an output *
+* with PORT cleared and released by making it an input again, so the   *
+* bus needs external pull-ups as the TWI pins do. Each half SCL period *
+* waits on the system tick's Timer0 clock, so the bit rate holds with  *
+* interrupts in between and after clk_set() retimes the tick. Edges    *
+* land on its 4 us counts, so hz is an upper bound and no half period  *
+* is shorter than 5 us.                                                *
+*                                                                      *
+* A slave may stretch the clock by holding SCL low after any edge, for *
+* up to TWI_TIMEOUT per bit. A bus found with SDA held low before a    *
+* START is recovered with up to nine clock pulses and a STOP first.    *
+*                                                                      *
+* twi_soft_read()/twi_soft_write() follow twi_read()/twi_write(): a    *
+* register pointer then the data, with the same twi_error_t codes and  *
+* twi_stats_t counters, kept per bus.                                  *
+***********************************************************************/
+
+#ifndef TWI_SOFT_H_
+#define TWI_SOFT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "gpio.h"
+#include "twi_hal.h"
+
+#define TWI_SOFT_HZ 50000UL     /*Default SCL*/
+#define TWI_SOFT_RECOVER 9      /*Clock pulses to free a stuck SDA*/
+
+typedef struct twi_soft {
+    uint8_t sda_base;       /*PINx address, DDRx and PORTx follow, see gpio.h*/
+    uint8_t sda;            /*Pin mask*/
+    uint8_t scl_base;
+    uint8_t scl;
+    uint8_t half_us;        /*Least time between SCL edges*/
+    twi_stats_t stats;
+} twi_soft_t;
+
+gpio_error_t twi_soft_init(twi_soft_t* bus, gpio_port_t sda_port, uint8_t sda_pin,
+                           gpio_port_t scl_port, uint8_t scl_pin, uint32_t hz);
+twi_error_t twi_soft_write(twi_soft_t* bus, uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len);
+twi_error_t twi_soft_read(twi_soft_t* bus, uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len);
+void twi_soft_stats(twi_soft_t* bus, twi_stats_t* stats);
+void twi_soft_stats_reset(twi_soft_t* bus);
+
+#endif //TWI_SOFT_H_
@@ -0,0 +1,65 @@
+/***********************************************************************
+* Byte ring buffer shared by the serial drivers                        *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: Lock-free single producer / single consumer FIFO between an *
+*          ISR and the main loop                                       *
+*                                                                      *
+* Storage size must be a power of two up to 256; one slot stays free   *
+* to tell full from empty. Each index is only written by one side and  *
+* 8-bit accesses are atomic on AVR, so no critical section is needed.  *
+***********************************************************************/
+
+#ifndef RING_H_
+#define RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct ring {
+    uint8_t* buf;
+    uint8_t mask;               /*Storage size - 1*/
+    volatile uint8_t head;      /*Next slot to write, producer only*/
+    volatile uint8_t tail;      /*Next slot to read, consumer only*/
+} ring_t;
+
+#define RING_INIT(storage) { (storage), (uint8_t)(sizeof(storage) - 1), 0, 0 }
+
+static inline bool ring_empty(const ring_t* r) {
+    return r->head == r->tail;
+}
+
+static inline bool ring_full(const ring_t* r) {
+    return ((uint8_t)(r->head + 1) & r->mask) == r->tail;
+}
+
+static inline uint8_t ring_count(const ring_t* r) {
+    return (uint8_t)(r->head - r->tail) & r->mask;
+}
+
+static inline uint8_t ring_space(const ring_t* r) {
+    return r->mask - ring_count(r);
+}
+
+static inline bool ring_put(ring_t* r, uint8_t b) {
+    uint8_t next = (uint8_t)(r->head + 1) & r->mask;
+    if (next == r->tail) return false;
+    r->buf[r->head] = b;
+    r->head = next;
+    return true;
+}
+
+static inline bool ring_get(ring_t* r, uint8_t* b) {
+    uint8_t tail = r->tail;
+    if (tail == r->head) return false;
+    *b = r->buf[tail];
+    r->tail = (uint8_t)(tail + 1) & r->mask;
+    return true;
+}
+
+// Consumer side only
+static inline void ring_flush(ring_t* r) {
+    r->tail = r->head;
+}
+
+#endif //RING_H_
@@ -0,0 +1,309 @@
+/***********************************************************************
+* Software UART on Timer2 and a pin change interrupt                   *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: A second, buffered serial link for an attached peripheral,  *
+*          the USART belongs to the CH340 debug port                   *
+***********************************************************************/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "suart.h"
+#include "ring.h"
+#include "pwr.h"
+#include "counter.h"
+#include "irq.h"
+#include "tmr2.h"
+
+#define SUART_FRAME_BITS 10     /*Start, 8 data, stop*/
+
+static const uint16_t suart_psc[7] = {1, 8, 32, 64, 128, 256, 1024};    /*CS22:0 - 1*/
+
+static uint8_t suart_tx_buf[SUART_TX_SIZE];
+static ring_t suart_tx = RING_INIT(suart_tx_buf);
+static uint8_t suart_rx_buf[SUART_RX_SIZE];
+static ring_t suart_rx = RING_INIT(suart_rx_buf);
+static uart_stats_t suart_stat;
+static bool suart_on = false;
+static uint32_t suart_hz = F_CPU;       /*System clock, see suart_retime()*/
+
+// Timer2 setting for suart_hz, times in 1/256 counts
+static uint8_t suart_cs;
+static uint16_t suart_bit;
+static uint16_t suart_late;             /*SUART_RX_ENTRY_CYCLES*/
+
+// Transmit side, OCR2A
+static volatile bool suart_tx_busy = false;
+static uint16_t suart_tx_at;            /*Compare the ISR is running for*/
+static uint16_t suart_tx_frame;         /*Bit 0 is the level for the next compare*/
+static uint8_t suart_tx_bits;           /*Levels left in suart_tx_frame*/
+static bool suart_tx_idle;              /*suart_tx_frame is the idle slot after a stop bit*/
+
+// Receive side, OCR2B
+static uint16_t suart_rx_at;
+static uint8_t suart_rx_shift;
+static uint8_t suart_rx_bits;
+
+/*************************** Bit Timing Stuff *************************/
+
+// Smallest prescaler that keeps the first RX sample, 1.5 bits after the
+// start edge, within one turn of the 8-bit counter with room to spare
+static void suart_plan(uint32_t hz) {
+    uint32_t bit;
+    uint8_t i;
+
+    for (i = 0; ; i++) {
+        bit = ((hz / suart_psc[i]) << 8) / BOARD_SUART_BAUD;
+        if (bit + (bit >> 1) < 0xF000UL || i == 6) break;
+    }
+    suart_bit = (uint16_t)bit;
+    suart_cs = i + 1;
+    suart_late = (uint16_t)(((uint32_t)SUART_RX_ENTRY_CYCLES << 8) / suart_psc[i]);
+    irq_watch(IRQ_SUART_TX, suart_psc[i], (uint8_t)((bit >> 8) / BOARD_IRQ_SUART_DIV));
+    irq_watch(IRQ_SUART_RX, suart_psc[i], (uint8_t)((bit >> 8) / BOARD_IRQ_SUART_DIV));
+}
+
+// Waits for the next start bit, an edge seen meanwhile is stale
+static void suart_rx_arm(void) {
+    TIMSK2 &= ~(1 << OCIE2B);
+    PCIFR = (1 << PCIF1);
+    PCMSK1 |= (1 << SUART_RX);
+}
+
+/**************************** Interrupt Stuff *************************/
+
+// One TX level per compare. After the stop bit the ring is checked, an
+// empty one gets an idle slot first so the stop bit is never cut short
+// by a byte queued right after.
+static inline void suart_tx_step(void) {
+    uint8_t b;
+
+    if (suart_tx_frame & 1) PORTC |= (1 << SUART_TX);
+    else PORTC &= ~(1 << SUART_TX);
+
+    suart_tx_at += suart_bit;
+    OCR2A = (uint8_t)(suart_tx_at >> 8);
+    suart_tx_frame >>= 1;
+    if (--suart_tx_bits) return;
+
+    if (ring_get(&suart_tx, &b)) {
+        suart_tx_frame = ((uint16_t)b << 1) | (1 << (SUART_FRAME_BITS - 1));
+        suart_tx_bits = SUART_FRAME_BITS;
+        suart_tx_idle = false;
+        STAT_INC(suart_stat.tx_bytes);
+    }
+    else if (!suart_tx_idle) {
+        suart_tx_frame = 1;
+        suart_tx_bits = 1;
+        suart_tx_idle = true;
+    }
+    else {
+        TIMSK2 &= ~(1 << OCIE2A);
+        suart_tx_busy = false;
+    }
+}
+
+// The stamp is read before the edge goes out, its sum after
+ISR(TIMER2_COMPA_vect) {
+    uint8_t now = TCNT2, at = OCR2A;
+
+    suart_tx_step();
+    irq_stamp(IRQ_SUART_TX, now - at);
+}
+
+// Start bit, or any other edge on PC1 while no frame is being sampled
+ISR(PCINT1_vect) {
+    uint8_t now = TCNT2;
+
+    if (PINC & (1 << SUART_RX)) return;
+    PCMSK1 &= ~(1 << SUART_RX);
+
+    suart_rx_at = ((uint16_t)now << 8) + suart_bit + (suart_bit >> 1) - suart_late;
+    OCR2B = (uint8_t)(suart_rx_at >> 8);
+    suart_rx_shift = 0;
+    suart_rx_bits = 0;
+    TIFR2 = (1 << OCF2B);
+    TIMSK2 |= (1 << OCIE2B);
+}
+
+// Samples mid-bit, LSB first. A low stop bit counts a frame error and
+// the byte is kept, as USART_RX_vect does.
+ISR(TIMER2_COMPB_vect) {
+    bool high = PINC & (1 << SUART_RX);
+
+    irq_stamp(IRQ_SUART_RX, TCNT2 - OCR2B);
+    if (suart_rx_bits < 8) {
+        suart_rx_at += suart_bit;
+        OCR2B = (uint8_t)(suart_rx_at >> 8);
+        suart_rx_shift = (suart_rx_shift >> 1) | (high ? 0x80 : 0);
+        suart_rx_bits++;
+        return;
+    }
+
+    STAT_INC(suart_stat.rx_bytes);
+    if (!high) STAT_INC(suart_stat.frame_errors);
+    if (!ring_put(&suart_rx, suart_rx_shift)) STAT_INC(suart_stat.rx_dropped);
+    suart_rx_arm();
+}
+
+/*************************** SUART Setup Stuff ************************/
+
+// Timer2 runs free from here on, the pins idle high. RX uses the pull-up
+// so an unconnected input reads idle instead of a stream of start bits.
+// False, with nothing touched, while tmr1's gated range holds Timer2.
+bool suart_init(void) {
+    if (!tmr2_claim(TMR2_SUART)) return false;
+    suart_stats_reset();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!suart_on) pwr_acquire(PWR_TIM2);
+        suart_on = true;
+        ring_flush(&suart_tx);
+        ring_flush(&suart_rx);
+        suart_tx_busy = false;
+
+        PORTC |= (1 << SUART_TX) | (1 << SUART_RX);
+        DDRC |= (1 << SUART_TX);
+        DDRC &= ~(1 << SUART_RX);
+
+        suart_plan(suart_hz);
+        TIMSK2 = 0;
+        TCCR2A = 0;
+        TCCR2B = suart_cs;
+        PCICR |= (1 << PCIE1);
+        suart_rx_arm();
+    }
+    return true;
+}
+
+// Stops Timer2 and hands it back, anything queued is dropped. TX stays
+// driven high.
+void suart_stop(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (suart_on) {
+            TCCR2B = 0;
+            TIMSK2 &= ~((1 << OCIE2A) | (1 << OCIE2B));
+            PCMSK1 &= ~(1 << SUART_RX);
+            PORTC |= (1 << SUART_TX);
+            ring_flush(&suart_tx);
+            ring_flush(&suart_rx);
+            suart_tx_busy = false;
+            suart_on = false;
+            pwr_release(PWR_TIM2);
+            tmr2_release(TMR2_SUART);
+        }
+    }
+}
+
+// False if the software UART is running and a system clock of hz would
+// leave fewer than BOARD_SUART_BIT_MIN cycles per bit
+bool suart_clock_ok(uint32_t hz) {
+    if (!suart_on) return true;
+    return hz / BOARD_SUART_BAUD >= BOARD_SUART_BIT_MIN;
+}
+
+// New prescaler and bit period for a system clock of hz, called by
+// clk_set() once TX has drained. A byte being received is lost.
+void suart_retime(uint32_t hz) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        suart_hz = hz;
+        if (suart_on) {
+            suart_plan(hz);
+            TCCR2B = suart_cs;
+            suart_rx_arm();
+        }
+    }
+}
+
+/*************************** SUART Transmit Stuff *********************/
+
+// The first compare is a bit away and outputs an idle slot, then the
+// ISR takes the byte from the ring
+static void suart_tx_start(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (!suart_tx_busy) {
+            suart_tx_busy = true;
+            suart_tx_frame = 1;
+            suart_tx_bits = 1;
+            suart_tx_idle = true;
+            suart_tx_at = ((uint16_t)TCNT2 << 8) + suart_bit;
+            OCR2A = (uint8_t)(suart_tx_at >> 8);
+            TIFR2 = (1 << OCF2A);
+            TIMSK2 |= (1 << OCIE2A);
+        }
+    }
+}
+
+// Queues the byte and returns, sleeping only while the ring is full. With
+// interrupts masked the compares are polled and run by hand instead.
+void suart_transmit_byte(uint8_t data) {
+    while (!ring_put(&suart_tx, data)) {
+        if (!(SREG & (1 << SREG_I))) {
+            suart_tx_start();
+            while (!(TIFR2 & (1 << OCF2A)));
+            TIFR2 = (1 << OCF2A);
+            suart_tx_step();
+            continue;
+        }
+        cli();
+        if (ring_full(&suart_tx)) pwr_sleep();
+        else sei();
+    }
+    suart_tx_start();
+}
+
+void suart_transmit_string(unsigned char* str) {
+    while (*str) suart_transmit_byte(*str++);
+}
+
+// Waits until the last stop bit is out. Returns at once with interrupts
+// masked, nothing would drain the ring.
+void suart_flush(void) {
+    if (!(SREG & (1 << SREG_I))) return;
+    while (suart_tx_busy) {
+        cli();
+        if (suart_tx_busy) pwr_sleep();
+        else sei();
+    }
+}
+
+uint8_t suart_tx_space(void) {
+    return ring_space(&suart_tx);
+}
+
+/*************************** SUART Receive Stuff **********************/
+
+// Sleeps until a byte is in the ring, interrupts must be enabled
+uint8_t suart_read_byte(void) {
+    uint8_t b;
+
+    while (!ring_get(&suart_rx, &b)) {
+        cli();
+        if (ring_empty(&suart_rx)) pwr_sleep();
+        else sei();
+    }
+    return b;
+}
+
+bool suart_rx_get(uint8_t* b) {
+    return ring_get(&suart_rx, b);
+}
+
+uint8_t suart_rx_available(void) {
+    return ring_count(&suart_rx);
+}
+
+// Same counters as the USART. Overruns and parity errors stay zero,
+// the receiver samples every frame and sends no parity.
+void suart_stats(uart_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = suart_stat;
+    }
+}
+
+void suart_stats_reset(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        suart_stat = (uart_stats_t){0};
+    }
+}
@@ -0,0 +1,64 @@
+/***********************************************************************
+* Software UART on Timer2 and a pin change interrupt                   *
+* @author Kevin Harper                                                 *
+* @date October 18, 2026                                               *
+* Purpose: A second, buffered serial link for an attached peripheral,  *
+*          the USART belongs to the CH340 debug port                   *
+*                                                                      *
+* 8N1 at BOARD_SUART_BAUD, TX on PC2 and RX on PC1. Timer2 runs free   *
+* and each side schedules its own compare match, OCR2A for TX edges    *
+* and OCR2B for RX samples, so both directions run at once. The bit    *
+* period is kept in 1/256 counts, so rounding does not add up over a   *
+* frame.                                                               *
+*                                                                      *
+* TX: the compare ISR first writes the level it worked out on its last *
+* pass, so every edge lands the same few cycles after its compare.     *
+* RX: the start bit's falling edge raises PCINT1, whose ISR stamps     *
+* TCNT2 and aims the first sample 1.5 bits on; the rest follow a bit   *
+* apart and the pin change is masked until the stop bit.               *
+*                                                                      *
+* Another ISR running when an edge or sample is due delays it. Samples *
+* may slip up to half a bit (13 us at 38400) less the two clocks'      *
+* error, so keep handlers well below that. IRQ_SUART_TX and _RX in     *
+* irq.h count compares entered over a bit / BOARD_IRQ_SUART_DIV late.  *
+*                                                                      *
+* Timer2 also times tmr1's gated frequency range, only one can hold it *
+* (tmr2.h): suart_init() fails while the gate runs, suart_stop() hands *
+* the timer back. PCINT1 is taken for the RX pin.                      *
+***********************************************************************/
+
+#ifndef SUART_H_
+#define SUART_H_
+
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "board.h"
+#include "uart.h"
+
+#define SUART_TX_SIZE 32    /*Power of two, see ring.h*/
+#define SUART_RX_SIZE 32
+
+// Both on port C, RX is PCINT9
+#define SUART_TX PORTC2
+#define SUART_RX PINC1
+
+// Cycles from the start bit's edge to the TCNT2 read in PCINT1_vect,
+// taken off the first sample
+#define SUART_RX_ENTRY_CYCLES 24
+
+bool suart_init(void);
+void suart_stop(void);
+void suart_transmit_byte(uint8_t data);
+void suart_transmit_string(unsigned char* str);
+void suart_flush(void);
+uint8_t suart_tx_space(void);
+uint8_t suart_read_byte(void);
+bool suart_rx_get(uint8_t* b);
+uint8_t suart_rx_available(void);
+bool suart_clock_ok(uint32_t hz);
+void suart_retime(uint32_t hz);
+void suart_stats(uart_stats_t* stats);
+void suart_stats_reset(void);
+
+#endif //SUART_H_
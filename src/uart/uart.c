@@ -10,53 +10,138 @@
 ***********************************************************************/
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include "uart.h"
+#include "ring.h"
+#include "pwr.h"
+#include "prof.h"
+#include "counter.h"
 
-// Need for BR calculation inside uart.h
-#define UART_BAUD 115200UL
+static uint8_t uart_tx_buf[UART_TX_SIZE];
+static ring_t uart_tx = RING_INIT(uart_tx_buf);
+static uint8_t uart_rx_buf[UART_RX_SIZE];
+static ring_t uart_rx = RING_INIT(uart_rx_buf);
+static volatile bool uart_tx_busy = false;     /*USART0 held from the first queued byte to TXC*/
+static uart_stats_t uart_stat;
+static uint16_t uart_ubrr = BOARD_UBRR;         /*For the current system clock, see uart_retime()*/
+static uint8_t uart_ucsrb;                      /*Set by uart_init(), without the TX interrupts*/
+static uint8_t uart_ucsrc;
+
+// Called right after a byte goes into UDR0, whose own TXC is a frame off.
+// A TXC still set from the byte before would end the burst under it. The
+// status bits are written as zero, as the datasheet asks.
+static inline void uart_txc_clear(void) {
+    UCSR0A = (UCSR0A & ((1 << U2X0) | (1 << MPCM0))) | (1 << TXC0);
+}
+
+// Feed the next queued byte, stop asking once the ring is drained
+ISR(USART_UDRE_vect) {
+    uint8_t b;
+    if (ring_get(&uart_tx, &b)) {
+        UDR0 = b;
+        uart_txc_clear();
+        STAT_INC(uart_stat.tx_bytes);
+    }
+    else UCSR0B &= ~(1 << UDRIE0);
+}
+
+// The error flags belong to the byte in UDR0 and have to be read before it
+static inline void uart_rx_count(uint8_t flags) {
+    STAT_INC(uart_stat.rx_bytes);
+    if (flags & (1 << DOR0)) STAT_INC(uart_stat.overruns);
+    if (flags & (1 << FE0)) STAT_INC(uart_stat.frame_errors);
+    if (flags & (1 << UPE0)) STAT_INC(uart_stat.parity_errors);
+}
+
+// Empties UDR0 into the RX ring, a byte that finds it full is lost
+ISR(USART_RX_vect) {
+    uint8_t flags = UCSR0A;
+    uint8_t b = UDR0;
+
+    uart_rx_count(flags);
+    if (!ring_put(&uart_rx, b)) STAT_INC(uart_stat.rx_dropped);
+}
+
+// Last stop bit is out, the USART can be powered down until the next byte.
+// A byte queued as it fired has set UDRIE0, its own TXC ends the burst.
+ISR(USART_TX_vect) {
+    if (ring_empty(&uart_tx) && !(UCSR0B & (1 << UDRIE0))) {
+        UCSR0B &= ~(1 << TXCIE0);
+        uart_tx_busy = false;
+        pwr_release(PWR_USART0);
+    }
+}
 
 /************************* UART Utility Stuff *************************/
 
-// This forces asynchronous mode on USART0 with 8-bit data width, 1 stop bit
-void uart_init(uart_dir_t dir, bool int_en, uart_parity_t par) {
+// Writes the whole configuration. The datasheet asks for the USART to be
+// set up again after PRR has powered it down, so the transmit path calls
+// this too when it wakes the USART for a burst.
+static void uart_load(void) {
     // Setup baudrate with integer calculated in uart.h macros
     //hw_reg8_write(UBRR0H, UBRRH_VALUE);
     //hw_reg8_write(UBRR0L, UBRRL_VALUE);
 
     // Calculated using eqn from datasheet and rounded to nearest int
-    UBRR0H = UBRRH_VALUE;
-    UBRR0L = UBRRL_VALUE;
+    UBRR0H = (uint8_t)(uart_ubrr >> 8);
+    UBRR0L = (uint8_t)uart_ubrr;
+    UCSR0A = BOARD_UART_U2X ? (1 << U2X0) : 0;
+    UCSR0C = uart_ucsrc;
+    UCSR0B = uart_ucsrb;
+}
+
+// This forces asynchronous mode on USART0 with 8-bit data width, 1 stop bit
+// Transmit is always interrupt driven through the TX ring, int_en makes the
+// receive side interrupt driven through the RX ring as well. A transmit-only
+// USART is powered down between bursts.
+void uart_init(uart_dir_t dir, bool int_en, uart_parity_t par) {
+    uart_stats_reset();
+    pwr_acquire(PWR_USART0);
+
+    // A new configuration starts with nothing in flight
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ring_flush(&uart_tx);
+        ring_flush(&uart_rx);
+        if (uart_tx_busy) {
+            uart_tx_busy = false;
+            pwr_release(PWR_USART0);
+        }
+    }
+
+    // TXD idles high while the USART is powered down
+    PORTD |= (1 << PORTD1);
+    DDRD |= (1 << DDD1);
 
     // Set UART direction
+    uart_ucsrb = 0;
     switch (dir) {
         case(TX):
             //hw_bit_write(USCR0B, TXEN0, 1); 
-            UCSR0B |= (1 << TXEN0);
+            uart_ucsrb |= (1 << TXEN0);
             break;
         case(RX):
             //hw_bit_write(USCR0B, RXEN0, 1); 
-            UCSR0B |= (1 << RXEN0);
+            uart_ucsrb |= (1 << RXEN0);
             break;
         case(BOTH):
             //hw_bit_write(USCR0B, TXEN0, 1); 
             //hw_bit_write(USCR0B, RXEN0, 1); 
-            UCSR0B |= (1 << TXEN0);
-            UCSR0B |= (1 << RXEN0);
+            uart_ucsrb |= (1 << TXEN0);
+            uart_ucsrb |= (1 << RXEN0);
             break;
         //default: return ERROR?
     }
-    // Optionally enable interrupts
-    // This requires setting up the vector table and assigning space to store the ISR
-    if (int_en) {
-        if ((dir == TX) || BOTH) UCSR0B |= (1 << TXCIE0);
-        else if ((dir == RX) || BOTH) UCSR0B |= (1 << RXCIE0);
-        //hw_bit_write(USCR0B, UDRIE0, 1);
-        UCSR0B |= (1 << UDRIE0);
-    }
     // Set 8-bit data width, asynchronous mode, 1 stop-bit,
     // with user input parity
     //hw_reg8_write(USCR0C, (0x06 | (par << 4)));
-    UCSR0C = (0x06 | (par << 4));
+    uart_ucsrc = (0x06 | (par << 4));
+
+    if (int_en && dir != TX) uart_ucsrb |= (1 << RXCIE0);
+    uart_load();
+
+    // A receiver has to stay clocked, transmit reacquires per burst
+    if (dir == TX) pwr_release(PWR_USART0);
 }
 
 bool uart_check_flag(uint8_t flag) {
@@ -116,26 +201,137 @@ void decToASCII(uint8_t buffer[], uint8_t decimal) {
 
 /************************ UART Receive Stuff **************************/
 
-uint8_t uart_read_byte() {
-    return 0;
+// Waits for a byte, sleeping on the RX ring when the receiver is interrupt
+// driven and polling RXC0 otherwise
+uint8_t uart_read_byte(void) {
+    uint8_t flags;
+    uint8_t b;
+
+    if ((UCSR0B & (1 << RXCIE0)) && (SREG & (1 << SREG_I))) {
+        while (!ring_get(&uart_rx, &b)) {
+            cli();
+            if (ring_empty(&uart_rx)) pwr_sleep();
+            else sei();
+        }
+        return b;
+    }
+
+    while (!(UCSR0A & (1 << RXC0)));
+    flags = UCSR0A;
+    b = UDR0;
+    uart_rx_count(flags);
+    return b;
+}
+
+// Blocks until len bytes arrived, no terminator is looked for
+void uart_read_string(uint8_t buffer[], uint8_t len) {
+    uint8_t i;
+    for (i = 0; i < len; i++) buffer[i] = uart_read_byte();
+}
+
+// Takes the oldest received byte without waiting, false if there is none
+bool uart_rx_get(uint8_t* b) {
+    return ring_get(&uart_rx, b);
+}
+
+uint8_t uart_rx_available(void) {
+    return ring_count(&uart_rx);
 }
-// Does a function like this even make sense?
-void uart_read_string(uint8_t buffer[], uint8_t len) {}
 
 /************************ UART Transmit Stuff *************************/
 
-//  Direct from ATMega328P datasheet pg 150
+// Power the USART up for a burst and arm TXC to power it down after.
+// Called with interrupts masked, in the same block that queues the byte:
+// TXC firing in between would power the USART down under it.
+static void uart_tx_start(void) {
+    bool off;
+
+    if (!uart_tx_busy) {
+        off = !(pwr_active() & (1 << PWR_USART0));
+        pwr_acquire(PWR_USART0);
+        if (off) uart_load();
+        uart_tx_busy = true;
+        UCSR0B |= (1 << TXCIE0);
+    }
+}
+
+// Queues the byte and returns, sleeping only while the ring is full
 void uart_transmit_byte(unsigned char data) {
-    /* Wait for empty transmit buffer */
-    //while (!(hw_reg8_read(USCR0A) & (1 << UDRE0)));
-    while (!(UCSR0A & (1 << UDRE0)));
-    /* Put data into buffer, sends the data */
-    //hw_reg8_write(UDR0, data);
-    UDR0 = data;
+    bool queued = false;
+    uint8_t b;
+
+    // Nothing drains the ring with interrupts masked, so push it out by hand
+    //  Direct from ATMega328P datasheet pg 150
+    if (!(SREG & (1 << SREG_I))) {
+        uart_tx_start();
+        while (ring_get(&uart_tx, &b)) {
+            while (!(UCSR0A & (1 << UDRE0)));
+            UDR0 = b;
+            STAT_INC(uart_stat.tx_bytes);
+        }
+        while (!(UCSR0A & (1 << UDRE0)));
+        UDR0 = data;
+        uart_txc_clear();
+        STAT_INC(uart_stat.tx_bytes);
+        return;
+    }
+
+    for (;;) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            if (ring_put(&uart_tx, data)) {
+                uart_tx_start();
+                UCSR0B |= (1 << UDRIE0);
+                queued = true;
+            }
+        }
+        if (queued) return;
+        cli();
+        if (ring_full(&uart_tx)) pwr_sleep();
+        else sei();
+    }
+}
+
+// False if the transmitter or receiver is enabled and BOARD_UART_BAUD
+// would be off by more than BOARD_UART_ERR_MAX at a system clock of hz
+bool uart_clock_ok(uint32_t hz) {
+    uint8_t en;
+
+    pwr_acquire(PWR_USART0);
+    en = UCSR0B & ((1 << TXEN0) | (1 << RXEN0));
+    pwr_release(PWR_USART0);
+    if (!en) return true;
+    if (hz < BOARD_UART_SAMPLES * BOARD_UART_BAUD) return false;
+    return BOARD_UART_ERR_AT(hz) <= BOARD_UART_ERR_MAX;
+}
+
+// Reloads UBRR0 for a new system clock, called by clk_set() once the
+// ring is flushed. Writing UBRR0L restarts the baud rate generator.
+void uart_retime(uint32_t hz) {
+    uart_ubrr = (hz >= BOARD_UART_SAMPLES * BOARD_UART_BAUD) ? BOARD_UBRR_AT(hz) : 0;
+    pwr_acquire(PWR_USART0);
+    UBRR0H = (uint8_t)(uart_ubrr >> 8);
+    UBRR0L = (uint8_t)uart_ubrr;
+    pwr_release(PWR_USART0);
+}
+
+// Waits until every queued byte has left the shift register. Returns at
+// once with the transmitter off, nothing would drain the ring.
+void uart_flush(void) {
+    while (uart_tx_busy && (UCSR0B & (1 << TXEN0))) {
+        cli();
+        if (uart_tx_busy) pwr_sleep();
+        else sei();
+    }
+}
+
+// Bytes that can be queued without uart_transmit_byte() sleeping
+uint8_t uart_tx_space(void) {
+    return ring_space(&uart_tx);
 }
 
 void uart_transmit_string(unsigned char* str) {
     int i = 0;
+    PROF_SCOPE(PROF_UART_STRING);
     // While there are still bytes to transmit...
     while (str[i] != '\0') {
         // clear transmit complete flag
@@ -149,4 +345,16 @@ void uart_transmit_nl(int num, bool cr) {
         uart_transmit_byte('\n');
     }
     if (cr) uart_transmit_byte('\r');
-}
\ No newline at end of file
+}
+
+void uart_stats(uart_stats_t* stats) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = uart_stat;
+    }
+}
+
+void uart_stats_reset(void) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        uart_stat = (uart_stats_t){0};
+    }
+}
@@ -10,12 +10,25 @@
 
 #include <avr/io.h>
 #include <stdbool.h>
+#include "board.h"
 
-#define round_(x) (x - (unsigned long)(x)>=0?(unsigned long)((x)+1):(unsigned long)((x)-1))
-#define UBRR_VALUE (((F_CPU / (16UL * (UART_BAUD))) - 1UL))
-#define UBRR_VALUE_ROUNDED_NEAREST round_(UBRR_VALUE) //round is included in utility.h
-#define UBRRH_VALUE ((uint8_t)UBRR_VALUE_ROUNDED_NEAREST >> 8)
-#define UBRRL_VALUE ((uint8_t)UBRR_VALUE_ROUNDED_NEAREST)
+#define UART_TX_SIZE 64     /*Power of two, see ring.h*/
+#define UART_RX_SIZE 64     /*Power of two, filled by USART_RX_vect with int_en*/
+
+// Rounded to nearest and range checked in board.h, at F_CPU
+#define UBRRH_VALUE ((uint8_t)(BOARD_UBRR >> 8))
+#define UBRRL_VALUE ((uint8_t)BOARD_UBRR)
+
+// Saturating, see counter.h. tx_bytes counts from the UDRE ISR, the
+// receive side from the RX ISR or, polled, from uart_read_byte()
+typedef struct uart_stats {
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint16_t overruns;      /*DOR0, bytes lost before this one was read*/
+    uint16_t frame_errors;  /*FE0, stop bit read as low*/
+    uint16_t parity_errors; /*UPE0*/
+    uint16_t rx_dropped;    /*RX ring full, byte read and lost*/
+} uart_stats_t;
 
 typedef enum {
     TX, 
@@ -36,10 +49,18 @@ bool uart_check_flag(uint8_t flag);         /*to be used to check flags
                                                 without need for using 
                                                 register access inlines*/
 void decToASCII(uint8_t buffer[], uint8_t decimal);
-uint8_t uart_read_byte(); //stub for future fxn
-void uart_read_string(uint8_t buffer[], uint8_t len);  //stub for future fxn
+uint8_t uart_read_byte(void);
+void uart_read_string(uint8_t buffer[], uint8_t len);
+bool uart_rx_get(uint8_t* b);
+uint8_t uart_rx_available(void);
 void uart_transmit_byte(unsigned char data);
 void uart_transmit_string(unsigned char* str);
 void uart_transmit_nl(int num, bool cr);
+void uart_flush(void);
+bool uart_clock_ok(uint32_t hz);
+void uart_retime(uint32_t hz);
+uint8_t uart_tx_space(void);
+void uart_stats(uart_stats_t* stats);
+void uart_stats_reset(void);
 
 #endif //UART_H_
\ No newline at end of file
@@ -0,0 +1,179 @@
+/***********************************************************************
+* Host micro-benchmarks                                                *
+* Purpose: Time the pure logic on the host and count simulated cycles  *
+*          for driver paths against the register mock, `make hostbench`*
+*                                                                      *
+* Host ns/op compares two versions of the same code on this machine,   *
+* it says nothing absolute about the AVR. Simulated cycles include the *
+* modelled bus and baud time and MOCK_ACCESS_CYCLES per register       *
+* access, not instruction timing.                                      *
+***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "test.h"
+#include "ring.h"
+#include "uart.h"
+#include "twi_hal.h"
+#include "spi.h"
+#include "oled.h"
+#include "fix.h"
+#include <math.h>
+
+#define BENCH_ITERS 1000000UL
+
+static volatile uint8_t bench_sink;
+
+static uint64_t bench_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#define BENCH(name, iters, body) do { \
+    uint64_t t0_ = bench_ns(); \
+    for (unsigned long n_ = 0; n_ < (iters); n_++) { body; } \
+    printf("%-28s %10.1f ns/op\n", (name), (double)(bench_ns() - t0_) / (double)(iters)); \
+} while (0)
+
+#define BENCH_SIM(name, body) do { \
+    uint64_t c0_ = mock_cycles; \
+    body; \
+    printf("%-28s %10llu cycles\n", (name), (unsigned long long)(mock_cycles - c0_)); \
+} while (0)
+
+static void bench_ring(void) {
+    static uint8_t buf[64];
+    ring_t r = RING_INIT(buf);
+    uint8_t b = 0;
+
+    BENCH("ring put+get", BENCH_ITERS, {
+        ring_put(&r, (uint8_t)n_);
+        ring_get(&r, &b);
+        bench_sink = b;
+    });
+    BENCH("ring fill+drain 63", BENCH_ITERS / 64, {
+        while (ring_put(&r, (uint8_t)n_));
+        while (ring_get(&r, &b)) bench_sink = b;
+    });
+}
+
+// RTC line as main.c prints it, sprintf against nibble lookups
+static void bench_bcd(void) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t rtc[7] = {0x50, 0x46, 0x20, 0x07, 0x16, 0x07, 0x23};
+    static const uint8_t order[6] = {6, 5, 4, 2, 1, 0};
+    char line[24];
+
+    BENCH("bcd sprintf", BENCH_ITERS, {
+        sprintf(line, "\r20%02x/%02x/%02x %02x:%02x:%02x",
+            rtc[6], rtc[5], rtc[4], rtc[2], rtc[1], rtc[0]);
+        bench_sink = line[3];
+    });
+    BENCH("bcd nibbles", BENCH_ITERS, {
+        char* p = line;
+        uint8_t k;
+        *p++ = '\r'; *p++ = '2'; *p++ = '0';
+        for (k = 0; k < 6; k++) {
+            *p++ = hex[rtc[order[k]] >> 4];
+            *p++ = hex[rtc[order[k]] & 0x0F];
+            *p++ = (k < 2) ? '/' : (k == 2) ? ' ' : (k < 5) ? ':' : '\0';
+        }
+        bench_sink = line[3];
+    });
+}
+
+static void bench_dec(void) {
+    uint8_t buf[2];
+
+    BENCH("decToASCII", BENCH_ITERS, {
+        decToASCII(buf, (uint8_t)(n_ % 100));
+        bench_sink = buf[0];
+    });
+}
+
+static void bench_drivers(void) {
+    static mock_twi_slave_t rtc;
+    uint8_t data[7] = {0};
+
+    mock_reset();
+    test_boot();
+    uart_init(TX, false, NONE);
+    BENCH_SIM("uart 32 bytes + flush", {
+        uart_transmit_string((unsigned char*)"0123456789abcdef0123456789abcdef");
+        uart_flush();
+    });
+
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.addr = 0x68;
+    mock_twi_attach(&rtc);
+    twi_init(false);
+    BENCH_SIM("twi_read 7 bytes @400k", twi_read(0x68, 0x00, data, sizeof(data)));
+    BENCH("twi_read 7 bytes (host)", 2000, twi_read(0x68, 0x00, data, sizeof(data)));
+}
+
+// ISR per byte against the polled loop for the same block
+static void bench_spi(void) {
+    static const spi_dev_t dev = SPI_DEV(GPIO_B, PORTB2, SPI_MODE0, SPI_DIV2, SPI_MSB_FIRST);
+    static uint8_t block[256];
+
+    mock_reset();
+    test_boot();
+    spi_init();
+    spi_dev_init(&dev);
+    BENCH_SIM("spi_transfer 256 @8M", spi_transfer(&dev, block, NULL, sizeof(block)));
+    BENCH_SIM("spi_burst 256 @8M", spi_burst(&dev, block, NULL, sizeof(block)));
+}
+
+// Whole screen against the one glyph a clock tick changes
+static void bench_oled(void) {
+    static mock_twi_slave_t panel;
+
+    mock_reset();
+    test_boot();
+    memset(&panel, 0, sizeof(panel));
+    panel.addr = OLED_ADDR;
+    mock_twi_attach(&panel);
+    twi_init(false);
+    oled_init();
+    BENCH_SIM("oled_flush full @400k", oled_flush());
+    oled_text(0, 0, "12:00:00");
+    oled_flush();
+    oled_text(0, 0, "12:00:01");
+    BENCH_SIM("oled_flush 1 digit @400k", oled_flush());
+}
+
+// The host has a float unit, so this only shows the fixed point code
+// is not slow, bench/bench_fix.c has the AVR cycles against soft float
+static void bench_fix(void) {
+    static volatile int16_t qa = Q8_8(1.7), qb = Q8_8(-2.3);
+    static volatile int32_t la = Q16_16(12.34), lb = Q16_16(-5.67);
+    static volatile float fa = 1.7f, fb = -2.3f;
+    static volatile uint16_t u = 54321;
+    static volatile uint32_t w = 123456789UL;
+    static volatile uint8_t ang = 77;
+
+    BENCH("q8_mul", BENCH_ITERS, bench_sink = q8_mul(qa, qb));
+    BENCH("q16_mul", BENCH_ITERS, bench_sink = q16_mul(la, lb));
+    BENCH("float mul", BENCH_ITERS, bench_sink = fa * fb);
+    BENCH("fix_udiv /10", BENCH_ITERS, bench_sink = fix_udiv(u, 10));
+    BENCH("uint16 /10", BENCH_ITERS, bench_sink = u / 10);
+    BENCH("fix_isqrt", BENCH_ITERS, bench_sink = fix_isqrt(w));
+    BENCH("sqrtf", BENCH_ITERS, bench_sink = sqrtf(w));
+    BENCH("fix_sin", BENCH_ITERS, bench_sink = fix_sin(ang));
+    BENCH("sinf", BENCH_ITERS, bench_sink = sinf(ang * (float)(2 * M_PI / 256)));
+    BENCH("fix_log2", BENCH_ITERS, bench_sink = fix_log2(w));
+    BENCH("log2f", BENCH_ITERS, bench_sink = log2f(w));
+}
+
+int main(void) {
+    bench_ring();
+    bench_bcd();
+    bench_dec();
+    bench_drivers();
+    bench_spi();
+    bench_oled();
+    bench_fix();
+    return 0;
+}
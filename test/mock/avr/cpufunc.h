@@ -0,0 +1,10 @@
+/***********************************************************************
+* Host mock of <avr/cpufunc.h>                                         *
+* Purpose: Instruction wrappers reduced to their ordering effect       *
+***********************************************************************/
+
+#ifndef MOCK_AVR_CPUFUNC_H_
+#define MOCK_AVR_CPUFUNC_H_
+#define _NOP() do { } while (0)
+#define _MemoryBarrier() __asm__ __volatile__("" ::: "memory")
+#endif
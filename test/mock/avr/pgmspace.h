@@ -0,0 +1,20 @@
+/***********************************************************************
+* Host mock of <avr/pgmspace.h>                                        *
+* Purpose: Flash and RAM share one address space on the host, so the   *
+*          pgm_read_*() accessors are plain loads                      *
+***********************************************************************/
+
+#ifndef MOCK_AVR_PGMSPACE_H_
+#define MOCK_AVR_PGMSPACE_H_
+#include <stdint.h>
+#include <string.h>
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)   (*(void * const *)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#endif
@@ -0,0 +1,23 @@
+/***********************************************************************
+* Host mock of <avr/power.h>                                           *
+* Purpose: clock_prescale_set() as the two CLKPR writes its inline asm *
+*          makes, back to back for the mock's timed sequence check     *
+***********************************************************************/
+
+#ifndef MOCK_AVR_POWER_H_
+#define MOCK_AVR_POWER_H_
+#include <avr/io.h>
+typedef enum {
+    clock_div_1 = 0,
+    clock_div_2 = 1,
+    clock_div_4 = 2,
+    clock_div_8 = 3,
+    clock_div_16 = 4,
+    clock_div_32 = 5,
+    clock_div_64 = 6,
+    clock_div_128 = 7,
+    clock_div_256 = 8
+} clock_div_t;
+#define clock_prescale_set(x) do { CLKPR = (1 << CLKPCE); CLKPR = (uint8_t)(x); } while (0)
+#define clock_prescale_get() ((clock_div_t)(CLKPR & 0x0F))
+#endif
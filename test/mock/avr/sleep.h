@@ -0,0 +1,23 @@
+/***********************************************************************
+* Host mock of <avr/sleep.h>                                           *
+* Purpose: sleep_cpu() hands over to the mock, which runs time forward *
+*          until an enabled interrupt is pending                       *
+***********************************************************************/
+
+#ifndef MOCK_AVR_SLEEP_H_
+#define MOCK_AVR_SLEEP_H_
+#include <avr/io.h>
+void mock_sleep(void);
+#define SLEEP_MODE_IDLE         (0x00 << 1)
+#define SLEEP_MODE_ADC          (0x01 << 1)
+#define SLEEP_MODE_PWR_DOWN     (0x02 << 1)
+#define SLEEP_MODE_PWR_SAVE     (0x03 << 1)
+#define SLEEP_MODE_STANDBY      (0x06 << 1)
+#define SLEEP_MODE_EXT_STANDBY  (0x07 << 1)
+#define set_sleep_mode(mode) (SMCR = (uint8_t)((SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode)))
+#define sleep_enable()  (SMCR |= (1 << SE))
+#define sleep_disable() (SMCR &= (uint8_t)~(1 << SE))
+#define sleep_cpu()     mock_sleep()
+#define sleep_mode()    do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+#define sleep_bod_disable() do { } while (0)
+#endif
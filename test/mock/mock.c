@@ -0,0 +1,274 @@
+/***********************************************************************
+* Host register mock for the ATMega328P                                *
+* Purpose: Register access hooks, simulated time, sleep and interrupt  *
+*          dispatch shared by the peripheral models                    *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+volatile uint8_t mock_sfr[0x100] __attribute__((aligned(2)));
+uint64_t mock_cycles = 0;
+uint8_t mock_ram[RAMEND + 1];
+
+static mock_read_fn mock_rd[0x100];
+static mock_write_fn mock_wr[0x100];
+
+// CLKPR, the system clock is F_CPU >> CLKPS. Every model counts in CPU
+// cycles and all their clocks follow the divider, only the conversions
+// from microseconds need it.
+static uint64_t mock_clkpce_at = 0;
+static bool mock_clkpce = false;
+
+// Hooked registers accessed since the last sync and their value before
+#define MOCK_TOUCH_MAX 4
+static uint8_t mock_touch_addr[MOCK_TOUCH_MAX];
+static uint8_t mock_touch_old[MOCK_TOUCH_MAX];
+static uint8_t mock_touch_n = 0;
+
+typedef struct mock_model {
+    void (*reset)(void);
+    void (*tick)(uint32_t cycles, uint8_t clk);
+} mock_model_t;
+
+static const mock_model_t mock_models[] = {
+    {mock_gpio_reset, NULL},
+    {mock_tmr_reset, mock_tmr_tick},
+    {mock_uart_reset, mock_uart_tick},
+    {mock_adc_reset, mock_adc_tick},
+    {mock_acomp_reset, mock_acomp_tick},
+    {mock_spi_reset, mock_spi_tick},
+    {mock_twi_reset, mock_twi_tick},
+    {mock_i2c_reset, mock_i2c_tick},
+    {mock_serial_reset, mock_serial_tick},
+    {mock_ee_reset, mock_ee_tick},
+};
+#define MOCK_MODELS (sizeof(mock_models) / sizeof(mock_models[0]))
+
+/*Interrupt vectors in priority order. An interrupt is pending while its*/
+/*flag and enable bits are both set (flag clear for the level_low ones) */
+typedef struct mock_vector {
+    void (*isr)(void);
+    uint8_t flag_reg, flag_bit;
+    uint8_t en_reg, en_bit;
+    bool level_low;             /*Pending while the flag bit is clear*/
+    bool clear;                 /*Hardware clears the flag on entry*/
+} mock_vector_t;
+
+static const mock_vector_t mock_vectors[] = {
+    {INT0_vect,          MOCK_ADDR(EIFR),   INTF0,  MOCK_ADDR(EIMSK),  INT0,    false, true},
+    {INT1_vect,          MOCK_ADDR(EIFR),   INTF1,  MOCK_ADDR(EIMSK),  INT1,    false, true},
+    {PCINT0_vect,        MOCK_ADDR(PCIFR),  PCIF0,  MOCK_ADDR(PCICR),  PCIE0,   false, true},
+    {PCINT1_vect,        MOCK_ADDR(PCIFR),  PCIF1,  MOCK_ADDR(PCICR),  PCIE1,   false, true},
+    {PCINT2_vect,        MOCK_ADDR(PCIFR),  PCIF2,  MOCK_ADDR(PCICR),  PCIE2,   false, true},
+    {WDT_vect,           MOCK_ADDR(WDTCSR), WDIF,   MOCK_ADDR(WDTCSR), WDIE,    false, true},
+    {TIMER2_COMPA_vect,  MOCK_ADDR(TIFR2),  OCF2A,  MOCK_ADDR(TIMSK2), OCIE2A,  false, true},
+    {TIMER2_COMPB_vect,  MOCK_ADDR(TIFR2),  OCF2B,  MOCK_ADDR(TIMSK2), OCIE2B,  false, true},
+    {TIMER2_OVF_vect,    MOCK_ADDR(TIFR2),  TOV2,   MOCK_ADDR(TIMSK2), TOIE2,   false, true},
+    {TIMER1_CAPT_vect,   MOCK_ADDR(TIFR1),  ICF1,   MOCK_ADDR(TIMSK1), ICIE1,   false, true},
+    {TIMER1_COMPA_vect,  MOCK_ADDR(TIFR1),  OCF1A,  MOCK_ADDR(TIMSK1), OCIE1A,  false, true},
+    {TIMER1_COMPB_vect,  MOCK_ADDR(TIFR1),  OCF1B,  MOCK_ADDR(TIMSK1), OCIE1B,  false, true},
+    {TIMER1_OVF_vect,    MOCK_ADDR(TIFR1),  TOV1,   MOCK_ADDR(TIMSK1), TOIE1,   false, true},
+    {TIMER0_COMPA_vect,  MOCK_ADDR(TIFR0),  OCF0A,  MOCK_ADDR(TIMSK0), OCIE0A,  false, true},
+    {TIMER0_COMPB_vect,  MOCK_ADDR(TIFR0),  OCF0B,  MOCK_ADDR(TIMSK0), OCIE0B,  false, true},
+    {TIMER0_OVF_vect,    MOCK_ADDR(TIFR0),  TOV0,   MOCK_ADDR(TIMSK0), TOIE0,   false, true},
+    {SPI_STC_vect,       MOCK_ADDR(SPSR),   SPIF,   MOCK_ADDR(SPCR),   SPIE,    false, true},
+    {USART_RX_vect,      MOCK_ADDR(UCSR0A), RXC0,   MOCK_ADDR(UCSR0B), RXCIE0,  false, false},
+    {USART_UDRE_vect,    MOCK_ADDR(UCSR0A), UDRE0,  MOCK_ADDR(UCSR0B), UDRIE0,  false, false},
+    {USART_TX_vect,      MOCK_ADDR(UCSR0A), TXC0,   MOCK_ADDR(UCSR0B), TXCIE0,  false, true},
+    {ADC_vect,           MOCK_ADDR(ADCSRA), ADIF,   MOCK_ADDR(ADCSRA), ADIE,    false, true},
+    {EE_READY_vect,      MOCK_ADDR(EECR),   EEPE,   MOCK_ADDR(EECR),   EERIE,   true,  false},
+    {ANALOG_COMP_vect,   MOCK_ADDR(ACSR),   ACI,    MOCK_ADDR(ACSR),   ACIE,    false, true},
+    {TWI_vect,           MOCK_ADDR(TWCR),   TWINT,  MOCK_ADDR(TWCR),   TWIE,    false, false},
+};
+#define MOCK_VECTORS (sizeof(mock_vectors) / sizeof(mock_vectors[0]))
+
+/************************** Mock Setup Stuff **************************/
+
+void mock_fail(const char* msg) {
+    fprintf(stderr, "mock: %s at cycle %llu\n", msg, (unsigned long long)mock_cycles);
+    exit(2);
+}
+
+// CLKPS only takes a write within four cycles of setting CLKPCE alone,
+// the write that follows it at the next access is at that distance
+static void mock_clkpr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    if (val == old) return;
+    if (val == (1 << CLKPCE)) {
+        mock_clkpce = true;
+        mock_clkpce_at = mock_cycles;
+        mock_sfr[addr] = (old & 0x0F) | (1 << CLKPCE);
+        return;
+    }
+    if (!mock_clkpce || mock_cycles - mock_clkpce_at > MOCK_ACCESS_CYCLES || (val & 0xF0) || val > 8) {
+        mock_fail("CLKPR written outside the timed sequence");
+    }
+    mock_clkpce = false;
+    mock_sfr[addr] = val;
+}
+
+// Power-on register values, then every model installs its hooks again
+void mock_reset(void) {
+    uint8_t i;
+
+    memset((void*)mock_sfr, 0, sizeof(mock_sfr));
+    memset(mock_rd, 0, sizeof(mock_rd));
+    memset(mock_wr, 0, sizeof(mock_wr));
+    memset(mock_ram, 0, sizeof(mock_ram));
+    mock_touch_n = 0;
+    mock_cycles = 0;
+
+    for (i = 0; i < MOCK_MODELS; i++) mock_models[i].reset();
+    mock_clkpce = false;
+    mock_hook(MOCK_ADDR(CLKPR), NULL, mock_clkpr_wr);
+}
+
+void mock_hook(uint8_t addr, mock_read_fn rd, mock_write_fn wr) {
+    mock_rd[addr] = rd;
+    mock_wr[addr] = wr;
+}
+
+/************************** Mock Time Stuff ***************************/
+
+static void mock_advance(uint32_t cycles, uint8_t clk) {
+    uint8_t i;
+
+    mock_cycles += cycles;
+    for (i = 0; i < MOCK_MODELS; i++) {
+        if (mock_models[i].tick) mock_models[i].tick(cycles, clk);
+    }
+}
+
+static const mock_vector_t* mock_pending(void) {
+    const mock_vector_t* v;
+    uint8_t i;
+    bool flag;
+
+    for (i = 0; i < MOCK_VECTORS; i++) {
+        v = &mock_vectors[i];
+        flag = (mock_sfr[v->flag_reg] >> v->flag_bit) & 1;
+        if (v->level_low) flag = !flag;
+        if (flag && ((mock_sfr[v->en_reg] >> v->en_bit) & 1)) return v;
+    }
+    return NULL;
+}
+
+// Runs the highest priority pending vector with I cleared, as the CPU
+// would, and returns true if one ran
+static bool mock_dispatch(void) {
+    const mock_vector_t* v;
+
+    if (!(SREG & (1 << SREG_I))) return false;
+    v = mock_pending();
+    if (v == NULL) return false;
+    if (v->isr == NULL) mock_fail("interrupt enabled without an ISR");
+
+    if (v->clear) mock_sfr[v->flag_reg] &= ~(1 << v->flag_bit);
+    SREG &= ~(1 << SREG_I);
+    v->isr();
+    mock_sync();                /*A flag cleared by the ISR's last access*/
+    SREG |= (1 << SREG_I);      /*reti*/
+    return true;
+}
+
+// Hands the accesses since the last sync to the write hooks
+void mock_sync(void) {
+    uint8_t i, n = mock_touch_n;
+    uint8_t addr;
+
+    mock_touch_n = 0;
+    for (i = 0; i < n; i++) {
+        addr = mock_touch_addr[i];
+        mock_wr[addr](addr, mock_touch_old[i], mock_sfr[addr]);
+    }
+}
+
+// Awake time, interrupts are taken whenever SREG_I allows
+void mock_run(uint32_t cycles) {
+    uint32_t step;
+
+    mock_sync();
+    while (cycles) {
+        step = (cycles < MOCK_SLEEP_STEP) ? cycles : MOCK_SLEEP_STEP;
+        mock_advance(step, MOCK_CLK_ALL);
+        while (mock_dispatch());
+        cycles -= step;
+    }
+}
+
+// At the system clock CLKPR selects
+void mock_run_us(uint32_t us) {
+    mock_run((uint32_t)((uint64_t)us * (F_CPU >> (CLKPR & 0x0F)) / 1000000UL));
+}
+
+void mock_delay_us(double us) {
+    mock_run((uint32_t)(us * (F_CPU / 1000000.0)));
+}
+
+/************************* Mock Access Stuff **************************/
+
+static void mock_access(uint8_t addr, uint8_t width) {
+    uint8_t i;
+
+    mock_sync();
+    mock_advance(MOCK_ACCESS_CYCLES, MOCK_CLK_ALL);
+    mock_dispatch();
+
+    for (i = 0; i < width; i++, addr++) {
+        if (mock_rd[addr]) mock_rd[addr](addr);
+        if (mock_wr[addr]) {
+            if (mock_touch_n == MOCK_TOUCH_MAX) mock_fail("too many pending register writes");
+            mock_touch_addr[mock_touch_n] = addr;
+            mock_touch_old[mock_touch_n] = mock_sfr[addr];
+            mock_touch_n++;
+        }
+    }
+}
+
+volatile uint8_t* mock_reg8(uint8_t addr) {
+    mock_access(addr, 1);
+    return &mock_sfr[addr];
+}
+
+volatile uint16_t* mock_reg16(uint8_t addr) {
+    mock_access(addr, 2);
+    return (volatile uint16_t*)&mock_sfr[addr];
+}
+
+/************************** Mock Sleep Stuff **************************/
+
+// Clocks left running per SMCR sleep mode
+static uint8_t mock_sleep_clk(void) {
+    switch (SMCR & ((1 << SM2) | (1 << SM1) | (1 << SM0))) {
+        case(SLEEP_MODE_IDLE):
+            return MOCK_CLK_ALL;
+        case(SLEEP_MODE_ADC):
+            return MOCK_CLK_ADC | MOCK_CLK_ASY;
+        case(SLEEP_MODE_PWR_SAVE):
+        case(SLEEP_MODE_EXT_STANDBY):
+            return MOCK_CLK_ASY;
+        default:
+            return 0;
+    }
+}
+
+// sleep_cpu(), returns once an interrupt has woken the core and run
+void mock_sleep(void) {
+    uint8_t clk;
+    uint32_t slept = 0;
+
+    mock_sync();
+    if (!(SMCR & (1 << SE))) return;
+    if (!(SREG & (1 << SREG_I))) mock_fail("sleep with interrupts disabled");
+
+    clk = mock_sleep_clk();
+    while (!mock_dispatch()) {
+        if (slept >= MOCK_SLEEP_LIMIT) mock_fail("sleep with nothing left to wake it");
+        mock_advance(MOCK_SLEEP_STEP, clk);
+        slept += MOCK_SLEEP_STEP;
+    }
+}
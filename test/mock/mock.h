@@ -0,0 +1,186 @@
+/***********************************************************************
+* Host register mock for the ATMega328P                                *
+* Purpose: Run the drivers in src/ unchanged under native gcc with the *
+*          peripherals they talk to modelled in software               *
+*                                                                      *
+* Registers are plain bytes in mock_sfr[]. Every access from driver    *
+* code goes through mock_reg8/16(), which advances simulated time by   *
+* MOCK_ACCESS_CYCLES, runs the peripheral models, dispatches pending   *
+* interrupts when SREG_I is set and then calls the hooks for the       *
+* register being accessed:                                             *
+*   read hook  - before the access, so a model can present a value     *
+*                (PINx from the pin levels, UDR0 from the RX side)     *
+*   write hook - at the next access, sleep or delay, with the value    *
+*                from before and after. It runs for every access to a  *
+*                hooked register, since a store of the value already   *
+*                held cannot be told apart from a read, and the model  *
+*                decides what counts as a write (TWINT written as one, *
+*                ADSC set, a byte placed in UDR0).                     *
+*                                                                      *
+* sleep_cpu() advances time until an enabled interrupt is pending and  *
+* only clocks the models the selected sleep mode leaves running, so a  *
+* sleep nothing can wake from fails the run instead of hanging it.     *
+***********************************************************************/
+
+#ifndef MOCK_H_
+#define MOCK_H_
+
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MOCK_ACCESS_CYCLES 4    /*Charged per register access*/
+#define MOCK_SLEEP_STEP 16      /*Cycles per step while asleep*/
+#define MOCK_SLEEP_LIMIT (2UL * F_CPU)  /*Longest sleep before giving up*/
+
+// Clock domains handed to the models, see ATMega328P datasheet table 10-1
+#define MOCK_CLK_IO  0x01       /*Timer0/1, USART, TWI, SPI*/
+#define MOCK_CLK_ADC 0x02
+#define MOCK_CLK_ASY 0x04       /*Timer2*/
+#define MOCK_CLK_ALL (MOCK_CLK_IO | MOCK_CLK_ADC | MOCK_CLK_ASY)
+
+// Offset of a register in mock_sfr[], for models built with MOCK_RAW
+#define MOCK_ADDR(reg) ((uint8_t)(&(reg) - &mock_sfr[0]))
+
+typedef void (*mock_read_fn)(uint8_t addr);
+typedef void (*mock_write_fn)(uint8_t addr, uint8_t old, uint8_t val);
+
+extern uint64_t mock_cycles;    /*Simulated CPU cycles since mock_reset()*/
+
+/*Core*/
+void mock_reset(void);
+void mock_hook(uint8_t addr, mock_read_fn rd, mock_write_fn wr);
+void mock_sync(void);
+void mock_run(uint32_t cycles);
+void mock_run_us(uint32_t us);
+void mock_fail(const char* msg);
+
+/*Pins, a driven pin reads its level, an undriven input reads its pull-up*/
+typedef enum mock_port {
+    MOCK_PORT_B,
+    MOCK_PORT_C,
+    MOCK_PORT_D
+} mock_port_t;
+
+void mock_pin_drive(mock_port_t port, uint8_t mask, uint8_t level);
+void mock_pin_release(mock_port_t port, uint8_t mask);
+
+/*Timers*/
+void mock_icp_edge(bool rising);
+
+/*USART0, transmitted bytes collect in mock_uart_out*/
+#define MOCK_UART_OUT_SIZE 1024
+
+extern uint8_t mock_uart_out[MOCK_UART_OUT_SIZE];
+extern uint16_t mock_uart_out_len;
+
+void mock_uart_rx(uint8_t b);
+
+/*ADC, 10-bit result per mux channel*/
+extern uint16_t mock_adc_in[16];
+
+/*Analog comparator, AIN0 and AIN1 in millivolts*/
+extern uint16_t mock_ain_mv[2];
+
+/*TWI, register file slaves addressed like the DS3231: the first byte */
+/*after SLA+W loads the pointer, reads and writes then auto-increment */
+#define MOCK_TWI_SLAVES 4
+
+typedef struct mock_twi_slave {
+    uint8_t addr;               /*7-bit*/
+    uint8_t ptr;
+    uint8_t reg[256];
+    uint8_t nack_after;         /*NACK the nth data byte written, 0 for never*/
+    void (*write)(uint16_t n, uint8_t b);   /*Optional, sees byte n after SLA+W, n = 0 the pointer*/
+} mock_twi_slave_t;
+
+// TWSR codes in the order the bus produced them
+#define MOCK_TWI_LOG 64
+
+extern uint8_t mock_twi_log[MOCK_TWI_LOG];
+extern uint8_t mock_twi_log_len;
+extern bool mock_twi_hung;              /*SCL held low, no step ever completes*/
+
+void mock_twi_attach(mock_twi_slave_t* slave);
+
+/*Software I2C on two port pins, the same slaves as the TWI. Starts,  */
+/*stops and the shortest SCL half period (cycles) are counted while a */
+/*transfer is on the bus                                              */
+extern uint16_t mock_i2c_stretch_us;    /*SCL held low after every ACK*/
+extern uint16_t mock_i2c_starts;
+extern uint16_t mock_i2c_stops;
+extern uint32_t mock_i2c_min_half;
+
+void mock_i2c_bus(mock_port_t sda_port, uint8_t sda_mask, mock_port_t scl_port, uint8_t scl_mask);
+void mock_i2c_attach(mock_twi_slave_t* slave);
+void mock_i2c_jam(void);
+
+/*Serial line on two port pins for a software UART, 8N1. Decoded TX   */
+/*bytes collect in mock_serial_out; mock_serial_skew is the furthest  */
+/*a TX edge landed from its place in the frame, in cycles             */
+#define MOCK_SERIAL_OUT_SIZE 256
+
+extern uint8_t mock_serial_out[MOCK_SERIAL_OUT_SIZE];
+extern uint16_t mock_serial_out_len;
+extern uint16_t mock_serial_frame_errors;
+extern uint32_t mock_serial_skew;
+
+void mock_serial_line(mock_port_t tx_port, uint8_t tx_mask, mock_port_t rx_port, uint8_t rx_mask, uint32_t baud);
+void mock_serial_rx(uint8_t b);
+
+/*SPI master, every byte sent is kept with the registers and port     */
+/*levels it went out with, mock_spi_reply() gives the byte that comes  */
+/*back (0xFF when NULL, MISO pulled up)                                */
+#define MOCK_SPI_OUT_SIZE 1024
+
+typedef struct mock_spi_byte {
+    uint8_t mosi;
+    uint8_t spcr;
+    uint8_t spsr;
+    uint8_t portb;
+    uint8_t portc;
+    uint8_t portd;
+} mock_spi_byte_t;
+
+extern mock_spi_byte_t mock_spi_out[MOCK_SPI_OUT_SIZE];
+extern uint16_t mock_spi_out_len;
+extern uint8_t (*mock_spi_reply)(uint8_t mosi);
+
+/*EEPROM, the array survives mock_reset() as it survives a reset on */
+/*the chip. mock_ee_wear counts the writes programmed per address    */
+extern uint8_t mock_eeprom[E2END + 1];
+extern uint16_t mock_ee_wear[E2END + 1];
+extern uint32_t mock_ee_writes;
+
+void mock_ee_erase(void);
+
+/*SRAM, the data space above the registers. The makefile points the  */
+/*linker symbols __heap_start and __stack into it, so .bss appears to */
+/*end at MOCK_HEAP_START and the stack to start at RAMEND            */
+extern uint8_t mock_ram[RAMEND + 1];
+
+/*Models, called by the core*/
+void mock_gpio_reset(void);
+void mock_tmr_reset(void);
+void mock_tmr_tick(uint32_t cycles, uint8_t clk);
+void mock_uart_reset(void);
+void mock_uart_tick(uint32_t cycles, uint8_t clk);
+void mock_adc_reset(void);
+void mock_adc_tick(uint32_t cycles, uint8_t clk);
+void mock_adc_trigger(uint8_t src);
+void mock_acomp_reset(void);
+void mock_acomp_tick(uint32_t cycles, uint8_t clk);
+void mock_spi_reset(void);
+void mock_spi_tick(uint32_t cycles, uint8_t clk);
+void mock_twi_reset(void);
+void mock_twi_tick(uint32_t cycles, uint8_t clk);
+void mock_i2c_reset(void);
+void mock_i2c_tick(uint32_t cycles, uint8_t clk);
+void mock_serial_reset(void);
+void mock_serial_tick(uint32_t cycles, uint8_t clk);
+void mock_ee_reset(void);
+void mock_ee_tick(uint32_t cycles, uint8_t clk);
+
+#endif //MOCK_H_
@@ -0,0 +1,69 @@
+/***********************************************************************
+* Host register mock, analog comparator model                          *
+* Purpose: Compare the input voltages chosen by ACSR, ADCSRB and ADMUX *
+*          and raise ACI, the ADC auto trigger and Timer1 input        *
+*          capture on the crossings ACIS selects                       *
+*                                                                      *
+* AIN0 and AIN1 come from mock_ain_mv[], a multiplexer channel from    *
+* mock_adc_in[] scaled to a 5 V AVCC, the bandgap is 1.1 V. The output *
+* follows the inputs on the I/O clock, so a crossing can not wake the  *
+* CPU from ADC noise reduction or power-save.                          *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+#define ACOMP_AVCC_MV 5000UL
+#define ACOMP_BANDGAP_MV 1100
+
+uint16_t mock_ain_mv[2];
+
+// ACO is read only, ACI is write one to clear
+static void acomp_acsr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    uint8_t aci = old & (1 << ACI);
+
+    if (val == old) return;
+    if (val & (1 << ACI)) aci = 0;
+    mock_sfr[addr] = (val & ~((1 << ACO) | (1 << ACI))) | (old & (1 << ACO)) | aci;
+}
+
+// The multiplexer feeds the comparator only while the ADC is off but clocked
+static uint16_t acomp_neg_mv(void) {
+    if ((ADCSRB & (1 << ACME)) && !(ADCSRA & (1 << ADEN)) && !(PRR & (1 << PRADC))) {
+        return (mock_adc_in[ADMUX & 0x07] & 0x3FF) * ACOMP_AVCC_MV / 1023;
+    }
+    return mock_ain_mv[1];
+}
+
+void mock_acomp_tick(uint32_t cycles, uint8_t clk) {
+    uint16_t pos;
+    bool high, was;
+    uint8_t acis;
+
+    (void)cycles;
+    if (!(clk & MOCK_CLK_IO) || (ACSR & (1 << ACD))) return;
+
+    pos = (ACSR & (1 << ACBG)) ? ACOMP_BANDGAP_MV : mock_ain_mv[0];
+    high = pos > acomp_neg_mv();
+    was = (ACSR & (1 << ACO)) != 0;
+    if (high == was) return;
+
+    if (high) ACSR |= (1 << ACO);
+    else ACSR &= ~(1 << ACO);
+
+    acis = ACSR & ((1 << ACIS1) | (1 << ACIS0));
+    if (acis == 0 || (acis == 2 && !high) || (acis == 3 && high)) {
+        // The ADC triggers on the rising edge of ACI, not on its level
+        if (!(ACSR & (1 << ACI))) {
+            ACSR |= (1 << ACI);
+            mock_adc_trigger(1);
+        }
+    }
+    if (ACSR & (1 << ACIC)) mock_icp_edge(high);
+}
+
+void mock_acomp_reset(void) {
+    mock_ain_mv[0] = 0;
+    mock_ain_mv[1] = 0;
+    mock_hook(MOCK_ADDR(ACSR), NULL, acomp_acsr_wr);
+}
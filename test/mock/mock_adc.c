@@ -0,0 +1,74 @@
+/***********************************************************************
+* Host register mock, ADC model                                        *
+* Purpose: Run conversions for the ADC clock time set by ADPS and load *
+*          ADC from mock_adc_in[] for the selected mux channel         *
+*                                                                      *
+* Free running restarts itself, the other auto trigger sources start a *
+* conversion through mock_adc_trigger() from the model that owns them. *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+uint16_t mock_adc_in[16];
+
+static const uint8_t adc_div[8] = {2, 2, 4, 8, 16, 32, 64, 128};
+static uint32_t adc_left = 0;       /*CPU cycles until the result*/
+static bool adc_first = true;       /*First conversion after ADEN takes 25 ADC clocks*/
+
+static void adc_start(void) {
+    adc_left = (adc_first ? 25UL : 13UL) * adc_div[ADCSRA & 0x07];
+    adc_first = false;
+}
+
+// ADSC only clears itself, ADIF is write one to clear
+static void adc_csra_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    if (adc_left) val |= (1 << ADSC);
+    if (val != old && (val & (1 << ADIF))) val &= ~(1 << ADIF);
+    else val = (val & ~(1 << ADIF)) | (old & (1 << ADIF));
+
+    if (!(val & (1 << ADEN))) {
+        val &= ~(1 << ADSC);
+        adc_left = 0;
+        adc_first = true;
+    }
+    mock_sfr[addr] = val;
+
+    if ((val & (1 << ADSC)) && !adc_left && !(PRR & (1 << PRADC))) adc_start();
+}
+
+void mock_adc_tick(uint32_t cycles, uint8_t clk) {
+    uint16_t res;
+
+    if (adc_left == 0 || !(clk & MOCK_CLK_ADC) || (PRR & (1 << PRADC))) return;
+    if (cycles < adc_left) {
+        adc_left -= cycles;
+        return;
+    }
+
+    res = mock_adc_in[ADMUX & 0x0F] & 0x3FF;
+    ADC = (ADMUX & (1 << ADLAR)) ? (res << 6) : res;
+    ADCSRA |= (1 << ADIF);
+
+    adc_left = 0;
+    if ((ADCSRA & (1 << ADATE)) && (ADCSRB & 0x07) == 0) adc_start();
+    else ADCSRA &= ~(1 << ADSC);
+}
+
+// A trigger event from source ADTS, ignored unless auto triggering from
+// it or while a conversion is still running
+void mock_adc_trigger(uint8_t src) {
+    if (!(ADCSRA & (1 << ADEN)) || !(ADCSRA & (1 << ADATE))) return;
+    if ((ADCSRB & 0x07) != src || adc_left || (PRR & (1 << PRADC))) return;
+    ADCSRA |= (1 << ADSC);
+    adc_start();
+}
+
+void mock_adc_reset(void) {
+    uint8_t i;
+
+    for (i = 0; i < 16; i++) mock_adc_in[i] = 0;
+    adc_left = 0;
+    adc_first = true;
+    mock_hook(MOCK_ADDR(ADCSRA), NULL, adc_csra_wr);
+}
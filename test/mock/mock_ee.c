@@ -0,0 +1,95 @@
+/***********************************************************************
+* Host register mock, EEPROM model                                     *
+* Purpose: Serve EERE reads from mock_eeprom[] and program a byte for  *
+*          the datasheet write time once EEPE follows EEMPE            *
+*                                                                      *
+* EEMPE is held for two register accesses rather than four cycles,     *
+* which is what `EECR = EEMPE; EECR |= EEPE` costs in the mock. The    *
+* EEPROM runs off its own oscillator, so writes go on in every sleep   *
+* mode.                                                                *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+#include <string.h>
+
+#define EE_MPE_WINDOW (2UL * MOCK_ACCESS_CYCLES)
+
+uint8_t mock_eeprom[E2END + 1];
+uint16_t mock_ee_wear[E2END + 1];
+uint32_t mock_ee_writes = 0;
+
+static uint32_t ee_mpe_left = 0;    /*Cycles EEMPE stays set*/
+static uint32_t ee_left = 0;        /*Cycles until the write in flight is done*/
+static uint16_t ee_addr;
+static uint8_t ee_data;
+static uint8_t ee_mode;             /*EEPM1:0*/
+
+// Erase and write 3.4 ms, erase or write alone 1.8 ms
+static uint32_t ee_write_cycles(uint8_t mode) {
+    return (mode == 0) ? (uint32_t)(F_CPU / 10000UL * 34UL) : (uint32_t)(F_CPU / 10000UL * 18UL);
+}
+
+static void ee_cr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    if ((val & (1 << EEMPE)) && !(old & (1 << EEMPE))) ee_mpe_left = EE_MPE_WINDOW;
+
+    if (ee_left) {
+        val |= (1 << EEPE);
+    }
+    else if ((val & (1 << EEPE)) && !(old & (1 << EEPE))) {
+        if (old & (1 << EEMPE)) {
+            ee_addr = EEAR & E2END;
+            ee_data = EEDR;
+            ee_mode = (val >> EEPM0) & 0x03;
+            ee_left = ee_write_cycles(ee_mode);
+            ee_mpe_left = 0;
+            val &= ~(1 << EEMPE);
+        }
+        else val &= ~(1 << EEPE);
+    }
+
+    // EERE is ignored while a write is in flight
+    if (val & (1 << EERE)) {
+        if (!ee_left) EEDR = mock_eeprom[EEAR & E2END];
+        val &= ~(1 << EERE);
+    }
+    mock_sfr[addr] = val;
+}
+
+void mock_ee_tick(uint32_t cycles, uint8_t clk) {
+    if (ee_mpe_left) {
+        if (cycles >= ee_mpe_left) {
+            ee_mpe_left = 0;
+            EECR &= ~(1 << EEMPE);
+        }
+        else ee_mpe_left -= cycles;
+    }
+
+    if (ee_left == 0) return;
+    if (cycles < ee_left) {
+        ee_left -= cycles;
+        return;
+    }
+
+    if (ee_mode == 0) mock_eeprom[ee_addr] = ee_data;
+    else if (ee_mode == 1) mock_eeprom[ee_addr] = 0xFF;
+    else mock_eeprom[ee_addr] &= ee_data;
+    mock_ee_wear[ee_addr]++;
+    mock_ee_writes++;
+
+    ee_left = 0;
+    EECR &= ~(1 << EEPE);
+}
+
+// The array keeps its contents across resets, like the chip
+void mock_ee_reset(void) {
+    memset(mock_ee_wear, 0, sizeof(mock_ee_wear));
+    mock_ee_writes = 0;
+    ee_mpe_left = 0;
+    ee_left = 0;
+    mock_hook(MOCK_ADDR(EECR), NULL, ee_cr_wr);
+}
+
+void mock_ee_erase(void) {
+    memset(mock_eeprom, 0xFF, sizeof(mock_eeprom));
+}
@@ -0,0 +1,74 @@
+/***********************************************************************
+* Host register mock, I/O port model                                   *
+* Purpose: PINx follows PORTx on outputs and the externally driven     *
+*          level (or the pull-up) on inputs; writing PINx toggles PORTx *
+*                                                                      *
+* A pin in PCMSKn that changes because mock_pin_drive() or             *
+* mock_pin_release() moved it raises PCIFn, port B to D are PCINT0..2. *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+// PINx, DDRx and PORTx sit three bytes apart per port
+#define MOCK_PIN_ADDR(port) ((uint8_t)(0x23 + 3 * (port)))
+
+static uint8_t gpio_drive[3];   /*Pins driven from outside*/
+static uint8_t gpio_level[3];   /*Their levels*/
+
+static uint8_t gpio_pins(mock_port_t port) {
+    uint8_t base = MOCK_PIN_ADDR(port);
+    uint8_t ddr = mock_sfr[base + 1];
+    uint8_t out = mock_sfr[base + 2];
+    uint8_t pullup = (MCUCR & (1 << PUD)) ? 0 : out;
+    uint8_t in = (gpio_drive[port] & gpio_level[port]) | (~gpio_drive[port] & pullup);
+
+    return (out & ddr) | (in & ~ddr);
+}
+
+static void gpio_pin_rd(uint8_t addr) {
+    mock_sfr[addr] = gpio_pins((mock_port_t)((addr - 0x23) / 3));
+}
+
+// Any one written to PINx toggles that PORTx bit
+static void gpio_pin_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    if (val != old) mock_sfr[addr + 2] ^= val;
+    gpio_pin_rd(addr);
+}
+
+static void gpio_pcint(mock_port_t port, uint8_t before) {
+    uint8_t pcmsk = mock_sfr[MOCK_ADDR(PCMSK0) + port];
+
+    if ((before ^ gpio_pins(port)) & pcmsk) PCIFR |= (1 << port);
+}
+
+// Writing one clears a flag, see tmr_tifr_wr() in mock_tmr.c
+static void gpio_pcifr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    mock_sfr[addr] = (val == old) ? old : (old & ~val);
+}
+
+void mock_pin_drive(mock_port_t port, uint8_t mask, uint8_t level) {
+    uint8_t before = gpio_pins(port);
+
+    gpio_drive[port] |= mask;
+    gpio_level[port] = (gpio_level[port] & ~mask) | (level & mask);
+    gpio_pcint(port, before);
+}
+
+void mock_pin_release(mock_port_t port, uint8_t mask) {
+    uint8_t before = gpio_pins(port);
+
+    gpio_drive[port] &= ~mask;
+    gpio_pcint(port, before);
+}
+
+void mock_gpio_reset(void) {
+    uint8_t port;
+
+    for (port = MOCK_PORT_B; port <= MOCK_PORT_D; port++) {
+        gpio_drive[port] = 0;
+        gpio_level[port] = 0;
+        mock_hook(MOCK_PIN_ADDR(port), gpio_pin_rd, gpio_pin_wr);
+    }
+    mock_hook(MOCK_ADDR(PCIFR), NULL, gpio_pcifr_wr);
+}
@@ -0,0 +1,223 @@
+/***********************************************************************
+* Host register mock, bit level I2C slaves on two port pins            *
+* Purpose: Decode START, STOP and bytes from the levels a software     *
+*          master puts on SDA and SCL and answer as register file      *
+*          slaves, with optional clock stretching                      *
+*                                                                      *
+* The master drives a line low through its DDR bit with PORT cleared.  *
+* Each line is the wired AND of that and the slave, with the external  *
+* pull-up presented on the pin when both let go. The slaves are the    *
+* ones the hardware TWI model uses, addressed the same way. After the  *
+* ACK of every byte the slave holds SCL low for mock_i2c_stretch_us.   *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+#define MOCK_PIN_ADDR(port) ((uint8_t)(0x23 + 3 * (port)))
+
+typedef enum i2c_phase {
+    I2C_IDLE,
+    I2C_ADDR,
+    I2C_WRITE,
+    I2C_READ,
+    I2C_DEAD        /*Not addressed or NACKed, waiting for STOP*/
+} i2c_phase_t;
+
+uint16_t mock_i2c_stretch_us = 0;
+uint16_t mock_i2c_starts = 0;
+uint16_t mock_i2c_stops = 0;
+uint32_t mock_i2c_min_half = 0;
+
+static mock_twi_slave_t* i2c_slaves[MOCK_TWI_SLAVES];
+static mock_twi_slave_t* i2c_sel = NULL;
+static bool i2c_on = false;
+static mock_port_t i2c_sda_port, i2c_scl_port;
+static uint8_t i2c_sda_mask, i2c_scl_mask;
+static bool i2c_sda, i2c_scl;               /*Line levels at the last update*/
+static bool i2c_hold_sda, i2c_hold_scl;     /*Pulled low by the slave*/
+static i2c_phase_t i2c_phase = I2C_IDLE;
+static uint8_t i2c_bit;                     /*SCL rising edges in this byte*/
+static uint8_t i2c_shift;
+static uint16_t i2c_written;
+static bool i2c_acked;                      /*By the master, reads only*/
+static uint32_t i2c_stretch_left = 0;
+static uint64_t i2c_edge_at;
+
+void mock_i2c_attach(mock_twi_slave_t* slave) {
+    uint8_t i;
+
+    for (i = 0; i < MOCK_TWI_SLAVES; i++) {
+        if (i2c_slaves[i] == NULL) {
+            i2c_slaves[i] = slave;
+            return;
+        }
+    }
+    mock_fail("too many I2C slaves");
+}
+
+static mock_twi_slave_t* i2c_find(uint8_t addr) {
+    uint8_t i;
+
+    for (i = 0; i < MOCK_TWI_SLAVES; i++) {
+        if (i2c_slaves[i] && i2c_slaves[i]->addr == addr) return i2c_slaves[i];
+    }
+    return NULL;
+}
+
+static bool i2c_line(mock_port_t port, uint8_t mask, bool hold) {
+    uint8_t base = MOCK_PIN_ADDR(port);
+    bool master_low = (mock_sfr[base + 1] & mask) && !(mock_sfr[base + 2] & mask);
+
+    return !(master_low || hold);
+}
+
+// The next bit of a read goes out while SCL is low
+static void i2c_put_bit(void) {
+    i2c_hold_sda = !(i2c_shift & (0x80 >> i2c_bit));
+}
+
+// Falling edge after the eighth bit, the slave answers in the ACK slot
+static void i2c_byte_done(void) {
+    switch (i2c_phase) {
+        case(I2C_ADDR):
+            i2c_sel = i2c_find(i2c_shift >> 1);
+            i2c_written = 0;
+            i2c_acked = true;
+            if (!i2c_sel) i2c_phase = I2C_DEAD;
+            else i2c_phase = (i2c_shift & 1) ? I2C_READ : I2C_WRITE;
+            i2c_hold_sda = (i2c_sel != NULL);
+            break;
+        case(I2C_WRITE):
+            if (i2c_sel->write) i2c_sel->write(i2c_written, i2c_shift);
+            if (i2c_written++ == 0) i2c_sel->ptr = i2c_shift;
+            else i2c_sel->reg[i2c_sel->ptr++] = i2c_shift;
+            i2c_hold_sda = !(i2c_sel->nack_after && i2c_written >= i2c_sel->nack_after);
+            if (!i2c_hold_sda) i2c_phase = I2C_DEAD;
+            break;
+        default:
+            i2c_hold_sda = false;       /*The master ACKs a read*/
+            break;
+    }
+}
+
+// Falling edge after the ACK slot
+static void i2c_ack_done(void) {
+    i2c_bit = 0;
+    i2c_hold_sda = false;
+    if (i2c_phase == I2C_READ) {
+        if (i2c_acked) {
+            i2c_shift = i2c_sel->reg[i2c_sel->ptr++];
+            i2c_put_bit();
+        }
+        else i2c_phase = I2C_DEAD;
+    }
+    if (i2c_phase != I2C_DEAD && mock_i2c_stretch_us) {
+        i2c_hold_scl = true;
+        i2c_stretch_left = (uint32_t)mock_i2c_stretch_us * (F_CPU / 1000000UL);
+    }
+}
+
+static void i2c_update(void) {
+    bool sda = i2c_line(i2c_sda_port, i2c_sda_mask, i2c_hold_sda);
+    bool scl = i2c_line(i2c_scl_port, i2c_scl_mask, i2c_hold_scl);
+
+    if (scl != i2c_scl) {
+        if (i2c_phase != I2C_IDLE) {
+            if (!mock_i2c_min_half || mock_cycles - i2c_edge_at < mock_i2c_min_half) {
+                mock_i2c_min_half = (uint32_t)(mock_cycles - i2c_edge_at);
+            }
+        }
+        i2c_edge_at = mock_cycles;
+    }
+
+    if (scl && i2c_scl && sda != i2c_sda) {
+        // SDA moving with SCL high is a START or a STOP
+        if (!sda) {
+            mock_i2c_starts++;
+            i2c_phase = I2C_ADDR;
+            i2c_bit = 0;
+            i2c_shift = 0;
+        }
+        else {
+            mock_i2c_stops++;
+            i2c_phase = I2C_IDLE;
+        }
+        i2c_hold_sda = false;
+    }
+    else if (scl && !i2c_scl && i2c_phase != I2C_IDLE) {
+        if (i2c_bit < 8 && (i2c_phase == I2C_ADDR || i2c_phase == I2C_WRITE)) {
+            i2c_shift = (i2c_shift << 1) | sda;
+        }
+        if (i2c_bit == 8 && i2c_phase == I2C_READ) i2c_acked = !sda;
+        i2c_bit++;
+    }
+    else if (!scl && i2c_scl && i2c_phase != I2C_IDLE) {
+        if (i2c_bit == 8) i2c_byte_done();
+        else if (i2c_bit == 9) i2c_ack_done();
+        else if (i2c_phase == I2C_READ && i2c_bit > 0) i2c_put_bit();
+    }
+
+    i2c_sda = i2c_line(i2c_sda_port, i2c_sda_mask, i2c_hold_sda);
+    i2c_scl = i2c_line(i2c_scl_port, i2c_scl_mask, i2c_hold_scl);
+    mock_pin_drive(i2c_sda_port, i2c_sda_mask, i2c_hold_sda ? 0 : i2c_sda_mask);
+    mock_pin_drive(i2c_scl_port, i2c_scl_mask, i2c_hold_scl ? 0 : i2c_scl_mask);
+}
+
+static void i2c_ddr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    (void)addr;
+    if (val != old) i2c_update();
+}
+
+// Puts the slaves on two pins, which have to be free of other models
+void mock_i2c_bus(mock_port_t sda_port, uint8_t sda_mask, mock_port_t scl_port, uint8_t scl_mask) {
+    i2c_sda_port = sda_port;
+    i2c_sda_mask = sda_mask;
+    i2c_scl_port = scl_port;
+    i2c_scl_mask = scl_mask;
+    i2c_on = true;
+    i2c_sda = i2c_scl = true;
+    mock_hook(MOCK_PIN_ADDR(sda_port) + 1, NULL, i2c_ddr_wr);
+    mock_hook(MOCK_PIN_ADDR(scl_port) + 1, NULL, i2c_ddr_wr);
+    i2c_update();
+}
+
+// Holds SDA low until SCL has been pulsed, as a slave cut off mid-read does
+void mock_i2c_jam(void) {
+    i2c_phase = I2C_READ;
+    i2c_sel = NULL;
+    i2c_acked = false;
+    i2c_bit = 1;
+    i2c_shift = 0x00;
+    i2c_hold_sda = true;
+    i2c_sda = false;            /*Not a START*/
+    i2c_update();
+}
+
+void mock_i2c_tick(uint32_t cycles, uint8_t clk) {
+    (void)clk;
+    if (!i2c_on || !i2c_stretch_left) return;
+
+    if (cycles < i2c_stretch_left) {
+        i2c_stretch_left -= cycles;
+        return;
+    }
+    i2c_stretch_left = 0;
+    i2c_hold_scl = false;
+    i2c_update();
+}
+
+void mock_i2c_reset(void) {
+    uint8_t i;
+
+    for (i = 0; i < MOCK_TWI_SLAVES; i++) i2c_slaves[i] = NULL;
+    i2c_sel = NULL;
+    i2c_on = false;
+    i2c_phase = I2C_IDLE;
+    i2c_hold_sda = i2c_hold_scl = false;
+    i2c_stretch_left = 0;
+    mock_i2c_stretch_us = 0;
+    mock_i2c_starts = 0;
+    mock_i2c_stops = 0;
+    mock_i2c_min_half = 0;
+}
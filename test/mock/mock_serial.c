@@ -0,0 +1,163 @@
+/***********************************************************************
+* Host register mock, serial line on two port pins                     *
+* Purpose: Decode 8N1 frames the firmware sends by toggling an output  *
+*          pin and clock bytes into an input pin at a set baud rate    *
+*                                                                      *
+* TX edges are stamped when PORTx is written. Each edge in a frame is  *
+* held against where it belongs, a whole number of bits after the      *
+* start edge, and mock_serial_skew keeps the worst miss in cycles. The *
+* frame is sampled mid-bit as a receiver would. Bytes for the RX pin   *
+* go out back to back, edges move on the model's tick.                 *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+#define MOCK_PIN_ADDR(port) ((uint8_t)(0x23 + 3 * (port)))
+#define SERIAL_RX_QUEUE 64
+
+uint8_t mock_serial_out[MOCK_SERIAL_OUT_SIZE];
+uint16_t mock_serial_out_len = 0;
+uint16_t mock_serial_frame_errors = 0;
+uint32_t mock_serial_skew = 0;
+
+static bool serial_on = false;
+static uint32_t serial_baud;
+static mock_port_t serial_tx_port, serial_rx_port;
+static uint8_t serial_tx_mask, serial_rx_mask;
+
+// Firmware to host
+static bool serial_tx_level;
+static bool serial_tx_frame = false;
+static uint64_t serial_tx_t0;           /*Start edge*/
+static uint8_t serial_tx_bit;           /*Next bit to sample, 0 the start bit*/
+static uint16_t serial_tx_shift;
+
+// Host to firmware
+static uint8_t serial_rx_queue[SERIAL_RX_QUEUE];
+static uint8_t serial_rx_head = 0, serial_rx_tail = 0;
+static bool serial_rx_frame = false;
+static uint64_t serial_rx_t0;
+static uint8_t serial_rx_bit;           /*Next bit to put on the pin*/
+
+// CPU cycles run at the clock CLKPR selects, the line keeps real time
+static uint64_t serial_hz(void) {
+    return F_CPU >> (CLKPR & 0x0F);
+}
+
+// Cycle of bit n's leading edge, half = true for its middle
+static uint64_t serial_at(uint64_t t0, uint8_t n, bool half) {
+    uint64_t num = (uint64_t)n * 2 + (half ? 1 : 0);
+    return t0 + (num * serial_hz() + serial_baud) / (2 * serial_baud);
+}
+
+static bool serial_tx_pin(void) {
+    uint8_t base = MOCK_PIN_ADDR(serial_tx_port);
+    return !(mock_sfr[base + 1] & serial_tx_mask) || (mock_sfr[base + 2] & serial_tx_mask);
+}
+
+static void serial_port_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    bool level = serial_tx_pin();
+    uint64_t k, edge, miss;
+
+    (void)addr;
+    if (val == old || level == serial_tx_level) return;
+    serial_tx_level = level;
+
+    if (!serial_tx_frame) {
+        if (level) return;
+        serial_tx_frame = true;
+        serial_tx_t0 = mock_cycles;
+        serial_tx_bit = 0;
+        serial_tx_shift = 0;
+        return;
+    }
+    k = ((mock_cycles - serial_tx_t0) * serial_baud * 2 + serial_hz()) / (2 * serial_hz());
+    edge = serial_at(serial_tx_t0, (uint8_t)k, false);
+    miss = (mock_cycles > edge) ? mock_cycles - edge : edge - mock_cycles;
+    if (miss > mock_serial_skew) mock_serial_skew = (uint32_t)miss;
+}
+
+static void serial_tx_tick(void) {
+    while (serial_tx_frame && mock_cycles >= serial_at(serial_tx_t0, serial_tx_bit, true)) {
+        serial_tx_shift |= (uint16_t)serial_tx_level << serial_tx_bit;
+        if (++serial_tx_bit < 10) continue;
+
+        serial_tx_frame = false;
+        if (serial_tx_shift & 1) mock_serial_frame_errors++;           /*Start bit gone high*/
+        if (!(serial_tx_shift & 0x200)) mock_serial_frame_errors++;    /*Stop bit low*/
+        if (mock_serial_out_len < MOCK_SERIAL_OUT_SIZE) {
+            mock_serial_out[mock_serial_out_len++] = (uint8_t)(serial_tx_shift >> 1);
+        }
+    }
+}
+
+static void serial_rx_tick(void) {
+    uint8_t b;
+
+    while (true) {
+        if (!serial_rx_frame) {
+            if (serial_rx_head == serial_rx_tail) return;
+            serial_rx_frame = true;
+            serial_rx_bit = 0;
+        }
+        if (mock_cycles < serial_at(serial_rx_t0, serial_rx_bit, false)) return;
+
+        b = serial_rx_queue[serial_rx_tail];
+        if (serial_rx_bit == 0) mock_pin_drive(serial_rx_port, serial_rx_mask, 0);
+        else if (serial_rx_bit <= 8) {
+            mock_pin_drive(serial_rx_port, serial_rx_mask, ((b >> (serial_rx_bit - 1)) & 1) ? serial_rx_mask : 0);
+        }
+        else if (serial_rx_bit == 9) mock_pin_drive(serial_rx_port, serial_rx_mask, serial_rx_mask);
+        else {
+            // The next start bit follows the stop bit directly
+            serial_rx_tail = (serial_rx_tail + 1) % SERIAL_RX_QUEUE;
+            serial_rx_t0 = serial_at(serial_rx_t0, 10, false);
+            serial_rx_frame = false;
+            continue;
+        }
+        serial_rx_bit++;
+    }
+}
+
+// Puts the line on two pins. baud is the host's side, set it off the
+// firmware's to check how much error the receiver takes.
+void mock_serial_line(mock_port_t tx_port, uint8_t tx_mask, mock_port_t rx_port, uint8_t rx_mask, uint32_t baud) {
+    serial_on = true;
+    serial_baud = baud;
+    serial_tx_port = tx_port;
+    serial_tx_mask = tx_mask;
+    serial_rx_port = rx_port;
+    serial_rx_mask = rx_mask;
+    serial_tx_level = serial_tx_pin();
+    mock_hook(MOCK_PIN_ADDR(tx_port) + 1, NULL, serial_port_wr);
+    mock_hook(MOCK_PIN_ADDR(tx_port) + 2, NULL, serial_port_wr);
+    mock_pin_drive(rx_port, rx_mask, rx_mask);
+}
+
+void mock_serial_rx(uint8_t b) {
+    uint8_t next = (serial_rx_head + 1) % SERIAL_RX_QUEUE;
+
+    if (next == serial_rx_tail) mock_fail("serial RX queue full");
+    if (serial_rx_head == serial_rx_tail && !serial_rx_frame) serial_rx_t0 = mock_cycles;
+    serial_rx_queue[serial_rx_head] = b;
+    serial_rx_head = next;
+}
+
+void mock_serial_tick(uint32_t cycles, uint8_t clk) {
+    (void)cycles;
+    (void)clk;
+    if (!serial_on) return;
+    serial_tx_tick();
+    serial_rx_tick();
+}
+
+void mock_serial_reset(void) {
+    serial_on = false;
+    serial_tx_frame = false;
+    serial_rx_frame = false;
+    serial_rx_head = serial_rx_tail = 0;
+    mock_serial_out_len = 0;
+    mock_serial_frame_errors = 0;
+    mock_serial_skew = 0;
+}
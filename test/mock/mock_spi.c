@@ -0,0 +1,90 @@
+/***********************************************************************
+* Host register mock, SPI master model                                 *
+* Purpose: Shift a byte out of SPDR in 8 SCK periods, set SPIF and     *
+*          present the slave's answer, recording each byte sent        *
+*                                                                      *
+* SPDR is a shift register with a read buffer on the chip. A read      *
+* presents the last byte received; an access is taken as a write      *
+* unless a received byte is unread and the access left it unchanged,  *
+* so drivers read SPDR before writing the next byte. Any SPDR access   *
+* clears SPIF and WCOL. Slave mode is not modelled.                    *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+mock_spi_byte_t mock_spi_out[MOCK_SPI_OUT_SIZE];
+uint16_t mock_spi_out_len = 0;
+uint8_t (*mock_spi_reply)(uint8_t mosi) = NULL;
+
+static uint32_t spi_left = 0;       /*Cycles until SPIF*/
+static uint8_t spi_shift;           /*Slave byte coming in*/
+static uint8_t spi_rdr;
+static bool spi_unread = false;
+
+// SCK divider from SPI2X:SPR1:SPR0, datasheet table 19-5
+static uint32_t spi_byte_cycles(void) {
+    static const uint8_t div[8] = {4, 16, 64, 128, 2, 8, 32, 64};
+
+    return 8UL * div[((SPSR & (1 << SPI2X)) << 2) | (SPCR & 0x03)];
+}
+
+static void spi_spdr_rd(uint8_t addr) {
+    mock_sfr[addr] = spi_rdr;
+}
+
+static void spi_spdr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    mock_spi_byte_t* b;
+
+    SPSR &= ~((1 << SPIF) | (1 << WCOL));
+    if (spi_unread && val == old) {
+        spi_unread = false;
+        return;
+    }
+    mock_sfr[addr] = spi_rdr;
+    if ((SPCR & ((1 << SPE) | (1 << MSTR))) != ((1 << SPE) | (1 << MSTR)) || (PRR & (1 << PRSPI))) return;
+    if (spi_left) {
+        SPSR |= (1 << WCOL);    /*Written mid byte, ignored as on the chip*/
+        return;
+    }
+
+    if (mock_spi_out_len < MOCK_SPI_OUT_SIZE) {
+        b = &mock_spi_out[mock_spi_out_len++];
+        b->mosi = val;
+        b->spcr = SPCR;
+        b->spsr = SPSR;
+        b->portb = PORTB;
+        b->portc = PORTC;
+        b->portd = PORTD;
+    }
+    spi_shift = mock_spi_reply ? mock_spi_reply(val) : 0xFF;
+    spi_unread = false;
+    spi_left = spi_byte_cycles();
+}
+
+void mock_spi_tick(uint32_t cycles, uint8_t clk) {
+    if (spi_left == 0 || !(clk & MOCK_CLK_IO) || (PRR & (1 << PRSPI))) return;
+    if (!(SPCR & (1 << SPE))) {
+        spi_left = 0;
+        return;
+    }
+
+    if (cycles < spi_left) {
+        spi_left -= cycles;
+        return;
+    }
+    spi_left = 0;
+    spi_rdr = spi_shift;
+    spi_unread = true;
+    SPDR = spi_rdr;
+    SPSR |= (1 << SPIF);
+}
+
+void mock_spi_reset(void) {
+    mock_spi_out_len = 0;
+    mock_spi_reply = NULL;
+    spi_left = 0;
+    spi_rdr = 0;
+    spi_unread = false;
+    mock_hook(MOCK_ADDR(SPDR), spi_spdr_rd, spi_spdr_wr);
+}
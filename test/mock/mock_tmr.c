@@ -0,0 +1,155 @@
+/***********************************************************************
+* Host register mock, Timer/Counter0/1/2 model                         *
+* Purpose: Count TCNTn at the selected prescaler and raise the compare *
+*          and overflow flags, plus input capture on ICP1              *
+*                                                                      *
+* Compare matches set their flag as TCNTn moves past OCRnx and the     *
+* counter clears on the same step, a cycle early next to the hardware. *
+* Output compare pins are not modelled.                                *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+// Timer0/1 share the prescaler table, Timer2 has its own
+static const uint16_t tmr_div01[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+static const uint16_t tmr_div2[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+typedef struct tmr8 {
+    volatile uint8_t* tccra;
+    volatile uint8_t* tccrb;
+    volatile uint8_t* tcnt;
+    volatile uint8_t* ocra;
+    volatile uint8_t* ocrb;
+    volatile uint8_t* tifr;
+    uint8_t prr;
+    uint8_t clk;
+    const uint16_t* div;
+    uint32_t acc;
+} tmr8_t;
+
+static tmr8_t tmr0 = {&TCCR0A, &TCCR0B, &TCNT0, &OCR0A, &OCR0B, &TIFR0, PRTIM0, MOCK_CLK_IO, tmr_div01, 0};
+static tmr8_t tmr2 = {&TCCR2A, &TCCR2B, &TCNT2, &OCR2A, &OCR2B, &TIFR2, PRTIM2, MOCK_CLK_ASY, tmr_div2, 0};
+
+static uint32_t tmr1_acc = 0;
+static bool tmr1_down = false;  /*Dual slope direction*/
+
+/************************** 8-bit Timer Stuff *************************/
+
+// WGM 2 and 7 count to OCRnA, the rest to 0xFF (phase correct is counted single slope)
+static void tmr8_count(tmr8_t* t) {
+    uint8_t wgm = (*t->tccra & 0x03) | ((*t->tccrb >> 1) & 0x04);
+    uint8_t top = (wgm == 2 || wgm == 7) ? *t->ocra : 0xFF;
+    uint8_t cnt = *t->tcnt;
+
+    if (cnt == *t->ocra) *t->tifr |= (1 << 1);  /*OCFnA*/
+    if (cnt == *t->ocrb) *t->tifr |= (1 << 2);  /*OCFnB*/
+    if (cnt == top) {
+        *t->tcnt = 0;
+        if (top == 0xFF || wgm == 7) *t->tifr |= (1 << 0);     /*TOVn, fast PWM at TOP*/
+    }
+    else {
+        *t->tcnt = cnt + 1;
+    }
+}
+
+static void tmr8_tick(tmr8_t* t, uint32_t cycles, uint8_t clk) {
+    uint16_t div = t->div[*t->tccrb & 0x07];
+
+    if (div == 0 || !(clk & t->clk) || (PRR & (1 << t->prr))) return;
+    t->acc += cycles;
+    while (t->acc >= div) {
+        t->acc -= div;
+        tmr8_count(t);
+    }
+}
+
+// Writing one clears a flag. A flag already set and written again looks
+// the same as a read and is left alone, the vector clears it anyway.
+static void tmr_tifr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    mock_sfr[addr] = (val == old) ? old : (old & ~val);
+}
+
+/************************** 16-bit Timer Stuff ************************/
+
+static uint16_t tmr1_top(uint8_t wgm) {
+    switch (wgm) {
+        case(4): case(9): case(11): case(15):
+            return OCR1A;
+        case(8): case(10): case(12): case(14):
+            return ICR1;
+        case(1): case(5):
+            return 0x00FF;
+        case(2): case(6):
+            return 0x01FF;
+        case(3): case(7):
+            return 0x03FF;
+        default:
+            return 0xFFFF;
+    }
+}
+
+static void tmr1_count(void) {
+    uint8_t wgm = (TCCR1A & 0x03) | ((TCCR1B >> 1) & 0x0C);
+    uint16_t top = tmr1_top(wgm);
+    uint16_t cnt = TCNT1;
+    bool dual = (wgm >= 1 && wgm <= 3) || (wgm >= 8 && wgm <= 11);
+
+    if (cnt == OCR1A) TIFR1 |= (1 << OCF1A);
+    if (cnt == OCR1B) TIFR1 |= (1 << OCF1B);
+    if (cnt == top && (wgm == 12 || wgm == 14 || wgm == 8 || wgm == 10)) TIFR1 |= (1 << ICF1);
+
+    if (dual) {
+        if (cnt >= top) tmr1_down = true;
+        if (tmr1_down && cnt == 0) {
+            tmr1_down = false;
+            TIFR1 |= (1 << TOV1);
+        }
+        TCNT1 = tmr1_down ? cnt - 1 : cnt + 1;
+        return;
+    }
+    if (cnt == top) {
+        TCNT1 = 0;
+        if (top == 0xFFFF || wgm >= 5) TIFR1 |= (1 << TOV1);
+    }
+    else {
+        TCNT1 = cnt + 1;
+    }
+}
+
+static void tmr1_tick(uint32_t cycles, uint8_t clk) {
+    uint16_t div = tmr_div01[TCCR1B & 0x07];
+
+    if (div == 0 || !(clk & MOCK_CLK_IO) || (PRR & (1 << PRTIM1))) return;
+    tmr1_acc += cycles;
+    while (tmr1_acc >= div) {
+        tmr1_acc -= div;
+        tmr1_count();
+    }
+}
+
+// Latches TCNT1 into ICR1 if the edge matches ICES1
+void mock_icp_edge(bool rising) {
+    mock_sync();
+    if (rising != ((TCCR1B >> ICES1) & 1)) return;
+    ICR1 = TCNT1;
+    TIFR1 |= (1 << ICF1);
+}
+
+/**************************** Timer Model *****************************/
+
+void mock_tmr_tick(uint32_t cycles, uint8_t clk) {
+    tmr8_tick(&tmr0, cycles, clk);
+    tmr1_tick(cycles, clk);
+    tmr8_tick(&tmr2, cycles, clk);
+}
+
+void mock_tmr_reset(void) {
+    tmr0.acc = 0;
+    tmr2.acc = 0;
+    tmr1_acc = 0;
+    tmr1_down = false;
+    mock_hook(MOCK_ADDR(TIFR0), NULL, tmr_tifr_wr);
+    mock_hook(MOCK_ADDR(TIFR1), NULL, tmr_tifr_wr);
+    mock_hook(MOCK_ADDR(TIFR2), NULL, tmr_tifr_wr);
+}
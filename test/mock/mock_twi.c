@@ -0,0 +1,178 @@
+/***********************************************************************
+* Host register mock, TWI master model                                 *
+* Purpose: Walk the master transmitter/receiver states of the TWI,     *
+*          report them in TWSR and TWINT after the bus time of each    *
+*          step and route the bytes to register file slaves            *
+*                                                                      *
+* An access to TWCR that leaves TWINT set counts as writing it one,    *
+* which is how every bus command is issued. Bus arbitration, slave     *
+* mode and clock stretching are not modelled, mock_twi_hung stands in  *
+* for a slave that never lets SCL go.                                  *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+typedef enum twi_phase {
+    TWI_IDLE,
+    TWI_ADDR,       /*START sent, SLA+R/W next*/
+    TWI_MT,         /*Master transmitter*/
+    TWI_MR,         /*Master receiver*/
+    TWI_DEAD        /*Addressed nobody, waiting for STOP*/
+} twi_phase_t;
+
+uint8_t mock_twi_log[MOCK_TWI_LOG];
+uint8_t mock_twi_log_len = 0;
+bool mock_twi_hung = false;
+
+static mock_twi_slave_t* twi_slaves[MOCK_TWI_SLAVES];
+static mock_twi_slave_t* twi_sel = NULL;
+static twi_phase_t twi_phase = TWI_IDLE;
+static bool twi_owned = false;
+static uint16_t twi_written = 0;    /*Bytes since SLA+W, the first is the pointer*/
+static uint8_t twi_status;
+static uint8_t twi_rx;
+static uint32_t twi_left = 0;       /*Cycles until TWINT*/
+static uint32_t twi_stop_left = 0;  /*Cycles until TWSTO clears*/
+
+// SCL period in CPU cycles, datasheet eqn 22-1
+static uint32_t twi_scl_cycles(void) {
+    return 16UL + 2UL * TWBR * (1UL << (2 * (TWSR & 0x03)));
+}
+
+void mock_twi_attach(mock_twi_slave_t* slave) {
+    uint8_t i;
+
+    for (i = 0; i < MOCK_TWI_SLAVES; i++) {
+        if (twi_slaves[i] == NULL) {
+            twi_slaves[i] = slave;
+            return;
+        }
+    }
+    mock_fail("too many TWI slaves");
+}
+
+static mock_twi_slave_t* twi_find(uint8_t addr) {
+    uint8_t i;
+
+    for (i = 0; i < MOCK_TWI_SLAVES; i++) {
+        if (twi_slaves[i] && twi_slaves[i]->addr == addr) return twi_slaves[i];
+    }
+    return NULL;
+}
+
+// One byte on the bus after SLA, as master transmitter or receiver
+static void twi_byte(uint8_t twcr) {
+    uint8_t b;
+
+    switch (twi_phase) {
+        case(TWI_ADDR):
+            b = TWDR;
+            twi_sel = twi_find(b >> 1);
+            twi_written = 0;
+            if (b & 1) {
+                twi_status = twi_sel ? 0x40 : 0x48;
+                twi_phase = twi_sel ? TWI_MR : TWI_DEAD;
+            }
+            else {
+                twi_status = twi_sel ? 0x18 : 0x20;
+                twi_phase = twi_sel ? TWI_MT : TWI_DEAD;
+            }
+            break;
+        case(TWI_MT):
+            b = TWDR;
+            if (twi_sel->write) twi_sel->write(twi_written, b);
+            if (twi_written++ == 0) twi_sel->ptr = b;
+            else twi_sel->reg[twi_sel->ptr++] = b;
+            twi_status = (twi_sel->nack_after && twi_written >= twi_sel->nack_after) ? 0x30 : 0x28;
+            break;
+        case(TWI_MR):
+            twi_rx = twi_sel->reg[twi_sel->ptr++];
+            twi_status = (twcr & (1 << TWEA)) ? 0x50 : 0x58;
+            break;
+        default:
+            twi_status = 0x00;  /*Bus error*/
+            break;
+    }
+    twi_left = 9UL * twi_scl_cycles();
+}
+
+static void twi_twcr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    if (!(val & (1 << TWEN))) {
+        mock_sfr[addr] = val & ~(1 << TWINT);
+        twi_phase = TWI_IDLE;
+        twi_owned = false;
+        twi_left = 0;
+        twi_stop_left = 0;
+        return;
+    }
+
+    // Writing zero to TWINT leaves it as it was, TWSTO only clears itself
+    if (twi_stop_left) val |= (1 << TWSTO);
+    if (!(val & (1 << TWINT)) || (PRR & (1 << PRTWI))) {
+        mock_sfr[addr] = (val & ~(1 << TWINT)) | (old & (1 << TWINT));
+        return;
+    }
+    mock_sfr[addr] = val & ~(1 << TWINT);
+
+    if (val & (1 << TWSTA)) {
+        twi_status = twi_owned ? 0x10 : 0x08;
+        twi_owned = true;
+        twi_phase = TWI_ADDR;
+        twi_left = twi_scl_cycles();
+    }
+    else if (val & (1 << TWSTO)) {
+        twi_owned = false;
+        twi_phase = TWI_IDLE;
+        twi_left = 0;
+        twi_stop_left = twi_scl_cycles();
+    }
+    else {
+        twi_byte(val);
+    }
+}
+
+// Status bits are read only, only the prescaler can be written
+static void twi_twsr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    mock_sfr[addr] = (old & 0xF8) | (val & 0x03);
+}
+
+void mock_twi_tick(uint32_t cycles, uint8_t clk) {
+    if (!(clk & MOCK_CLK_IO) || (PRR & (1 << PRTWI)) || mock_twi_hung) return;
+
+    if (twi_stop_left) {
+        if (cycles < twi_stop_left) twi_stop_left -= cycles;
+        else {
+            twi_stop_left = 0;
+            TWCR &= ~(1 << TWSTO);
+        }
+    }
+    if (twi_left) {
+        if (cycles < twi_left) twi_left -= cycles;
+        else {
+            twi_left = 0;
+            if (twi_phase == TWI_MR && twi_status >= 0x50) TWDR = twi_rx;
+            TWSR = twi_status | (TWSR & 0x03);
+            if (mock_twi_log_len < MOCK_TWI_LOG) mock_twi_log[mock_twi_log_len++] = twi_status;
+            TWCR |= (1 << TWINT);
+        }
+    }
+}
+
+void mock_twi_reset(void) {
+    uint8_t i;
+
+    for (i = 0; i < MOCK_TWI_SLAVES; i++) twi_slaves[i] = NULL;
+    twi_sel = NULL;
+    twi_phase = TWI_IDLE;
+    twi_owned = false;
+    twi_left = 0;
+    twi_stop_left = 0;
+    mock_twi_log_len = 0;
+    mock_twi_hung = false;
+    TWSR = 0xF8;
+    TWDR = 0xFF;
+    TWBR = 0x00;
+    mock_hook(MOCK_ADDR(TWCR), NULL, twi_twcr_wr);
+    mock_hook(MOCK_ADDR(TWSR), NULL, twi_twsr_wr);
+}
@@ -0,0 +1,100 @@
+/***********************************************************************
+* Host register mock, USART0 model                                     *
+* Purpose: Shift bytes out at the programmed baud rate with the double *
+*          buffered UDRE0/TXC0 handshake and feed bytes in on RXC0     *
+*                                                                      *
+* UDR0 is two registers on the chip. A read presents the received      *
+* byte; an access is taken as a write unless a received byte is        *
+* waiting and the access left it unchanged.                            *
+***********************************************************************/
+
+#define MOCK_RAW
+#include "mock.h"
+
+uint8_t mock_uart_out[MOCK_UART_OUT_SIZE];
+uint16_t mock_uart_out_len = 0;
+
+static uint32_t uart_shift_left = 0;    /*Cycles until the shift register is empty*/
+static uint8_t uart_shift;
+static uint8_t uart_tdr;                /*Waiting behind the shift register*/
+static uint8_t uart_rdr;
+
+// Start, data, parity and stop bits times the bit period
+static uint32_t uart_frame_cycles(void) {
+    uint8_t bits = 1 + 5 + ((UCSR0C >> UCSZ00) & 0x03);
+    uint32_t bit = ((UCSR0A & (1 << U2X0)) ? 8UL : 16UL) * ((UBRR0 & 0x0FFF) + 1UL);
+
+    if (UCSR0C & (1 << UPM01)) bits++;
+    bits += (UCSR0C & (1 << USBS0)) ? 2 : 1;
+    return bits * bit;
+}
+
+static void uart_udr_rd(uint8_t addr) {
+    mock_sfr[addr] = uart_rdr;
+}
+
+static void uart_udr_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    if ((UCSR0A & (1 << RXC0)) && val == old) {
+        UCSR0A &= ~((1 << RXC0) | (1 << DOR0));
+        return;
+    }
+    mock_sfr[addr] = uart_rdr;
+    if (!(UCSR0B & (1 << TXEN0)) || (PRR & (1 << PRUSART0))) return;
+    if (!(UCSR0A & (1 << UDRE0))) return;   /*Ignored, as on the chip*/
+
+    if (uart_shift_left == 0) {
+        uart_shift = val;
+        uart_shift_left = uart_frame_cycles();
+    }
+    else {
+        uart_tdr = val;
+        UCSR0A &= ~(1 << UDRE0);
+    }
+}
+
+// Status bits are read only apart from U2X0, MPCM0 and TXC0 (write one to clear)
+static void uart_ucsra_wr(uint8_t addr, uint8_t old, uint8_t val) {
+    uint8_t ro = (1 << RXC0) | (1 << UDRE0) | (1 << FE0) | (1 << DOR0) | (1 << UPE0);
+    uint8_t txc = old & (1 << TXC0);
+
+    if (val != old && (val & (1 << TXC0))) txc = 0;
+    mock_sfr[addr] = (old & ro) | txc | (val & ((1 << U2X0) | (1 << MPCM0)));
+}
+
+void mock_uart_rx(uint8_t b) {
+    mock_sync();
+    if (!(UCSR0B & (1 << RXEN0))) return;
+    if (UCSR0A & (1 << RXC0)) UCSR0A |= (1 << DOR0);
+    uart_rdr = b;
+    UCSR0A |= (1 << RXC0);
+}
+
+void mock_uart_tick(uint32_t cycles, uint8_t clk) {
+    if (uart_shift_left == 0 || !(clk & MOCK_CLK_IO) || (PRR & (1 << PRUSART0))) return;
+
+    if (cycles < uart_shift_left) {
+        uart_shift_left -= cycles;
+        return;
+    }
+    if (mock_uart_out_len < MOCK_UART_OUT_SIZE) mock_uart_out[mock_uart_out_len++] = uart_shift;
+
+    if (!(UCSR0A & (1 << UDRE0))) {
+        uart_shift = uart_tdr;
+        uart_shift_left = uart_frame_cycles();
+        UCSR0A |= (1 << UDRE0);
+    }
+    else {
+        uart_shift_left = 0;
+        UCSR0A |= (1 << TXC0);
+    }
+}
+
+void mock_uart_reset(void) {
+    mock_uart_out_len = 0;
+    uart_shift_left = 0;
+    uart_rdr = 0;
+    UCSR0A = (1 << UDRE0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    mock_hook(MOCK_ADDR(UDR0), uart_udr_rd, uart_udr_wr);
+    mock_hook(MOCK_ADDR(UCSR0A), NULL, uart_ucsra_wr);
+}
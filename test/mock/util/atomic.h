@@ -0,0 +1,35 @@
+/***********************************************************************
+* Host mock of <util/atomic.h>                                         *
+* Purpose: Same save/cli/restore shape as avr-libc, applied to the     *
+*          mocked SREG.                                                *
+***********************************************************************/
+
+#ifndef MOCK_UTIL_ATOMIC_H_
+#define MOCK_UTIL_ATOMIC_H_
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static __inline__ uint8_t __iCliRetVal(void) {
+    cli();
+    return 1;
+}
+
+static __inline__ uint8_t __iSeiRetVal(void) {
+    sei();
+    return 1;
+}
+
+static __inline__ void __iRestore(const uint8_t *__s) {
+    SREG = *__s;
+}
+
+#define ATOMIC_BLOCK(type) for (type, __ToDo = __iCliRetVal(); __ToDo; __ToDo = 0)
+#define NONATOMIC_BLOCK(type) for (type, __ToDo = __iSeiRetVal(); __ToDo; __ToDo = 0)
+
+#define ATOMIC_RESTORESTATE uint8_t sreg_save __attribute__((__cleanup__(__iRestore))) = SREG
+#define ATOMIC_FORCEON uint8_t sreg_save __attribute__((__unused__)) = 0
+#define NONATOMIC_RESTORESTATE ATOMIC_RESTORESTATE
+#define NONATOMIC_FORCEOFF uint8_t sreg_save __attribute__((__unused__)) = 0
+
+#endif /* MOCK_UTIL_ATOMIC_H_ */
@@ -0,0 +1,28 @@
+/***********************************************************************
+* Host mock of <util/crc16.h>                                          *
+* Purpose: The C equivalents avr-libc documents for its asm versions   *
+***********************************************************************/
+
+#ifndef MOCK_UTIL_CRC16_H_
+#define MOCK_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+static inline uint8_t _crc8_ccitt_update(uint8_t crc, uint8_t data) {
+    uint8_t i;
+
+    crc ^= data;
+    for (i = 0; i < 8; i++) {
+        if (crc & 0x80) crc = (crc << 1) ^ 0x07;
+        else crc <<= 1;
+    }
+    return crc;
+}
+
+static inline uint16_t _crc_ccitt_update(uint16_t crc, uint8_t data) {
+    data ^= (uint8_t)(crc & 0xFF);
+    data ^= data << 4;
+    return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+#endif
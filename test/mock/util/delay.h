@@ -0,0 +1,11 @@
+/***********************************************************************
+* Host mock of <util/delay.h>                                          *
+* Purpose: Busy waits advance simulated time instead of spinning       *
+***********************************************************************/
+
+#ifndef MOCK_UTIL_DELAY_H_
+#define MOCK_UTIL_DELAY_H_
+void mock_delay_us(double us);
+#define _delay_us(us) mock_delay_us(us)
+#define _delay_ms(ms) mock_delay_us((ms) * 1000.0)
+#endif
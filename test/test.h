@@ -0,0 +1,69 @@
+/***********************************************************************
+* Host unit test helpers                                               *
+* Purpose: Minimal check macros for the suites in test/, every test    *
+*          starts from a freshly reset register mock                   *
+***********************************************************************/
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include "mock.h"
+#include "pwr.h"
+#include "systick.h"
+
+extern unsigned test_checks;
+extern unsigned test_failures;
+
+#define CHECK(cond) do { \
+    test_checks++; \
+    if (!(cond)) { \
+        test_failures++; \
+        printf("    %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+    long long a_ = (long long)(a), b_ = (long long)(b); \
+    test_checks++; \
+    if (a_ != b_) { \
+        test_failures++; \
+        printf("    %s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #a, a_, b_); \
+    } \
+} while (0)
+
+#define RUN(test) do { \
+    printf("  %s\n", #test); \
+    mock_reset(); \
+    test(); \
+} while (0)
+
+// What main() does before any driver runs
+static inline void test_boot(void) {
+    pwr_init();
+    systick_init();
+    sei();
+}
+
+void test_ring(void);
+void test_fmt(void);
+void test_gpio(void);
+void test_uart(void);
+void test_adc(void);
+void test_twi(void);
+void test_mem(void);
+void test_ee(void);
+void test_log(void);
+void test_spi(void);
+void test_oled(void);
+void test_fix(void);
+void test_stats(void);
+void test_acomp(void);
+void test_clk(void);
+void test_cmd(void);
+void test_twi_soft(void);
+void test_suart(void);
+void test_irq(void);
+
+#endif //TEST_H_
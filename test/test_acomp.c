@@ -0,0 +1,199 @@
+/***********************************************************************
+* Analog comparator driver tests                                       *
+***********************************************************************/
+
+#include "test.h"
+#include "acomp.h"
+#include "adc.h"
+#include "tmr1.h"
+
+static void acomp_rejects_bad_config(void) {
+    test_boot();
+    CHECK_EQ(acomp_init(ACOMP_POS_BANDGAP + 1, ACOMP_NEG_AIN1, ACOMP_RISING, ACOMP_EVENT), ACOMP_INVALID_INPUT);
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, 8, ACOMP_RISING, ACOMP_EVENT), ACOMP_INVALID_INPUT);
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, 1, ACOMP_EVENT), ACOMP_INVALID_INPUT);
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, ACOMP_RISING, ACOMP_CAPTURE + 1), ACOMP_INVALID_ACTION);
+    // The ADC would convert its own multiplexer channel, not the comparator's
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ADC2, ACOMP_RISING, ACOMP_START_ADC), ACOMP_INVALID_ACTION);
+    CHECK(PRR & (1 << PRADC));
+}
+
+static void acomp_queues_rising_edges(void) {
+    acomp_event_t ev;
+    uint32_t before;
+
+    test_boot();
+    mock_ain_mv[1] = 2500;
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, ACOMP_RISING, ACOMP_EVENT), ACOMP_OK);
+    CHECK(!(PRR & (1 << PRADC)));
+    CHECK(DIDR1 & (1 << AIN0D));
+    CHECK(DIDR1 & (1 << AIN1D));
+    CHECK(!acomp_read(&ev));
+
+    mock_run_us(100);
+    before = systick_micros();
+    mock_ain_mv[0] = 2600;
+    mock_run_us(10);
+    CHECK(acomp_level());
+    CHECK(acomp_read(&ev));
+    CHECK(ev.high);
+    CHECK(ev.us - before <= 10);
+
+    // Falling crossings are not selected
+    mock_ain_mv[0] = 2400;
+    mock_run_us(10);
+    CHECK(!acomp_level());
+    CHECK(!acomp_read(&ev));
+
+    acomp_stop();
+    CHECK(ACSR & (1 << ACD));
+    CHECK(PRR & (1 << PRADC));
+    mock_ain_mv[0] = 2600;
+    mock_run_us(10);
+    CHECK(!acomp_read(&ev));
+}
+
+// Bandgap against ADC2 through the multiplexer, a falling edge is the
+// channel rising above 1.1 V
+static void acomp_bandgap_against_mux(void) {
+    acomp_event_t ev;
+    uint16_t v;
+
+    test_boot();
+    mock_adc_in[ADC2] = 100;                    /*~0.49 V*/
+    CHECK_EQ(acomp_init(ACOMP_POS_BANDGAP, ADC2, ACOMP_FALLING, ACOMP_EVENT), ACOMP_OK);
+    CHECK(ADCSRB & (1 << ACME));
+    CHECK(ACSR & (1 << ACBG));
+    CHECK(DIDR0 & (1 << ADC2D));
+    mock_run_us(10);
+    CHECK(acomp_level());
+    CHECK(!acomp_read(&ev));
+
+    mock_adc_in[ADC2] = 400;                    /*~1.96 V*/
+    mock_run_us(10);
+    CHECK(acomp_read(&ev));
+    CHECK(!ev.high);
+
+    // adc_read() borrows the multiplexer, the ADC is off again afterwards
+    mock_adc_in[ADC2] = 100;
+    mock_adc_in[ADC5] = 0x155;
+    CHECK_EQ(adc_read(ADC5, &v), ADC_OK);
+    CHECK_EQ(v, 0x155);
+    CHECK(!(PRR & (1 << PRADC)));
+
+    acomp_stop();
+    CHECK(!(ADCSRB & (1 << ACME)));
+    CHECK(!(DIDR0 & (1 << ADC2D)));
+    CHECK(PRR & (1 << PRADC));
+}
+
+// A buffer someone else turned off stays off after the comparator stops
+static void acomp_keeps_foreign_didr0(void) {
+    test_boot();
+    DIDR0 = (1 << ADC3D);
+    CHECK_EQ(acomp_init(ACOMP_POS_BANDGAP, ADC3, ACOMP_TOGGLE, ACOMP_EVENT), ACOMP_OK);
+    acomp_stop();
+    CHECK_EQ(DIDR0, 1 << ADC3D);
+}
+
+static void acomp_refuses_busy_mux(void) {
+    test_boot();
+    adc_init(ANALOG_VCC, FREE, ADC0, true);
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ADC1, ACOMP_TOGGLE, ACOMP_EVENT), ACOMP_ADC_BUSY);
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, ACOMP_TOGGLE, ACOMP_EVENT), ACOMP_OK);
+}
+
+static void acomp_counts_dropped_events(void) {
+    acomp_event_t ev;
+    acomp_stats_t s;
+    uint8_t i, n = 0;
+
+    test_boot();
+    mock_ain_mv[1] = 1000;
+    acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, ACOMP_TOGGLE, ACOMP_EVENT);
+    for (i = 0; i < 12; i++) {
+        mock_ain_mv[0] = (i & 1) ? 900 : 1100;
+        mock_run_us(5);
+    }
+
+    acomp_stats(&s);
+    CHECK_EQ(s.crossings, 12);
+    CHECK_EQ(s.dropped, 12 - (ACOMP_QUEUE_SIZE - 1));
+    while (acomp_read(&ev)) {
+        CHECK_EQ(ev.high, !(n & 1));
+        n++;
+    }
+    CHECK_EQ(n, ACOMP_QUEUE_SIZE - 1);
+}
+
+// The crossing starts the conversion, the result is there ~13 ADC clocks later
+static void acomp_starts_adc(void) {
+    acomp_event_t ev;
+    uint16_t v;
+    adc_stats_t s;
+
+    test_boot();
+    mock_ain_mv[1] = 2000;
+    mock_adc_in[ADC3] = 0x123;
+    adc_init(ANALOG_VCC, AIN, ADC3, true);
+    mock_run_us(300);
+    adc_result(&v);                             /*The conversion ADSC started*/
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, ACOMP_RISING, ACOMP_START_ADC), ACOMP_OK);
+
+    mock_run_us(500);
+    CHECK(!adc_result(&v));
+
+    mock_adc_in[ADC3] = 0x2B4;
+    mock_ain_mv[0] = 2100;
+    mock_run_us(5);
+    CHECK(acomp_read(&ev));
+    CHECK(!adc_result(&v));
+    mock_run_us(13UL * 128UL * 1000000UL / F_CPU + 5);
+    CHECK(adc_result(&v));
+    CHECK_EQ(v, 0x2B4);
+
+    adc_stats(&s);
+    CHECK_EQ(s.conversions, 2);
+    CHECK_EQ(s.missed, 0);
+}
+
+// ACIC hands the output to Timer1, the comparator interrupt stays off
+static void acomp_feeds_input_capture(void) {
+    acomp_event_t ev;
+    tmr1_capture_t cap;
+
+    test_boot();
+    mock_ain_mv[1] = 2000;
+    tmr1_icp_init(TMR1_ICP_PERIOD, TMR1_EDGE_RISING, false);
+    CHECK_EQ(acomp_init(ACOMP_POS_AIN0, ACOMP_NEG_AIN1, ACOMP_RISING, ACOMP_CAPTURE), ACOMP_OK);
+    CHECK(ACSR & (1 << ACIC));
+    CHECK(!(ACSR & (1 << ACIE)));
+
+    mock_ain_mv[0] = 2100;
+    mock_run_us(100);
+    mock_ain_mv[0] = 1900;
+    mock_run_us(100);
+    mock_ain_mv[0] = 2100;
+    mock_run_us(100);
+
+    CHECK(tmr1_icp_read(&cap));
+    CHECK_EQ(cap.edge, TMR1_EDGE_RISING);
+    CHECK(tmr1_icp_read(&cap));
+    CHECK(!tmr1_icp_read(&cap));
+    CHECK(tmr1_icp_period() >= 200UL * (F_CPU / 1000000UL) - 64);
+    CHECK(tmr1_icp_period() <= 200UL * (F_CPU / 1000000UL) + 64);
+    CHECK(!acomp_read(&ev));
+    tmr1_icp_stop();
+}
+
+void test_acomp(void) {
+    printf("acomp\n");
+    RUN(acomp_rejects_bad_config);
+    RUN(acomp_queues_rising_edges);
+    RUN(acomp_bandgap_against_mux);
+    RUN(acomp_keeps_foreign_didr0);
+    RUN(acomp_refuses_busy_mux);
+    RUN(acomp_counts_dropped_events);
+    RUN(acomp_starts_adc);
+    RUN(acomp_feeds_input_capture);
+}
@@ -0,0 +1,71 @@
+/***********************************************************************
+* ADC driver tests                                                     *
+***********************************************************************/
+
+#include "test.h"
+#include "adc.h"
+
+static void adc_setup(void) {
+    test_boot();
+    pwr_acquire(PWR_ADC);
+    ADMUX = (1 << REFS0);
+    ADCSRA = ADCPSC_VAL;
+    pwr_release(PWR_ADC);
+}
+
+static void adc_reads_selected_channel(void) {
+    uint16_t v = 0;
+
+    adc_setup();
+    mock_adc_in[ADC3] = 0x2A5;
+    mock_adc_in[ADC2] = 0x011;
+
+    CHECK_EQ(adc_read(ADC3, &v), ADC_OK);
+    CHECK_EQ(v, 0x2A5);
+    CHECK_EQ(adc_read(ADC2, &v), ADC_OK);
+    CHECK_EQ(v, 0x011);
+}
+
+// The conversion wakes the CPU out of ADC noise reduction sleep
+static void adc_sleeps_through_conversion(void) {
+    uint16_t v = 0;
+    uint64_t start;
+
+    adc_setup();
+    mock_adc_in[ADC3] = 100;
+    start = mock_cycles;
+    adc_read(ADC3, &v);
+
+    CHECK_EQ(v, 100);
+    CHECK(mock_cycles - start >= 25UL * 128UL);
+    CHECK(PRR & (1 << PRADC));
+    CHECK(!(ADCSRA & (1 << ADEN)));
+}
+
+static void adc_polls_with_interrupts_masked(void) {
+    uint16_t v = 0;
+
+    adc_setup();
+    mock_adc_in[ADC1] = 0x3FF;
+    cli();
+    CHECK_EQ(adc_read(ADC1, &v), ADC_OK);
+    sei();
+    CHECK_EQ(v, 0x3FF);
+    CHECK(!(ADCSRA & (1 << ADIF)));
+}
+
+static void adc_rejects_bad_mux(void) {
+    uint16_t v = 0xBEEF;
+
+    adc_setup();
+    CHECK_EQ(adc_read((mux_value_t)(ADC8 + 1), &v), ADC_INVALID_MUX);
+    CHECK_EQ(v, 0xBEEF);
+}
+
+void test_adc(void) {
+    printf("adc\n");
+    RUN(adc_reads_selected_channel);
+    RUN(adc_sleeps_through_conversion);
+    RUN(adc_polls_with_interrupts_masked);
+    RUN(adc_rejects_bad_mux);
+}
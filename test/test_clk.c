@@ -0,0 +1,141 @@
+/***********************************************************************
+* System clock manager tests                                           *
+***********************************************************************/
+
+#include "test.h"
+#include "clk.h"
+#include "uart.h"
+#include "twi_hal.h"
+#include "adc.h"
+#include "tmr1.h"
+
+static void clk_rejects_bad_div(void) {
+    test_boot();
+    CHECK_EQ(clk_set(CLK_DIV256 + 1), CLK_INVALID_DIV);
+    CHECK_EQ(clk_get(), CLK_DIV1);
+    CHECK_EQ(CLKPR, 0);
+}
+
+// 115200 baud is 3.5% off at 8 MHz, the UART keeps the clock at 16 MHz
+static void clk_refused_by_uart(void) {
+    test_boot();
+    uart_init(BOTH, false, NONE);
+    CHECK_EQ(clk_set(CLK_DIV2), CLK_UART_BAUD);
+    CHECK_EQ(clk_hz(), F_CPU);
+    CHECK_EQ(CLKPR, 0);
+    UCSR0B = 0;
+}
+
+// Time keeps going across the change and ticks at the new clock
+static void clk_retimes_systick(void) {
+    uint32_t us, ms;
+    clk_div_t div;
+
+    test_boot();
+    mock_run_us(1500);
+    for (div = CLK_DIV2; div <= CLK_DIV256; div++) {
+        us = systick_micros();
+        ms = systick_millis();
+        CHECK_EQ(clk_set(div), CLK_OK);
+        CHECK_EQ(CLKPR, div);
+        CHECK_EQ(clk_hz(), F_CPU >> div);
+        CHECK(systick_micros() - us < 100UL << div);
+        CHECK(systick_millis() - ms <= 4);
+
+        us = systick_micros();
+        ms = systick_millis();
+        mock_run_us(20000);
+        CHECK(systick_micros() - us >= 20000);
+        CHECK(systick_micros() - us <= 20000 + (30UL << div));
+        CHECK(systick_millis() - ms >= 18);
+        CHECK(systick_millis() - ms <= 22);
+    }
+
+    CHECK_EQ(clk_set(CLK_DIV1), CLK_OK);
+    CHECK_EQ(OCR0A, SYSTICK_TOP);
+    us = systick_micros();
+    mock_run_us(1000);
+    CHECK(systick_micros() - us >= 1000);
+    CHECK(systick_micros() - us <= 1010);
+}
+
+static void clk_retimes_uart_twi_adc(void) {
+    uint16_t v;
+
+    test_boot();
+    uart_init(TX, false, NONE);
+    UCSR0B = 0;                                 /*Transmitter off, no baud rate to keep*/
+    twi_init(false);
+    mock_adc_in[ADC4] = 0x1C7;
+
+    CHECK_EQ(clk_set(CLK_DIV8), CLK_OK);
+    CHECK_EQ(UBRR0L, 1);                        /*2 MHz / (8 * 125000) - 1*/
+    CHECK_EQ(TWBR, BOARD_TWBR_MIN);
+    CHECK_EQ(ADCSRA & 0x07, 4);                 /*2 MHz / 16 = 125 kHz*/
+    CHECK_EQ(adc_read(ADC4, &v), ADC_OK);
+    CHECK_EQ(v, 0x1C7);
+
+    CHECK_EQ(clk_set(CLK_DIV1), CLK_OK);
+    CHECK_EQ(UBRR0L, BOARD_UBRR);
+    CHECK_EQ(TWBR, BOARD_TWBR);
+    CHECK_EQ(ADCSRA & 0x07, ADCPSC_VAL);
+}
+
+// Phase correct 1 kHz keeps its frequency and 50% duty
+static void clk_retimes_pwm(void) {
+    test_boot();
+    TMR1_INIT(TMR1_PWM_PHASE, 1000);
+    tmr1_pwm_duty(TMR1_CH_A, TMR1_DUTY_PCT(50));
+    CHECK_EQ(ICR1, 8000);
+    CHECK_EQ(OCR1A, 4000);
+
+    CHECK_EQ(clk_set(CLK_DIV4), CLK_OK);
+    CHECK_EQ(TCCR1B & 0x07, TMR1_CLK_DIV1);
+    CHECK_EQ(ICR1, 2000);
+    CHECK_EQ(OCR1A, 1000);
+
+    // TMR1_INIT() is worked out for F_CPU, 10 Hz CTC then needs a
+    // smaller prescaler at 1 MHz
+    CHECK_EQ(clk_set(CLK_DIV1), CLK_OK);
+    CHECK_EQ(OCR1A, 4000);
+    TMR1_INIT(TMR1_CTC, 10);
+    CHECK_EQ(TCCR1B & 0x07, TMR1_CLK_DIV64);
+    CHECK_EQ(OCR1A, 24999);
+    CHECK_EQ(clk_set(CLK_DIV16), CLK_OK);
+    CHECK_EQ(TCCR1B & 0x07, TMR1_CLK_DIV8);
+    CHECK_EQ(OCR1A, 12499);
+
+    CHECK_EQ(clk_set(CLK_DIV1), CLK_OK);
+    CHECK_EQ(TCCR1B & 0x07, TMR1_CLK_DIV64);
+    CHECK_EQ(OCR1A, 24999);
+    tmr1_stop();
+}
+
+// Captures count system clock ticks, the frequency stays right
+static void clk_retimes_capture(void) {
+    uint8_t i;
+
+    test_boot();
+    tmr1_icp_init(TMR1_ICP_PERIOD, TMR1_EDGE_RISING, false);
+    CHECK_EQ(clk_set(CLK_DIV2), CLK_OK);
+    for (i = 0; i < 3; i++) {
+        mock_icp_edge(true);
+        mock_run_us(100);
+    }
+    CHECK(tmr1_icp_period() >= 800 - 16 && tmr1_icp_period() <= 800 + 16);
+    CHECK(tmr1_icp_freq() >= 9800 && tmr1_icp_freq() <= 10200);
+
+    CHECK_EQ(clk_set(CLK_DIV1), CLK_OK);
+    tmr1_icp_stop();
+    tmr1_stop();
+}
+
+void test_clk(void) {
+    printf("clk\n");
+    RUN(clk_rejects_bad_div);
+    RUN(clk_refused_by_uart);
+    RUN(clk_retimes_systick);
+    RUN(clk_retimes_uart_twi_adc);
+    RUN(clk_retimes_pwm);
+    RUN(clk_retimes_capture);
+}
@@ -0,0 +1,281 @@
+/***********************************************************************
+* Binary command interface tests                                       *
+***********************************************************************/
+
+#include "test.h"
+#include "cmd.h"
+#include "uart.h"
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include <string.h>
+
+#define FRAME_CYCLES (10UL * BOARD_UART_SAMPLES * (BOARD_UBRR + 1))
+#define FRAME_US (FRAME_CYCLES / (F_CPU / 1000000UL) + 1)
+
+static uint8_t short_calls;
+
+// Declares more than it writes, the rest goes out as zeros
+static cmd_status_t cmd_short(const uint8_t* arg, uint8_t len) {
+    (void)arg;
+    (void)len;
+    short_calls++;
+    cmd_reply_begin(4);
+    cmd_reply_byte(0x11);
+    return CMD_OK;
+}
+
+static cmd_status_t cmd_refuse(const uint8_t* arg, uint8_t len) {
+    (void)arg;
+    (void)len;
+    return CMD_BAD_ARG;
+}
+
+static const cmd_entry_t test_cmds[] PROGMEM = {
+    {cmd_ping, 0, CMD_PAYLOAD_MAX},
+    {cmd_read_regs, 2, 2},
+    {cmd_dump_stats, 0, 0},
+    {0, 0, 0},
+    {cmd_short, 1, 3},
+    {cmd_refuse, 0, 0},
+};
+
+static void cmd_setup(void) {
+    test_boot();
+    uart_init(BOTH, true, NONE);
+    cmd_init(test_cmds, sizeof(test_cmds) / sizeof(test_cmds[0]));
+    short_calls = 0;
+}
+
+static void cmd_feed(uint8_t b) {
+    mock_uart_rx(b);
+    mock_run_us(FRAME_US);
+}
+
+// A request with its CRC, plus crc_xor to corrupt it
+static void cmd_send(uint8_t id, const uint8_t* arg, uint8_t len, uint16_t crc_xor) {
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    crc = _crc_ccitt_update(crc, len);
+    crc = _crc_ccitt_update(crc, id);
+    cmd_feed(CMD_SYNC);
+    cmd_feed(len);
+    cmd_feed(id);
+    for (i = 0; i < len; i++) {
+        crc = _crc_ccitt_update(crc, arg[i]);
+        cmd_feed(arg[i]);
+    }
+    crc ^= crc_xor;
+    cmd_feed((uint8_t)crc);
+    cmd_feed((uint8_t)(crc >> 8));
+}
+
+// Checks the reply framing and CRC, returns its data
+static const uint8_t* cmd_reply(uint8_t id, cmd_status_t status, uint8_t len) {
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    uart_flush();
+    CHECK_EQ(mock_uart_out_len, len + 6);
+    CHECK_EQ(mock_uart_out[0], CMD_SYNC);
+    CHECK_EQ(mock_uart_out[1], len + 1);
+    CHECK_EQ(mock_uart_out[2], id | CMD_REPLY);
+    CHECK_EQ(mock_uart_out[3], status);
+    for (i = 1; i < len + 4; i++) crc = _crc_ccitt_update(crc, mock_uart_out[i]);
+    CHECK_EQ(mock_uart_out[len + 4], (uint8_t)crc);
+    CHECK_EQ(mock_uart_out[len + 5], (uint8_t)(crc >> 8));
+    return &mock_uart_out[4];
+}
+
+static void cmd_ping_round_trip(void) {
+    const uint8_t msg[] = {1, 2, 3, 0xC3, 0xA5};
+    cmd_stats_t s;
+
+    cmd_setup();
+    cmd_send(0, msg, sizeof(msg), 0);
+    CHECK(cmd_poll());
+    CHECK(memcmp(cmd_reply(0, CMD_OK, sizeof(msg)), msg, sizeof(msg)) == 0);
+    CHECK(!cmd_poll());
+
+    cmd_stats(&s);
+    CHECK_EQ(s.requests, 1);
+    CHECK_EQ(s.crc_errors, 0);
+}
+
+// Corrupted request, the handler is not called
+static void cmd_rejects_bad_crc(void) {
+    const uint8_t arg = 1;
+    cmd_stats_t s;
+
+    cmd_setup();
+    cmd_send(4, &arg, 1, 0x0100);
+    CHECK(cmd_poll());
+    cmd_reply(4, CMD_BAD_CRC, 0);
+    CHECK_EQ(short_calls, 0);
+
+    cmd_stats(&s);
+    CHECK_EQ(s.requests, 1);
+    CHECK_EQ(s.crc_errors, 1);
+}
+
+static void cmd_checks_table(void) {
+    const uint8_t arg[4] = {0};
+    cmd_stats_t s;
+
+    cmd_setup();
+    cmd_send(3, 0, 0, 0);                       /*Hole in the table*/
+    CHECK(cmd_poll());
+    cmd_reply(3, CMD_UNKNOWN, 0);
+
+    mock_uart_out_len = 0;
+    cmd_send(200, 0, 0, 0);                     /*Past its end*/
+    CHECK(cmd_poll());
+    cmd_reply(200, CMD_UNKNOWN, 0);
+
+    mock_uart_out_len = 0;
+    cmd_send(4, arg, 4, 0);
+    CHECK(cmd_poll());
+    cmd_reply(4, CMD_BAD_LEN, 0);
+    CHECK_EQ(short_calls, 0);
+
+    cmd_stats(&s);
+    CHECK_EQ(s.requests, 3);
+    CHECK_EQ(s.unknown, 2);
+    CHECK_EQ(s.bad_len, 1);
+}
+
+static void cmd_handler_replies(void) {
+    const uint8_t arg = 7;
+    const uint8_t* data;
+
+    cmd_setup();
+    cmd_send(4, &arg, 1, 0);
+    CHECK(cmd_poll());
+    data = cmd_reply(4, CMD_OK, 4);
+    CHECK_EQ(short_calls, 1);
+    CHECK_EQ(data[0], 0x11);
+    CHECK_EQ(data[1], 0);
+    CHECK_EQ(data[3], 0);
+
+    // A refusal without data still gets its status back
+    mock_uart_out_len = 0;
+    cmd_send(5, 0, 0, 0);
+    CHECK(cmd_poll());
+    cmd_reply(5, CMD_BAD_ARG, 0);
+}
+
+// Noise, an oversized length and a stalled request are all skipped
+static void cmd_resyncs(void) {
+    const uint8_t msg[] = {9};
+    uint8_t i;
+    cmd_stats_t s;
+
+    cmd_setup();
+    cmd_feed('x');
+    cmd_feed(CMD_SYNC);
+    cmd_feed(CMD_PAYLOAD_MAX + 1);
+    CHECK(!cmd_poll());
+
+    cmd_feed(CMD_SYNC);
+    cmd_feed(1);
+    cmd_feed(0);
+    for (i = 0; i <= CMD_TIMEOUT_MS; i++) {
+        CHECK(!cmd_poll());
+        mock_run_us(1000);
+    }
+    CHECK(!cmd_poll());
+
+    cmd_send(0, msg, 1, 0);
+    CHECK(cmd_poll());
+    CHECK_EQ(cmd_reply(0, CMD_OK, 1)[0], 9);
+
+    cmd_stats(&s);
+    CHECK_EQ(s.requests, 1);
+    CHECK_EQ(s.dropped, 2);
+}
+
+// Bytes that were held up in the ring are not a stalled request
+static void cmd_late_poll_is_no_timeout(void) {
+    const uint8_t msg[] = {1, 2};
+    cmd_stats_t s;
+
+    cmd_setup();
+    cmd_feed(CMD_SYNC);
+    CHECK(!cmd_poll());
+    cmd_send(0, msg, 2, 0);                     /*The sync again, then a whole frame*/
+    mock_run_us((CMD_TIMEOUT_MS + 5) * 1000UL);
+    CHECK(cmd_poll());
+    cmd_stats(&s);
+    CHECK_EQ(s.dropped, 1);                     /*The second sync read as a length*/
+    CHECK_EQ(s.requests, 1);
+}
+
+static void cmd_reads_registers(void) {
+    uint8_t arg[2] = {MOCK_ADDR(DDRB), 3};
+    const uint8_t* data;
+
+    cmd_setup();
+    DDRB = 0x5A;
+    PORTB = 0xA5;
+    cmd_send(1, arg, 2, 0);
+    CHECK(cmd_poll());
+    data = cmd_reply(1, CMD_OK, 3);
+    CHECK_EQ(data[0], 0x5A);
+    CHECK_EQ(data[1], 0xA5);
+
+    arg[0] = 0x10;
+    mock_uart_out_len = 0;
+    cmd_send(1, arg, 2, 0);
+    CHECK(cmd_poll());
+    cmd_reply(1, CMD_BAD_ARG, 0);
+
+    arg[0] = 0xFE;
+    mock_uart_out_len = 0;
+    cmd_send(1, arg, 2, 0);
+    CHECK(cmd_poll());
+    cmd_reply(1, CMD_BAD_ARG, 0);
+}
+
+static void cmd_dumps_stats(void) {
+    const uint8_t* data;
+    uint32_t ms, rx;
+
+    cmd_setup();
+    mock_run_us(5000);
+    cmd_send(2, 0, 0, 0);
+    CHECK(cmd_poll());
+    data = cmd_reply(2, CMD_OK, 52);
+
+    ms = data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    rx = data[24] | ((uint32_t)data[25] << 8);
+    CHECK(ms >= 5);
+    CHECK(ms <= systick_millis());
+    CHECK_EQ(rx, 5);
+}
+
+// The reply starts on the wire within a frame of the request's CRC
+static void cmd_reply_latency(void) {
+    const uint8_t msg[] = {0xAA};
+    uint64_t start;
+
+    cmd_setup();
+    cmd_send(0, msg, 1, 0);
+    start = mock_cycles;
+    CHECK(cmd_poll());
+    while (mock_uart_out_len == 0 && mock_cycles - start < 10 * FRAME_CYCLES) mock_run_us(1);
+    CHECK(mock_cycles - start <= FRAME_CYCLES + 200);
+    cmd_reply(0, CMD_OK, 1);
+}
+
+void test_cmd(void) {
+    printf("cmd\n");
+    RUN(cmd_ping_round_trip);
+    RUN(cmd_rejects_bad_crc);
+    RUN(cmd_checks_table);
+    RUN(cmd_handler_replies);
+    RUN(cmd_resyncs);
+    RUN(cmd_late_poll_is_no_timeout);
+    RUN(cmd_reads_registers);
+    RUN(cmd_dumps_stats);
+    RUN(cmd_reply_latency);
+}
@@ -0,0 +1,188 @@
+/***********************************************************************
+* EEPROM driver tests                                                  *
+***********************************************************************/
+
+#include "test.h"
+#include "ee.h"
+#include <string.h>
+
+// One erase and write, in cycles
+#define EE_WRITE_CYCLES (F_CPU / 10000UL * 34UL)
+
+static void ee_setup(void) {
+    test_boot();
+    mock_ee_erase();
+    ee_init();
+}
+
+static void ee_write_returns_before_commit(void) {
+    const uint8_t set[4] = {1, 2, 3, 4};
+    uint8_t got[4] = {0};
+    uint64_t start;
+
+    ee_setup();
+    start = mock_cycles;
+    CHECK_EQ(ee_write(0x10, set, sizeof(set)), EE_OK);
+    CHECK(mock_cycles - start < EE_WRITE_CYCLES);
+    CHECK(ee_busy());
+
+    // Queued bytes read back before they reach the array
+    CHECK_EQ(ee_read(0x10, got, sizeof(got)), EE_OK);
+    CHECK(memcmp(got, set, sizeof(set)) == 0);
+
+    ee_flush();
+    CHECK(!ee_busy());
+    CHECK(memcmp(&mock_eeprom[0x10], set, sizeof(set)) == 0);
+    CHECK(mock_cycles - start >= 4 * EE_WRITE_CYCLES);
+    CHECK(PRR & (1 << PRADC));
+}
+
+static void ee_skips_unchanged_bytes(void) {
+    const uint8_t set[4] = {9, 8, 7, 6};
+    uint8_t got[4];
+
+    ee_setup();
+    mock_eeprom[0x20] = 9;
+    mock_eeprom[0x22] = 7;
+    ee_write(0x20, set, sizeof(set));
+    ee_flush();
+    CHECK_EQ(mock_ee_writes, 2);
+
+    // Once the line is cached the same bytes are not even queued
+    ee_read(0x20, got, sizeof(got));
+    ee_write(0x20, set, sizeof(set));
+    CHECK(!ee_busy());
+    CHECK_EQ(mock_ee_writes, 2);
+}
+
+static void ee_coalesces_queued_writes(void) {
+    uint8_t b;
+
+    ee_setup();
+    for (b = 1; b <= 10; b++) ee_write(0x30, &b, 1);
+    ee_flush();
+    CHECK_EQ(mock_eeprom[0x30], 10);
+    CHECK(mock_ee_wear[0x30] <= 2);
+}
+
+static void ee_rejects_out_of_range(void) {
+    uint8_t b[2] = {0};
+
+    ee_setup();
+    CHECK_EQ(ee_write(EE_SIZE - 1, b, 2), EE_INVALID_ADDR);
+    CHECK_EQ(ee_read(EE_SIZE, b, 1), EE_INVALID_ADDR);
+    CHECK_EQ(ee_read(EE_SIZE - 2, b, 2), EE_OK);
+}
+
+static void ee_polls_with_interrupts_masked(void) {
+    const uint8_t set[3] = {0x5A, 0xA5, 0x3C};
+
+    ee_setup();
+    cli();
+    ee_write(0x40, set, sizeof(set));
+    ee_flush();
+    sei();
+    CHECK(memcmp(&mock_eeprom[0x40], set, sizeof(set)) == 0);
+}
+
+static void ee_ring_spreads_saves(void) {
+    ee_ring_t ring = EE_RING_INIT(0x100, 4, sizeof(uint32_t));
+    uint32_t boots = 0;
+    uint8_t slot;
+
+    ee_setup();
+    CHECK_EQ(ee_ring_open(&ring), EE_EMPTY);
+    CHECK_EQ(ee_ring_load(&ring, &boots), EE_EMPTY);
+
+    // One save per boot, each committed before the next
+    for (boots = 1; boots <= 10; boots++) {
+        ee_ring_save(&ring, &boots);
+        ee_flush();
+    }
+
+    // Each slot's sequence byte was written 2 or 3 times out of 10 saves
+    for (slot = 0; slot < 4; slot++) {
+        CHECK(mock_ee_wear[0x100 + slot * 6] >= 2);
+        CHECK(mock_ee_wear[0x100 + slot * 6] <= 3);
+    }
+
+    // Find it again from the array alone
+    ee_init();
+    ring = (ee_ring_t)EE_RING_INIT(0x100, 4, sizeof(uint32_t));
+    CHECK_EQ(ee_ring_open(&ring), EE_OK);
+    CHECK_EQ(ring.newest, 1);
+    CHECK_EQ(ee_ring_load(&ring, &boots), EE_OK);
+    CHECK_EQ(boots, 10);
+}
+
+static void ee_ring_survives_torn_save(void) {
+    ee_ring_t ring = EE_RING_INIT(0x200, 3, 2);
+    const uint8_t a[2] = {0x11, 0x22};
+    const uint8_t b[2] = {0x33, 0x44};
+    uint8_t got[2];
+
+    ee_setup();
+    ee_ring_open(&ring);
+    ee_ring_save(&ring, a);
+    ee_ring_save(&ring, b);
+    ee_flush();
+
+    // Reset hit before the CRC of the second save went in
+    mock_eeprom[0x200 + 4 + 3] ^= 0xFF;
+    ee_init();
+    ring = (ee_ring_t)EE_RING_INIT(0x200, 3, 2);
+    CHECK_EQ(ee_ring_open(&ring), EE_OK);
+    CHECK_EQ(ring.newest, 0);
+    ee_ring_load(&ring, got);
+    CHECK(memcmp(got, a, 2) == 0);
+
+    // The next save reuses the torn slot
+    ee_ring_save(&ring, b);
+    ee_flush();
+    ee_init();
+    ring = (ee_ring_t)EE_RING_INIT(0x200, 3, 2);
+    ee_ring_open(&ring);
+    CHECK_EQ(ring.newest, 1);
+}
+
+// 127 bytes of 0xFF have a CRC of 0xFF, an erased array still reads empty
+static void ee_ring_blank_is_empty(void) {
+    ee_ring_t ring = EE_RING_INIT(0x80, 2, 126);
+
+    ee_setup();
+    CHECK_EQ(ee_ring_open(&ring), EE_EMPTY);
+    CHECK_EQ(ring.newest, EE_RING_NONE);
+}
+
+// The largest payload, the slot walk covers 256 bytes with its sequence
+static void ee_ring_full_size_payload(void) {
+    ee_ring_t ring = EE_RING_INIT(0x000, 2, 255);
+    uint8_t data[255], got[255];
+    uint16_t i;
+
+    ee_setup();
+    CHECK_EQ(ee_ring_open(&ring), EE_EMPTY);
+    for (i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 7);
+    ee_ring_save(&ring, data);
+    ee_flush();
+
+    ee_init();
+    ring = (ee_ring_t)EE_RING_INIT(0x000, 2, 255);
+    CHECK_EQ(ee_ring_open(&ring), EE_OK);
+    CHECK_EQ(ring.newest, 0);
+    CHECK_EQ(ee_ring_load(&ring, got), EE_OK);
+    CHECK(memcmp(got, data, sizeof(data)) == 0);
+}
+
+void test_ee(void) {
+    printf("ee\n");
+    RUN(ee_write_returns_before_commit);
+    RUN(ee_skips_unchanged_bytes);
+    RUN(ee_coalesces_queued_writes);
+    RUN(ee_rejects_out_of_range);
+    RUN(ee_polls_with_interrupts_masked);
+    RUN(ee_ring_spreads_saves);
+    RUN(ee_ring_survives_torn_save);
+    RUN(ee_ring_blank_is_empty);
+    RUN(ee_ring_full_size_payload);
+}
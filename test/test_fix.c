@@ -0,0 +1,144 @@
+/***********************************************************************
+* Fixed point math tests, checked against double on the host           *
+***********************************************************************/
+
+#include "test.h"
+#include "fix.h"
+#include <math.h>
+#include <stdlib.h>
+
+static void fix_constants_and_conversions(void) {
+    CHECK_EQ(Q8_8(1.0), Q8_8_ONE);
+    CHECK_EQ(Q8_8(-0.5), -128);
+    CHECK_EQ(Q8_8(3.14159), 804);
+    CHECK_EQ(Q16_16(1.0), Q16_16_ONE);
+    CHECK_EQ(Q16_16(-2.25), -147456L);
+
+    CHECK_EQ(q8_from_int(-3), Q8_8(-3.0));
+    CHECK_EQ(q16_from_int(-32768), Q16_16_MIN);
+    CHECK_EQ(q16_from_q8(Q8_8(-1.5)), Q16_16(-1.5));
+    CHECK_EQ(q8_from_q16(Q16_16(2.5)), Q8_8(2.5));
+    CHECK_EQ(q8_from_q16(Q16_16(1000.0)), Q8_8_MAX);
+    CHECK_EQ(q8_from_q16(Q16_16_MAX), Q8_8_MAX);
+    CHECK_EQ(q8_from_q16(Q16_16(-1000.0)), Q8_8_MIN);
+    CHECK_EQ(Q8_8_INT(Q8_8(-0.5)), -1);
+    CHECK_EQ(Q16_16_INT(Q16_16(7.75)), 7);
+}
+
+static void fix_add_sub_saturate(void) {
+    CHECK_EQ(q8_add(Q8_8(1.5), Q8_8(2.25)), Q8_8(3.75));
+    CHECK_EQ(q8_add(Q8_8(100.0), Q8_8(100.0)), Q8_8_MAX);
+    CHECK_EQ(q8_add(Q8_8(-100.0), Q8_8(-100.0)), Q8_8_MIN);
+    CHECK_EQ(q8_sub(Q8_8(-100.0), Q8_8(100.0)), Q8_8_MIN);
+    CHECK_EQ(q8_sub(Q8_8(100.0), Q8_8(-100.0)), Q8_8_MAX);
+
+    CHECK_EQ(q16_add(Q16_16(1.5), Q16_16(-2.25)), Q16_16(-0.75));
+    CHECK_EQ(q16_add(Q16_16(30000.0), Q16_16(30000.0)), Q16_16_MAX);
+    CHECK_EQ(q16_add(Q16_16(-30000.0), Q16_16(-30000.0)), Q16_16_MIN);
+    CHECK_EQ(q16_sub(Q16_16(-30000.0), Q16_16(30000.0)), Q16_16_MIN);
+    CHECK_EQ(q16_sub(Q16_16(30000.0), Q16_16(-30000.0)), Q16_16_MAX);
+    CHECK_EQ(q16_sub(0, Q16_16_MIN), Q16_16_MAX);
+}
+
+static void fix_mul_rounds_and_saturates(void) {
+    int32_t a, b;
+    double want;
+    int fails = 0;
+    int n;
+
+    CHECK_EQ(q8_mul(Q8_8(1.5), Q8_8(-2.0)), Q8_8(-3.0));
+    CHECK_EQ(q8_mul(Q8_8(0.5), Q8_8(0.5)), Q8_8(0.25));
+    CHECK_EQ(q8_mul(Q8_8(20.0), Q8_8(20.0)), Q8_8_MAX);
+    CHECK_EQ(q8_mul(Q8_8(-20.0), Q8_8(20.0)), Q8_8_MIN);
+    CHECK_EQ(q8_mul(Q8_8_MIN, Q8_8_MIN), Q8_8_MAX);
+
+    CHECK_EQ(q16_mul(Q16_16(1.5), Q16_16(-2.0)), Q16_16(-3.0));
+    CHECK_EQ(q16_mul(Q16_16(-181.0), Q16_16(-181.0)), Q16_16(32761.0));
+    CHECK_EQ(q16_mul(Q16_16(200.0), Q16_16(200.0)), Q16_16_MAX);
+    CHECK_EQ(q16_mul(Q16_16(-200.0), Q16_16(200.0)), Q16_16_MIN);
+    CHECK_EQ(q16_mul(Q16_16_MIN, Q16_16_ONE), Q16_16_MIN);
+    CHECK_EQ(q16_mul(Q16_16_MIN, -Q16_16_ONE), Q16_16_MAX);
+
+    // Random operands against the exact product, within one LSB
+    srand(39);
+    for (n = 0; n < 10000; n++) {
+        a = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand()) >> (rand() % 16);
+        b = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand()) >> (rand() % 16);
+        want = (double)a * (double)b / 65536.0;
+        if (want > Q16_16_MAX) want = Q16_16_MAX;
+        if (want < Q16_16_MIN) want = Q16_16_MIN;
+        if (fabs((double)q16_mul(a, b) - want) > 1.0) fails++;
+    }
+    CHECK_EQ(fails, 0);
+}
+
+static void fix_udiv_is_exact(void) {
+    uint32_t x;
+    int fails = 0;
+
+    CHECK_EQ(FIX_RECIP(10), 6554);
+    for (x = 0; x <= UINT16_MAX; x++) {
+        if (fix_udiv(x, 10) != x / 10) fails++;
+        if (fix_udiv(x, 3) != x / 3) fails++;
+        if (fix_udiv(x, 1023) != x / 1023) fails++;
+        if (fix_udiv(x, 60000) != x / 60000) fails++;
+        if (fix_udiv(x, 1) != x) fails++;
+    }
+    CHECK_EQ(fails, 0);
+}
+
+static void fix_isqrt_is_floor(void) {
+    uint32_t x;
+    int fails = 0;
+
+    CHECK_EQ(fix_isqrt(0), 0);
+    CHECK_EQ(fix_isqrt(1), 1);
+    CHECK_EQ(fix_isqrt(15), 3);
+    CHECK_EQ(fix_isqrt(16), 4);
+    CHECK_EQ(fix_isqrt(UINT32_MAX), 65535);
+    CHECK_EQ(fix_isqrt(65536UL * 65536UL - 1), 65535);
+    for (x = 1; x < 2000000UL; x += 7) {
+        uint32_t r = fix_isqrt(x);
+        if (r * r > x || (r + 1) * (r + 1) <= x) fails++;
+    }
+    CHECK_EQ(fails, 0);
+}
+
+static void fix_sin_and_log2_tables(void) {
+    double err, worst = 0;
+    uint16_t a;
+    uint32_t x;
+
+    CHECK_EQ(fix_sin(0), 0);
+    CHECK_EQ(fix_sin(FIX_DEG(90)), 32767);
+    CHECK_EQ(fix_sin(FIX_DEG(180)), 0);
+    CHECK_EQ(fix_sin(FIX_DEG(270)), -32767);
+    CHECK_EQ(fix_cos(0), 32767);
+    CHECK_EQ(fix_cos(FIX_DEG(180)), -32767);
+    for (a = 0; a < 256; a++) {
+        err = fabs(fix_sin(a) / 32768.0 - sin(a * 2 * M_PI / 256));
+        if (err > worst) worst = err;
+    }
+    CHECK(worst < 0.0001);
+
+    worst = 0;
+    CHECK_EQ(fix_log2(0), Q8_8_MIN);
+    CHECK_EQ(fix_log2(1), 0);
+    CHECK_EQ(fix_log2(1024), Q8_8(10.0));
+    CHECK_EQ(fix_log2(UINT32_MAX), Q8_8(32.0));
+    for (x = 1; x < 4000000000UL; x += x / 3 + 1) {
+        err = fabs(fix_log2(x) / 256.0 - log2(x));
+        if (err > worst) worst = err;
+    }
+    CHECK(worst <= 1.0 / 256);
+}
+
+void test_fix(void) {
+    printf("fix\n");
+    RUN(fix_constants_and_conversions);
+    RUN(fix_add_sub_saturate);
+    RUN(fix_mul_rounds_and_saturates);
+    RUN(fix_udiv_is_exact);
+    RUN(fix_isqrt_is_floor);
+    RUN(fix_sin_and_log2_tables);
+}
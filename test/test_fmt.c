@@ -0,0 +1,36 @@
+/***********************************************************************
+* Formatting tests                                                     *
+***********************************************************************/
+
+#include "test.h"
+#include "uart.h"
+
+// Values above 99 depend on sizeof(pointer) inside decToASCII and so
+// differ between host and target, only 0 -- 99 is covered
+static void dec_one_digit_is_terminated(void) {
+    uint8_t buf[2] = {0xFF, 0xFF};
+
+    decToASCII(buf, 7);
+    CHECK_EQ(buf[0], '7');
+    CHECK_EQ(buf[1], '\0');
+
+    decToASCII(buf, 0);
+    CHECK_EQ(buf[0], '0');
+}
+
+static void dec_two_digits(void) {
+    uint8_t buf[2];
+    uint8_t d;
+
+    for (d = 10; d < 100; d++) {
+        decToASCII(buf, d);
+        CHECK_EQ(buf[0], '0' + d / 10);
+        CHECK_EQ(buf[1], '0' + d % 10);
+    }
+}
+
+void test_fmt(void) {
+    printf("fmt\n");
+    RUN(dec_one_digit_is_terminated);
+    RUN(dec_two_digits);
+}
@@ -0,0 +1,53 @@
+/***********************************************************************
+* GPIO driver tests                                                    *
+***********************************************************************/
+
+#include "test.h"
+#include "gpio.h"
+
+static void gpio_output_pin_drives_port(void) {
+    CHECK_EQ(gpio_pin_init(GPIO_D, DIR_OUTPUT, 5), GPIO_OK);
+    CHECK_EQ(gpio_pin_write(GPIO_D, 5, HIGH), GPIO_OK);
+    CHECK_EQ(PORTD, 1 << 5);
+    CHECK_EQ(PIND & (1 << 5), 1 << 5);
+
+    CHECK_EQ(gpio_pin_write(GPIO_D, 5, LOW), GPIO_OK);
+    CHECK_EQ(PORTD, 0);
+}
+
+static void gpio_write_needs_output(void) {
+    CHECK_EQ(gpio_pin_write(GPIO_B, 2, HIGH), GPIO_INVALID_DIR);
+    CHECK_EQ(gpio_pin_write(GPIO_B, 8, HIGH), GPIO_INVALID_PIN);
+    CHECK_EQ(PORTB, 0);
+}
+
+static void gpio_pullup_reads_high_until_driven(void) {
+    bit_t v = LOW;
+
+    CHECK_EQ(gpio_pin_init(GPIO_C, DIR_INPUT_PULLUP, PINC0), GPIO_OK);
+    CHECK_EQ(gpio_pin_read(GPIO_C, PINC0, &v), GPIO_OK);
+    CHECK_EQ(v, HIGH);
+
+    mock_pin_drive(MOCK_PORT_C, 1 << PINC0, 0);
+    CHECK_EQ(gpio_pin_read(GPIO_C, PINC0, &v), GPIO_OK);
+    CHECK_EQ(v, LOW);
+
+    mock_pin_release(MOCK_PORT_C, 1 << PINC0);
+    gpio_pin_read(GPIO_C, PINC0, &v);
+    CHECK_EQ(v, HIGH);
+}
+
+static void gpio_port_write_masked(void) {
+    CHECK_EQ(gpio_port_init(GPIO_D, DIR_OUTPUT, 0xFC), GPIO_OK);
+    CHECK_EQ(gpio_port_write(GPIO_D, 0xFF, 0xFC), GPIO_OK);
+    CHECK_EQ(PIND & 0xFC, 0xFC);
+    CHECK_EQ(gpio_port_write(GPIO_D, 0x00, 0xF0), GPIO_INVALID_DIR);
+}
+
+void test_gpio(void) {
+    printf("gpio\n");
+    RUN(gpio_output_pin_drives_port);
+    RUN(gpio_write_needs_output);
+    RUN(gpio_pullup_reads_high_until_driven);
+    RUN(gpio_port_write_masked);
+}
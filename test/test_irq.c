@@ -0,0 +1,191 @@
+/***********************************************************************
+* Interrupt latency budget and preemptible handler tests               *
+***********************************************************************/
+
+#include "test.h"
+#include "irq.h"
+#include "suart.h"
+#include "tmr1.h"
+#include <string.h>
+
+#define TICK_CYCLES (F_CPU / 1000UL)
+#define BIT_CYCLES (F_CPU / BOARD_SUART_BAUD)
+
+static uint8_t irq_depth, irq_depth_max;
+static uint8_t irq_runs;
+static uint32_t irq_burn_us;
+
+// A slow CTC callback, the mock runs the other interrupts meanwhile if
+// they are enabled
+static void irq_slow_cb(void) {
+    if (++irq_depth > irq_depth_max) irq_depth_max = irq_depth;
+    irq_runs++;
+    mock_run_us(irq_burn_us);
+    irq_burn_us = 0;
+    irq_depth--;
+}
+
+// The same callback written as if handlers could not be preempted
+static void irq_masked_cb(void) {
+    cli();
+    mock_run_us(300);
+    sei();
+}
+
+static void irq_setup(void) {
+    test_boot();
+    irq_stats_reset();
+    irq_depth = irq_depth_max = 0;
+    irq_runs = 0;
+    irq_burn_us = 0;
+}
+
+static void irq_stamps_against_budget(void) {
+    irq_stats_t s;
+
+    irq_setup();
+    irq_watch(IRQ_SUART_RX, 8, 10);
+    irq_stamp(IRQ_SUART_RX, 5);
+    irq_stamp(IRQ_SUART_RX, 12);
+    irq_stamp(IRQ_SUART_RX, 10);
+
+    irq_stats(IRQ_SUART_RX, &s);
+    CHECK_EQ(s.count, 3);
+    CHECK_EQ(s.late, 1);
+    CHECK_EQ(s.nested, 0);
+    CHECK_EQ(s.latency_max, 12 * 8);
+    CHECK_EQ(s.budget, 10 * 8);
+    CHECK(irq_masked_max() >= 12 * 8);
+
+    // The budget belongs to the driver and stays
+    irq_stats_reset();
+    irq_stats(IRQ_SUART_RX, &s);
+    CHECK_EQ(s.count, 0);
+    CHECK_EQ(s.latency_max, 0);
+    CHECK_EQ(s.budget, 10 * 8);
+}
+
+// Interrupts held off across a match show up as the tick's latency
+static void irq_systick_sees_masked_time(void) {
+    irq_stats_t s;
+
+    irq_setup();
+    mock_run_us(5000);
+    irq_stats(IRQ_SYSTICK, &s);
+    CHECK(s.count >= 4);
+    CHECK_EQ(s.late, 0);
+    CHECK(s.latency_max < s.budget);
+    CHECK_EQ(s.budget, (uint32_t)(SYSTICK_TOP / BOARD_IRQ_TICK_DIV) * SYSTICK_PSC);
+
+    // Just past a tick, the next match falls half way through the mask
+    while (TCNT0 > 2) mock_run(16);
+    cli();
+    mock_run_us(1500);
+    sei();
+    mock_run(16);
+
+    irq_stats(IRQ_SYSTICK, &s);
+    CHECK_EQ(s.late, 1);
+    CHECK(s.latency_max >= TICK_CYCLES * 4 / 10);
+    CHECK(s.latency_max <= TICK_CYCLES * 6 / 10);
+    CHECK_EQ(irq_masked_max(), s.latency_max);
+}
+
+static void irq_suart_on_budget(void) {
+    irq_stats_t s;
+
+    irq_setup();
+    mock_serial_line(MOCK_PORT_C, 1 << PC2, MOCK_PORT_C, 1 << PC1, BOARD_SUART_BAUD);
+    suart_init();
+    suart_transmit_string((unsigned char*)"budget");
+    suart_flush();
+
+    irq_stats(IRQ_SUART_TX, &s);
+    CHECK(s.count >= 6 * 10);
+    CHECK_EQ(s.late, 0);
+    CHECK(s.budget >= BIT_CYCLES / BOARD_IRQ_SUART_DIV - 8);
+    CHECK(s.budget <= BIT_CYCLES / BOARD_IRQ_SUART_DIV);
+}
+
+// A 300 us callback every millisecond runs beside the software UART,
+// whose compares preempt it
+static void irq_callback_preempted(void) {
+    const char* out = "preempted callback";
+    irq_stats_t s;
+
+    irq_setup();
+    mock_serial_line(MOCK_PORT_C, 1 << PC2, MOCK_PORT_C, 1 << PC1, BOARD_SUART_BAUD);
+    suart_init();
+    TMR1_INIT(TMR1_CTC, 1000);
+    tmr1_ctc_callback(irq_slow_cb);
+
+    suart_transmit_string((unsigned char*)out);
+    while (mock_serial_out_len < strlen(out)) {
+        irq_burn_us = 300;
+        mock_run_us(1000);
+    }
+    suart_flush();
+    tmr1_ctc_callback(0);
+
+    CHECK_EQ(mock_serial_out_len, strlen(out));
+    CHECK(memcmp(mock_serial_out, out, strlen(out)) == 0);
+    CHECK(mock_serial_skew <= BIT_CYCLES / 16);
+    irq_stats(IRQ_SUART_TX, &s);
+    CHECK_EQ(s.late, 0);
+    irq_stats(IRQ_TMR1_CTC, &s);
+    CHECK(s.count >= 3);
+    CHECK_EQ(s.count, irq_runs);
+}
+
+// The same load with interrupts masked breaks the budget, and the line
+static void irq_masked_callback_flagged(void) {
+    const char* out = "masked callback";
+    irq_stats_t s;
+
+    irq_setup();
+    mock_serial_line(MOCK_PORT_C, 1 << PC2, MOCK_PORT_C, 1 << PC1, BOARD_SUART_BAUD);
+    suart_init();
+    TMR1_INIT(TMR1_CTC, 1000);
+    tmr1_ctc_callback(irq_masked_cb);
+
+    suart_transmit_string((unsigned char*)out);
+    suart_flush();
+    tmr1_ctc_callback(0);
+
+    irq_stats(IRQ_SUART_TX, &s);
+    CHECK(s.late > 0);
+    CHECK(s.latency_max > s.budget);
+    CHECK(irq_masked_max() >= s.latency_max);
+    CHECK(mock_serial_out_len != strlen(out) || memcmp(mock_serial_out, out, strlen(out)) != 0);
+}
+
+// A period that ends while the callback runs reruns it, never nests it
+static void irq_body_not_reentered(void) {
+    irq_stats_t s;
+
+    irq_setup();
+    TMR1_INIT(TMR1_CTC, 1000);
+    tmr1_ctc_callback(irq_slow_cb);
+    irq_burn_us = 1500;
+    mock_run_us(1100);          /*First match, then the long run*/
+    mock_run_us(1500);
+    tmr1_ctc_callback(0);
+
+    CHECK_EQ(irq_depth_max, 1);
+    CHECK_EQ(irq_depth, 0);
+    irq_stats(IRQ_TMR1_CTC, &s);
+    CHECK_EQ(s.nested, 1);
+    CHECK_EQ(s.count, irq_runs);
+    CHECK(irq_runs >= 3);
+    CHECK(SREG & (1 << SREG_I));
+}
+
+void test_irq(void) {
+    printf("irq\n");
+    RUN(irq_stamps_against_budget);
+    RUN(irq_systick_sees_masked_time);
+    RUN(irq_suart_on_budget);
+    RUN(irq_callback_preempted);
+    RUN(irq_masked_callback_flagged);
+    RUN(irq_body_not_reentered);
+}
@@ -0,0 +1,356 @@
+/***********************************************************************
+* Logging pipeline tests, batches decoded back into records            *
+***********************************************************************/
+
+#include "test.h"
+#include "log.h"
+#include "uart.h"
+#include "twi_hal.h"
+#include <string.h>
+#include <util/crc16.h>
+
+#define CAP_SIZE 512
+
+// Capture sink, takes at most cap_chunk bytes a call, nothing while busy
+static uint8_t cap[CAP_SIZE];
+static uint16_t cap_len;
+static uint8_t cap_chunk;
+static bool cap_busy;
+
+static uint8_t cap_sink(const uint8_t* data, uint8_t len) {
+    if (cap_busy) return 0;
+    if (len > cap_chunk) len = cap_chunk;
+    memcpy(&cap[cap_len], data, len);
+    cap_len += len;
+    return len;
+}
+
+static void log_setup(void) {
+    test_boot();
+    cap_len = 0;
+    cap_chunk = 255;
+    cap_busy = false;
+    log_init(cap_sink);
+}
+
+// Runs the task until n batches have gone to the sink
+static void log_wait_batches(uint32_t n) {
+    log_stats_t st;
+    uint16_t tries = 0;
+
+    do {
+        log_task();
+        log_stats(&st);
+    } while (st.batches < n && ++tries < 1000);
+    CHECK_EQ(st.batches, n);
+}
+
+static uint32_t varint(const uint8_t** p) {
+    uint32_t v = 0;
+    uint8_t shift = 0;
+
+    do {
+        v |= (uint32_t)(**p & 0x7F) << shift;
+        shift += 7;
+    } while (*(*p)++ & 0x80);
+    return v;
+}
+
+// Decodes one batch at b into out, returns the record count or -1
+static int decode(const uint8_t* b, log_rec_t* out) {
+    const uint8_t* p = b + LOG_HEADER;
+    uint16_t last[LOG_SRC_COUNT] = {0};
+    uint8_t crc = 0xFF;
+    uint32_t t;
+    uint32_t zz;
+    uint8_t tag;
+    int i;
+
+    if (b[0] != LOG_MAGIC) return -1;
+    for (i = 0; i < b[1]; i++) crc = _crc8_ccitt_update(crc, b[i]);
+    if (crc != 0) return -1;
+
+    memcpy(&t, &b[3], sizeof(t));
+    for (i = 0; i < b[2]; i++) {
+        tag = *p++;
+        if (!(tag & 0x40)) t += varint(&p);
+        out[i].ms = t;
+        out[i].src = (tag >> 4) & 0x03;
+        out[i].ch = tag & 0x0F;
+        if (!(tag & 0x80)) {
+            zz = varint(&p);
+            last[out[i].src] += (zz & 1) ? ~(zz >> 1) : (zz >> 1);
+        }
+        out[i].value = last[out[i].src];
+    }
+    if (p != b + b[1] - 1) return -1;
+    return b[2];
+}
+
+static void log_round_trips_records(void) {
+    log_rec_t got[16];
+    log_stats_t st;
+
+    log_setup();
+    CHECK_EQ(log_put(LOG_SRC_ADC, 3, 512), LOG_OK);
+    CHECK_EQ(log_put(LOG_SRC_ADC, 3, 512), LOG_OK);
+    mock_run_us(5000);
+    CHECK_EQ(log_put(LOG_SRC_GPIO, 2, 0x0101), LOG_OK);
+    CHECK_EQ(log_put(LOG_SRC_ADC, 3, 498), LOG_OK);
+    CHECK_EQ(log_put(LOG_SRC_USER, 15, 0xFFFF), LOG_OK);
+    CHECK_EQ(log_put(LOG_SRC_USER, 16, 0), LOG_INVALID_CH);
+
+    log_task();
+    CHECK_EQ(cap_len, 0);       /*Not full and not due yet*/
+    log_flush();
+
+    CHECK_EQ(decode(cap, got), 5);
+    CHECK_EQ(cap_len, cap[1]);
+    CHECK_EQ(got[0].value, 512);
+    CHECK_EQ(got[1].ms, got[0].ms);
+    CHECK_EQ(got[1].value, 512);
+    CHECK(got[2].ms - got[0].ms >= 5);
+    CHECK_EQ(got[2].src, LOG_SRC_GPIO);
+    CHECK_EQ(got[2].value, 0x0101);
+    CHECK_EQ(got[3].ch, 3);
+    CHECK_EQ(got[3].value, 498);
+    CHECK_EQ(got[4].ch, 15);
+    CHECK_EQ(got[4].value, 0xFFFF);
+
+    // Repeats cost a tag byte and a small change two
+    CHECK_EQ(cap[LOG_HEADER + 3], 0xC3);
+
+    log_stats(&st);
+    CHECK_EQ(st.logged, 5);
+    CHECK_EQ(st.batches, 1);
+    CHECK_EQ(st.bytes_in, 5 * sizeof(log_rec_t));
+    CHECK_EQ(st.bytes_out, cap_len);
+    CHECK(st.bytes_out < st.bytes_in);
+}
+
+static void log_closes_batch_on_time_and_size(void) {
+    log_rec_t got[64];
+    uint16_t off = 0;
+    int total = 0;
+    int n;
+    uint8_t i;
+
+    log_setup();
+    log_put(LOG_SRC_ADC, 0, 100);
+    log_task();
+    mock_run_us(LOG_BATCH_MS * 1000UL - 2000UL);
+    log_task();
+    CHECK_EQ(cap_len, 0);
+    mock_run_us(3000);
+    log_task();
+    CHECK(cap_len > 0);
+    CHECK_EQ(decode(cap, got), 1);
+
+    // Large swings fill a batch well before the deadline
+    cap_len = 0;
+    for (i = 0; i < 40; i++) {
+        log_put(LOG_SRC_ADC, 0, (i & 1) ? 0 : 1023);
+        if (i % 8 == 7) log_task();
+    }
+    log_flush();
+    while (off < cap_len) {
+        n = decode(&cap[off], got);
+        CHECK(n > 0);
+        if (n <= 0) break;
+        CHECK_EQ(got[0].value, (total & 1) ? 0 : 1023);
+        CHECK(cap[off + 1] <= LOG_BATCH_SIZE);
+        total += n;
+        off += cap[off + 1];
+    }
+    CHECK_EQ(total, 40);
+}
+
+// A flush with no batch open leaves the next one to fill as usual
+static void log_idle_flush_is_forgotten(void) {
+    log_rec_t got[4];
+    uint8_t i;
+
+    log_setup();
+    log_flush();
+    for (i = 0; i < 3; i++) {
+        log_put(LOG_SRC_ADC, 0, 100 + i);
+        log_task();
+    }
+    CHECK_EQ(cap_len, 0);
+    log_flush();
+    CHECK_EQ(decode(cap, got), 3);
+}
+
+static void log_full_ring_drops_and_backpressures(void) {
+    log_stats_t st;
+    uint8_t i;
+
+    log_setup();
+    for (i = 0; i < LOG_RING_SIZE - 1; i++) {
+        CHECK_EQ(log_backpressure(), i >= LOG_HIGH_WATER);
+        CHECK_EQ(log_put(LOG_SRC_ADC, 0, i), LOG_OK);
+    }
+    CHECK_EQ(log_put(LOG_SRC_ADC, 0, 99), LOG_FULL);
+
+    log_stats(&st);
+    CHECK_EQ(st.logged, LOG_RING_SIZE - 1);
+    CHECK_EQ(st.dropped, 1);
+    CHECK_EQ(st.peak, LOG_RING_SIZE - 1);
+
+    log_task();
+    CHECK(!log_backpressure());
+    log_stats_reset();
+    log_stats(&st);
+    CHECK_EQ(st.dropped, 0);
+}
+
+static void log_busy_sink_holds_batch(void) {
+    log_rec_t got[8];
+    log_stats_t st;
+
+    log_setup();
+    cap_busy = true;
+    log_put(LOG_SRC_ADC, 1, 10);
+    log_flush();
+    log_put(LOG_SRC_ADC, 1, 20);
+    log_task();
+    log_stats(&st);
+    CHECK_EQ(st.sink_busy, 2);
+    CHECK_EQ(st.batches, 0);
+
+    // The held batch goes whole, then the next one opens, a few bytes a call
+    cap_busy = false;
+    cap_chunk = 3;
+    log_task();
+    log_task();
+    log_task();
+    log_flush();
+    log_wait_batches(2);
+    CHECK_EQ(cap_len, cap[1] + cap[cap[1] + 1]);
+    CHECK_EQ(decode(cap, got), 1);
+    CHECK_EQ(got[0].value, 10);
+    CHECK_EQ(decode(&cap[cap[1]], got), 1);
+    CHECK_EQ(got[0].value, 20);
+    log_stats(&st);
+    CHECK_EQ(st.batches, 2);
+}
+
+static void log_rtc_stores_second_of_day(void) {
+    const uint8_t bcd[3] = {0x59, 0x59, 0x23};
+    log_rec_t got[1];
+
+    log_setup();
+    CHECK_EQ(log_rtc(bcd), LOG_OK);
+    log_flush();
+    CHECK_EQ(decode(cap, got), 1);
+    CHECK_EQ(got[0].src, LOG_SRC_RTC);
+    CHECK_EQ(((uint32_t)got[0].ch << 16) | got[0].value, 86399UL);
+}
+
+// Rebuilds a batch from the "D<offset><hex>" lines on the UART, skipping
+// the other lines. Returns the D lines seen, -1 if any line is not whole.
+static int log_uart_lines(uint8_t* batch) {
+    uint16_t i = 0, end, k;
+    unsigned at, byte;
+    int lines = 0;
+
+    while (i < mock_uart_out_len) {
+        for (end = i; end < mock_uart_out_len && mock_uart_out[end] != '\n'; end++);
+        if (end == mock_uart_out_len || end == i || mock_uart_out[end - 1] != '\r') return -1;
+        if (mock_uart_out[i] == 'D') {
+            if ((end - i) % 2 != 0 || end - i < 6) return -1;
+            for (k = i + 1; k < end - 1; k++) {
+                if (!strchr("0123456789ABCDEF", mock_uart_out[k])) return -1;
+            }
+            sscanf((const char*)&mock_uart_out[i + 1], "%2X", &at);
+            for (k = i + 3; k < end - 1; k += 2) {
+                sscanf((const char*)&mock_uart_out[k], "%2X", &byte);
+                batch[at++] = byte;
+            }
+            lines++;
+        }
+        i = end + 1;
+    }
+    return lines;
+}
+
+static void log_uart_sink_prints_hex_lines(void) {
+    uint8_t batch[LOG_BATCH_SIZE];
+    log_rec_t got[2];
+
+    log_setup();
+    uart_init(TX, false, NONE);
+    log_init(log_sink_uart);
+    log_put(LOG_SRC_ADC, 0, 300);
+    log_put(LOG_SRC_ADC, 0, 301);
+    log_flush();
+    log_wait_batches(1);
+    uart_flush();
+
+    CHECK_EQ(mock_uart_out[0], 'D');
+    CHECK_EQ(log_uart_lines(batch), 1);
+    CHECK_EQ(mock_uart_out_len, 3 + 2 * batch[1] + 2);
+    CHECK_EQ(decode(batch, got), 2);
+    CHECK_EQ(got[1].value, 301);
+}
+
+// A full batch needs several lines, other tasks' text goes out between
+// them and never inside one
+static void log_uart_lines_stay_whole(void) {
+    uint8_t batch[LOG_BATCH_SIZE];
+    log_rec_t got[LOG_BATCH_SIZE];
+    log_stats_t st;
+    uint8_t i = 0;
+
+    log_setup();
+    uart_init(TX, false, NONE);
+    log_init(log_sink_uart);
+    do {
+        log_put(LOG_SRC_ADC, i & 0x03, (i & 1) ? 1000 + i : i);
+        log_put(LOG_SRC_GPIO, 5, i);
+        log_task();
+        uart_transmit_string((unsigned char*)"PORTB: 0x3F\r\n");
+        mock_run_us(2000);
+        log_stats(&st);
+    } while (st.batches == 0 && ++i < 100);
+    uart_flush();
+
+    CHECK_EQ(st.batches, 1);
+    CHECK(log_uart_lines(batch) >= 3);
+    CHECK(batch[1] > LOG_BATCH_SIZE - LOG_REC_MAX - 1);
+    CHECK(decode(batch, got) > 0);
+}
+
+static void log_24c_sink_writes_pages(void) {
+    static mock_twi_slave_t eeprom;
+    log_rec_t got[8];
+    uint8_t i;
+
+    log_setup();
+    memset(&eeprom, 0, sizeof(eeprom));
+    eeprom.addr = LOG_24C_ADDR;
+    mock_twi_attach(&eeprom);
+    twi_init(false);
+
+    log_init(log_sink_24c);
+    for (i = 0; i < 8; i++) log_put(LOG_SRC_ADC, 2, 700 + i * 50);
+    log_flush();
+    log_wait_batches(1);
+
+    CHECK(eeprom.reg[1] > LOG_24C_PAGE);
+    CHECK_EQ(decode(eeprom.reg, got), 8);
+    CHECK_EQ(got[7].value, 1050);
+}
+
+void test_log(void) {
+    printf("log\n");
+    RUN(log_round_trips_records);
+    RUN(log_closes_batch_on_time_and_size);
+    RUN(log_idle_flush_is_forgotten);
+    RUN(log_full_ring_drops_and_backpressures);
+    RUN(log_busy_sink_holds_batch);
+    RUN(log_rtc_stores_second_of_day);
+    RUN(log_uart_sink_prints_hex_lines);
+    RUN(log_uart_lines_stay_whole);
+    RUN(log_24c_sink_writes_pages);
+}
@@ -0,0 +1,34 @@
+/***********************************************************************
+* Host unit test runner                                                *
+* Purpose: Run every suite against the register mock, `make test`      *
+***********************************************************************/
+
+#include "test.h"
+
+unsigned test_checks = 0;
+unsigned test_failures = 0;
+
+int main(void) {
+    test_ring();
+    test_fmt();
+    test_gpio();
+    test_uart();
+    test_adc();
+    test_twi();
+    test_mem();
+    test_ee();
+    test_log();
+    test_spi();
+    test_oled();
+    test_fix();
+    test_stats();
+    test_acomp();
+    test_clk();
+    test_cmd();
+    test_twi_soft();
+    test_suart();
+    test_irq();
+
+    printf("%u checks, %u failed\n", test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
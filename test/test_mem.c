@@ -0,0 +1,61 @@
+/***********************************************************************
+* SRAM high-water mark tests, on the mock's SRAM between .bss at       *
+* MOCK_HEAP_START and the stack at RAMEND                              *
+***********************************************************************/
+
+#include "test.h"
+#include "mem.h"
+#include <string.h>
+
+#define FRAME 0x20      /*Stack the pretend caller is using*/
+
+static void mem_setup(void) {
+    SP = RAMEND - FRAME;
+    mem_paint();
+}
+
+static void mem_paint_stops_below_sp(void) {
+    uint16_t a;
+
+    memset(&mock_ram[RAMEND - FRAME - MEM_GUARD + 1], 0x11, FRAME + MEM_GUARD);
+    mem_setup();
+
+    CHECK_EQ(mock_ram[MOCK_HEAP_START - 1], 0);
+    CHECK_EQ(mock_ram[MOCK_HEAP_START], MEM_CANARY);
+    CHECK_EQ(mock_ram[RAMEND - FRAME - MEM_GUARD], MEM_CANARY);
+    for (a = RAMEND - FRAME - MEM_GUARD + 1; a <= RAMEND; a++) CHECK_EQ(mock_ram[a], 0x11);
+}
+
+static void mem_reports_deepest_stack(void) {
+    mem_stats_t st;
+
+    mem_setup();
+    mock_ram[0x700] = 0x42;     /*A call chain reached down to here*/
+    mock_ram[0x780] = 0x00;
+    mem_stats(&st);
+
+    CHECK_EQ(st.static_bytes, MOCK_HEAP_START - RAMSTART);
+    CHECK_EQ(st.free_min, 0x700 - MOCK_HEAP_START);
+    CHECK_EQ(st.stack_peak, RAMEND + 1 - 0x700);
+    CHECK_EQ(st.stack_now, FRAME);
+    CHECK_EQ(mem_free_min(), st.free_min);
+}
+
+static void mem_repaint_restarts_mark(void) {
+    uint16_t before;
+
+    mem_setup();
+    before = mem_free_min();
+    mock_ram[MOCK_HEAP_START + 8] = 0;
+    CHECK_EQ(mem_free_min(), 8);
+
+    mem_paint();
+    CHECK_EQ(mem_free_min(), before);
+}
+
+void test_mem(void) {
+    printf("mem\n");
+    RUN(mem_paint_stops_below_sp);
+    RUN(mem_reports_deepest_stack);
+    RUN(mem_repaint_restarts_mark);
+}
@@ -0,0 +1,225 @@
+/***********************************************************************
+* SSD1306 driver tests against a GDDRAM model on the TWI bus           *
+***********************************************************************/
+
+#include "test.h"
+#include "oled.h"
+#include "font5x7.h"
+#include "twi_hal.h"
+#include <avr/pgmspace.h>
+#include <string.h>
+
+// Panel model, horizontal addressing inside the last column/page window
+static mock_twi_slave_t panel;
+static uint8_t gddram[OLED_PAGES * OLED_WIDTH];
+static uint8_t ctrl;
+static uint8_t cmd[3];
+static uint8_t cmd_n;
+static uint8_t col0, col1, page0, page1, col, page;
+static bool panel_on;
+static uint8_t contrast;
+static uint16_t data_bytes;
+static uint8_t windows;
+
+static uint8_t cmd_len(uint8_t c) {
+    switch (c) {
+        case 0x21: case 0x22:
+            return 3;
+        case 0xD5: case 0xA8: case 0xD3: case 0x8D: case 0x20:
+        case 0xDA: case 0x81: case 0xD9: case 0xDB:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+static void panel_write(uint16_t n, uint8_t b) {
+    if (n == 0) {
+        ctrl = b;
+        cmd_n = 0;
+        return;
+    }
+    if (ctrl == OLED_CTRL_DATA) {
+        gddram[page * OLED_WIDTH + col] = b;
+        data_bytes++;
+        if (col++ == col1) {
+            col = col0;
+            page = (page == page1) ? page0 : page + 1;
+        }
+        return;
+    }
+
+    cmd[cmd_n++] = b;
+    if (cmd_n < cmd_len(cmd[0])) return;
+    cmd_n = 0;
+    switch (cmd[0]) {
+        case 0x21:
+            col = col0 = cmd[1];
+            col1 = cmd[2];
+            windows++;
+            break;
+        case 0x22:
+            page = page0 = cmd[1];
+            page1 = cmd[2];
+            break;
+        case 0x81:
+            contrast = cmd[1];
+            break;
+        case 0xAE: case 0xAF:
+            panel_on = cmd[0] & 1;
+            break;
+    }
+}
+
+static void oled_setup(void) {
+    test_boot();
+    memset(&panel, 0, sizeof(panel));
+    panel.addr = OLED_ADDR;
+    panel.write = panel_write;
+    mock_twi_attach(&panel);
+    twi_init(false);
+
+    memset(gddram, 0xAA, sizeof(gddram));
+    col0 = col = page0 = page = 0;
+    col1 = OLED_WIDTH - 1;
+    page1 = OLED_PAGES - 1;
+    panel_on = false;
+    data_bytes = 0;
+    windows = 0;
+}
+
+static void oled_start(void) {
+    oled_setup();
+    oled_init();
+    oled_flush();
+    data_bytes = 0;
+    windows = 0;
+}
+
+static void oled_init_clears_panel(void) {
+    oled_setup();
+    CHECK_EQ(oled_init(), OLED_OK);
+    CHECK(panel_on);
+    CHECK(oled_dirty());
+    CHECK_EQ(oled_flush(), OLED_OK);
+    CHECK(!oled_dirty());
+
+    // Full width pages merge, bounded by the region size
+    CHECK_EQ(data_bytes, OLED_PAGES * OLED_WIDTH);
+    CHECK_EQ(windows, OLED_PAGES * OLED_WIDTH / 256);
+    CHECK(memcmp(gddram, oled_buffer(), sizeof(gddram)) == 0);
+    CHECK_EQ(gddram[0], 0);
+
+    CHECK_EQ(oled_contrast(0x20), OLED_OK);
+    CHECK_EQ(contrast, 0x20);
+    CHECK_EQ(oled_power(false), OLED_OK);
+    CHECK(!panel_on);
+}
+
+static void oled_sends_only_changes(void) {
+    oled_start();
+    CHECK_EQ(oled_text(0, 0, "12:00"), OLED_OK);
+    CHECK_EQ(oled_flush(), OLED_OK);
+    CHECK_EQ(windows, 1);
+    CHECK(data_bytes <= 5 * OLED_CHAR_W);
+    CHECK(memcmp(gddram, oled_buffer(), sizeof(gddram)) == 0);
+
+    // The same text again is not even dirty, one new digit is one glyph
+    oled_text(0, 0, "12:00");
+    CHECK(!oled_dirty());
+    data_bytes = 0;
+    windows = 0;
+    oled_text(0, 0, "12:01");
+    oled_flush();
+    CHECK_EQ(windows, 1);
+    CHECK(data_bytes <= FONT_WIDTH);
+    CHECK(memcmp(gddram, oled_buffer(), sizeof(gddram)) == 0);
+
+    // Two rows are two regions
+    data_bytes = 0;
+    windows = 0;
+    oled_text_P(OLED_WIDTH - 2 * OLED_CHAR_W, 1, PSTR("ok"));
+    oled_char(0, OLED_PAGES - 1, '#');
+    oled_flush();
+    CHECK_EQ(windows, 2);
+    CHECK(memcmp(gddram, oled_buffer(), sizeof(gddram)) == 0);
+}
+
+static void oled_digit_costs_far_less_than_screen(void) {
+    uint64_t start;
+    uint32_t full, digit;
+
+    oled_setup();
+    oled_init();
+    start = mock_cycles;
+    oled_flush();
+    full = mock_cycles - start;
+
+    oled_text(0, 0, "12:00");
+    oled_flush();
+    oled_text(0, 0, "12:01");
+    start = mock_cycles;
+    oled_flush();
+    digit = mock_cycles - start;
+
+    CHECK(full > 10UL * (F_CPU / 1000UL));
+    CHECK(digit < F_CPU / 1000UL);
+    CHECK(digit * 20 < full);
+}
+
+static void oled_draws_pixels_and_bars(void) {
+    oled_start();
+    CHECK_EQ(oled_pixel(OLED_WIDTH - 1, OLED_HEIGHT - 1, true), OLED_OK);
+    CHECK_EQ(oled_pixel(OLED_WIDTH, 0, true), OLED_INVALID_POS);
+    CHECK_EQ(oled_pixel(0, OLED_HEIGHT, true), OLED_INVALID_POS);
+    CHECK_EQ(oled_bar(10, 0, 12, 4), OLED_OK);
+    CHECK_EQ(oled_bar(120, 0, 12, 4), OLED_INVALID_POS);
+    oled_flush();
+
+    CHECK_EQ(gddram[(OLED_PAGES - 1) * OLED_WIDTH + OLED_WIDTH - 1], 0x80);
+    CHECK_EQ(gddram[10], 0x7E);
+    CHECK_EQ(gddram[14], 0x7E);
+    CHECK_EQ(gddram[15], 0x42);
+    CHECK_EQ(gddram[21], 0x7E);
+
+    oled_pixel(OLED_WIDTH - 1, OLED_HEIGHT - 1, false);
+    oled_flush();
+    CHECK_EQ(gddram[(OLED_PAGES - 1) * OLED_WIDTH + OLED_WIDTH - 1], 0x00);
+}
+
+static void oled_text_bounds(void) {
+    oled_start();
+    CHECK_EQ(oled_char(OLED_WIDTH - OLED_CHAR_W + 1, 0, 'A'), OLED_INVALID_POS);
+    CHECK_EQ(oled_char(0, OLED_PAGES, 'A'), OLED_INVALID_POS);
+    CHECK_EQ(oled_text(OLED_WIDTH - 2 * OLED_CHAR_W, 0, "abc"), OLED_INVALID_POS);
+
+    // Outside the font shows as '?'
+    oled_clear();
+    oled_char(0, 0, '?');
+    oled_char(OLED_CHAR_W, 0, '\x7F');
+    CHECK(memcmp(oled_buffer(), oled_buffer() + OLED_CHAR_W, OLED_CHAR_W) == 0);
+}
+
+static void oled_bus_error_keeps_dirty(void) {
+    oled_setup();
+    panel.addr = OLED_ADDR + 1;
+    CHECK_EQ(oled_init(), OLED_BUS);
+    oled_text(0, 0, "x");
+    CHECK_EQ(oled_update(), OLED_BUS);
+    CHECK(oled_dirty());
+
+    panel.addr = OLED_ADDR;
+    CHECK_EQ(oled_flush(), OLED_OK);
+    CHECK(!oled_dirty());
+    CHECK(memcmp(gddram, oled_buffer(), sizeof(gddram)) == 0);
+}
+
+void test_oled(void) {
+    printf("oled\n");
+    RUN(oled_init_clears_panel);
+    RUN(oled_sends_only_changes);
+    RUN(oled_digit_costs_far_less_than_screen);
+    RUN(oled_draws_pixels_and_bars);
+    RUN(oled_text_bounds);
+    RUN(oled_bus_error_keeps_dirty);
+}
@@ -0,0 +1,62 @@
+/***********************************************************************
+* Ring buffer tests                                                    *
+***********************************************************************/
+
+#include "test.h"
+#include "ring.h"
+
+static uint8_t ring_buf[8];
+
+static void ring_starts_empty(void) {
+    ring_t r = RING_INIT(ring_buf);
+
+    CHECK(ring_empty(&r));
+    CHECK(!ring_full(&r));
+    CHECK_EQ(ring_count(&r), 0);
+    CHECK_EQ(ring_space(&r), 7);
+}
+
+// One slot stays free to tell full from empty
+static void ring_fills_to_size_minus_one(void) {
+    ring_t r = RING_INIT(ring_buf);
+    uint8_t i;
+
+    for (i = 0; i < 7; i++) CHECK(ring_put(&r, i));
+    CHECK(ring_full(&r));
+    CHECK(!ring_put(&r, 0xAA));
+    CHECK_EQ(ring_count(&r), 7);
+    CHECK_EQ(ring_space(&r), 0);
+}
+
+static void ring_keeps_order_across_wrap(void) {
+    ring_t r = RING_INIT(ring_buf);
+    uint8_t i, b = 0;
+
+    for (i = 0; i < 5; i++) ring_put(&r, i);
+    for (i = 0; i < 5; i++) ring_get(&r, &b);
+    for (i = 0; i < 6; i++) CHECK(ring_put(&r, 0x10 + i));
+    CHECK_EQ(ring_count(&r), 6);
+    for (i = 0; i < 6; i++) {
+        CHECK(ring_get(&r, &b));
+        CHECK_EQ(b, 0x10 + i);
+    }
+    CHECK(!ring_get(&r, &b));
+}
+
+static void ring_flush_drops_everything(void) {
+    ring_t r = RING_INIT(ring_buf);
+
+    ring_put(&r, 1);
+    ring_put(&r, 2);
+    ring_flush(&r);
+    CHECK(ring_empty(&r));
+    CHECK_EQ(ring_space(&r), 7);
+}
+
+void test_ring(void) {
+    printf("ring\n");
+    RUN(ring_starts_empty);
+    RUN(ring_fills_to_size_minus_one);
+    RUN(ring_keeps_order_across_wrap);
+    RUN(ring_flush_drops_everything);
+}
@@ -0,0 +1,190 @@
+/***********************************************************************
+* SPI master driver tests against a slave that answers byte ^ 0x5A     *
+***********************************************************************/
+
+#include "test.h"
+#include "spi.h"
+#include <string.h>
+
+static const spi_dev_t flash = SPI_DEV(GPIO_B, PORTB2, SPI_MODE0, SPI_DIV16, SPI_MSB_FIRST);
+static const spi_dev_t dac = SPI_DEV(GPIO_D, PORTD4, SPI_MODE3, SPI_DIV2, SPI_LSB_FIRST);
+
+static uint8_t done_count;
+
+static uint8_t xor_slave(uint8_t mosi) {
+    return mosi ^ 0x5A;
+}
+
+static void spi_setup(void) {
+    test_boot();
+    mock_spi_reply = xor_slave;
+    done_count = 0;
+    spi_init();
+    spi_dev_init(&flash);
+    spi_dev_init(&dac);
+}
+
+static void count_done(spi_xfer_t* x) {
+    done_count++;
+}
+
+static void spi_transfer_is_full_duplex(void) {
+    const uint8_t tx[4] = {0x03, 0x00, 0x10, 0x20};
+    uint8_t rx[4] = {0};
+    uint64_t start;
+    uint8_t i;
+
+    spi_setup();
+    CHECK(PORTB & (1 << PORTB2));
+    start = mock_cycles;
+    CHECK_EQ(spi_transfer(&flash, tx, rx, sizeof(rx)), SPI_OK);
+    CHECK(mock_cycles - start >= 4 * 8 * 16);
+
+    CHECK_EQ(mock_spi_out_len, 4);
+    for (i = 0; i < 4; i++) {
+        CHECK_EQ(mock_spi_out[i].mosi, tx[i]);
+        CHECK_EQ(rx[i], tx[i] ^ 0x5A);
+        CHECK(!(mock_spi_out[i].portb & (1 << PORTB2)));
+        CHECK_EQ(mock_spi_out[i].spcr & ((1 << CPOL) | (1 << CPHA) | (1 << DORD) | 0x03), SPI_DIV16);
+    }
+    CHECK(PORTB & (1 << PORTB2));
+    CHECK(!spi_busy());
+    CHECK(PRR & (1 << PRSPI));
+}
+
+static void spi_queue_switches_devices(void) {
+    uint8_t a_tx[3] = {1, 2, 3};
+    uint8_t b_rx[2] = {0};
+    spi_xfer_t a = {&flash, a_tx, a_tx, sizeof(a_tx), count_done};
+    spi_xfer_t b = {&dac, NULL, b_rx, sizeof(b_rx), count_done};
+    uint64_t start;
+
+    spi_setup();
+    start = mock_cycles;
+    CHECK_EQ(spi_submit(&a), SPI_OK);
+    CHECK_EQ(spi_submit(&b), SPI_OK);
+    CHECK(mock_cycles - start < 8 * 16);    /*Returned before the first byte was out*/
+    CHECK(a.busy && b.busy);
+    CHECK(spi_busy());
+
+    spi_wait(&b);
+    CHECK(!a.busy && !b.busy);
+    CHECK_EQ(done_count, 2);
+
+    // In place receive, then the second device with its own mode and clock
+    CHECK_EQ(a_tx[0], 1 ^ 0x5A);
+    CHECK_EQ(a_tx[2], 3 ^ 0x5A);
+    CHECK_EQ(b_rx[1], SPI_FILL ^ 0x5A);
+    CHECK_EQ(mock_spi_out_len, 5);
+    CHECK_EQ(mock_spi_out[3].mosi, SPI_FILL);
+    CHECK(mock_spi_out[2].spcr & (1 << SPIE));
+    CHECK(!(mock_spi_out[2].portb & (1 << PORTB2)));
+    CHECK(mock_spi_out[2].portd & (1 << PORTD4));
+    CHECK(mock_spi_out[3].portb & (1 << PORTB2));
+    CHECK(!(mock_spi_out[3].portd & (1 << PORTD4)));
+    CHECK_EQ(mock_spi_out[3].spcr & ((1 << CPOL) | (1 << CPHA) | (1 << DORD)), (1 << CPOL) | (1 << CPHA) | (1 << DORD));
+    CHECK(mock_spi_out[3].spsr & (1 << SPI2X));
+    CHECK(!spi_busy());
+}
+
+static void spi_rejects_bad_requests(void) {
+    const spi_dev_t on_mosi = SPI_DEV(GPIO_B, PORTB3, SPI_MODE0, SPI_DIV4, SPI_MSB_FIRST);
+    const spi_dev_t on_reset = SPI_DEV(GPIO_C, 6, SPI_MODE0, SPI_DIV4, SPI_MSB_FIRST);
+    const spi_dev_t slow = SPI_DEV(GPIO_B, PORTB2, SPI_MODE0, SPI_DIV128, SPI_MSB_FIRST);
+    spi_xfer_t x[SPI_QUEUE_SIZE];
+    spi_xfer_t empty = {&flash, NULL, NULL, 0};
+    uint8_t i;
+
+    spi_setup();
+    CHECK_EQ(spi_dev_init(&on_mosi), SPI_INVALID_DEV);
+    CHECK_EQ(spi_dev_init(&on_reset), SPI_INVALID_DEV);
+    CHECK_EQ(spi_submit(&empty), SPI_INVALID_LEN);
+    CHECK_EQ(spi_burst(&flash, NULL, NULL, 0), SPI_INVALID_LEN);
+
+    memset(x, 0, sizeof(x));
+    for (i = 0; i < SPI_QUEUE_SIZE; i++) {
+        x[i].dev = &slow;
+        x[i].len = 1;
+    }
+    for (i = 0; i < SPI_QUEUE_SIZE - 1; i++) CHECK_EQ(spi_submit(&x[i]), SPI_OK);
+    CHECK_EQ(spi_submit(&x[SPI_QUEUE_SIZE - 1]), SPI_FULL);
+    CHECK_EQ(spi_submit(&x[0]), SPI_BUSY);
+    spi_flush();
+    CHECK_EQ(mock_spi_out_len, SPI_QUEUE_SIZE - 1);
+}
+
+static void spi_burst_runs_back_to_back(void) {
+    static uint8_t block[256];
+    static uint8_t back[256];
+    uint8_t first = 0x9F;
+    spi_xfer_t x = {&flash, &first, NULL, 1};
+    uint64_t start;
+    uint16_t i;
+
+    spi_setup();
+    for (i = 0; i < sizeof(block); i++) block[i] = (uint8_t)i;
+
+    // A queued transfer finishes before the burst takes the bus
+    spi_submit(&x);
+    spi_burst(&dac, block, NULL, 1);
+    CHECK(!x.busy);
+    CHECK_EQ(mock_spi_out[0].mosi, 0x9F);
+
+    mock_spi_out_len = 0;
+    start = mock_cycles;
+    CHECK_EQ(spi_burst(&dac, block, back, sizeof(block)), SPI_OK);
+    CHECK_EQ(mock_spi_out_len, 256);
+    for (i = 0; i < sizeof(block); i++) CHECK_EQ(back[i], block[i] ^ 0x5A);
+    CHECK(!(mock_spi_out[255].spcr & (1 << SPIE)));
+    CHECK(!(mock_spi_out[255].portd & (1 << PORTD4)));
+    CHECK(PORTD & (1 << PORTD4));
+    CHECK(PRR & (1 << PRSPI));
+    CHECK(mock_cycles - start >= 256 * 8 * 2);
+}
+
+static void spi_polls_with_interrupts_masked(void) {
+    const uint8_t tx[2] = {0xAA, 0x55};
+    uint8_t rx[2] = {0};
+
+    spi_setup();
+    cli();
+    CHECK_EQ(spi_transfer(&flash, tx, rx, sizeof(rx)), SPI_OK);
+    sei();
+    CHECK_EQ(rx[0], 0xAA ^ 0x5A);
+    CHECK_EQ(rx[1], 0x55 ^ 0x5A);
+    CHECK(!spi_busy());
+}
+
+// Callback from the ISR queueing the next transfer
+static uint8_t chain_buf[1] = {0x42};
+static spi_xfer_t chain_next = {&dac, chain_buf, NULL, 1, count_done};
+
+static void chain_done(spi_xfer_t* x) {
+    done_count++;
+    spi_submit(&chain_next);
+}
+
+static void spi_done_callback_can_submit(void) {
+    uint8_t b = 0x01;
+    spi_xfer_t x = {&flash, &b, NULL, 1, chain_done};
+
+    spi_setup();
+    chain_next.busy = false;
+    spi_submit(&x);
+    spi_wait(&x);
+    spi_wait(&chain_next);
+    CHECK_EQ(done_count, 2);
+    CHECK_EQ(mock_spi_out_len, 2);
+    CHECK_EQ(mock_spi_out[1].mosi, 0x42);
+    CHECK(!spi_busy());
+}
+
+void test_spi(void) {
+    printf("spi\n");
+    RUN(spi_transfer_is_full_duplex);
+    RUN(spi_queue_switches_devices);
+    RUN(spi_rejects_bad_requests);
+    RUN(spi_burst_runs_back_to_back);
+    RUN(spi_polls_with_interrupts_masked);
+    RUN(spi_done_callback_can_submit);
+}
@@ -0,0 +1,156 @@
+/***********************************************************************
+* Driver statistics tests                                              *
+***********************************************************************/
+
+#include "test.h"
+#include "stats.h"
+#include "counter.h"
+#include <string.h>
+
+static mock_twi_slave_t rtc;
+
+static void stats_setup(void) {
+    test_boot();
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.addr = 0x68;
+    mock_twi_attach(&rtc);
+    twi_init(false);
+    uart_init(BOTH, false, NONE);
+    stats_reset();
+}
+
+static void stats_counters_saturate(void) {
+    uint8_t c8 = 0xFE;
+    uint16_t c16 = 0xFFF0;
+    uint32_t c32 = 0xFFFFFFFEUL;
+
+    STAT_INC(c8);
+    CHECK_EQ(c8, 0xFF);
+    STAT_INC(c8);
+    CHECK_EQ(c8, 0xFF);
+    STAT_ADD(c16, 0x0F);
+    CHECK_EQ(c16, 0xFFFF);
+    c16 = 0xFFF0;
+    STAT_ADD(c16, 0x100);
+    CHECK_EQ(c16, 0xFFFF);
+    STAT_ADD(c32, 1);
+    CHECK_EQ(c32, 0xFFFFFFFFUL);
+    STAT_INC(c32);
+    CHECK_EQ(c32, 0xFFFFFFFFUL);
+}
+
+static void stats_count_twi(void) {
+    uint8_t buf[7] = {0};
+    stats_t s;
+    uint64_t start;
+
+    stats_setup();
+    CHECK_EQ(twi_write(0x68, 0x00, buf, 3), TWI_OK);
+    CHECK_EQ(twi_read(0x68, 0x00, buf, sizeof(buf)), TWI_OK);
+
+    // A NACK fails the step at once instead of waiting out the timeout
+    start = mock_cycles;
+    CHECK_EQ(twi_read(0x50, 0x00, buf, sizeof(buf)), TWI_NACK);
+    CHECK(mock_cycles - start < TWI_TIMEOUT * (F_CPU / 1000000UL) / 2);
+
+    stats_snapshot(&s);
+    CHECK_EQ(s.twi.transactions, 3);
+    CHECK_EQ(s.twi.bytes, 3 + sizeof(buf));
+    CHECK_EQ(s.twi.nacks, 1);
+    CHECK_EQ(s.twi.start_fails, 0);
+    CHECK_EQ(s.twi.restart_fails, 0);
+    CHECK_EQ(s.twi.timeouts, 0);
+}
+
+static void stats_count_twi_timeout(void) {
+    uint8_t buf[2] = {0};
+    stats_t s;
+
+    // A slave holding SCL low, the START never completes
+    stats_setup();
+    mock_twi_hung = true;
+    CHECK_EQ(twi_write(0x68, 0x00, buf, sizeof(buf)), TWI_ERROR_TIMEOUT);
+    stats_snapshot(&s);
+    CHECK_EQ(s.twi.transactions, 1);
+    CHECK_EQ(s.twi.start_fails, 0);
+    CHECK_EQ(s.twi.timeouts, 1);
+    CHECK_EQ(s.twi.bytes, 0);
+}
+
+static void stats_count_uart(void) {
+    stats_t s;
+    uint8_t b;
+
+    stats_setup();
+    uart_transmit_string((unsigned char*)"stats");
+    uart_flush();
+
+    mock_uart_rx('a');
+    b = uart_read_byte();
+    CHECK_EQ(b, 'a');
+
+    // The second byte lands on an unread first one
+    mock_uart_rx('b');
+    mock_uart_rx('c');
+    b = uart_read_byte();
+    CHECK_EQ(b, 'c');
+
+    stats_snapshot(&s);
+    CHECK_EQ(s.uart.tx_bytes, 5);
+    CHECK_EQ(s.uart.rx_bytes, 2);
+    CHECK_EQ(s.uart.overruns, 1);
+    CHECK_EQ(s.uart.frame_errors, 0);
+
+    // Interrupts off sends by polling, still counted
+    cli();
+    uart_transmit_byte('!');
+    sei();
+    stats_snapshot(&s);
+    CHECK_EQ(s.uart.tx_bytes, 6);
+}
+
+static void stats_count_adc_and_gpio(void) {
+    stats_t s;
+    uint16_t v;
+    bit_t bit;
+
+    stats_setup();
+    mock_adc_in[3] = 512;
+    adc_read(ADC3, &v);
+    adc_read(ADC3, &v);
+    cli();
+    adc_read(ADC3, &v);
+    sei();
+
+    gpio_pin_init(GPIO_B, DIR_OUTPUT, PORTB0);
+    gpio_pin_init(GPIO_C, DIR_INPUT, PINC0);
+    gpio_pin_write(GPIO_B, PORTB0, HIGH);
+    gpio_pin_write(GPIO_B, PORTB0, LOW);
+    gpio_pin_read(GPIO_C, PINC0, &bit);
+    CHECK(gpio_pin_write(GPIO_C, PINC0, HIGH) != GPIO_OK);
+    CHECK(gpio_pin_read(GPIO_B, 9, &bit) != GPIO_OK);
+
+    stats_snapshot(&s);
+    CHECK_EQ(s.adc.conversions, 3);
+    CHECK_EQ(s.adc.missed, 0);
+    CHECK_EQ(s.gpio.writes, 2);
+    CHECK_EQ(s.gpio.reads, 1);
+    CHECK_EQ(s.gpio.errors, 2);
+    CHECK(s.ms == systick_millis());
+
+    stats_reset();
+    stats_snapshot(&s);
+    CHECK_EQ(s.adc.conversions, 0);
+    CHECK_EQ(s.gpio.writes, 0);
+    CHECK_EQ(s.uart.tx_bytes, 0);
+    CHECK_EQ(s.twi.transactions, 0);
+}
+
+void test_stats(void) {
+    printf("stats\n");
+    RUN(stats_counters_saturate);
+    RUN(stats_count_twi);
+    RUN(stats_count_twi_timeout);
+    RUN(stats_count_uart);
+    RUN(stats_count_adc_and_gpio);
+}
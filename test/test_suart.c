@@ -0,0 +1,240 @@
+/***********************************************************************
+* Software UART tests against the serial line model on PC2/PC1         *
+***********************************************************************/
+
+#include "test.h"
+#include "suart.h"
+#include "uart.h"
+#include "clk.h"
+#include "tmr1.h"
+#include <string.h>
+
+#define BIT_CYCLES (F_CPU / BOARD_SUART_BAUD)
+#define FRAME_US (10UL * 1000000UL / BOARD_SUART_BAUD + 1)
+
+static void suart_setup(uint32_t host_baud) {
+    test_boot();
+    mock_serial_line(MOCK_PORT_C, 1 << PC2, MOCK_PORT_C, 1 << PC1, host_baud);
+    CHECK(suart_init());
+}
+
+// Whatever the model received so far, as a string
+static bool suart_sent(const char* s) {
+    return mock_serial_out_len == strlen(s) && memcmp(mock_serial_out, s, strlen(s)) == 0;
+}
+
+static void suart_rx_all(uint8_t* buf, uint8_t len) {
+    uint8_t i;
+    for (i = 0; i < len; i++) CHECK(suart_rx_get(&buf[i]));
+}
+
+static void suart_sends_frames(void) {
+    uart_stats_t s;
+
+    suart_setup(BOARD_SUART_BAUD);
+    suart_transmit_string((unsigned char*)"Hello, 0x55\xAA");
+    suart_flush();
+    CHECK(suart_sent("Hello, 0x55\xAA"));
+    CHECK_EQ(mock_serial_frame_errors, 0);
+    CHECK(mock_serial_skew <= BIT_CYCLES / 16);
+    CHECK(PORTC & (1 << PC2));                  /*Idles high*/
+
+    suart_stats(&s);
+    CHECK_EQ(s.tx_bytes, mock_serial_out_len);
+}
+
+static void suart_receives_frames(void) {
+    const uint8_t msg[] = {0x55, 0x00, 0xFF, 0xA5, 0x01, 0x80};
+    uint8_t got[sizeof(msg)];
+    uart_stats_t s;
+    uint8_t i;
+
+    suart_setup(BOARD_SUART_BAUD);
+    for (i = 0; i < sizeof(msg); i++) mock_serial_rx(msg[i]);
+    mock_run_us(sizeof(msg) * FRAME_US);
+    CHECK_EQ(suart_rx_available(), sizeof(msg));
+    suart_rx_all(got, sizeof(msg));
+    CHECK(memcmp(got, msg, sizeof(msg)) == 0);
+
+    suart_stats(&s);
+    CHECK_EQ(s.rx_bytes, sizeof(msg));
+    CHECK_EQ(s.frame_errors, 0);
+}
+
+// Both directions at once, each on its own compare channel
+static void suart_full_duplex(void) {
+    const char* out = "0123456789abcdef";
+    uint8_t got[16];
+    uint8_t i;
+
+    suart_setup(BOARD_SUART_BAUD);
+    for (i = 0; i < 16; i++) mock_serial_rx(0xF0 ^ i);
+    suart_transmit_string((unsigned char*)out);
+    suart_flush();
+    mock_run_us(2 * FRAME_US);
+
+    CHECK(suart_sent(out));
+    CHECK(mock_serial_skew <= BIT_CYCLES / 16);
+    CHECK_EQ(suart_rx_available(), 16);
+    suart_rx_all(got, 16);
+    for (i = 0; i < 16; i++) CHECK_EQ(got[i], 0xF0 ^ i);
+}
+
+// A sender 3% off either way is still sampled inside every bit
+static void suart_takes_baud_error(void) {
+    uint8_t b = 0, i;
+
+    for (i = 0; i < 2; i++) {
+        suart_setup(i ? BOARD_SUART_BAUD * 97 / 100 : BOARD_SUART_BAUD * 103 / 100);
+        mock_serial_rx(0x5A);
+        mock_serial_rx(0x0F);
+        mock_run_us(3 * FRAME_US);
+        CHECK(suart_rx_get(&b));
+        CHECK_EQ(b, 0x5A);
+        CHECK(suart_rx_get(&b));
+        CHECK_EQ(b, 0x0F);
+    }
+}
+
+// A break reads as a zero byte with a low stop bit
+static void suart_counts_frame_errors(void) {
+    uart_stats_t s;
+    uint8_t b = 0xFF;
+
+    suart_setup(BOARD_SUART_BAUD);
+    mock_pin_drive(MOCK_PORT_C, 1 << PC1, 0);
+    mock_run_us(2 * FRAME_US);
+    mock_pin_drive(MOCK_PORT_C, 1 << PC1, 1 << PC1);
+    mock_run_us(FRAME_US);
+
+    CHECK(suart_rx_get(&b));
+    CHECK_EQ(b, 0);
+    CHECK(!suart_rx_get(&b));
+    suart_stats(&s);
+    CHECK_EQ(s.rx_bytes, 1);
+    CHECK_EQ(s.frame_errors, 1);
+}
+
+// The ring overflows into rx_dropped, the oldest bytes are kept
+static void suart_drops_when_full(void) {
+    uart_stats_t s;
+    uint8_t b = 0, i;
+
+    suart_setup(BOARD_SUART_BAUD);
+    for (i = 0; i < SUART_RX_SIZE + 2; i++) mock_serial_rx(i);
+    mock_run_us((SUART_RX_SIZE + 2) * FRAME_US);
+    CHECK_EQ(suart_rx_available(), SUART_RX_SIZE - 1);
+    CHECK(suart_rx_get(&b));
+    CHECK_EQ(b, 0);
+    suart_stats(&s);
+    CHECK_EQ(s.rx_dropped, 3);
+}
+
+// The USART and the system tick keep interrupting, the frames still hold
+static void suart_beside_busy_usart(void) {
+    const char* out = "software uart under load";
+    uint8_t got[8];
+    uint8_t i;
+
+    suart_setup(BOARD_SUART_BAUD);
+    uart_init(BOTH, true, NONE);
+    for (i = 0; i < 8; i++) mock_serial_rx(0x11 * i);
+    for (i = 0; i < 4; i++) uart_transmit_string((unsigned char*)"0123456789ABCDEF");
+    suart_transmit_string((unsigned char*)out);
+    suart_flush();
+    uart_flush();
+    mock_run_us(FRAME_US);
+
+    CHECK(suart_sent(out));
+    CHECK_EQ(mock_serial_frame_errors, 0);
+    CHECK(mock_serial_skew <= BIT_CYCLES / 8);
+    CHECK_EQ(mock_uart_out_len, 64);
+    suart_rx_all(got, 8);
+    for (i = 0; i < 8; i++) CHECK_EQ(got[i], 0x11 * i);
+}
+
+// More than the ring holds with interrupts masked, sent by polling
+static void suart_sends_with_interrupts_off(void) {
+    char out[SUART_TX_SIZE + 9];
+
+    suart_setup(BOARD_SUART_BAUD);
+    memset(out, 'p', sizeof(out) - 1);
+    out[sizeof(out) - 1] = '\0';
+    cli();
+    suart_transmit_string((unsigned char*)out);
+    sei();
+    suart_flush();
+    CHECK(suart_sent(out));
+    CHECK_EQ(mock_serial_frame_errors, 0);
+}
+
+// Half the clock still leaves BOARD_SUART_BIT_MIN cycles, an eighth not
+static void suart_follows_clock(void) {
+    const uint8_t b = 0xC3;
+    uint8_t got = 0;
+
+    suart_setup(BOARD_SUART_BAUD);
+    CHECK_EQ(clk_set(CLK_DIV8), CLK_SUART_BAUD);
+    CHECK_EQ(clk_set(CLK_DIV2), CLK_OK);
+
+    suart_transmit_byte(b);
+    mock_serial_rx(0x3C);
+    suart_flush();
+    mock_run_us(2 * FRAME_US);
+    CHECK_EQ(mock_serial_out_len, 1);
+    CHECK_EQ(mock_serial_out[0], b);
+    CHECK(suart_rx_get(&got));
+    CHECK_EQ(got, 0x3C);
+    CHECK_EQ(clk_set(CLK_DIV1), CLK_OK);
+}
+
+// Rising edges 10 us apart, fast enough for tmr1's gated range
+static void suart_icp_edges(void) {
+    uint8_t i;
+
+    for (i = 0; i < 4; i++) {
+        mock_icp_edge(true);
+        mock_run_us(10);
+    }
+}
+
+// Timer2 stays with whichever of the two took it first
+static void suart_shares_timer2_with_gate(void) {
+    test_boot();
+    mock_serial_line(MOCK_PORT_C, 1 << PC2, MOCK_PORT_C, 1 << PC1, BOARD_SUART_BAUD);
+    suart_stop();
+    tmr1_icp_init(TMR1_ICP_PERIOD, TMR1_EDGE_RISING, false);
+    suart_icp_edges();
+    CHECK(tmr1_icp_gated());
+    CHECK(!suart_init());
+    CHECK(TIMSK2 & (1 << TOIE2));
+    CHECK_EQ(TIMSK2 & ((1 << OCIE2A) | (1 << OCIE2B)), 0);
+
+    tmr1_icp_stop();
+    CHECK(suart_init());
+    tmr1_icp_init(TMR1_ICP_PERIOD, TMR1_EDGE_RISING, false);
+    suart_icp_edges();
+    CHECK(!tmr1_icp_gated());
+    CHECK(tmr1_icp_period() >= 10UL * (F_CPU / 1000000UL));
+    CHECK(tmr1_icp_period() <= 10UL * (F_CPU / 1000000UL) + 32);
+
+    suart_transmit_string((unsigned char*)"shared");
+    suart_flush();
+    CHECK(suart_sent("shared"));
+    tmr1_icp_stop();
+    tmr1_stop();
+}
+
+void test_suart(void) {
+    printf("suart\n");
+    RUN(suart_sends_frames);
+    RUN(suart_receives_frames);
+    RUN(suart_full_duplex);
+    RUN(suart_takes_baud_error);
+    RUN(suart_counts_frame_errors);
+    RUN(suart_drops_when_full);
+    RUN(suart_beside_busy_usart);
+    RUN(suart_sends_with_interrupts_off);
+    RUN(suart_follows_clock);
+    RUN(suart_shares_timer2_with_gate);
+}
@@ -0,0 +1,111 @@
+/***********************************************************************
+* TWI driver tests against a DS3231 shaped register file slave         *
+***********************************************************************/
+
+#include "test.h"
+#include "twi_hal.h"
+#include <string.h>
+
+#define RTC_ADDR 0x68
+
+static mock_twi_slave_t rtc;
+
+static void twi_setup(void) {
+    test_boot();
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.addr = RTC_ADDR;
+    mock_twi_attach(&rtc);
+    twi_init(false);
+}
+
+static uint8_t bcd(uint8_t b) {
+    return (b >> 4) * 10 + (b & 0x0F);
+}
+
+static void twi_write_then_read_back(void) {
+    uint8_t set[7] = {0x50, 0x46, 0x20, 0x07, 0x16, 0x07, 0x23};
+    uint8_t got[7] = {0};
+
+    twi_setup();
+    CHECK_EQ(twi_write(RTC_ADDR, 0x00, set, sizeof(set)), TWI_OK);
+    CHECK(memcmp(rtc.reg, set, sizeof(set)) == 0);
+
+    CHECK_EQ(twi_read(RTC_ADDR, 0x00, got, sizeof(got)), TWI_OK);
+    CHECK(memcmp(got, set, sizeof(set)) == 0);
+
+    // Seconds, minutes, hours, day, date, month, year
+    CHECK_EQ(bcd(got[0]), 50);
+    CHECK_EQ(bcd(got[1]), 46);
+    CHECK_EQ(bcd(got[2]), 20);
+    CHECK_EQ(bcd(got[4]), 16);
+    CHECK_EQ(bcd(got[6]), 23);
+}
+
+static void twi_read_walks_master_states(void) {
+    const uint8_t expect[] = {0x08, 0x18, 0x28, 0x10, 0x40, 0x50, 0x50, 0x58};
+    uint8_t got[3];
+
+    twi_setup();
+    rtc.reg[0x10] = 0xA1;
+    rtc.reg[0x11] = 0xA2;
+    rtc.reg[0x12] = 0xA3;
+
+    CHECK_EQ(twi_read(RTC_ADDR, 0x10, got, sizeof(got)), TWI_OK);
+    CHECK_EQ(got[0], 0xA1);
+    CHECK_EQ(got[2], 0xA3);
+    CHECK_EQ(mock_twi_log_len, sizeof(expect));
+    CHECK(memcmp(mock_twi_log, expect, sizeof(expect)) == 0);
+}
+
+static void twi_absent_slave_nacks(void) {
+    uint8_t got[2];
+
+    twi_setup();
+    CHECK_EQ(twi_read(0x50, 0x00, got, sizeof(got)), TWI_NACK);
+    CHECK_EQ(mock_twi_log[1], TWIT_ADDR_NACK);
+    CHECK(!(TWCR & (1 << TWSTO)));
+}
+
+static void twi_data_nack_stops_write(void) {
+    uint8_t set[4] = {1, 2, 3, 4};
+
+    twi_setup();
+    rtc.nack_after = 3;     /*Pointer, then two data bytes*/
+    CHECK_EQ(twi_write(RTC_ADDR, 0x00, set, sizeof(set)), TWI_NACK);
+    CHECK_EQ(rtc.reg[0], 1);
+    CHECK_EQ(rtc.reg[1], 2);
+    CHECK_EQ(rtc.reg[2], 0);
+}
+
+static void twi_powered_down_after_transfer(void) {
+    uint8_t b = 0;
+
+    twi_setup();
+    CHECK(PRR & (1 << PRTWI));
+    twi_write(RTC_ADDR, 0x00, &b, 1);
+    CHECK(PRR & (1 << PRTWI));
+}
+
+// Set up again on the way out of PRR, whatever the registers were left at
+static void twi_reloaded_after_power_down(void) {
+    uint8_t b = 0x42;
+
+    twi_setup();
+    TWBR = 0xFF;
+    TWSR = 0x03;
+    TWCR = 0;
+    CHECK_EQ(twi_write(RTC_ADDR, 0x00, &b, 1), TWI_OK);
+    CHECK_EQ(rtc.reg[0], 0x42);
+    CHECK_EQ(TWBR, BOARD_TWBR);
+    CHECK_EQ(TWSR & 0x03, 0);
+}
+
+void test_twi(void) {
+    printf("twi\n");
+    RUN(twi_write_then_read_back);
+    RUN(twi_read_walks_master_states);
+    RUN(twi_absent_slave_nacks);
+    RUN(twi_data_nack_stops_write);
+    RUN(twi_powered_down_after_transfer);
+    RUN(twi_reloaded_after_power_down);
+}
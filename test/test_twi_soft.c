@@ -0,0 +1,183 @@
+/***********************************************************************
+* Software I2C master tests against the bit level slave model          *
+***********************************************************************/
+
+#include "test.h"
+#include "twi_soft.h"
+#include "twi_hal.h"
+#include <string.h>
+
+#define RTC_ADDR 0x68
+
+static mock_twi_slave_t rtc;
+static twi_soft_t bus;
+
+// SDA on PD4, SCL on PD5
+static void soft_setup(void) {
+    test_boot();
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.addr = RTC_ADDR;
+    mock_i2c_bus(MOCK_PORT_D, 1 << PD4, MOCK_PORT_D, 1 << PD5);
+    mock_i2c_attach(&rtc);
+    CHECK_EQ(twi_soft_init(&bus, GPIO_D, 4, GPIO_D, 5, 0), GPIO_OK);
+}
+
+static void soft_write_then_read_back(void) {
+    uint8_t set[5] = {0x50, 0x46, 0x20, 0x07, 0x16};
+    uint8_t got[5] = {0};
+    twi_stats_t s;
+
+    soft_setup();
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x02, set, sizeof(set)), TWI_OK);
+    CHECK(memcmp(&rtc.reg[2], set, sizeof(set)) == 0);
+
+    CHECK_EQ(twi_soft_read(&bus, RTC_ADDR, 0x02, got, sizeof(got)), TWI_OK);
+    CHECK(memcmp(got, set, sizeof(set)) == 0);
+    CHECK_EQ(mock_i2c_starts, 3);               /*The read restarts once*/
+    CHECK_EQ(mock_i2c_stops, 2);
+
+    // Both lines released between transfers
+    CHECK(!(DDRD & ((1 << PD4) | (1 << PD5))));
+    CHECK(!(PORTD & ((1 << PD4) | (1 << PD5))));
+
+    twi_soft_stats(&bus, &s);
+    CHECK_EQ(s.transactions, 2);
+    CHECK_EQ(s.bytes, 10);
+}
+
+static void soft_absent_slave_nacks(void) {
+    uint8_t got[2];
+    twi_stats_t s;
+
+    soft_setup();
+    CHECK_EQ(twi_soft_read(&bus, 0x50, 0x00, got, sizeof(got)), TWI_NACK);
+    CHECK_EQ(mock_i2c_stops, 1);
+    twi_soft_stats(&bus, &s);
+    CHECK_EQ(s.nacks, 1);
+    CHECK_EQ(s.bytes, 0);
+}
+
+static void soft_data_nack_stops_write(void) {
+    uint8_t set[4] = {1, 2, 3, 4};
+
+    soft_setup();
+    rtc.nack_after = 3;     /*Pointer, then two data bytes*/
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x00, set, sizeof(set)), TWI_NACK);
+    CHECK_EQ(rtc.reg[0], 1);
+    CHECK_EQ(rtc.reg[1], 2);
+    CHECK_EQ(rtc.reg[2], 0);
+    CHECK_EQ(mock_i2c_stops, 1);
+}
+
+// SCL held low after every ACK, the master waits for it
+static void soft_honors_clock_stretching(void) {
+    uint8_t set[3] = {0xA1, 0xA2, 0xA3};
+    uint8_t got[3] = {0};
+    twi_stats_t s;
+    uint64_t start;
+
+    soft_setup();
+    mock_i2c_stretch_us = 200;
+    start = mock_cycles;
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x10, set, sizeof(set)), TWI_OK);
+    CHECK(mock_cycles - start >= 5UL * 200 * (F_CPU / 1000000UL));
+    CHECK_EQ(twi_soft_read(&bus, RTC_ADDR, 0x10, got, sizeof(got)), TWI_OK);
+    CHECK(memcmp(got, set, sizeof(set)) == 0);
+    twi_soft_stats(&bus, &s);
+    CHECK_EQ(s.timeouts, 0);
+}
+
+static void soft_stretch_times_out(void) {
+    uint8_t b = 0;
+    twi_stats_t s;
+
+    soft_setup();
+    mock_i2c_stretch_us = TWI_TIMEOUT * 3;
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x00, &b, 1), TWI_ERROR_TIMEOUT);
+    twi_soft_stats(&bus, &s);
+    CHECK_EQ(s.transactions, 1);
+    CHECK_EQ(s.timeouts, 1);
+    CHECK_EQ(s.nacks, 0);
+
+    // The bus is usable again once the slave lets go
+    mock_i2c_stretch_us = 0;
+    mock_run_us(TWI_TIMEOUT * 3);
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x00, &b, 1), TWI_OK);
+}
+
+// A slave left holding SDA mid-read is clocked free before the START
+static void soft_recovers_stuck_sda(void) {
+    uint8_t b = 0x5A;
+
+    soft_setup();
+    mock_i2c_jam();
+    CHECK(!(PIND & (1 << PD4)));
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x20, &b, 1), TWI_OK);
+    CHECK_EQ(rtc.reg[0x20], 0x5A);
+    CHECK(PIND & (1 << PD4));
+    CHECK_EQ(mock_i2c_stops, 2);                /*Recovery, then the write*/
+}
+
+// No SCL half period is shorter than hz allows
+static void soft_keeps_bit_rate(void) {
+    uint8_t got[4];
+    uint64_t start;
+
+    soft_setup();
+    CHECK_EQ(twi_soft_init(&bus, GPIO_D, 4, GPIO_D, 5, 20000), GPIO_OK);
+    start = mock_cycles;
+    CHECK_EQ(twi_soft_read(&bus, RTC_ADDR, 0x00, got, sizeof(got)), TWI_OK);
+    CHECK(mock_i2c_min_half >= (F_CPU / 20000UL) / 2);
+
+    // 9 bits a byte, SLA+W, pointer, SLA+R and four data bytes
+    CHECK(mock_cycles - start >= 7UL * 9 * (F_CPU / 20000UL));
+}
+
+static void soft_rejects_bad_pins(void) {
+    soft_setup();
+    CHECK_EQ(twi_soft_init(&bus, 3, 0, GPIO_D, 5, 0), GPIO_INVALID_PORT);
+    CHECK_EQ(twi_soft_init(&bus, GPIO_D, 8, GPIO_D, 5, 0), GPIO_INVALID_PIN);
+    CHECK_EQ(twi_soft_init(&bus, GPIO_C, 4, GPIO_C, 6, 0), GPIO_INVALID_PIN);
+    CHECK_EQ(twi_soft_init(&bus, GPIO_D, 5, GPIO_D, 5, 0), GPIO_INVALID_PIN);
+}
+
+// Both buses in turn, each with its own slave and counters
+static void soft_beside_hardware_twi(void) {
+    mock_twi_slave_t other;
+    uint8_t b = 0x33, got = 0;
+    twi_stats_t s;
+
+    soft_setup();
+    memset(&other, 0, sizeof(other));
+    other.addr = 0x50;
+    mock_twi_attach(&other);
+    twi_init(false);
+    twi_stats_reset();
+
+    CHECK_EQ(twi_write(0x50, 0x01, &b, 1), TWI_OK);
+    CHECK_EQ(twi_soft_write(&bus, RTC_ADDR, 0x01, &b, 1), TWI_OK);
+    CHECK_EQ(twi_soft_read(&bus, 0x50, 0x01, &got, 1), TWI_NACK);
+    CHECK_EQ(twi_read(RTC_ADDR, 0x01, &got, 1), TWI_NACK);
+    CHECK_EQ(other.reg[1], 0x33);
+    CHECK_EQ(rtc.reg[1], 0x33);
+
+    twi_stats(&s);
+    CHECK_EQ(s.transactions, 2);
+    CHECK_EQ(s.nacks, 1);
+    twi_soft_stats(&bus, &s);
+    CHECK_EQ(s.transactions, 2);
+    CHECK_EQ(s.nacks, 1);
+}
+
+void test_twi_soft(void) {
+    printf("twi_soft\n");
+    RUN(soft_write_then_read_back);
+    RUN(soft_absent_slave_nacks);
+    RUN(soft_data_nack_stops_write);
+    RUN(soft_honors_clock_stretching);
+    RUN(soft_stretch_times_out);
+    RUN(soft_recovers_stuck_sda);
+    RUN(soft_keeps_bit_rate);
+    RUN(soft_rejects_bad_pins);
+    RUN(soft_beside_hardware_twi);
+}
@@ -0,0 +1,174 @@
+/***********************************************************************
+* UART driver tests                                                    *
+***********************************************************************/
+
+#include "test.h"
+#include "uart.h"
+#include <string.h>
+
+// 10 bit frame at the board's UBRR and samples per bit
+#define FRAME_CYCLES (10UL * BOARD_UART_SAMPLES * (BOARD_UBRR + 1))
+
+static void uart_string_goes_out_in_order(void) {
+    const char* msg = "hello, ll oo\r\n";
+
+    test_boot();
+    uart_init(TX, false, NONE);
+    uart_transmit_string((unsigned char*)msg);
+    uart_flush();
+
+    CHECK_EQ(mock_uart_out_len, strlen(msg));
+    CHECK(memcmp(mock_uart_out, msg, strlen(msg)) == 0);
+}
+
+static void uart_runs_at_baud_rate(void) {
+    uint64_t start;
+
+    test_boot();
+    uart_init(TX, false, NONE);
+    start = mock_cycles;
+    uart_transmit_string((unsigned char*)"0123456789");
+    uart_flush();
+
+    CHECK(mock_cycles - start >= 10 * FRAME_CYCLES);
+    CHECK(mock_cycles - start < 11 * FRAME_CYCLES);
+}
+
+// More than the ring holds, the writer has to sleep for space
+static void uart_blocks_when_ring_full(void) {
+    uint16_t i;
+
+    test_boot();
+    uart_init(TX, false, NONE);
+    for (i = 0; i < 3 * UART_TX_SIZE; i++) uart_transmit_byte('a' + (i % 26));
+    uart_flush();
+
+    CHECK_EQ(mock_uart_out_len, 3 * UART_TX_SIZE);
+    for (i = 0; i < 3 * UART_TX_SIZE; i++) CHECK_EQ(mock_uart_out[i], 'a' + (i % 26));
+}
+
+static void uart_powered_down_between_bursts(void) {
+    test_boot();
+    uart_init(TX, false, NONE);
+    CHECK(PRR & (1 << PRUSART0));
+
+    uart_transmit_byte('x');
+    CHECK(!(PRR & (1 << PRUSART0)));
+    uart_flush();
+    CHECK(PRR & (1 << PRUSART0));
+}
+
+// A byte queued around the end of the last frame, while TXC is due, has
+// to keep the USART powered until it is out too
+static void uart_queued_as_txc_fires(void) {
+    uint32_t at;
+
+    for (at = FRAME_CYCLES - 64; at < FRAME_CYCLES + 64; at += 4) {
+        mock_reset();
+        test_boot();
+        uart_init(TX, false, NONE);
+        uart_transmit_byte('a');
+        mock_run(at);
+        uart_transmit_byte('b');
+        uart_flush();
+
+        CHECK_EQ(mock_uart_out_len, 2);
+        CHECK(memcmp(mock_uart_out, "ab", 2) == 0);
+        CHECK(PRR & (1 << PRUSART0));
+    }
+}
+
+// Set up again on the way out of PRR, whatever the registers were left at
+static void uart_reloaded_after_power_down(void) {
+    test_boot();
+    uart_init(TX, false, NONE);
+    UBRR0 = 0;
+    UCSR0B = 0;
+    UCSR0C = 0;
+    uart_transmit_string((unsigned char*)"up");
+    uart_flush();
+
+    CHECK_EQ(mock_uart_out_len, 2);
+    CHECK(memcmp(mock_uart_out, "up", 2) == 0);
+    CHECK_EQ(UBRR0, BOARD_UBRR);
+    CHECK(PRR & (1 << PRUSART0));
+}
+
+// Nothing drains the ring with interrupts masked, bytes are polled out
+static void uart_polls_with_interrupts_masked(void) {
+    test_boot();
+    uart_init(TX, false, NONE);
+    cli();
+    uart_transmit_string((unsigned char*)"ok");
+    sei();
+    uart_flush();
+
+    CHECK_EQ(mock_uart_out_len, 2);
+    CHECK(memcmp(mock_uart_out, "ok", 2) == 0);
+}
+
+// A frame time apart, as a host would send them
+static void uart_rx_feed(const char* s) {
+    while (*s) {
+        mock_uart_rx((uint8_t)*s++);
+        mock_run_us(FRAME_CYCLES / (F_CPU / 1000000UL) + 1);
+    }
+}
+
+// The ISR empties UDR0 before the next byte lands, nothing overruns
+static void uart_receives_into_ring(void) {
+    uint8_t buf[5];
+    uint8_t b;
+    uart_stats_t s;
+
+    test_boot();
+    uart_init(BOTH, true, NONE);
+    CHECK(UCSR0B & (1 << RXCIE0));
+    CHECK(!uart_rx_get(&b));
+
+    uart_rx_feed("hello");
+    CHECK_EQ(uart_rx_available(), 5);
+    uart_read_string(buf, sizeof(buf));
+    CHECK(memcmp(buf, "hello", 5) == 0);
+    CHECK_EQ(uart_rx_available(), 0);
+
+    uart_stats(&s);
+    CHECK_EQ(s.rx_bytes, 5);
+    CHECK_EQ(s.overruns, 0);
+    CHECK_EQ(s.rx_dropped, 0);
+}
+
+// A full ring loses the new byte, the oldest ones are kept
+static void uart_rx_ring_full_drops(void) {
+    uint8_t i, b;
+    uart_stats_t s;
+
+    test_boot();
+    uart_init(RX, true, NONE);
+    for (i = 0; i < UART_RX_SIZE + 2; i++) {
+        mock_uart_rx(i);
+        mock_run_us(FRAME_CYCLES / (F_CPU / 1000000UL) + 1);
+    }
+    CHECK_EQ(uart_rx_available(), UART_RX_SIZE - 1);
+
+    uart_stats(&s);
+    CHECK_EQ(s.rx_bytes, UART_RX_SIZE + 2);
+    CHECK_EQ(s.rx_dropped, 3);
+    for (i = 0; i < UART_RX_SIZE - 1; i++) {
+        CHECK(uart_rx_get(&b));
+        CHECK_EQ(b, i);
+    }
+}
+
+void test_uart(void) {
+    printf("uart\n");
+    RUN(uart_string_goes_out_in_order);
+    RUN(uart_runs_at_baud_rate);
+    RUN(uart_blocks_when_ring_full);
+    RUN(uart_powered_down_between_bursts);
+    RUN(uart_queued_as_txc_fires);
+    RUN(uart_reloaded_after_power_down);
+    RUN(uart_polls_with_interrupts_masked);
+    RUN(uart_receives_into_ring);
+    RUN(uart_rx_ring_full_drops);
+}
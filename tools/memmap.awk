@@ -0,0 +1,49 @@
+# Static SRAM per module from a GNU ld map file
+# Usage: awk [-v budget=N -v stack=N -v margin=N] -f tools/memmap.awk build/x.map
+#
+# Sums the .data, .bss and .noinit input sections by the object they came
+# from. With a budget, exits 1 when static use plus the stack peak plus the
+# margin does not fit.
+
+function hex(s,    i, v) {
+    v = 0
+    s = tolower(s)
+    sub(/^0x/, "", s)
+    for (i = 1; i <= length(s); i++) v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    return v
+}
+
+function add(size, obj,    n) {
+    n = hex(size)
+    if (n == 0) return
+    sub(/^.*\//, "", obj)
+    if (!(obj in ram)) order[++mods] = obj
+    ram[obj] += n
+    total += n
+}
+
+/^Linker script and memory map/ { inmap = 1; next }
+!inmap { next }
+
+# Output section header, in column 0
+/^[._A-Za-z]/ { out = $1; wrapped = 0; next }
+out != ".data" && out != ".bss" && out != ".noinit" { next }
+
+# Long input section names go on a line of their own
+/^ [._A-Za-z*]/ && NF == 1 { wrapped = 1; next }
+wrapped && $1 ~ /^0x/ && $2 ~ /^0x/ { add($2, $3); wrapped = 0; next }
+/^ [._A-Za-z]/ && $2 ~ /^0x/ && $3 ~ /^0x/ { add($3, $4); next }
+/^ \*fill\*/ { add($3, "(fill)"); next }
+
+END {
+    for (i = 1; i <= mods; i++) printf "%-24s %6d\n", order[i], ram[order[i]]
+    printf "%-24s %6d\n", "static", total
+    if (budget == "") exit 0
+    printf "%-24s %6d\n", "stack peak", stack
+    printf "%-24s %6d\n", "margin", margin
+    printf "%-24s %6d of %d\n", "total", total + stack + margin, budget
+    if (total + stack + margin > budget) {
+        print "SRAM over budget" > "/dev/stderr"
+        exit 1
+    }
+}